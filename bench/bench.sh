@@ -0,0 +1,127 @@
+#!/bin/bash
+#
+# bench.sh - time the crawler against a local synthetic site
+#
+# usage: bash bench.sh [crawler options]
+#
+# Starts siteserver, crawls its site with ../crawler/crawler into a
+# temporary pageDirectory, and reports the crawl's throughput and the
+# server's response-time percentiles.  The crawl runs with -d 0 -c 0
+# unless the options given say otherwise; try -j 8 or -e 64.
+#
+# The site and the crawl are set by these environment variables
+# (defaults in brackets):
+#   PORT     port to serve on [8088]
+#   PAGES    pages in the site [1000]
+#   FANOUT   links on each page [10]
+#   SIZE     bytes of text on each page [4096]
+#   LATENCY  milliseconds the server waits before each response [0]
+#   CAPACITY requests the server answers at once; it turns away any more
+#            with 503 [0: no limit]
+#   HOSTS    hosts (ports, from PORT up) the site is spread over [1]
+#   KBPS     kilobytes per second of the one link every body is sent over
+#            [0: no limit]
+#   GZIP     if 1, the server gzips pages for a client that accepts it [0]
+#   DEPTH    the crawl's maxDepth [3]
+#   RECORD   archive file to record the crawl's responses into (-a) [none]
+#   REPLAY   archive file to replay (-p) instead of starting the server;
+#            only the crawl's time and pages saved are reported [none]
+#
+# CS50 TSE, 2024
+
+PORT=${PORT:-8088}
+PAGES=${PAGES:-1000}
+FANOUT=${FANOUT:-10}
+SIZE=${SIZE:-4096}
+LATENCY=${LATENCY:-0}
+CAPACITY=${CAPACITY:-0}
+HOSTS=${HOSTS:-1}
+KBPS=${KBPS:-0}
+GZIP=${GZIP:-0}
+DEPTH=${DEPTH:-3}
+SITE=http://127.0.0.1:$PORT/tse/
+# the internal prefix must cover every host
+PREFIX=$SITE
+if [ "$HOSTS" -gt 1 ]; then
+  PREFIX=http://127.0.0.1:
+fi
+
+dir=$(mktemp -d) || exit 1
+mkdir "$dir/pages"
+trap 'rm -rf "$dir"' EXIT
+
+# the pages saved: the entries in the docstore's table, 16 bytes each
+savedPages() {
+  if [ -f "$1/.docstore" ]; then
+    echo $(( $(wc -c < "$1/.docstore") / 16 ))
+  else
+    echo 0
+  fi
+}
+
+# replaying needs no server: crawl the archive, and time that alone
+if [ -n "$REPLAY" ]; then
+  start=$(date +%s.%N)
+  ../crawler/crawler -d 0 -c 0 "$@" -p "$REPLAY" -s "$PREFIX" "${SITE}0.html" "$dir/pages" "$DEPTH" > "$dir/log"
+  status=$?
+  end=$(date +%s.%N)
+  saved=$(savedPages "$dir/pages")
+  echo "replay:  $REPLAY"
+  echo "crawl:   crawler -d 0 -c 0 $* (maxDepth $DEPTH), exit status $status"
+  awk -v start="$start" -v end="$end" -v saved="$saved" 'BEGIN {
+    secs = end - start
+    printf "time:    %.3f s, %d pages saved\n", secs, saved
+    printf "rate:    %.1f pages/s\n", saved / secs
+  }'
+  exit $status
+fi
+if [ -n "$RECORD" ]; then
+  set -- "$@" -a "$RECORD"
+fi
+gzip=
+if [ "$GZIP" = 1 ]; then
+  gzip=-z
+fi
+
+# start the server, and wait until it listens
+./siteserver -p "$PORT" -n "$PAGES" -f "$FANOUT" -s "$SIZE" -l "$LATENCY" -k "$CAPACITY" -H "$HOSTS" -b "$KBPS" $gzip \
+    > "$dir/stats" 2> "$dir/server.err" &
+server=$!
+for i in $(seq 100); do
+  if (exec 3<> "/dev/tcp/127.0.0.1/$PORT") 2> /dev/null; then
+    break
+  fi
+  if ! kill -0 $server 2> /dev/null; then
+    cat >&2 "$dir/server.err"
+    exit 2
+  fi
+  sleep 0.1
+done
+
+# crawl it
+start=$(date +%s.%N)
+../crawler/crawler -d 0 -c 0 "$@" -s "$PREFIX" "${SITE}0.html" "$dir/pages" "$DEPTH" > "$dir/log"
+status=$?
+end=$(date +%s.%N)
+
+# the server prints its stats as it exits
+kill -TERM $server
+wait $server
+saved=$(savedPages "$dir/pages")
+
+echo "site:    $PAGES pages, fanout $FANOUT, $SIZE bytes, ${LATENCY} ms latency, capacity $CAPACITY, $HOSTS hosts, $KBPS KB/s, gzip $GZIP"
+echo "crawl:   crawler -d 0 -c 0 $* (maxDepth $DEPTH), exit status $status"
+awk -v start="$start" -v end="$end" -v saved="$saved" '
+  { stat[$1] = $2; if ($1 == "latencyMs") { p90 = $3; p99 = $4; max = $5 } }
+  END {
+    secs = end - start
+    printf "time:    %.3f s, %d pages saved\n", secs, saved
+    printf "fetched: %d pages (%d not modified, %d not found, %d overloaded), %d bytes\n",
+           stat["pages"], stat["notModified"], stat["notFound"], stat["overloaded"],
+           stat["bytes"]
+    printf "rate:    %.1f pages/s, %.2f MB/s\n",
+           stat["pages"] / secs, stat["bytes"] / secs / 1e6
+    printf "latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+           stat["latencyMs"], p90, p99, max
+  }' "$dir/stats"
+exit $status
@@ -0,0 +1,701 @@
+/*
+ * siteserver.c - a local HTTP server for a generated test site
+ *
+ * usage: ./siteserver [-p port] [-n pages] [-f fanout] [-s pageBytes]
+ *                     [-l latencyMs] [-k capacity] [-H hosts] [-b kbps] [-z] [-c] [-D]
+ *
+ * Serves pages /tse/0.html to /tse/<pages-1>.html on 127.0.0.1:port, so
+ * the crawler can be run, and timed, without the CS50 server.  Every page
+ * is made up on request, the same way each time: about pageBytes of words
+ * and fanout links.  Page i links to pages fanout*i+1 to fanout*i+fanout
+ * (a tree rooted at 0.html, so every page can be reached) and, past the
+ * end of the site, to pages chosen by a hash of i, so the crawler meets
+ * URLs it has seen before.  Each response waits latencyMs first, as if
+ * the server were far away.  With -k, at most 'capacity' requests are
+ * answered at once; any more are turned away at once with 503 Service
+ * Unavailable, as an overloaded server would.
+ *
+ * With -H, the site is spread over 'hosts' hosts: the server listens on
+ * ports port to port+hosts-1, page i belongs to the one at port+(i mod
+ * hosts), and links to it name that host in full.  (Every port serves
+ * every page, so only the links tell the hosts apart.)
+ *
+ * With -b, every body crosses one shared link of 'kbps' kilobytes per
+ * second: a response waits for the bodies ahead of it, then for the time
+ * its own takes, as if the crawler were at the end of a slow line.  With
+ * -z, pages go gzip-coded to any client that accepts gzip, so the bytes
+ * sent, and that wait, are those of the coded page.  With -c, pages go
+ * with chunked transfer-coding rather than a Content-Length, in chunks
+ * of many sizes, from 1 byte up.  With -D, every link has a twin that
+ * ends in "?copy", and /tse/<i>.html?copy is served as /tse/<i>.html
+ * is, so the crawler meets the same page under two URLs.
+ *
+ * Pages carry an ETag, and a request with a matching If-None-Match is
+ * answered 304, so re-crawls can be timed too.  Connections are kept
+ * alive unless the client asks otherwise; each is served by a thread of
+ * its own.
+ *
+ * On SIGINT or SIGTERM the server prints what it served, and the
+ * percentiles of the time it took to answer each request (from the end
+ * of the request to the end of the response), then exits:
+ *
+ *     connections <n>
+ *     requests <n>
+ *     pages <n>
+ *     notModified <n>
+ *     notFound <n>
+ *     overloaded <n>
+ *     bytes <n>
+ *     latencyMs <p50> <p90> <p99> <max>
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // getopt, sigaction, clock_gettime, strncasecmp
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+/**************** file-local types ****************/
+/* the site to serve, from the command line */
+typedef struct site {
+  int port;
+  long pages;
+  int fanout;
+  long pageBytes;
+  long latencyMs;
+  long capacity;            // requests answered at once (0: any number)
+  int hosts;                // ports the site is spread over
+  long kbps;                // kilobytes per second of the link (0: no limit)
+  bool gzip;                // gzip pages for clients that accept it
+  bool chunked;             // send pages chunked
+  bool copies;              // link, and serve, each page again with ?copy
+} site_t;
+
+/* what the server has served; guarded by statsLock */
+typedef struct stats {
+  long connections;         // accepted
+  long requests, pages, notModified, notFound, overloaded;
+  long long bytes;
+  double* latency;          // ms to answer each request
+  long numLatency, maxLatency;
+} stats_t;
+
+/**************** file-local constants ****************/
+static const int MAX_PORT = 65535;
+static const long MAX_PAGES = 100000000;
+static const int MAX_FANOUT = 1000;
+static const long MAX_PAGE_BYTES = 64L * 1024 * 1024;
+static const long MAX_LATENCY = 60000;
+static const long MAX_CAPACITY = 100000;
+static const int MAX_HOSTS = 256;
+static const long MAX_KBPS = 10000000;
+static const size_t MAX_REQUEST = 16384;    // longest request header we take
+static const int IDLE_TIMEOUT = 30;         // seconds a kept-alive connection may idle
+static const size_t CHUNKS[] = { 1, 7, 100, 1000, 4096 };   // chunk sizes, in turn
+static const int NUM_CHUNKS = sizeof(CHUNKS) / sizeof(CHUNKS[0]);
+
+static const char* WORDS[] = {
+  "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+  "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa",
+  "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey",
+  "xray", "yankee", "zulu", "search", "engine", "crawler", "indexer",
+  "querier", "page", "link", "word", "document", "dartmouth", "computer",
+  "science", "network", "socket", "thread", "memory", "latency", "queue",
+};
+static const int NUM_WORDS = sizeof(WORDS) / sizeof(WORDS[0]);
+
+/**************** global variables ****************/
+static site_t site = { 8088, 1000, 10, 4096, 0, 0, 1, 0, false, false, false };
+static stats_t stats;
+static long answering = 0;  // requests being answered; guarded by statsLock
+static double linkFree = 0; // when the link has sent every body; guarded by statsLock
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t stopping = 0;
+
+/**************** local functions ****************/
+static void parseArgs(const int argc, char* argv[]);
+static int listenOn(const int port);
+static long parseNumber(const char* arg, const long max, const char* what);
+static void* serve(void* arg);
+static bool readRequest(const int sock, char* buf, size_t* len, size_t* used);
+static bool respond(const int sock, const char* request, bool* keepAlive);
+static char* makePage(const long id, size_t* len);
+static char* gzipPage(char* page, size_t* len);
+static char* chunkPage(char* page, size_t* len);
+static bool sendResponse(const int sock, const char* header, const char* body,
+                         size_t bodyLen);
+static bool hasHeader(const char* request, const char* name, const char* value);
+static void record(const double ms, const int status, const size_t bytes);
+static void report(void);
+static int compareDoubles(const void* a, const void* b);
+static void onSignal(int sig);
+static double now(void);
+static uint64_t mix(uint64_t x);
+
+/**************** main ****************/
+int
+main(const int argc, char* argv[])
+{
+  parseArgs(argc, argv);
+
+  // stop on SIGINT or SIGTERM; accept() must return, so no SA_RESTART
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  struct pollfd listeners[MAX_HOSTS];
+  for (int h = 0; h < site.hosts; h++) {
+    listeners[h].fd = listenOn(site.port + h);
+    listeners[h].events = POLLIN;
+    if (listeners[h].fd < 0) {
+      fprintf(stderr, "Unable to listen on 127.0.0.1:%d\n", site.port + h);
+      exit(2);
+    }
+  }
+  fprintf(stderr, "Serving %ld pages at http://127.0.0.1:%d/tse/0.html\n",
+          site.pages, site.port);
+
+  int next = 0;             // the listener to try first, so none is starved
+  while (!stopping) {
+    if (poll(listeners, site.hosts, -1) <= 0) {
+      continue;             // interrupted
+    }
+    int h = next;
+    while (listeners[h].revents == 0) {
+      h = (h + 1) % site.hosts;
+    }
+    next = (h + 1) % site.hosts;
+    int sock = accept(listeners[h].fd, NULL, NULL);
+    if (sock < 0) {
+      continue;             // interrupted, or the client gave up
+    }
+    pthread_mutex_lock(&statsLock);
+    stats.connections++;
+    pthread_mutex_unlock(&statsLock);
+    int* arg = malloc(sizeof(int));
+    pthread_t thread;
+    if (arg == NULL) {
+      close(sock);
+      continue;
+    }
+    *arg = sock;
+    if (pthread_create(&thread, NULL, serve, arg) != 0) {
+      close(sock);
+      free(arg);
+      continue;
+    }
+    pthread_detach(thread);
+  }
+  for (int h = 0; h < site.hosts; h++) {
+    close(listeners[h].fd);
+  }
+  report();
+  return 0;
+}
+
+/**************** parseArgs ****************/
+/* read the options into 'site'; exit with a message on any bad one */
+static void
+parseArgs(const int argc, char* argv[])
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "p:n:f:s:l:k:H:b:zcD")) != -1) {
+    if (opt == 'p') {
+      site.port = (int) parseNumber(optarg, MAX_PORT, "Port");
+    } else if (opt == 'n') {
+      site.pages = parseNumber(optarg, MAX_PAGES, "Number of pages");
+    } else if (opt == 'f') {
+      site.fanout = (int) parseNumber(optarg, MAX_FANOUT, "Fanout");
+    } else if (opt == 's') {
+      site.pageBytes = parseNumber(optarg, MAX_PAGE_BYTES, "Page size");
+    } else if (opt == 'l') {
+      site.latencyMs = parseNumber(optarg, MAX_LATENCY, "Latency");
+    } else if (opt == 'k') {
+      site.capacity = parseNumber(optarg, MAX_CAPACITY, "Capacity");
+    } else if (opt == 'H') {
+      site.hosts = (int) parseNumber(optarg, MAX_HOSTS, "Hosts");
+    } else if (opt == 'b') {
+      site.kbps = parseNumber(optarg, MAX_KBPS, "Bandwidth");
+    } else if (opt == 'z') {
+      site.gzip = true;
+    } else if (opt == 'c') {
+      site.chunked = true;
+    } else if (opt == 'D') {
+      site.copies = true;
+    } else {
+      fprintf(stderr, "Usage: %s [-p port] [-n pages] [-f fanout] [-s pageBytes] [-l latencyMs] [-k capacity] [-H hosts] [-b kbps] [-z] [-c] [-D]\n",
+              argv[0]);
+      exit(1);
+    }
+  }
+  if (optind != argc || site.port < 1 || site.pages < 1 || site.hosts < 1
+      || site.port + site.hosts - 1 > MAX_PORT) {
+    fprintf(stderr, "Usage: %s [-p port] [-n pages] [-f fanout] [-s pageBytes] [-l latencyMs] [-k capacity] [-H hosts] [-b kbps] [-z] [-c] [-D]\n",
+            argv[0]);
+    exit(1);
+  }
+}
+
+/* listenOn: a socket listening on 127.0.0.1:port, or -1 */
+static int
+listenOn(const int port)
+{
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (listener < 0
+      || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+      || bind(listener, (struct sockaddr*) &addr, sizeof(addr)) != 0
+      || listen(listener, 1024) != 0) {
+    if (listener >= 0) {
+      close(listener);
+    }
+    return -1;
+  }
+  return listener;
+}
+
+/* parseNumber: a whole number from 0 to max, or exit */
+static long
+parseNumber(const char* arg, const long max, const char* what)
+{
+  char* end;
+  long value = strtol(arg, &end, 10);
+  if (end == arg || *end != '\0' || value < 0 || value > max) {
+    fprintf(stderr, "%s should be between 0 and %ld (inclusive)\n", what, max);
+    exit(1);
+  }
+  return value;
+}
+
+/**************** serve ****************/
+/* thread: answer requests on one connection until either side closes it */
+static void*
+serve(void* arg)
+{
+  int sock = *(int*) arg;
+  free(arg);
+  struct timeval idle = { IDLE_TIMEOUT, 0 };
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+  int on = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  char* buf = malloc(MAX_REQUEST + 1);
+  size_t len = 0;           // bytes in buf
+  size_t used;              // bytes of buf the request took
+  bool keepAlive = true;
+  while (buf != NULL && keepAlive && readRequest(sock, buf, &len, &used)) {
+    // the request is a string ending at its blank line
+    char saved = buf[used];
+    buf[used] = '\0';
+    bool ok = respond(sock, buf, &keepAlive);
+    buf[used] = saved;
+    // keep any pipelined request that came in behind it
+    memmove(buf, buf + used, len - used);
+    len -= used;
+    if (!ok) {
+      break;
+    }
+  }
+  free(buf);
+  close(sock);
+  return NULL;
+}
+
+/* readRequest: read until buf holds a whole request header; *used is
+ * its length.  False if the connection closed or the header is too long */
+static bool
+readRequest(const int sock, char* buf, size_t* len, size_t* used)
+{
+  for (;;) {
+    buf[*len] = '\0';
+    char* end = strstr(buf, "\r\n\r\n");
+    if (end != NULL) {
+      *used = end + 4 - buf;
+      return true;
+    }
+    if (*len == MAX_REQUEST) {
+      return false;
+    }
+    ssize_t got = recv(sock, buf + *len, MAX_REQUEST - *len, 0);
+    if (got <= 0) {
+      return false;
+    }
+    *len += got;
+  }
+}
+
+/**************** respond ****************/
+/* answer one request; *keepAlive is whether the connection stays open.
+ * False if the response could not be sent */
+static bool
+respond(const int sock, const char* request, bool* keepAlive)
+{
+  double start = now();
+  bool http10 = strstr(request, " HTTP/1.0\r\n") != NULL;
+  *keepAlive = http10 ? hasHeader(request, "Connection", "keep-alive")
+                      : !hasHeader(request, "Connection", "close");
+
+  // which page: GET /tse/<id>.html, or with -D /tse/<id>.html?copy
+  long id = -1;
+  int end = 0;
+  bool get = strncmp(request, "GET ", 4) == 0;
+  if (get && sscanf(request, "GET /tse/%ld.html%n", &id, &end) == 1 && end > 0
+      && site.copies && strncmp(request + end, "?copy", 5) == 0) {
+    end += 5;
+  }
+  if (!get || end == 0 || request[end] != ' ' || id < 0 || id >= site.pages) {
+    id = -1;
+  }
+
+  // beyond its capacity, the server answers at once, and only to say no
+  bool overloaded = false;
+  if (site.capacity > 0) {
+    pthread_mutex_lock(&statsLock);
+    overloaded = answering >= site.capacity;
+    if (!overloaded) {
+      answering++;
+    }
+    pthread_mutex_unlock(&statsLock);
+  }
+
+  if (site.latencyMs > 0 && !overloaded) {
+    struct timespec ts = { site.latencyMs / 1000, (site.latencyMs % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+  }
+
+  char etag[32];
+  snprintf(etag, sizeof(etag), "\"p%ld-%ld\"", id, site.pageBytes);
+  char header[256];
+  char* body = NULL;
+  size_t bodyLen = 0;
+  int status;
+  if (overloaded) {
+    status = 503;
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+             *keepAlive ? "keep-alive" : "close");
+  } else if (id < 0) {
+    status = get ? 404 : 501;
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: %s\r\n\r\n",
+             status, get ? "Not Found" : "Not Implemented",
+             *keepAlive ? "keep-alive" : "close");
+  } else if (hasHeader(request, "If-None-Match", etag)) {
+    status = 304;
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: %s\r\n\r\n",
+             etag, *keepAlive ? "keep-alive" : "close");
+  } else {
+    status = 200;
+    body = makePage(id, &bodyLen);
+    bool coded = site.gzip && body != NULL && hasHeader(request, "Accept-Encoding", "gzip");
+    if (coded) {
+      body = gzipPage(body, &bodyLen);
+    }
+    char framing[64];
+    if (site.chunked && body != NULL) {
+      body = chunkPage(body, &bodyLen);
+      snprintf(framing, sizeof(framing), "Transfer-Encoding: chunked\r\n");
+    } else {
+      snprintf(framing, sizeof(framing), "Content-Length: %zu\r\n", bodyLen);
+    }
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n%s%s"
+             "ETag: %s\r\nConnection: %s\r\n\r\n",
+             coded ? "Content-Encoding: gzip\r\n" : "", framing,
+             etag, *keepAlive ? "keep-alive" : "close");
+    if (site.kbps > 0 && body != NULL) {
+      // the body takes its turn on the link, after those ahead of it
+      pthread_mutex_lock(&statsLock);
+      double t = now();
+      linkFree = (linkFree > t ? linkFree : t) + bodyLen / (site.kbps * 1024.0);
+      long us = (long) ((linkFree - t) * 1e6);
+      pthread_mutex_unlock(&statsLock);
+      struct timespec ts = { us / 1000000, (us % 1000000) * 1000L };
+      nanosleep(&ts, NULL);
+    }
+  }
+  bool sent = false;
+  if (status != 200 || body != NULL) {
+    sent = sendResponse(sock, header, body, bodyLen);
+  }
+  free(body);
+  if (site.capacity > 0 && !overloaded) {
+    pthread_mutex_lock(&statsLock);
+    answering--;
+    pthread_mutex_unlock(&statsLock);
+  }
+  if (sent) {
+    record((now() - start) * 1000.0, status, bodyLen);
+  }
+  return sent;
+}
+
+/**************** makePage ****************/
+/* the page numbered id, malloc'd, with its length in *len */
+static char*
+makePage(const long id, size_t* len)
+{
+  size_t cap = site.pageBytes + 96 * (2 * site.fanout + 2) + 256;
+  char* page = malloc(cap);
+  if (page == NULL) {
+    return NULL;
+  }
+  size_t n = snprintf(page, cap, "<html><head><title>Page %ld</title></head><body>\n<p>", id);
+
+  // words, picked the same way for this page every time
+  uint64_t state = mix(id + 1);
+  while (n < (size_t) site.pageBytes) {
+    state = mix(state);
+    const char* word = WORDS[state % NUM_WORDS];
+    n += snprintf(page + n, cap - n, "%s%c", word, (state >> 32) % 12 == 0 ? '\n' : ' ');
+  }
+  n += snprintf(page + n, cap - n, "</p>\n");
+
+  // the tree's links, then links back into the site from its leaves
+  for (int k = 1; k <= site.fanout; k++) {
+    long link = id * site.fanout + k;
+    if (link <= id || link >= site.pages) {
+      link = mix((uint64_t) id * MAX_FANOUT + k) % site.pages;
+    }
+    if (site.hosts > 1) {
+      n += snprintf(page + n, cap - n, "<a href=\"http://127.0.0.1:%ld/tse/%ld.html\">%ld</a>\n",
+                    site.port + link % site.hosts, link, link);
+    } else {
+      n += snprintf(page + n, cap - n, "<a href=\"%ld.html\">%ld</a>\n", link, link);
+    }
+    if (site.copies) {
+      n += snprintf(page + n, cap - n, "<a href=\"http://127.0.0.1:%ld/tse/%ld.html?copy\">%ld</a>\n",
+                    site.port + link % site.hosts, link, link);
+    }
+  }
+  n += snprintf(page + n, cap - n, "</body></html>\n");
+  *len = n;
+  return page;
+}
+
+/* gzipPage: the page, gzip-coded; the page given is freed, and *len is
+ * updated.  NULL if out of memory */
+static char*
+gzipPage(char* page, size_t* len)
+{
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  // 15 + 16: the largest window, with a gzip wrapper
+  if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    free(page);
+    return NULL;
+  }
+  size_t cap = deflateBound(&z, *len);
+  char* coded = malloc(cap);
+  if (coded != NULL) {
+    z.next_in = (Bytef*) page;
+    z.avail_in = *len;
+    z.next_out = (Bytef*) coded;
+    z.avail_out = cap;
+    if (deflate(&z, Z_FINISH) == Z_STREAM_END) {
+      *len = z.total_out;
+    } else {
+      free(coded);
+      coded = NULL;
+    }
+  }
+  deflateEnd(&z);
+  free(page);
+  return coded;
+}
+
+/* chunkPage: the page in chunked transfer-coding, its chunks CHUNKS
+ * bytes long in turn, then the last, empty chunk; the page given is
+ * freed, and *len is updated.  NULL if out of memory */
+static char*
+chunkPage(char* page, size_t* len)
+{
+  if (page == NULL) {
+    return NULL;
+  }
+  // each chunk adds at most 16 hex digits and two CRLFs; the smallest is 1 byte
+  size_t cap = *len * 21 + 8;
+  char* chunked = malloc(cap);
+  if (chunked != NULL) {
+    size_t n = 0;
+    for (size_t at = 0, c = 0; at < *len; at += CHUNKS[c], c = (c + 1) % NUM_CHUNKS) {
+      size_t size = *len - at < CHUNKS[c] ? *len - at : CHUNKS[c];
+      n += sprintf(chunked + n, "%zx\r\n", size);
+      memcpy(chunked + n, page + at, size);
+      n += size;
+      n += sprintf(chunked + n, "\r\n");
+    }
+    n += sprintf(chunked + n, "0\r\n\r\n");
+    *len = n;
+  }
+  free(page);
+  return chunked;
+}
+
+/* sendResponse: send header and body together (one write where it can,
+ * so the client never waits on a delayed ACK between them); false on error */
+static bool
+sendResponse(const int sock, const char* header, const char* body, size_t bodyLen)
+{
+  struct iovec iov[2] = {
+    { (void*) header, strlen(header) },
+    { (void*) body, body != NULL ? bodyLen : 0 },
+  };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  while (iov[0].iov_len + iov[1].iov_len > 0) {
+    ssize_t sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    // step past what went out
+    for (int i = 0; i < 2; i++) {
+      size_t step = (size_t) sent < iov[i].iov_len ? (size_t) sent : iov[i].iov_len;
+      iov[i].iov_base = (char*) iov[i].iov_base + step;
+      iov[i].iov_len -= step;
+      sent -= step;
+    }
+  }
+  return true;
+}
+
+/* hasHeader: whether the request has header 'name' with a value that
+ * contains 'value' (names and values compared without case) */
+static bool
+hasHeader(const char* request, const char* name, const char* value)
+{
+  size_t nameLen = strlen(name);
+  size_t valueLen = strlen(value);
+  for (const char* line = strstr(request, "\r\n"); line != NULL;
+       line = strstr(line, "\r\n")) {
+    line += 2;
+    if (strncasecmp(line, name, nameLen) == 0 && line[nameLen] == ':') {
+      const char* lineEnd = strstr(line, "\r\n");
+      for (const char* p = line + nameLen + 1; p + valueLen <= lineEnd; p++) {
+        if (strncasecmp(p, value, valueLen) == 0) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/**************** record ****************/
+/* add one answered request to the stats */
+static void
+record(const double ms, const int status, const size_t bytes)
+{
+  pthread_mutex_lock(&statsLock);
+  stats.requests++;
+  if (status == 200) {
+    stats.pages++;
+  } else if (status == 304) {
+    stats.notModified++;
+  } else if (status == 503) {
+    stats.overloaded++;
+  } else {
+    stats.notFound++;
+  }
+  stats.bytes += bytes;
+  if (stats.numLatency == stats.maxLatency) {
+    long grown = stats.maxLatency > 0 ? 2 * stats.maxLatency : 4096;
+    double* latency = realloc(stats.latency, grown * sizeof(double));
+    if (latency != NULL) {
+      stats.latency = latency;
+      stats.maxLatency = grown;
+    }
+  }
+  if (stats.numLatency < stats.maxLatency) {
+    stats.latency[stats.numLatency++] = ms;
+  }
+  pthread_mutex_unlock(&statsLock);
+}
+
+/**************** report ****************/
+/* print the stats, in the form given at the top of this file */
+static void
+report(void)
+{
+  pthread_mutex_lock(&statsLock);
+  printf("connections %ld\n", stats.connections);
+  printf("requests %ld\npages %ld\nnotModified %ld\nnotFound %ld\noverloaded %ld\nbytes %lld\n",
+         stats.requests, stats.pages, stats.notModified, stats.notFound, stats.overloaded,
+         stats.bytes);
+  long n = stats.numLatency;
+  if (n > 0) {
+    qsort(stats.latency, n, sizeof(double), compareDoubles);
+    printf("latencyMs %.3f %.3f %.3f %.3f\n", stats.latency[(n - 1) * 50 / 100],
+           stats.latency[(n - 1) * 90 / 100], stats.latency[(n - 1) * 99 / 100],
+           stats.latency[n - 1]);
+  } else {
+    printf("latencyMs 0 0 0 0\n");
+  }
+  fflush(stdout);
+  pthread_mutex_unlock(&statsLock);
+}
+
+/* compareDoubles: qsort helper, ascending */
+static int
+compareDoubles(const void* a, const void* b)
+{
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/* onSignal: stop accepting connections */
+static void
+onSignal(int sig)
+{
+  stopping = 1;
+}
+
+/* now: seconds on the monotonic clock */
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* mix: scramble the bits of x (the splitmix64 finalizer) */
+static uint64_t
+mix(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
@@ -0,0 +1,217 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * dictionary.c -- preset dictionaries trained on sample pages, and zlib compression against them
+ *
+ * see dictionary.h.  Training counts, for every piece of the sample, the
+ * pages it is found in, in an open-addressed table keyed by the piece's
+ * fingerprint; a piece found in k pages saves about (k - 1) copies of itself
+ * in those pages, so pieces are chosen by k times their length.
+ *
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <zlib.h>
+#include "dictionary.h"
+#include "fingerprint.h"
+
+#define DICTIONARY_BYTES (32 * 1024)   // deflate's window: no match reaches further back
+#define MIN_PIECE 32                   // a '>' ends a piece only once it is this long
+
+/* one distinct piece of the sample */
+typedef struct piece {
+    uint64_t hash;        // its fingerprint
+    const char *text;     // its first occurrence, in the sample
+    size_t length;
+    int pages;            // pages it is found in
+    int lastPage;         // the last of them, so a page counts once
+    size_t first;         // where it first occurs, counting pieces from the sample's start
+} piece_t;
+
+/**************** local functions ****************/
+static size_t pieceLength(const char *text);
+static int byValue(const void *a, const void *b);
+static int byFirst(const void *a, const void *b);
+
+
+/**
+ * Cuts the samples into pieces, counts the pages each distinct piece is found in, and
+ * strings together the most valuable ones found in more than one; see dictionary.h.
+ */
+unsigned char *dictionaryTrain(const char **samples, const int count, size_t *length) {
+    if (!length) {
+        return NULL;
+    }
+    *length = 0;
+    if (!samples || count < 2) {
+        return NULL;
+    }
+
+    // a table at most half full of the pieces
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        for (const char *p = samples[i]; p && *p; p += pieceLength(p)) {
+            total++;
+        }
+    }
+    size_t slots = 1024;
+    while (slots < 2 * total) {
+        slots *= 2;
+    }
+    piece_t *pieces = malloc((total + 1) * sizeof(piece_t));
+    piece_t **table = calloc(slots, sizeof(piece_t *));
+    if (!pieces || !table) {
+        free(pieces);
+        free(table);
+        return NULL;
+    }
+
+    size_t distinct = 0, ordinal = 0;
+    for (int i = 0; i < count; i++) {
+        for (const char *p = samples[i]; p && *p; ordinal++) {
+            size_t n = pieceLength(p);
+            uint64_t hash = fingerprint(p, n);
+            size_t slot = hash & (slots - 1);
+            while (table[slot] && (table[slot]->hash != hash || table[slot]->length != n)) {
+                slot = (slot + 1) & (slots - 1);
+            }
+            piece_t *piece = table[slot];
+            if (!piece) {
+                piece = table[slot] = &pieces[distinct++];
+                *piece = (piece_t) { hash, p, n, 1, i, ordinal };
+            } else if (piece->lastPage != i) {
+                piece->pages++;
+                piece->lastPage = i;
+            }
+            p += n;
+        }
+    }
+    free(table);
+
+    // the most valuable pieces that fit, then back in the order they came
+    qsort(pieces, distinct, sizeof(piece_t), byValue);
+    size_t chosen = 0, bytes = 0;
+    for (size_t i = 0; i < distinct; i++) {
+        if (pieces[i].pages > 1 && bytes + pieces[i].length <= DICTIONARY_BYTES) {
+            bytes += pieces[i].length;
+            pieces[chosen++] = pieces[i];
+        }
+    }
+    qsort(pieces, chosen, sizeof(piece_t), byFirst);
+    unsigned char *dictionary = bytes > 0 ? malloc(bytes) : NULL;
+    if (dictionary) {
+        for (size_t i = 0; i < chosen; i++) {
+            memcpy(dictionary + *length, pieces[i].text, pieces[i].length);
+            *length += pieces[i].length;
+        }
+    }
+    free(pieces);
+    return dictionary;
+}
+
+/**
+ * Deflates the text, in one call, into a buffer big enough for the worst case;
+ * see dictionary.h.
+ */
+unsigned char *dictionaryCompress(const unsigned char *dictionary, const size_t dictionaryLength,
+                                  const char *text, const size_t length,
+                                  size_t *compressedLength) {
+    if (!text || !compressedLength || length > UINT32_MAX || dictionaryLength > UINT32_MAX) {
+        return NULL;
+    }
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (deflateInit(&z, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return NULL;
+    }
+    unsigned char *data = NULL;
+    if (!dictionary || deflateSetDictionary(&z, dictionary, dictionaryLength) == Z_OK) {
+        uLong bound = deflateBound(&z, length);
+        data = malloc(bound);
+        if (data) {
+            z.next_in = (unsigned char *) text;
+            z.avail_in = length;
+            z.next_out = data;
+            z.avail_out = bound;
+            if (deflate(&z, Z_FINISH) == Z_STREAM_END) {
+                *compressedLength = z.total_out;
+            } else {
+                free(data);
+                data = NULL;
+            }
+        }
+    }
+    deflateEnd(&z);
+    return data;
+}
+
+/**
+ * Inflates the data into a buffer of exactly the expected length, supplying the dictionary
+ * when the stream asks for it; see dictionary.h.
+ */
+char *dictionaryExpand(const unsigned char *dictionary, const size_t dictionaryLength,
+                       const unsigned char *data, const size_t dataLength, const size_t length) {
+    if (!data || dataLength > UINT32_MAX || length > UINT32_MAX
+        || dictionaryLength > UINT32_MAX) {
+        return NULL;
+    }
+    char *text = malloc(length + 1);
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (!text || inflateInit(&z) != Z_OK) {
+        free(text);
+        return NULL;
+    }
+    z.next_in = (unsigned char *) data;
+    z.avail_in = dataLength;
+    z.next_out = (unsigned char *) text;
+    z.avail_out = length;
+    int status = inflate(&z, Z_FINISH);
+    if (status == Z_NEED_DICT && dictionary
+        && inflateSetDictionary(&z, dictionary, dictionaryLength) == Z_OK) {
+        status = inflate(&z, Z_FINISH);
+    }
+    bool ok = status == Z_STREAM_END && z.total_out == length;
+    inflateEnd(&z);
+    if (!ok) {
+        free(text);
+        return NULL;
+    }
+    text[length] = '\0';
+    return text;
+}
+
+/**
+ * Returns the length of the piece at text: through the first newline, or through the
+ * first '>' at least MIN_PIECE bytes in, or to the end.
+ */
+static size_t pieceLength(const char *text) {
+    size_t n = 0;
+    while (text[n] != '\0') {
+        char c = text[n++];
+        if (c == '\n' || (c == '>' && n >= MIN_PIECE)) {
+            break;
+        }
+    }
+    return n;
+}
+
+/**
+ * Orders pieces by the bytes they would save, most first.
+ */
+static int byValue(const void *a, const void *b) {
+    const piece_t *p = a, *q = b;
+    double u = (double) p->pages * p->length, v = (double) q->pages * q->length;
+    return (u < v) - (u > v);
+}
+
+/**
+ * Orders pieces by where they first occur.
+ */
+static int byFirst(const void *a, const void *b) {
+    const piece_t *p = a, *q = b;
+    return (p->first > q->first) - (p->first < q->first);
+}
@@ -0,0 +1,68 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * dictionary.h -- header file for CS50 'dictionary' module
+ *
+ * The pages of one site repeat the same boilerplate -- headers, navigation,
+ * scripts, footers -- page after page.  Compressed one at a time, each page
+ * pays for its own copy of it; compressed against a preset dictionary that
+ * already holds it, a page costs little more than what is its own.
+ *
+ * This module builds such a dictionary from a sample of a site's pages, and
+ * compresses and expands single pages with zlib (deflate), against a
+ * dictionary or none.  The docstore keeps the dictionaries, and says which
+ * one each page was compressed with.
+ */
+
+#ifndef __DICTIONARY_H_
+#define __DICTIONARY_H_
+
+#include <stddef.h>
+
+/**
+ * @brief Builds a dictionary from sample pages.
+ *
+ * The pages are cut into pieces, each ending at a newline, or at a '>' once it is long
+ * enough; the pieces found in more than one page, the most bytes saved first, make up the
+ * dictionary, at most 32 kB (all of it that deflate can refer back to), in the order they
+ * first appear in the sample, so that runs of boilerplate stay runs.
+ *
+ * @param samples The pages.
+ * @param count How many there are.
+ * @param length Where to store the dictionary's length; 0 if the pages have nothing in common.
+ * @return The dictionary, malloc'd; or NULL if out of memory, or if *length is 0.
+ * Note: The caller is responsible for freeing it.
+ */
+unsigned char *dictionaryTrain(const char **samples, const int count, size_t *length);
+
+/**
+ * @brief Compresses a page.
+ *
+ * @param dictionary The dictionary to compress against, or NULL for none.
+ * @param dictionaryLength Its length.
+ * @param text The page.
+ * @param length Its length.
+ * @param compressedLength Where to store the length of the result.
+ * @return The compressed page (a zlib stream), malloc'd; or NULL on failure.
+ * Note: The caller is responsible for freeing it.
+ */
+unsigned char *dictionaryCompress(const unsigned char *dictionary, const size_t dictionaryLength,
+                                  const char *text, const size_t length,
+                                  size_t *compressedLength);
+
+/**
+ * @brief Expands a page compressed by dictionaryCompress, with the same dictionary.
+ *
+ * @param dictionary The dictionary it was compressed against, or NULL for none.
+ * @param dictionaryLength Its length.
+ * @param data The compressed page.
+ * @param dataLength Its length.
+ * @param length The length of the page it expands to.
+ * @return The page, malloc'd and null-terminated; or NULL if it is damaged, does not expand
+ *         to exactly length bytes, or needs another dictionary, or if out of memory.
+ * Note: The caller is responsible for freeing it.
+ */
+char *dictionaryExpand(const unsigned char *dictionary, const size_t dictionaryLength,
+                       const unsigned char *data, const size_t dataLength, const size_t length);
+
+#endif //__DICTIONARY_H_
@@ -0,0 +1,860 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * docstore.c -- pages packed into append-only segments, found through a dense table
+ *
+ * see docstore.h for the format.  Every read and write is a pread or a
+ * pwrite at a known offset, so no file position is shared; the table is
+ * read BLOCK_ENTRIES entries at a time, so a scan in docID order reads it
+ * once, and each record is read whole, with one call.
+ *
+ * A compressing docstore keeps the first SAMPLE_PAGES pages it saves (or
+ * their first SAMPLE_BYTES) and trains a dictionary on them; until then it
+ * compresses without one.  Its dictionaries are all loaded when it is opened,
+ * and a page is expanded against the one its record names.
+ *
+*/
+
+#define _POSIX_C_SOURCE 200809L   // pread, pwrite, fsync, ftruncate
+#define _FILE_OFFSET_BITS 64      // segments and tables past 2 GB on 32-bit machines
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "docstore.h"
+#include "dictionary.h"
+#include "fingerprint.h"
+
+#define ENTRY_BYTES 16       // bytes of a table entry: offset, segment, length
+#define HEADER_BYTES 12      // bytes of a record's header: urlLength, depth, htmlLength
+#define BLOCK_ENTRIES 4096   // table entries read at once
+#define PACK_BYTES 12        // bytes before a compressed page: dictionary, length expanded
+#define SAMPLE_PAGES 32      // pages the first dictionary is trained on
+#define SAMPLE_BYTES 65536   // bytes of each page kept for training, at most
+#define DICTIONARIES -2      // filePath's number for the dictionaries
+
+static const uint64_t COMPRESSED = 0x80000000;   // set in htmlLength if the HTML is compressed
+
+static const off_t SEGMENT_BYTES = 256L * 1024 * 1024;  // a segment this long is full
+
+/**************** global types ****************/
+/* a dictionary, as it is in the dictionaries file */
+typedef struct preset {
+    uint64_t id;               // its fingerprint, by which records name it
+    unsigned char *bytes;
+    size_t length;
+} preset_t;
+
+struct docstore {
+    char *pageDirectory;
+    int table;                 // the table's descriptor, or -1 if there is none yet
+    int *segments;             // each segment's descriptor, or -1 until it is read or written
+    int numSegments;
+    off_t end;                 // length of the last segment: where the next record goes
+    int slots;                 // entries in the table
+    int dirtyFrom;             // first segment appended to since the last sync, or -1
+    bool tableDirty;           // entries written since the last sync
+    bool created;              // files created or renamed since the last sync
+    int blockFirst;            // docID of the first entry in block
+    int blockCount;            // entries in block; 0 if none
+    unsigned char block[BLOCK_ENTRIES * ENTRY_BYTES];  // entries read ahead
+    int dictionaryFile;        // the dictionaries' descriptor, or -1 if pages are not compressed
+    off_t dictionaryEnd;       // where the next dictionary goes
+    bool dictionaryDirty;      // dictionary written since the last sync
+    preset_t *presets;         // every dictionary in it; pages are compressed with the last
+    int numPresets;
+    char **samples;            // pages kept to train the first dictionary on, while sampling
+    int numSamples;
+    bool sampling;             // compressing, but with no dictionary yet
+};
+
+/**************** local functions ****************/
+static char *filePath(const char *pageDirectory, const int segment);
+static int openFile(const char *path, const bool create);
+static int segmentFile(docstore_t *store, const int segment);
+static bool makeTable(docstore_t *store);
+static bool addSegment(docstore_t *store);
+static int readEntry(docstore_t *store, const int docID, int *segment, off_t *offset,
+                     size_t *length);
+static bool writeEntry(docstore_t *store, const int docID, const int segment,
+                       const off_t offset, const size_t length);
+static bool readAll(const int fd, void *buf, size_t len, off_t offset);
+static bool writeAll(const int fd, const void *buf, size_t len, off_t offset);
+static void putNumber(unsigned char *p, uint64_t value, const int bytes);
+static uint64_t getNumber(const unsigned char *p, const int bytes);
+static bool loadPresets(docstore_t *store);
+static bool addPreset(docstore_t *store, unsigned char *bytes, const size_t length);
+static const preset_t *findPreset(const docstore_t *store, const uint64_t id);
+static void addSample(docstore_t *store, const char *html, const size_t length);
+static void dropSamples(docstore_t *store);
+static unsigned char *compressPage(docstore_t *store, const char *html, const size_t length,
+                                   unsigned char *pack, size_t *packedLength);
+static char *expandPage(const docstore_t *store, const unsigned char *data, const size_t length);
+
+
+/**
+ * Opens a page directory's docstore: the table, if there is one, and the last segment,
+ * to learn where the next record goes; see docstore.h.
+ */
+docstore_t *docstoreOpen(const char *pageDirectory) {
+    if (!pageDirectory) {
+        return NULL;
+    }
+    docstore_t *store = calloc(1, sizeof(docstore_t));
+    char *path = filePath(pageDirectory, -1);
+    if (!store || !path || !(store->pageDirectory = malloc(strlen(pageDirectory) + 1))) {
+        free(path);
+        docstoreClose(store);
+        return NULL;
+    }
+    strcpy(store->pageDirectory, pageDirectory);
+    store->dirtyFrom = -1;
+    store->dictionaryFile = -1;
+    store->table = openFile(path, false);
+    free(path);
+    struct stat st;
+    if (store->table < 0 && errno != ENOENT) {
+        docstoreClose(store);
+        return NULL;
+    }
+    if (store->table >= 0 && fstat(store->table, &st) == 0) {
+        store->slots = st.st_size / ENTRY_BYTES;
+    }
+
+    // the segments are numbered from 0, with no gaps
+    for (;;) {
+        path = filePath(pageDirectory, store->numSegments);
+        bool exists = path && access(path, F_OK) == 0;
+        free(path);
+        if (!exists) {
+            break;
+        }
+        store->numSegments++;
+    }
+    store->segments = malloc((store->numSegments + 1) * sizeof(int));
+    if (!store->segments) {
+        docstoreClose(store);
+        return NULL;
+    }
+    for (int i = 0; i < store->numSegments; i++) {
+        store->segments[i] = -1;
+    }
+    if (store->numSegments > 0) {
+        int fd = segmentFile(store, store->numSegments - 1);
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            docstoreClose(store);
+            return NULL;
+        }
+        store->end = st.st_size;
+    }
+    if (!loadPresets(store)) {
+        docstoreClose(store);
+        return NULL;
+    }
+    return store;
+}
+
+/**
+ * Appends a record to the last segment, starting a new one if that is full, then writes
+ * the docID's entry; see docstore.h.
+ */
+bool docstorePut(docstore_t *store, const int docID, const char *url, const int depth,
+                 const char *html) {
+    if (!store || docID < 1 || !url || !html || depth < 0) {
+        return false;
+    }
+    size_t urlLength = strlen(url);
+    size_t htmlLength = strlen(html);
+
+    // a compressing docstore stores the HTML compressed, if that is smaller
+    unsigned char pack[PACK_BYTES];
+    size_t packedLength = 0;
+    unsigned char *packed = NULL;
+    if (store->dictionaryFile >= 0) {
+        packed = compressPage(store, html, htmlLength, pack, &packedLength);
+    }
+    const void *body = packed ? (const void *) packed : html;
+    size_t bodyLength = packed ? packedLength : htmlLength;
+    size_t packLength = packed ? PACK_BYTES : 0;
+    size_t length = HEADER_BYTES + urlLength + packLength + bodyLength;
+    if (length >= COMPRESSED || !makeTable(store)) {
+        free(packed);
+        return false;
+    }
+    if (store->numSegments == 0 || store->end >= SEGMENT_BYTES) {
+        if (!addSegment(store)) {
+            free(packed);
+            return false;
+        }
+    }
+    int segment = store->numSegments - 1;
+    int fd = segmentFile(store, segment);
+    unsigned char *head = malloc(HEADER_BYTES + urlLength + packLength);
+    if (fd < 0 || !head) {
+        free(head);
+        free(packed);
+        return false;
+    }
+
+    // the header and the URL in one write, then the HTML; a record cut short by an
+    // error has no entry, and the next one is written over it
+    putNumber(head, urlLength, 4);
+    putNumber(head + 4, depth, 4);
+    putNumber(head + 8, packed ? (packLength + bodyLength) | COMPRESSED : htmlLength, 4);
+    memcpy(head + HEADER_BYTES, url, urlLength);
+    memcpy(head + HEADER_BYTES + urlLength, pack, packLength);
+    off_t offset = store->end;
+    bool ok = writeAll(fd, head, HEADER_BYTES + urlLength + packLength, offset)
+              && writeAll(fd, body, bodyLength, offset + HEADER_BYTES + urlLength + packLength);
+    free(head);
+    free(packed);
+    if (!ok) {
+        return false;
+    }
+    store->end += length;
+    if (store->dirtyFrom < 0 || store->dirtyFrom > segment) {
+        store->dirtyFrom = segment;
+    }
+    return writeEntry(store, docID, segment, offset, length);
+}
+
+/**
+ * Reads a document's record, whole when its HTML is wanted; see docstore.h.
+ */
+int docstoreGet(docstore_t *store, const int docID, char **url, int *depth, char **html) {
+    if (!store || !url || !depth) {
+        return 0;
+    }
+    int segment;
+    off_t offset;
+    size_t length;
+    int found = readEntry(store, docID, &segment, &offset, &length);
+    int fd = found == 1 ? segmentFile(store, segment) : -1;
+    if (found != 1 || fd < 0) {
+        return found == 1 ? 0 : found;
+    }
+
+    // one read: of the whole record, or just of its header (then one more, of the URL)
+    unsigned char header[HEADER_BYTES];
+    unsigned char *record = html ? malloc(length + 1) : header;
+    if (!record || !readAll(fd, record, html ? length : HEADER_BYTES, offset)) {
+        if (record != header) {
+            free(record);
+        }
+        return 0;
+    }
+    size_t urlLength = getNumber(record, 4);
+    size_t htmlLength = getNumber(record + 8, 4) & ~COMPRESSED;
+    bool compressed = getNumber(record + 8, 4) & COMPRESSED;
+    if (urlLength > length || HEADER_BYTES + urlLength + htmlLength != length) {
+        if (record != header) {
+            free(record);
+        }
+        return 0; // damaged
+    }
+    *depth = (int) getNumber(record + 4, 4);
+    char *u = malloc(urlLength + 1);
+    if (!u || (!html && !readAll(fd, u, urlLength, offset + HEADER_BYTES))) {
+        free(u);
+        if (record != header) {
+            free(record);
+        }
+        return 0;
+    }
+    if (html && compressed) {
+        memcpy(u, record + HEADER_BYTES, urlLength);
+        *html = expandPage(store, record + HEADER_BYTES + urlLength, htmlLength);
+        free(record);
+        if (!*html) {
+            free(u);
+            return 0; // damaged, or its dictionary is missing
+        }
+    } else if (html) {
+        // the HTML takes over the record's memory
+        memcpy(u, record + HEADER_BYTES, urlLength);
+        memmove(record, record + HEADER_BYTES + urlLength, htmlLength);
+        record[htmlLength] = '\0';
+        *html = (char *) record;
+    }
+    u[urlLength] = '\0';
+    *url = u;
+    return 1;
+}
+
+/**
+ * Returns the number of entries in the table; see docstore.h.
+ */
+int docstoreCount(const docstore_t *store) {
+    return store ? store->slots : 0;
+}
+
+/**
+ * Creates the dictionaries file, which marks the docstore as compressing, if there is
+ * none yet; see docstore.h.
+ */
+bool docstoreCompress(docstore_t *store) {
+    if (!store) {
+        return false;
+    }
+    if (store->dictionaryFile >= 0) {
+        return true;
+    }
+    char *path = filePath(store->pageDirectory, DICTIONARIES);
+    store->dictionaryFile = path ? openFile(path, true) : -1;
+    free(path);
+    if (store->dictionaryFile < 0) {
+        return false;
+    }
+    store->dictionaryEnd = 0;
+    store->created = true;
+    store->sampling = store->numPresets == 0;
+    return true;
+}
+
+/**
+ * Cuts the table back to lastDocID entries, or removes every file of the docstore;
+ * see docstore.h.
+ */
+bool docstoreTruncate(docstore_t *store, const int lastDocID) {
+    if (!store || lastDocID < 0) {
+        return false;
+    }
+    store->blockCount = 0;
+    if (lastDocID > 0) {
+        if (lastDocID >= store->slots) {
+            return true;
+        }
+        if (ftruncate(store->table, (off_t) lastDocID * ENTRY_BYTES) != 0) {
+            return false;
+        }
+        store->slots = lastDocID;
+        store->tableDirty = true;
+        return true;
+    }
+
+    // nothing is left to refer to any segment, or any dictionary
+    bool ok = true;
+    for (int i = DICTIONARIES; i < store->numSegments; i++) {
+        int *fd = i == DICTIONARIES ? &store->dictionaryFile
+                  : i < 0 ? &store->table : &store->segments[i];
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+        char *path = filePath(store->pageDirectory, i);
+        ok = path && (unlink(path) == 0 || errno == ENOENT) && ok;
+        free(path);
+    }
+    store->numSegments = 0;
+    store->end = 0;
+    store->slots = 0;
+    store->dirtyFrom = -1;
+    store->tableDirty = false;
+    for (int i = 0; i < store->numPresets; i++) {
+        free(store->presets[i].bytes);
+    }
+    store->numPresets = 0;
+    store->dictionaryEnd = 0;
+    store->dictionaryDirty = false;
+    dropSamples(store);
+    return ok;
+}
+
+/**
+ * Syncs a new dictionary, then the segments appended to, then the table, then the directory
+ * if it has new names; see docstore.h.
+ */
+bool docstoreSync(docstore_t *store) {
+    if (!store) {
+        return false;
+    }
+    bool ok = true;
+    if (store->dictionaryDirty) {
+        ok = fsync(store->dictionaryFile) == 0;
+    }
+    for (int i = store->dirtyFrom; i >= 0 && i < store->numSegments; i++) {
+        int fd = segmentFile(store, i);
+        ok = fd >= 0 && fsync(fd) == 0 && ok;
+    }
+    if (store->tableDirty) {
+        ok = fsync(store->table) == 0 && ok;
+    }
+    if (store->created) {
+        int fd = open(store->pageDirectory, O_RDONLY);
+        ok = fd >= 0 && fsync(fd) == 0 && ok;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (ok) {
+        store->dirtyFrom = -1;
+        store->tableDirty = store->created = store->dictionaryDirty = false;
+    }
+    return ok;
+}
+
+/**
+ * Renames another directory's segments in after this store's, copies its entries over,
+ * renumbered, and removes its table; see docstore.h.
+ */
+bool docstoreMerge(docstore_t *store, const char *pageDirectory, const int offset, int *count) {
+    if (!store || !pageDirectory || offset < 0 || !count) {
+        return false;
+    }
+    *count = 0;
+    docstore_t *from = docstoreOpen(pageDirectory);
+    if (!from) {
+        return false;
+    }
+    if (from->table < 0 && from->numSegments == 0 && from->dictionaryFile < 0) {
+        docstoreClose(from);
+        return true; // nothing to move
+    }
+
+    // its dictionaries first, so that no record moved in names one that is not here
+    bool ok = from->dictionaryFile < 0 || docstoreCompress(store);
+    for (int i = 0; ok && i < from->numPresets; i++) {
+        if (!findPreset(store, from->presets[i].id)) {
+            ok = addPreset(store, from->presets[i].bytes, from->presets[i].length);
+            from->presets[i].bytes = NULL;  // the store has it now
+        }
+    }
+    if (!ok) {
+        docstoreClose(from);
+        return false;
+    }
+    int *segments = realloc(store->segments,
+                            (store->numSegments + from->numSegments + 1) * sizeof(int));
+    if (!segments || !makeTable(store)) {
+        store->segments = segments ? segments : store->segments;
+        docstoreClose(from);
+        return false;
+    }
+    store->segments = segments;
+
+    // the segments, renumbered after ours
+    int base = store->numSegments;
+    for (int i = 0; ok && i < from->numSegments; i++) {
+        char *oldPath = filePath(pageDirectory, i);
+        char *newPath = filePath(store->pageDirectory, base + i);
+        ok = oldPath && newPath && rename(oldPath, newPath) == 0;
+        free(oldPath);
+        free(newPath);
+        if (ok) {
+            store->segments[store->numSegments++] = -1;
+            store->created = true;
+        }
+    }
+    if (store->numSegments > base) {
+        // appending carries on at the end of the last one moved in
+        struct stat st;
+        int fd = segmentFile(store, store->numSegments - 1);
+        ok = fd >= 0 && fstat(fd, &st) == 0 && ok;
+        store->end = ok ? st.st_size : SEGMENT_BYTES;
+    }
+
+    // then the entries; an empty one stays empty
+    for (int docID = 1; ok && docID <= from->slots; docID++) {
+        int segment;
+        off_t at;
+        size_t length;
+        int found = readEntry(from, docID, &segment, &at, &length);
+        if (found == 1) {
+            ok = writeEntry(store, offset + docID, base + segment, at, length);
+        } else {
+            ok = found == -1;
+        }
+    }
+    *count = from->slots;
+    for (int i = -1; ok && i >= DICTIONARIES; i--) {
+        char *path = filePath(pageDirectory, i);
+        ok = path && (unlink(path) == 0 || errno == ENOENT);
+        free(path);
+    }
+    docstoreClose(from);
+    return ok;
+}
+
+/**
+ * Closes every file of the docstore, and frees it; see docstore.h.
+ */
+void docstoreClose(docstore_t *store) {
+    if (!store) {
+        return;
+    }
+    if (store->table >= 0) {
+        close(store->table);
+    }
+    for (int i = 0; store->segments && i < store->numSegments; i++) {
+        if (store->segments[i] >= 0) {
+            close(store->segments[i]);
+        }
+    }
+    if (store->dictionaryFile >= 0) {
+        close(store->dictionaryFile);
+    }
+    for (int i = 0; i < store->numPresets; i++) {
+        free(store->presets[i].bytes);
+    }
+    free(store->presets);
+    dropSamples(store);
+    free(store->segments);
+    free(store->pageDirectory);
+    free(store);
+}
+
+/**
+ * Returns the malloc'd path of a docstore file: the table for segment -1, the dictionaries
+ * for DICTIONARIES, or a segment; NULL if out of memory.
+ */
+static char *filePath(const char *pageDirectory, const int segment) {
+    char *path = malloc(strlen(pageDirectory) + 32);
+    if (path) {
+        if (segment == DICTIONARIES) {
+            sprintf(path, "%s/.docstore.dict", pageDirectory);
+        } else if (segment < 0) {
+            sprintf(path, "%s/.docstore", pageDirectory);
+        } else {
+            sprintf(path, "%s/.docstore.%d", pageDirectory, segment);
+        }
+    }
+    return path;
+}
+
+/**
+ * Opens a docstore file to read and write, or, if that is not allowed, just to read;
+ * or creates it.  Returns the descriptor, or -1 with errno set.
+ */
+static int openFile(const char *path, const bool create) {
+    int fd = open(path, O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0 && !create && (errno == EACCES || errno == EROFS)) {
+        fd = open(path, O_RDONLY);
+    }
+    return fd;
+}
+
+/**
+ * Returns the descriptor of a segment, opening it on first use; -1 on error.
+ */
+static int segmentFile(docstore_t *store, const int segment) {
+    if (segment < 0 || segment >= store->numSegments) {
+        return -1;
+    }
+    if (store->segments[segment] < 0) {
+        char *path = filePath(store->pageDirectory, segment);
+        store->segments[segment] = path ? openFile(path, false) : -1;
+        free(path);
+    }
+    return store->segments[segment];
+}
+
+/**
+ * Creates the table, if there is none yet; false on error.
+ */
+static bool makeTable(docstore_t *store) {
+    if (store->table >= 0) {
+        return true;
+    }
+    char *path = filePath(store->pageDirectory, -1);
+    store->table = path ? openFile(path, true) : -1;
+    free(path);
+    store->created = store->created || store->table >= 0;
+    return store->table >= 0;
+}
+
+/**
+ * Begins a new, empty segment after the last; false on error.
+ */
+static bool addSegment(docstore_t *store) {
+    int *segments = realloc(store->segments, (store->numSegments + 1) * sizeof(int));
+    char *path = filePath(store->pageDirectory, store->numSegments);
+    if (segments) {
+        store->segments = segments;
+    }
+    int fd = segments && path ? openFile(path, true) : -1;
+    free(path);
+    if (fd < 0) {
+        return false;
+    }
+    store->segments[store->numSegments++] = fd;
+    store->end = 0;
+    store->created = true;
+    return true;
+}
+
+/**
+ * Looks up a docID's entry, reading the table ahead from it when it is not in the block.
+ * Returns 1 with the entry, -1 if the entry is empty or past the end, 0 on error.
+ */
+static int readEntry(docstore_t *store, const int docID, int *segment, off_t *offset,
+                     size_t *length) {
+    if (docID < 1 || docID > store->slots) {
+        return -1;
+    }
+    if (docID < store->blockFirst || docID >= store->blockFirst + store->blockCount) {
+        int count = store->slots - docID + 1 < BLOCK_ENTRIES ? store->slots - docID + 1
+                                                             : BLOCK_ENTRIES;
+        store->blockCount = 0;
+        if (!readAll(store->table, store->block, (size_t) count * ENTRY_BYTES,
+                     (off_t) (docID - 1) * ENTRY_BYTES)) {
+            return 0;
+        }
+        store->blockFirst = docID;
+        store->blockCount = count;
+    }
+    const unsigned char *entry = store->block + (size_t) (docID - store->blockFirst) * ENTRY_BYTES;
+    *offset = (off_t) getNumber(entry, 8);
+    *segment = (int) getNumber(entry + 8, 4);
+    *length = getNumber(entry + 12, 4);
+    if (*length == 0) {
+        return -1;
+    }
+    return (*length >= HEADER_BYTES && *segment < store->numSegments) ? 1 : 0;
+}
+
+/**
+ * Writes a docID's entry, and forgets the block if it held it; false on error.
+ */
+static bool writeEntry(docstore_t *store, const int docID, const int segment,
+                       const off_t offset, const size_t length) {
+    unsigned char entry[ENTRY_BYTES];
+    putNumber(entry, offset, 8);
+    putNumber(entry + 8, segment, 4);
+    putNumber(entry + 12, length, 4);
+    if (!writeAll(store->table, entry, ENTRY_BYTES, (off_t) (docID - 1) * ENTRY_BYTES)) {
+        return false;
+    }
+    if (docID >= store->blockFirst && docID < store->blockFirst + BLOCK_ENTRIES) {
+        store->blockCount = 0;
+    }
+    if (docID > store->slots) {
+        store->slots = docID;
+    }
+    store->tableDirty = true;
+    return true;
+}
+
+/**
+ * Reads exactly len bytes at offset, retrying short reads; false on error or end of file.
+ */
+static bool readAll(const int fd, void *buf, size_t len, off_t offset) {
+    unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t got = pread(fd, p, len, offset);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += got;
+        len -= got;
+        offset += got;
+    }
+    return true;
+}
+
+/**
+ * Writes exactly len bytes at offset, retrying short writes; false on error.
+ */
+static bool writeAll(const int fd, const void *buf, size_t len, off_t offset) {
+    const unsigned char *p = buf;
+    while (len > 0) {
+        ssize_t put = pwrite(fd, p, len, offset);
+        if (put < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += put;
+        len -= put;
+        offset += put;
+    }
+    return true;
+}
+
+/**
+ * Stores a number in the given number of bytes, little-endian.
+ */
+static void putNumber(unsigned char *p, uint64_t value, const int bytes) {
+    for (int i = 0; i < bytes; i++, value >>= 8) {
+        p[i] = value & 0xff;
+    }
+}
+
+/**
+ * Reads back a number stored by putNumber.
+ */
+static uint64_t getNumber(const unsigned char *p, const int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/**
+ * Reads every dictionary in the dictionaries file, if there is one, and notes where the
+ * next goes: after the last whole one, so that one cut short by a crash is written over.
+ * False on error.
+ */
+static bool loadPresets(docstore_t *store) {
+    char *path = filePath(store->pageDirectory, DICTIONARIES);
+    store->dictionaryFile = path ? openFile(path, false) : -1;
+    free(path);
+    if (store->dictionaryFile < 0) {
+        return errno == ENOENT;   // not compressing
+    }
+    struct stat st;
+    if (fstat(store->dictionaryFile, &st) != 0) {
+        return false;
+    }
+    unsigned char size[4];
+    for (off_t at = 0; at + 4 <= st.st_size; ) {
+        if (!readAll(store->dictionaryFile, size, 4, at)) {
+            return false;
+        }
+        size_t length = getNumber(size, 4);
+        if (length == 0 || at + 4 + (off_t) length > st.st_size) {
+            break;
+        }
+        unsigned char *bytes = malloc(length);
+        preset_t *presets = realloc(store->presets, (store->numPresets + 1) * sizeof(preset_t));
+        if (presets) {
+            store->presets = presets;
+        }
+        if (!bytes || !presets || !readAll(store->dictionaryFile, bytes, length, at + 4)) {
+            free(bytes);
+            return false;
+        }
+        presets[store->numPresets++] = (preset_t) { fingerprint(bytes, length), bytes, length };
+        at += 4 + length;
+        store->dictionaryEnd = at;
+    }
+    store->sampling = store->numPresets == 0;
+    return true;
+}
+
+/**
+ * Appends a dictionary to the dictionaries file, and to the presets, taking over its bytes
+ * (freed on error); the pages saved next are compressed with it.  False on error.
+ */
+static bool addPreset(docstore_t *store, unsigned char *bytes, const size_t length) {
+    preset_t *presets = realloc(store->presets, (store->numPresets + 1) * sizeof(preset_t));
+    if (presets) {
+        store->presets = presets;
+    }
+    unsigned char size[4];
+    putNumber(size, length, 4);
+    if (!presets || length == 0 || length > UINT32_MAX
+        || !writeAll(store->dictionaryFile, size, 4, store->dictionaryEnd)
+        || !writeAll(store->dictionaryFile, bytes, length, store->dictionaryEnd + 4)) {
+        free(bytes);
+        return false;
+    }
+    store->dictionaryEnd += 4 + length;
+    store->dictionaryDirty = true;
+    presets[store->numPresets++] = (preset_t) { fingerprint(bytes, length), bytes, length };
+    return true;
+}
+
+/**
+ * Returns the dictionary with the given fingerprint, or NULL if there is none.
+ */
+static const preset_t *findPreset(const docstore_t *store, const uint64_t id) {
+    for (int i = 0; i < store->numPresets; i++) {
+        if (store->presets[i].id == id) {
+            return &store->presets[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Keeps (the start of) a page to train on; with SAMPLE_PAGES of them, trains the first
+ * dictionary, and stops sampling whether or not one comes of it.
+ */
+static void addSample(docstore_t *store, const char *html, const size_t length) {
+    if (!store->samples && !(store->samples = malloc(SAMPLE_PAGES * sizeof(char *)))) {
+        return;
+    }
+    size_t n = length < SAMPLE_BYTES ? length : SAMPLE_BYTES;
+    char *sample = malloc(n + 1);
+    if (sample) {
+        memcpy(sample, html, n);
+        sample[n] = '\0';
+        store->samples[store->numSamples++] = sample;
+    }
+    if (store->numSamples == SAMPLE_PAGES) {
+        size_t dictionaryLength;
+        unsigned char *dictionary = dictionaryTrain((const char **) store->samples,
+                                                    store->numSamples, &dictionaryLength);
+        if (dictionary) {
+            addPreset(store, dictionary, dictionaryLength);
+        }
+        dropSamples(store);
+    }
+}
+
+/**
+ * Frees the samples, and stops sampling.
+ */
+static void dropSamples(docstore_t *store) {
+    for (int i = 0; i < store->numSamples; i++) {
+        free(store->samples[i]);
+    }
+    free(store->samples);
+    store->samples = NULL;
+    store->numSamples = 0;
+    store->sampling = false;
+}
+
+/**
+ * Compresses a page with the newest dictionary (or none, while sampling), filling in pack:
+ * the dictionary's fingerprint (0 for none) and the page's length.  Returns the compressed
+ * page, malloc'd, with its length; or NULL if it is no smaller, or on error, so the page is
+ * stored as it is.
+ */
+static unsigned char *compressPage(docstore_t *store, const char *html, const size_t length,
+                                   unsigned char *pack, size_t *packedLength) {
+    if (store->sampling && length > 0) {
+        addSample(store, html, length);
+    }
+    const preset_t *preset = store->numPresets > 0 ? &store->presets[store->numPresets - 1]
+                                                   : NULL;
+    unsigned char *packed = dictionaryCompress(preset ? preset->bytes : NULL,
+                                               preset ? preset->length : 0,
+                                               html, length, packedLength);
+    if (packed && PACK_BYTES + *packedLength >= length) {
+        free(packed);
+        return NULL;
+    }
+    putNumber(pack, preset ? preset->id : 0, 8);
+    putNumber(pack + 8, length, 4);
+    return packed;
+}
+
+/**
+ * Expands a compressed page, as stored after its URL: the pack, then the zlib stream.
+ * Returns the page, malloc'd; or NULL if it is damaged or its dictionary is missing.
+ */
+static char *expandPage(const docstore_t *store, const unsigned char *data, const size_t length) {
+    if (length < PACK_BYTES) {
+        return NULL;
+    }
+    uint64_t id = getNumber(data, 8);
+    const preset_t *preset = id != 0 ? findPreset(store, id) : NULL;
+    if (id != 0 && !preset) {
+        return NULL;
+    }
+    return dictionaryExpand(preset ? preset->bytes : NULL, preset ? preset->length : 0,
+                            data + PACK_BYTES, length - PACK_BYTES, getNumber(data + 8, 4));
+}
@@ -0,0 +1,146 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * docstore.h -- header file for CS50 'docstore' module
+ *
+ * A docstore keeps the pages of a page directory packed into a few large
+ * files, instead of one file per page.  Pages are appended, as records,
+ * to segment files '.docstore.0', '.docstore.1', ..., each filled to about
+ * 256 MB before the next is begun; a record is
+ *
+ *     urlLength depth htmlLength url html
+ *
+ * with the three numbers 4-byte little-endian integers and no terminators.
+ * The table '.docstore' holds one 16-byte entry per docID, in docID order
+ * (document d at byte 16*(d-1)): the 8-byte offset of its record, the
+ * 4-byte number of the segment it is in, and the record's 4-byte length;
+ * an all-zero entry means there is no such document.
+ *
+ * So a million pages cost a handful of files, not a million; finding a
+ * page is one read of the table (usually already cached) and one of its
+ * record; and reading the pages in docID order, as the indexer does, reads
+ * each segment front to back.
+ *
+ * A docstore may compress the pages it saves (see docstoreCompress); then
+ * it has a third file, '.docstore.dict', of the preset dictionaries pages
+ * are compressed against, each a 4-byte length and its bytes.  A page is
+ * stored compressed only if that makes it smaller; then its htmlLength has
+ * its top bit set, and its html is the 8-byte fingerprint of the dictionary
+ * it was compressed with (0 for none), its 4-byte length once expanded, and
+ * the zlib stream.  Every reader expands it, so it loads as it was saved.
+ *
+ * Nothing is ever overwritten: saving a docID again appends a new record
+ * and points its entry at it, leaving the old one as dead space.  An entry
+ * is written only after its record, so a process that crashes leaves no
+ * entry pointing at a partial record.  A system crash or power loss may
+ * write the files back in any order; only what was synced (docstoreSync)
+ * before it is sure to be whole, which is what checkpoints rely on.
+ *
+ * A docstore is not thread-safe; the pagedir module serializes its use.
+ */
+
+#ifndef __DOCSTORE_H_
+#define __DOCSTORE_H_
+
+#include <stdbool.h>
+
+typedef struct docstore docstore_t;  // opaque to users of the module
+
+/**
+ * @brief Opens the docstore of a page directory, for reading and appending.
+ *
+ * Its files are created by the first docstorePut; until then, every document is missing.
+ * A docstore in a directory that cannot be written can still be read.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @return The docstore, or NULL if out of memory or its files cannot be opened.
+ * Note: The caller is responsible for calling docstoreClose.
+ */
+docstore_t *docstoreOpen(const char *pageDirectory);
+
+/**
+ * @brief Appends a document's record, and points docID's entry at it.
+ *
+ * Saving a docID that is already there replaces it.  Entries between the highest docID
+ * so far and this one are left empty.
+ *
+ * @param store The docstore.
+ * @param docID The document's ID, at least 1.
+ * @param url The document's URL.
+ * @param depth The depth at which it was found.
+ * @param html Its HTML.
+ * @return True if the record and its entry were written, false otherwise.
+ */
+bool docstorePut(docstore_t *store, const int docID, const char *url, const int depth,
+                 const char *html);
+
+/**
+ * @brief Reads a document back.
+ *
+ * @param store The docstore.
+ * @param docID The document's ID.
+ * @param url Where to store its URL, malloc'd.
+ * @param depth Where to store its depth.
+ * @param html Where to store its HTML, malloc'd; or NULL, to read only the URL and depth.
+ * @return 1 on success, -1 if there is no such document, 0 for other failures
+ *         (a damaged record, a read error, or out of memory), as pageDirLoad does.
+ * Note: On success, the caller is responsible for freeing *url and *html.
+ */
+int docstoreGet(docstore_t *store, const int docID, char **url, int *depth, char **html);
+
+/**
+ * @brief Returns the highest docID the table has an entry for (some may be empty).
+ */
+int docstoreCount(const docstore_t *store);
+
+/**
+ * @brief Makes the docstore compress every page it saves from now on.
+ *
+ * The choice is kept in the page directory, so the docstore compresses whenever it is opened
+ * again, until it is truncated to nothing.  The first pages saved are kept as a sample; once
+ * there are enough, a dictionary is trained on them (see dictionary.h), and later pages are
+ * compressed against it.  Until then they are compressed without one.
+ *
+ * @return True if done, false otherwise.
+ */
+bool docstoreCompress(docstore_t *store);
+
+/**
+ * @brief Removes every document numbered above lastDocID.
+ *
+ * Their records stay in the segments as dead space, except that with lastDocID 0, the
+ * segments, the table and the dictionaries are removed altogether.
+ *
+ * @return True if done, false otherwise.
+ */
+bool docstoreTruncate(docstore_t *store, const int lastDocID);
+
+/**
+ * @brief Makes everything appended so far durable (fsync), records before entries.
+ *
+ * @return True if done, false otherwise.
+ */
+bool docstoreSync(docstore_t *store);
+
+/**
+ * @brief Moves the documents of another page directory's docstore into this one, renumbered.
+ *
+ * The other docstore's segments are renamed into this directory, after this one's, and its
+ * document n gets entry offset+n here; so the pages themselves are not copied, and the
+ * other directory must be on the same file system.  Its dictionaries are added to this one's
+ * (which then compresses too, if it did not).  The other docstore is then removed.
+ *
+ * @param store The docstore the documents move into.
+ * @param pageDirectory The page directory whose docstore they move from.
+ * @param offset The docID just before the first one its documents get.
+ * @param count Where to store the highest docID it had (0 if it had no docstore).
+ * @return True if everything was moved, false otherwise.
+ */
+bool docstoreMerge(docstore_t *store, const char *pageDirectory, const int offset, int *count);
+
+/**
+ * @brief Closes the docstore's files, and frees it.  NULL is ignored.
+ */
+void docstoreClose(docstore_t *store);
+
+#endif //__DOCSTORE_H_
@@ -0,0 +1,75 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * fingerprint.c -- 64-bit fingerprints of strings and byte blocks
+ *
+ * The hash is MurmurHash64A (Austin Appleby, public domain), with the
+ * input read byte by byte into little-endian words so that every machine
+ * computes the same fingerprint for the same bytes.
+ *
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "fingerprint.h"
+
+static const uint64_t MULTIPLIER = 0xc6a4a7935bd1e995ULL;
+static const int SHIFT = 47;
+static const uint64_t SEED = 0x54534543726177ULL;   // any fixed value will do
+
+/**************** local functions ****************/
+static uint64_t readWord(const unsigned char *p, const size_t n);
+
+
+/**
+ * Computes the fingerprint of len bytes at data; see fingerprint.h.
+ */
+uint64_t fingerprint(const void *data, const size_t len) {
+    const unsigned char *p = data;
+    uint64_t h = SEED ^ (len * MULTIPLIER);
+
+    // mix in the input eight bytes at a time
+    size_t words = len / 8;
+    for (size_t i = 0; i < words; i++, p += 8) {
+        uint64_t k = readWord(p, 8);
+        k *= MULTIPLIER;
+        k ^= k >> SHIFT;
+        k *= MULTIPLIER;
+        h ^= k;
+        h *= MULTIPLIER;
+    }
+
+    // then whatever is left over
+    size_t rest = len % 8;
+    if (rest > 0) {
+        h ^= readWord(p, rest);
+        h *= MULTIPLIER;
+    }
+
+    // final avalanche, so every input bit affects every output bit
+    h ^= h >> SHIFT;
+    h *= MULTIPLIER;
+    h ^= h >> SHIFT;
+
+    // 0 is reserved to mean "no fingerprint"
+    return h != 0 ? h : 1;
+}
+
+/**
+ * Computes the fingerprint of a string; see fingerprint.h.
+ */
+uint64_t fingerprintString(const char *str) {
+    return str ? fingerprint(str, strlen(str)) : fingerprint(NULL, 0);
+}
+
+/**
+ * Reads n (at most 8) bytes as a little-endian number.
+ */
+static uint64_t readWord(const unsigned char *p, const size_t n) {
+    uint64_t k = 0;
+    for (size_t i = n; i > 0; i--) {
+        k = (k << 8) | p[i - 1];
+    }
+    return k;
+}
@@ -0,0 +1,40 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * fingerprint.h -- header file for CS50 'fingerprint' module
+ *
+ * A fingerprint is a 64-bit hash of a string or a block of bytes, good
+ * enough that two different inputs practically never share one: among a
+ * billion inputs, the chance of any collision at all is about 3%, and
+ * among a million it is below one in ten million.  Modules that must
+ * recognise inputs they have met before (URLs, page contents) can keep
+ * just the fingerprint instead of the input itself.
+ */
+
+#ifndef __FINGERPRINT_H_
+#define __FINGERPRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Computes the fingerprint of a block of bytes.
+ *
+ * The result depends only on the bytes, never on the machine's byte
+ * order or word size, so fingerprints may be saved and compared later.
+ *
+ * @param data The bytes to fingerprint; may be NULL only if len is 0.
+ * @param len The number of bytes.
+ * @return The 64-bit fingerprint; never 0, so callers may use 0 as "none".
+ */
+uint64_t fingerprint(const void *data, const size_t len);
+
+/**
+ * @brief Computes the fingerprint of a null-terminated string (without its null).
+ *
+ * @param str The string to fingerprint; NULL is treated like "".
+ * @return The 64-bit fingerprint; never 0.
+ */
+uint64_t fingerprintString(const char *str);
+
+#endif //__FINGERPRINT_H_
@@ -30,6 +30,7 @@ typedef struct hashtable index_t;
 /**************** global functions ****************/
 index_t *indexInit(const int slots);
 int indexAdd(index_t *index, const char *word, const int docID);
+int indexPage(index_t *index, webpage_t *page, const int docID);
 counters_t *indexFind(index_t *index, const char *word);
 int indexUpdate(index_t *index, const char *word, const int docID, const int freq);
 index_t *indexLoad(const char* fn);
@@ -79,6 +80,23 @@ int indexAdd(index_t *index, const char *word, const int docID) {
 }
 
 
+/* Add every word of 3 or more letters in a webpage to the index */
+int indexPage(index_t *index, webpage_t *page, const int docID) {
+    if (index == NULL || page == NULL || docID < 1) {   // validate arguments
+        return -1;
+    }
+    int pos = 0;
+    char *word;
+    while ((word = webpage_getNextWord(page, &pos)) != NULL) {  // step through each word
+        int result = strlen(word) >= 3 ? indexAdd(index, word, docID) : 0; // skip trivial words
+        mem_free(word);
+        if (result != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /* Find the counters set associated with a word in the index */
 counters_t *indexFind(index_t *index, const char *word) {
     if (index == NULL || word == NULL) {    // validate args
@@ -13,6 +13,7 @@
 
 #include "hashtable.h"
 #include "counters.h"
+#include "webpage.h"
 
 #ifndef IndexCoeff
 #define IndexCoeff 825 // Default size for hashtable; can be overridden at compile time
@@ -55,6 +56,20 @@ index_t *indexInit(const int slots);
  */
 int indexAdd(index_t *index, const char *word, const int docID);
 
+/**
+ * @brief Adds every word of a webpage to the index under its document ID.
+ *
+ * Words are the runs of letters outside HTML tags, as found by webpage_getNextWord;
+ * those shorter than 3 letters are skipped, and the rest are normalized to lower case.
+ * This is how both the indexer and the crawler's fused index mode index a page.
+ *
+ * @param index The index to update.
+ * @param page The webpage, with its HTML.
+ * @param docID The document ID the page is saved under.
+ * @return 0 on success, -1 on failure (e.g., invalid arguments or memory allocation failure).
+ */
+int indexPage(index_t *index, webpage_t *page, const int docID);
+
 /**
  * @brief Retrieves the counters set associated with a given word in the index.
  *
@@ -0,0 +1,437 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * manifest.c -- one file of every document's URL, depth, length and fingerprint
+ *
+ * see manifest.h for the format.  manifestRecord appends one line per page
+ * saved to '.manifest.log', as pagedir appends validators, so the crawler
+ * never reads its pages back for them.  manifestWrite gathers the entries
+ * and the strings from those lines in memory, and writes them out at the
+ * end, since the header needs the count; manifestOpen maps the file and
+ * checks it once, so that manifestGet is only arithmetic.
+ *
+*/
+
+#define _POSIX_C_SOURCE 200809L   // mmap, st_mtim
+#define _FILE_OFFSET_BITS 64      // manifests past 2 GB on 32-bit machines
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <inttypes.h>
+#include "manifest.h"
+#include "pagedir.h"
+#include "fingerprint.h"
+#include "webpage.h"
+#include "mem.h"
+#include "file.h"
+
+#define MAGIC "TSEMANI1"
+#define HEADER_BYTES 32   // magic, count, 0, the table's size and modification time
+#define ENTRY_BYTES 24    // fingerprint, URL offset, depth, length
+
+/**************** global types ****************/
+struct manifest {
+    unsigned char *map;        // the whole file
+    size_t size;               // bytes of it
+    int count;                 // entries
+    const char *strings;       // the URLs, after the entries
+    size_t stringBytes;
+};
+
+/* a growing buffer, for the entries and the strings as they are gathered */
+typedef struct buffer {
+    unsigned char *data;
+    size_t used, size;
+} buffer_t;
+
+/**************** local functions ****************/
+static char *filePath(const char *pageDirectory, const char *name);
+static void tableStamp(const char *pageDirectory, uint64_t *size, uint64_t *time);
+static unsigned char *grow(buffer_t *buffer, const size_t bytes);
+static bool putEntry(buffer_t *entries, buffer_t *strings, const int docID, const char *url,
+                     const int depth, const size_t length, const uint64_t hash);
+static bool parseRecord(char *line, int *docID, int *depth, size_t *length, uint64_t *hash,
+                        const char **url);
+static void putNumber(unsigned char *p, uint64_t value, const int bytes);
+static uint64_t getNumber(const unsigned char *p, const int bytes);
+
+
+/**
+ * Gathers the entries and strings from the lines of '.manifest.log', the last line for a
+ * docID winning, and from the pages any docID up to the last one missing lacks a line for;
+ * then writes the header, the entries and the strings to '.manifest.tmp' and renames it
+ * '.manifest'; see manifest.h.
+ */
+bool manifestWrite(const char *pageDirectory) {
+    if (!pageDirectory) {
+        return false;
+    }
+
+    // Note the table first: a page saved while we read makes the manifest stale, not wrong
+    uint64_t stampSize, stampTime;
+    tableStamp(pageDirectory, &stampSize, &stampTime);
+
+    buffer_t entries = {NULL, 0, 0}, strings = {NULL, 0, 0};
+    bool ok = true;
+    char *log = filePath(pageDirectory, ".manifest.log");
+    FILE *fp = log ? fopen(log, "r") : NULL;
+    free(log);
+    if (fp) {
+        char *line;
+        while (ok && (line = file_readLine(fp)) != NULL) {
+            int docID, depth;
+            size_t length;
+            uint64_t hash;
+            const char *url;
+            if (parseRecord(line, &docID, &depth, &length, &hash, &url)) {
+                ok = putEntry(&entries, &strings, docID, url, depth, length, hash);
+            }
+            mem_free(line);
+        }
+        fclose(fp);
+    }
+
+    // Read only the pages with no line: saved by a crawl before there was a log, or just
+    // before a crash; past the last line, up to the first one missing
+    int docID = 1, found = 0;
+    webpage_t *page;
+    for (; ok && docID < INT32_MAX; docID++) {
+        size_t at = (size_t) (docID - 1) * ENTRY_BYTES;
+        if (at < entries.used && getNumber(entries.data + at, 8) != 0) {
+            continue;
+        }
+        if ((found = pageDirLoad(&page, pageDirectory, docID)) != 1) {
+            if (at < entries.used && found == -1) {
+                continue;   // no such document: its entry stays 0
+            }
+            break;
+        }
+        const char *html = webpage_getHTML(page);
+        size_t htmlLength = html ? strlen(html) : 0;
+        ok = putEntry(&entries, &strings, docID, webpage_getURL(page), webpage_getDepth(page),
+                      htmlLength, fingerprint(html, htmlLength));
+        webpage_delete(page);
+    }
+    ok = ok && found == -1;
+
+    // Write it aside, then put it in place
+    char *temp = filePath(pageDirectory, ".manifest.tmp");
+    char *path = filePath(pageDirectory, ".manifest");
+    fp = NULL;
+    if (ok && temp && path && (fp = fopen(temp, "wb"))) {
+        unsigned char header[HEADER_BYTES] = MAGIC;
+        putNumber(header + 8, entries.used / ENTRY_BYTES, 4);
+        putNumber(header + 12, 0, 4);
+        putNumber(header + 16, stampSize, 8);
+        putNumber(header + 24, stampTime, 8);
+        ok = fwrite(header, HEADER_BYTES, 1, fp) == 1
+            && fwrite(entries.data, 1, entries.used, fp) == entries.used
+            && fwrite(strings.data, 1, strings.used, fp) == strings.used;
+        ok = (fclose(fp) == 0) && ok && rename(temp, path) == 0;
+        if (!ok) {
+            remove(temp);
+        }
+    } else {
+        ok = false;
+    }
+
+    free(temp);
+    free(path);
+    free(entries.data);
+    free(strings.data);
+    return ok;
+}
+
+/**
+ * Appends "docID<TAB>depth<TAB>length<TAB>fingerprint<TAB>URL" to '.manifest.log', the
+ * fingerprint in hex; as with the validators, the line goes out in a single write to a file
+ * opened for appending.  See manifest.h.
+ */
+bool manifestRecord(const char *pageDirectory, const int docID, const char *url,
+                    const int depth, const size_t length, const uint64_t hash) {
+    if (!pageDirectory || docID < 1 || !url || url[strcspn(url, "\t\n")] != '\0'
+        || depth < 0 || length > UINT32_MAX || hash == 0) {
+        return false;
+    }
+    char *path = filePath(pageDirectory, ".manifest.log");
+    FILE *fp = path ? fopen(path, "a") : NULL;
+    free(path);
+    if (!fp) {
+        return false;
+    }
+    bool ok = fprintf(fp, "%d\t%d\t%zu\t%016" PRIx64 "\t%s\n", docID, depth, length, hash, url) > 0;
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
+}
+
+/**
+ * Appends a segment's lines to the page directory's log, each renumbered after offset,
+ * then removes the segment's log; see manifest.h.
+ */
+bool manifestMerge(const char *pageDirectory, const char *segment, const int offset) {
+    if (!pageDirectory || !segment || offset < 0) {
+        return false;
+    }
+    char *from = filePath(segment, ".manifest.log");
+    char *to = filePath(pageDirectory, ".manifest.log");
+    FILE *in = from ? fopen(from, "r") : NULL;
+    FILE *out = in && to ? fopen(to, "a") : NULL;
+    bool ok = from && to && (in == NULL || out != NULL);
+    if (in && out) {
+        // the whole segment's lines in one file opened once, not a line at a time
+        char *line;
+        while ((line = file_readLine(in)) != NULL) {
+            int docID, depth;
+            size_t length;
+            uint64_t hash;
+            const char *url;
+            if (parseRecord(line, &docID, &depth, &length, &hash, &url)) {
+                ok = fprintf(out, "%d\t%d\t%zu\t%016" PRIx64 "\t%s\n",
+                             offset + docID, depth, length, hash, url) > 0 && ok;
+            }
+            mem_free(line);
+        }
+    }
+    if (out) {
+        ok = (fclose(out) == 0) && ok;
+    }
+    if (in) {
+        fclose(in);
+        remove(from);
+    }
+    free(from);
+    free(to);
+    return ok;
+}
+
+/**
+ * Removes '.manifest.log'; see manifest.h.
+ */
+void manifestClear(const char *pageDirectory) {
+    char *path = pageDirectory ? filePath(pageDirectory, ".manifest.log") : NULL;
+    if (path) {
+        remove(path);
+    }
+    free(path);
+}
+
+/**
+ * Maps '.manifest', and checks that its header, its entries and its strings fit in it, that
+ * the last string ends, and that it was made from the docstore table there is now.
+ */
+manifest_t *manifestOpen(const char *pageDirectory) {
+    if (!pageDirectory) {
+        return NULL;
+    }
+    char *path = filePath(pageDirectory, ".manifest");
+    int fd = path ? open(path, O_RDONLY) : -1;
+    free(path);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat status;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && status.st_size >= HEADER_BYTES) {
+        map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);   // the mapping stays
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    manifest_t *manifest = malloc(sizeof(manifest_t));
+    if (!manifest) {
+        munmap(map, status.st_size);
+        return NULL;
+    }
+    manifest->map = map;
+    manifest->size = status.st_size;
+    manifest->count = getNumber(manifest->map + 8, 4);
+    size_t stringsAt = HEADER_BYTES + (size_t) manifest->count * ENTRY_BYTES;
+    manifest->strings = (const char *) manifest->map + stringsAt;
+    manifest->stringBytes = manifest->size - stringsAt;
+
+    uint64_t stampSize, stampTime;
+    tableStamp(pageDirectory, &stampSize, &stampTime);
+    if (memcmp(manifest->map, MAGIC, 8) != 0 || manifest->count < 0
+        || stringsAt > manifest->size
+        || (manifest->count > 0 && (manifest->stringBytes == 0
+                                    || manifest->strings[manifest->stringBytes - 1] != '\0'))
+        || getNumber(manifest->map + 16, 8) != stampSize
+        || getNumber(manifest->map + 24, 8) != stampTime) {
+        manifestClose(manifest);
+        return NULL;
+    }
+    return manifest;
+}
+
+/**
+ * Returns the number of entries.
+ */
+int manifestCount(const manifest_t *manifest) {
+    return manifest ? manifest->count : 0;
+}
+
+/**
+ * Reads docID's entry, in place; see manifest.h.
+ */
+bool manifestGet(const manifest_t *manifest, const int docID, manifestEntry_t *entry) {
+    if (!manifest || !entry || docID < 1 || docID > manifest->count) {
+        return false;
+    }
+    const unsigned char *p = manifest->map + HEADER_BYTES + (size_t) (docID - 1) * ENTRY_BYTES;
+    uint64_t hash = getNumber(p, 8);
+    uint64_t urlOffset = getNumber(p + 8, 8);
+    if (hash == 0 || urlOffset >= manifest->stringBytes) {
+        return false;
+    }
+    entry->url = manifest->strings + urlOffset;
+    entry->depth = getNumber(p + 16, 4);
+    entry->length = getNumber(p + 20, 4);
+    entry->hash = hash;
+    return true;
+}
+
+/**
+ * Unmaps the manifest and frees it.
+ */
+void manifestClose(manifest_t *manifest) {
+    if (manifest) {
+        munmap(manifest->map, manifest->size);
+        free(manifest);
+    }
+}
+
+/**
+ * Returns the path of a file in the page directory, malloc'd; or NULL if out of memory.
+ */
+static char *filePath(const char *pageDirectory, const char *name) {
+    char *path = malloc(strlen(pageDirectory) + strlen(name) + 2);
+    if (path) {
+        sprintf(path, "%s/%s", pageDirectory, name);
+    }
+    return path;
+}
+
+/**
+ * Notes the docstore table's size and modification time, in ns, or 0 and 0 if it has none;
+ * every page saved, and every truncation, changes one or the other.
+ */
+static void tableStamp(const char *pageDirectory, uint64_t *size, uint64_t *time) {
+    struct stat status;
+    char *path = filePath(pageDirectory, ".docstore");
+    *size = *time = 0;
+    if (path && stat(path, &status) == 0) {
+        *size = status.st_size;
+        *time = (uint64_t) status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+    }
+    free(path);
+}
+
+/**
+ * Makes room for bytes more at the end of a buffer, doubling it as needed, and returns
+ * where they go; or NULL if out of memory.  Earlier pointers into it may move.
+ */
+static unsigned char *grow(buffer_t *buffer, const size_t bytes) {
+    if (buffer->used + bytes > buffer->size) {
+        size_t size = buffer->size ? buffer->size : 4096;
+        while (size < buffer->used + bytes) {
+            size *= 2;
+        }
+        unsigned char *data = realloc(buffer->data, size);
+        if (!data) {
+            return NULL;
+        }
+        buffer->data = data;
+        buffer->size = size;
+    }
+    buffer->used += bytes;
+    return buffer->data + buffer->used - bytes;
+}
+
+/**
+ * Stores a number in the given number of bytes, least significant first.
+ */
+static void putNumber(unsigned char *p, uint64_t value, const int bytes) {
+    for (int i = 0; i < bytes; i++, value >>= 8) {
+        p[i] = value & 0xff;
+    }
+}
+
+/**
+ * Reads back a number stored by putNumber.
+ */
+static uint64_t getNumber(const unsigned char *p, const int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/**
+ * Stores docID's entry, and its URL after the strings, growing the entries with zeroed ones
+ * up to docID as needed; false if out of memory, or if the HTML is too long to record.
+ */
+static bool putEntry(buffer_t *entries, buffer_t *strings, const int docID, const char *url,
+                     const int depth, const size_t length, const uint64_t hash) {
+    size_t at = (size_t) (docID - 1) * ENTRY_BYTES;
+    if (at + ENTRY_BYTES > entries->used) {
+        size_t used = entries->used;
+        if (!grow(entries, at + ENTRY_BYTES - used)) {
+            return false;
+        }
+        memset(entries->data + used, 0, entries->used - used);
+    }
+    size_t urlLength = strlen(url) + 1;
+    unsigned char *string = grow(strings, urlLength);
+    if (!string || length > UINT32_MAX) {
+        return false;
+    }
+    memcpy(string, url, urlLength);
+    unsigned char *entry = entries->data + at;
+    putNumber(entry, hash, 8);
+    putNumber(entry + 8, string - strings->data, 8);
+    putNumber(entry + 16, depth, 4);
+    putNumber(entry + 20, length, 4);
+    return true;
+}
+
+/**
+ * Splits a line written by manifestRecord, in place; false if it does not parse (say, one
+ * cut short by a crash).
+ */
+static bool parseRecord(char *line, int *docID, int *depth, size_t *length, uint64_t *hash,
+                        const char **url) {
+    char *end;
+    long id = strtol(line, &end, 10);
+    if (*end != '\t' || id < 1 || id >= INT32_MAX) {
+        return false;
+    }
+    long d = strtol(end + 1, &end, 10);
+    if (*end != '\t' || d < 0 || d > INT32_MAX) {
+        return false;
+    }
+    unsigned long long n = strtoull(end + 1, &end, 10);
+    if (*end != '\t' || n > UINT32_MAX) {
+        return false;
+    }
+    unsigned long long h = strtoull(end + 1, &end, 16);
+    if (*end != '\t' || h == 0 || end[1] == '\0') {
+        return false;
+    }
+    *docID = id;
+    *depth = d;
+    *length = n;
+    *hash = h;
+    *url = end + 1;
+    return true;
+}
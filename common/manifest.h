@@ -0,0 +1,120 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * manifest.h -- header file for CS50 'manifest' module
+ *
+ * A manifest lists, for every docID of a page directory, the page's URL, depth, length and
+ * content fingerprint, in one file, '.manifest', laid out to be used in place once mapped
+ * into memory.  So a program that needs the URLs of many documents -- the querier, printing
+ * its results -- maps the manifest once, and finds each URL with no file I/O at all, where
+ * getPageUrl reads the page directory for every one.
+ *
+ * The file, with every number little-endian:
+ *
+ *     header   "TSEMANI1", count (4 bytes), 0 (4 bytes),
+ *              the docstore table's size and modification time in ns (8 bytes each)
+ *     entries  count of them, one per docID from 1: fingerprint of the HTML (8 bytes),
+ *              offset of the URL in the strings (8), depth (4), length of the HTML (4);
+ *              a fingerprint of 0 means there is no such document
+ *     strings  the URLs, each followed by a '\0'
+ *
+ * As it saves each page, the crawler records the page's entry with manifestRecord, a line
+ * appended to '.manifest.log'; once every page is saved, manifestWrite builds the manifest
+ * from those lines, without reading the pages back.  The manifest records which docstore
+ * table it was made from, so a manifest left behind by a crawl that was later resumed or
+ * re-crawled is not used.
+ */
+
+#ifndef __MANIFEST_H_
+#define __MANIFEST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct manifest manifest_t;  // opaque to users of the module
+
+/* what the manifest holds for one document */
+typedef struct manifestEntry {
+    const char *url;    // in the mapped manifest: valid until manifestClose
+    int depth;          // the depth at which the crawler found it
+    size_t length;      // bytes of its HTML
+    uint64_t hash;      // fingerprint of its HTML (see fingerprint.h)
+} manifestEntry_t;
+
+/**
+ * @brief Records a saved page's entry, for manifestWrite.
+ *
+ * One line, "docID<TAB>depth<TAB>length<TAB>fingerprint<TAB>URL", is appended to
+ * '.manifest.log'; a later line for the same docID replaces an earlier one.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @param docID The document's ID.
+ * @param url Its URL, with no tab or newline.
+ * @param depth The depth at which the crawler found it.
+ * @param length Bytes of its HTML.
+ * @param hash Fingerprint of its HTML (see fingerprint.h).
+ * @return True if the line was written, false otherwise.
+ */
+bool manifestRecord(const char *pageDirectory, const int docID, const char *url,
+                    const int depth, const size_t length, const uint64_t hash);
+
+/**
+ * @brief Moves a segment's recorded entries into a page directory, renumbered after offset,
+ * as pageDirMerge moves its pages.
+ *
+ * @param pageDirectory The directory the pages move into.
+ * @param segment The directory holding documents 1 to n.
+ * @param offset The docID just before the first one the segment's pages get.
+ * @return True if every entry was moved, or the segment has none; false otherwise.
+ */
+bool manifestMerge(const char *pageDirectory, const char *segment, const int offset);
+
+/**
+ * @brief Forgets all recorded entries, as a new crawl into the page directory begins.
+ */
+void manifestClear(const char *pageDirectory);
+
+/**
+ * @brief Writes the manifest of every page in a page directory, replacing any earlier one.
+ *
+ * The entries are those recorded, in docID order from 1.  Only a page with none -- saved
+ * before pages were recorded, say -- is read, up to the first docID missing, as the indexer
+ * reads them.  The manifest is written aside, then renamed into place.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @return True if written, false otherwise.
+ */
+bool manifestWrite(const char *pageDirectory);
+
+/**
+ * @brief Maps a page directory's manifest into memory, read-only.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @return The manifest, or NULL if there is none, it does not match the pages saved now,
+ *         or it is damaged; the caller may then fall back on getPageUrl.
+ * Note: The caller is responsible for calling manifestClose.
+ */
+manifest_t *manifestOpen(const char *pageDirectory);
+
+/**
+ * @brief Returns the number of docIDs the manifest covers, 1 to that number.
+ */
+int manifestCount(const manifest_t *manifest);
+
+/**
+ * @brief Looks a document up.
+ *
+ * @param manifest The manifest.
+ * @param docID The document's ID.
+ * @param entry Where to store what the manifest holds for it.
+ * @return True if the manifest has the document, false otherwise.
+ */
+bool manifestGet(const manifest_t *manifest, const int docID, manifestEntry_t *entry);
+
+/**
+ * @brief Unmaps the manifest, and frees it.  NULL is ignored.
+ */
+void manifestClose(manifest_t *manifest);
+
+#endif //__MANIFEST_H_
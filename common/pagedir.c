@@ -7,6 +7,11 @@
  * those directories, load webpages from those files, validate page directories, and retrieve URLs
  * from document files. It is primarily used by the TSE's crawler and querier modules.
  *
+ * Pages are packed into the page directory's docstore (see docstore.h). The docstore last used
+ * is kept open, under a lock, so a process that saves or loads page after page in one directory
+ * opens its files once, and the crawler's threads may share it. Pages saved one file per page,
+ * before the docstore, are still loaded.
+ *
 */
 
 #include <stdlib.h>
@@ -14,17 +19,51 @@
 #include <string.h>
 #include <dirent.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
 #include <math.h>
+#include <pthread.h>
 #include "pagedir.h"
+#include "docstore.h"
+#include "manifest.h"
 #include "webpage.h"
 #include "mem.h"
 #include "file.h"
 
 /**************** global functions ****************/
 bool pageDirInit(const char *pageDirectory);
-void pageDirSave(webpage_t *page, const char* pageDirectory, int fn);
+bool pageDirSave(webpage_t *page, const char* pageDirectory, int fn);
 int pageDirLoad(webpage_t **page, const char* pageDirectory, int docID);
 bool pageDirValidate(const char* pageDirectory);
+bool pageDirSaveValidators(const char* pageDirectory, const int docID,
+                           const char* etag, const char* lastModified);
+void pageDirClearValidators(const char* pageDirectory);
+bool pageDirLoadValidators(const char* pageDirectory, void* arg,
+                           void (*itemfunc)(void* arg, const int docID,
+                                            const char* etag, const char* lastModified));
+bool pageDirSaveAlias(const char* pageDirectory, const int docID, const char* url);
+void pageDirClearAliases(const char* pageDirectory);
+bool pageDirMerge(const char* pageDirectory, const char* segment, const int offset, int* count);
+bool pageDirSync(const char* pageDirectory);
+bool pageDirCompress(const char* pageDirectory);
+bool pageDirTruncate(const char* pageDirectory, const int lastDocID);
+
+/**************** local types and functions ****************/
+/* what pageDirMerge passes to mergeValidator for each line */
+typedef struct merge {
+    const char* pageDirectory;
+    int offset;
+    bool ok;
+} merge_t;
+static void mergeValidator(void* arg, const int docID,
+                           const char* etag, const char* lastModified);
+static docstore_t *storeFor(const char *pageDirectory);
+static void forgetStore(const char *pageDirectory);
+
+/* the docstore last used, and its directory; storeLock guards both, and its use */
+static pthread_mutex_t storeLock = PTHREAD_MUTEX_INITIALIZER;
+static docstore_t *openStore = NULL;
+static char *openDirectory = NULL;
 
 
 /**
@@ -59,47 +98,62 @@ bool pageDirInit(const char *pageDirectory) {
 }
 
 /**
- * Saves a webpage's content to a file within a page directory. The file is named using
- * an integer ID, and it contains the webpage's URL, depth, and HTML content.
+ * Saves a webpage's URL, depth, and HTML content as one record in the page directory's
+ * docstore, under the given document ID.
  * 
  * @param page The webpage to save.
  * @param pageDirectory The directory where the page will be saved.
- * @param fn The file ID used for naming the file.
+ * @param fn The document ID to save it as.
  */
-void pageDirSave(webpage_t *page, const char* pageDirectory, int fn) {
-    if (!page || !pageDirectory || fn < 0) {
-        return; // Invalid input handling
-    }
-
-    // Construct the file name and open the file
-    char fileName[strlen(pageDirectory) + (int) log10(fn) + 3];
-    sprintf(fileName, "%s/%d", pageDirectory, fn);
-    FILE *fp = fopen(fileName, "w");
-    if (!fp) {
-        return;
+bool pageDirSave(webpage_t *page, const char* pageDirectory, int fn) {
+    if (!page || !pageDirectory || fn < 1) {
+        return false; // Invalid input handling
     }
 
-    // Write the webpage data to the file
-    fprintf(fp, "%s\n%d\n%s\n", webpage_getURL(page), webpage_getDepth(page), webpage_getHTML(page));
-    fclose(fp);
+    pthread_mutex_lock(&storeLock);
+    docstore_t *store = storeFor(pageDirectory);
+    bool ok = store && docstorePut(store, fn, webpage_getURL(page), webpage_getDepth(page),
+                                   webpage_getHTML(page));
+    pthread_mutex_unlock(&storeLock);
+    return ok;
 }
 
 /**
- * Loads a webpage from a file within a page directory. The file should contain the webpage's
- * URL, depth, and HTML content, in that order.
+ * Loads a webpage from the page directory's docstore or, failing that, from a file of its
+ * own, which should contain the webpage's URL, depth, and HTML content, in that order.
  * 
  * @param page Pointer to a webpage pointer where the loaded webpage will be stored.
- * @param pageDirectory The directory containing the webpage file.
- * @param docID The file ID corresponding to the webpage.
- * @return 1 on success, -1 if the file is invalid, and 0 for other failures.
+ * @param pageDirectory The directory containing the webpage.
+ * @param docID The document ID of the webpage.
+ * @return 1 on success, -1 if there is no such page, and 0 for other failures.
  */
 int pageDirLoad(webpage_t **page, const char* pageDirectory, int docID) {
     if (!page || !pageDirectory || docID < 1) {
         return 0; // Invalid input handling
     }
 
+    // Look the page up in the docstore
+    char *storedURL, *storedHTML;
+    int storedDepth;
+    pthread_mutex_lock(&storeLock);
+    docstore_t *store = storeFor(pageDirectory);
+    int found = store ? docstoreGet(store, docID, &storedURL, &storedDepth, &storedHTML) : 0;
+    pthread_mutex_unlock(&storeLock);
+    if (found == 1) {
+        *page = webpage_new(storedURL, storedDepth, storedHTML);
+        if (!*page) {
+            mem_free(storedURL);
+            mem_free(storedHTML);
+            return 0; // Allocation failure
+        }
+        return 1;
+    }
+    if (found == 0) {
+        return 0;
+    }
+
     // Construct the file name and open the file
-    char docFile[strlen(pageDirectory) + (int) log10(docID) + 2];
+    char docFile[strlen(pageDirectory) + (int) log10(docID) + 3];
     sprintf(docFile, "%s/%d", pageDirectory, docID);
     FILE *fp = fopen(docFile, "r");
     if (!fp) {
@@ -111,6 +165,9 @@ int pageDirLoad(webpage_t **page, const char* pageDirectory, int docID) {
     char *depthStr = file_readLine(fp);
     char *html = file_readFile(fp);
     int depth = atoi(depthStr);
+    if (html && *html && html[strlen(html) - 1] == '\n') {
+        html[strlen(html) - 1] = '\0'; // the newline written after the page, not part of it
+    }
     
     // Allocate and initialize the webpage
     *page = webpage_new(url, depth, html);
@@ -164,8 +221,19 @@ char *getPageUrl(const char *pageDirectory, const int docID) {
         return NULL;
     }
 
+    // Read just the URL and depth from the docstore
+    char *url;
+    int depth;
+    pthread_mutex_lock(&storeLock);
+    docstore_t *store = storeFor(pageDirectory);
+    int found = store ? docstoreGet(store, docID, &url, &depth, NULL) : 0;
+    pthread_mutex_unlock(&storeLock);
+    if (found != -1) {
+        return found == 1 ? url : NULL;
+    }
+
     // Construct the file name and open the file
-    char docFile[strlen(pageDirectory) + (int) log10(docID) + 2];
+    char docFile[strlen(pageDirectory) + (int) log10(docID) + 3];
     sprintf(docFile, "%s/%d", pageDirectory, docID);
     FILE *fp = fopen(docFile, "r");
     if (!fp) {
@@ -173,7 +241,314 @@ char *getPageUrl(const char *pageDirectory, const int docID) {
     }
 
     // Read the URL from the file
-    char *url = file_readLine(fp);
+    url = file_readLine(fp);
     fclose(fp);
     return url; // Caller is responsible for freeing the URL string
-}
\ No newline at end of file
+}
+
+/**
+ * Appends a page's validators to the .validators file of a page directory, as one line
+ * "docID<TAB>etag<TAB>lastModified", with an empty field for a missing validator.
+ * Each line goes out in a single write to a file opened for appending, so workers
+ * saving pages at the same time do not interleave their lines.
+ *
+ * @param pageDirectory The directory holding the pages.
+ * @param docID The document ID of the page.
+ * @param etag The ETag, or NULL.
+ * @param lastModified The Last-Modified date, or NULL.
+ * @return True if the line was written, false otherwise.
+ */
+bool pageDirSaveValidators(const char* pageDirectory, const int docID,
+                           const char* etag, const char* lastModified) {
+    if (!pageDirectory || docID < 1) {
+        return false;
+    }
+    etag = etag ? etag : "";
+    lastModified = lastModified ? lastModified : "";
+    if (etag[strcspn(etag, "\t\n")] != '\0' || lastModified[strcspn(lastModified, "\t\n")] != '\0') {
+        return false; // cannot be stored on one line
+    }
+
+    char fileName[strlen(pageDirectory) + 13];
+    sprintf(fileName, "%s/.validators", pageDirectory);
+    FILE *fp = fopen(fileName, "a");
+    if (!fp) {
+        return false;
+    }
+    // stdio buffers the whole line and writes it at fclose
+    bool ok = fprintf(fp, "%d\t%s\t%s\n", docID, etag, lastModified) > 0;
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
+}
+
+/**
+ * Removes the .validators file of a page directory, if there is one.
+ *
+ * @param pageDirectory The directory holding the pages.
+ */
+void pageDirClearValidators(const char* pageDirectory) {
+    if (!pageDirectory) {
+        return;
+    }
+    char fileName[strlen(pageDirectory) + 13];
+    sprintf(fileName, "%s/.validators", pageDirectory);
+    remove(fileName);
+}
+
+/**
+ * Reads the .validators file of a page directory, calling itemfunc on each line.
+ * Lines that do not parse (say, one cut short by a crash) are skipped.
+ *
+ * @param pageDirectory The directory holding the pages.
+ * @param arg Passed through to itemfunc.
+ * @param itemfunc Called with the docID and validators (NULL if missing) of each line.
+ * @return True if the file was read or does not exist, false otherwise.
+ */
+bool pageDirLoadValidators(const char* pageDirectory, void* arg,
+                           void (*itemfunc)(void* arg, const int docID,
+                                            const char* etag, const char* lastModified)) {
+    if (!pageDirectory || !itemfunc) {
+        return false;
+    }
+
+    char fileName[strlen(pageDirectory) + 13];
+    sprintf(fileName, "%s/.validators", pageDirectory);
+    FILE *fp = fopen(fileName, "r");
+    if (!fp) {
+        return pageDirValidate(pageDirectory); // no validators saved yet
+    }
+
+    char *line;
+    while ((line = file_readLine(fp)) != NULL) {
+        // split "docID<TAB>etag<TAB>lastModified"
+        char *etag = strchr(line, '\t');
+        char *lastModified = etag ? strchr(etag + 1, '\t') : NULL;
+        int docID = atoi(line);
+        if (lastModified && docID > 0) {
+            *etag++ = '\0';
+            *lastModified++ = '\0';
+            itemfunc(arg, docID, *etag ? etag : NULL, *lastModified ? lastModified : NULL);
+        }
+        mem_free(line);
+    }
+    fclose(fp);
+    return true;
+}
+
+/**
+ * Appends an alias to the .aliases file of a page directory, as one line "docID<TAB>URL":
+ * the URL served a page identical to the one saved as docID. As with the validators, the
+ * line goes out in a single write to a file opened for appending.
+ *
+ * @param pageDirectory The directory holding the pages.
+ * @param docID The document ID the content is saved under.
+ * @param url The duplicate's URL.
+ * @return True if the line was written, false otherwise.
+ */
+bool pageDirSaveAlias(const char* pageDirectory, const int docID, const char* url) {
+    if (!pageDirectory || docID < 1 || !url || url[strcspn(url, "\t\n")] != '\0') {
+        return false;
+    }
+
+    char fileName[strlen(pageDirectory) + 10];
+    sprintf(fileName, "%s/.aliases", pageDirectory);
+    FILE *fp = fopen(fileName, "a");
+    if (!fp) {
+        return false;
+    }
+    bool ok = fprintf(fp, "%d\t%s\n", docID, url) > 0;
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
+}
+
+/**
+ * Removes the .aliases file of a page directory, if there is one.
+ *
+ * @param pageDirectory The directory holding the pages.
+ */
+void pageDirClearAliases(const char* pageDirectory) {
+    if (!pageDirectory) {
+        return;
+    }
+    char fileName[strlen(pageDirectory) + 10];
+    sprintf(fileName, "%s/.aliases", pageDirectory);
+    remove(fileName);
+}
+
+/**
+ * Moves a segment's pages, aliases, manifest entries and validators into a page directory, renumbered
+ * after offset, then removes the segment. The pages are renamed, not copied: the
+ * segment's docstore files, or else its page files, so the segment must be on the
+ * same file system (a subdirectory, say).
+ *
+ * @param pageDirectory The directory the pages move into.
+ * @param segment The directory holding documents 1 to n.
+ * @param offset The docID just before the first one the segment's pages get.
+ * @param count Where to store n.
+ * @return True if everything was moved, false otherwise.
+ */
+bool pageDirMerge(const char* pageDirectory, const char* segment, const int offset, int* count) {
+    if (!pageDirectory || !segment || offset < 0 || !count) {
+        return false;
+    }
+    size_t length = strlen(pageDirectory) > strlen(segment) ? strlen(pageDirectory) : strlen(segment);
+    char from[length + 16];
+    char to[length + 16];
+
+    // the pages: the segment's docstore, moved in after this directory's
+    pthread_mutex_lock(&storeLock);
+    forgetStore(segment);
+    docstore_t *store = storeFor(pageDirectory);
+    int n = 0;
+    bool ok = store && docstoreMerge(store, segment, offset, &n);
+    pthread_mutex_unlock(&storeLock);
+
+    // or, if it had none, its page files, until the first docID missing
+    for (bool files = ok && n == 0; files; n++) {
+        sprintf(from, "%s/%d", segment, n + 1);
+        sprintf(to, "%s/%d", pageDirectory, offset + n + 1);
+        if (rename(from, to) != 0) {
+            ok = (errno == ENOENT);
+            break;
+        }
+    }
+    *count = n;
+
+    // the aliases, as "docID<TAB>URL" lines
+    sprintf(from, "%s/.aliases", segment);
+    FILE *fp = fopen(from, "r");
+    if (fp) {
+        char *line;
+        while ((line = file_readLine(fp)) != NULL) {
+            char *url = strchr(line, '\t');
+            int docID = atoi(line);
+            if (url && docID > 0) {
+                ok = pageDirSaveAlias(pageDirectory, offset + docID, url + 1) && ok;
+            }
+            mem_free(line);
+        }
+        fclose(fp);
+        remove(from);
+    }
+
+    // the manifest's entries
+    ok = manifestMerge(pageDirectory, segment, offset) && ok;
+
+    // the validators
+    merge_t merge = { pageDirectory, offset, true };
+    ok = pageDirLoadValidators(segment, &merge, mergeValidator) && merge.ok && ok;
+    pageDirClearValidators(segment);
+
+    // and the segment itself, now empty
+    sprintf(from, "%s/.crawler", segment);
+    remove(from);
+    return rmdir(segment) == 0 && ok;
+}
+
+/**
+ * pageDirLoadValidators helper for pageDirMerge: saves one segment's validators
+ * in the page directory, renumbered.
+ */
+static void mergeValidator(void* arg, const int docID,
+                           const char* etag, const char* lastModified) {
+    merge_t *merge = arg;
+    if (!pageDirSaveValidators(merge->pageDirectory, merge->offset + docID, etag, lastModified)) {
+        merge->ok = false;
+    }
+}
+
+/**
+ * Makes every page saved so far in a page directory durable, by syncing its docstore.
+ *
+ * @param pageDirectory The directory holding the pages.
+ * @return True if synced, false otherwise.
+ */
+bool pageDirSync(const char* pageDirectory) {
+    if (!pageDirectory) {
+        return false;
+    }
+    pthread_mutex_lock(&storeLock);
+    docstore_t *store = storeFor(pageDirectory);
+    bool ok = store && docstoreSync(store);
+    pthread_mutex_unlock(&storeLock);
+    return ok;
+}
+
+/**
+ * Makes a page directory compress the pages saved in it from now on, through its docstore.
+ *
+ * @param pageDirectory The directory holding the pages.
+ * @return True if done, false otherwise.
+ */
+bool pageDirCompress(const char* pageDirectory) {
+    if (!pageDirectory) {
+        return false;
+    }
+    pthread_mutex_lock(&storeLock);
+    docstore_t *store = storeFor(pageDirectory);
+    bool ok = store && docstoreCompress(store);
+    pthread_mutex_unlock(&storeLock);
+    return ok;
+}
+
+/**
+ * Removes every page numbered above lastDocID from a page directory: from its docstore, and
+ * any files of their own, numbered from lastDocID+1 up to the first one missing.
+ *
+ * @param pageDirectory The directory holding the pages.
+ * @param lastDocID The last docID to keep; 0 removes every page.
+ * @return True if the docstore was cut back, false otherwise.
+ */
+bool pageDirTruncate(const char* pageDirectory, const int lastDocID) {
+    if (!pageDirectory || lastDocID < 0) {
+        return false;
+    }
+    pthread_mutex_lock(&storeLock);
+    docstore_t *store = storeFor(pageDirectory);
+    bool ok = store && docstoreTruncate(store, lastDocID);
+    pthread_mutex_unlock(&storeLock);
+
+    char fileName[strlen(pageDirectory) + 16];
+    for (int id = lastDocID + 1; ; id++) {
+        sprintf(fileName, "%s/%d", pageDirectory, id);
+        if (remove(fileName) != 0) {
+            break;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Returns the docstore of a page directory: the one open, if it is that directory's, or
+ * else a newly opened one, which is kept open in its place. NULL if it cannot be opened.
+ * The caller holds storeLock.
+ */
+static docstore_t *storeFor(const char *pageDirectory) {
+    if (openStore && strcmp(openDirectory, pageDirectory) == 0) {
+        return openStore;
+    }
+    forgetStore(openDirectory);
+    char *directory = malloc(strlen(pageDirectory) + 1);
+    docstore_t *store = directory ? docstoreOpen(pageDirectory) : NULL;
+    if (!store) {
+        free(directory);
+        return NULL;
+    }
+    strcpy(directory, pageDirectory);
+    openStore = store;
+    openDirectory = directory;
+    return store;
+}
+
+/**
+ * Closes the open docstore if it is that of the given directory, whose files are about to
+ * change under it. The caller holds storeLock.
+ */
+static void forgetStore(const char *pageDirectory) {
+    if (openStore && pageDirectory && strcmp(openDirectory, pageDirectory) == 0) {
+        docstoreClose(openStore);
+        free(openDirectory);
+        openStore = NULL;
+        openDirectory = NULL;
+    }
+}
@@ -6,6 +6,10 @@
  * This module facilitates operations on directories used by a web crawler to store webpages.
  * It includes functionality to initialize a new page directory, save webpages to the directory,
  * load webpages from the directory, validate the directory, and retrieve URLs for specific document IDs.
+ *
+ * Pages are kept packed in the directory's docstore (see docstore.h), not in one file per page;
+ * a directory saved one file per page, as before, can still be loaded. These functions may be
+ * called from several threads at once.
  */
 
 #ifndef __PAGE_DIR_H_
@@ -22,25 +26,30 @@
 bool pageDirInit(const char *pageDirectory);
 
 /**
- * @brief Saves a webpage to a file within the specified page directory.
+ * @brief Saves a webpage to the specified page directory.
  *
- * The webpage's URL, depth, and HTML content are written to a file named using the given file ID.
+ * The webpage's URL, depth, and HTML content are appended to the directory's docstore as the
+ * document with the given ID, replacing any page saved under that ID before.
  *
  * @param page The webpage to save.
  * @param pageDirectory The path to the page directory where the webpage should be saved.
- * @param fn The file ID to use for naming the saved webpage file.
+ * @param fn The document ID to save it as.
+ * @return True if the whole page was written, false otherwise.
  *
- * Note: If any of the parameters are invalid (e.g., NULL page or pageDirectory, or negative fn), the function does nothing.
+ * Note: If any of the parameters are invalid (e.g., NULL page or pageDirectory, or fn below 1), the function does nothing.
  */
-void pageDirSave(webpage_t *page, const char* pageDirectory, const int fn);
+bool pageDirSave(webpage_t *page, const char* pageDirectory, const int fn);
 
 /**
- * @brief Loads a webpage from a file within a crawler directory into a webpage object.
+ * @brief Loads a webpage from a crawler directory into a webpage object.
+ *
+ * The page comes back exactly as it was saved. Loading pages in docID order reads the
+ * docstore from front to back.
  *
  * @param page A pointer to a webpage object pointer where the loaded webpage will be stored.
- * @param pageDirectory The path to the crawler directory containing the webpage file.
- * @param docID The document ID corresponding to the webpage file to load.
- * @return -1 if the webpage file is invalid, 0 for other failures, and 1 on success.
+ * @param pageDirectory The path to the crawler directory containing the webpage.
+ * @param docID The document ID of the webpage to load.
+ * @return -1 if there is no such webpage, 0 for other failures, and 1 on success.
  */
 int pageDirLoad(webpage_t **page, const char* pageDirectory, int docID);
 
@@ -64,4 +73,106 @@ bool pageDirValidate(const char* pageDirectory);
  */
 char *getPageUrl(const char *pageDirectory, const int docID);
 
+/**
+ * @brief Records the HTTP validators (ETag, Last-Modified) a page was served with.
+ *
+ * Validators are appended, one line per call, to the .validators file in the page directory,
+ * so that a later re-crawl can fetch the page conditionally. A later line for the same docID
+ * replaces an earlier one; a line with neither validator clears them.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @param docID The document ID of the saved page.
+ * @param etag The page's ETag, or NULL.
+ * @param lastModified The page's Last-Modified date, or NULL.
+ * @return True if the line was written, false otherwise (including values holding a tab or newline).
+ */
+bool pageDirSaveValidators(const char* pageDirectory, const int docID,
+                           const char* etag, const char* lastModified);
+
+/**
+ * @brief Forgets all recorded validators, as a new crawl into the page directory begins.
+ *
+ * @param pageDirectory The path to the page directory.
+ */
+void pageDirClearValidators(const char* pageDirectory);
+
+/**
+ * @brief Reads back the validators recorded by pageDirSaveValidators.
+ *
+ * itemfunc is called once per recorded line, in the order the lines were written, with NULL
+ * for a missing validator; the strings are valid only during the call.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @param arg Passed through to itemfunc.
+ * @param itemfunc Called for each line.
+ * @return True if the file was read (or there is none yet), false if it could not be opened.
+ */
+bool pageDirLoadValidators(const char* pageDirectory, void* arg,
+                           void (*itemfunc)(void* arg, const int docID,
+                                            const char* etag, const char* lastModified));
+
+/**
+ * @brief Records that a URL's page is identical to a page already saved, and was not saved again.
+ *
+ * Aliases are appended, one "docID<TAB>URL" line per call, to the .aliases file in the page
+ * directory, where docID is the page the URL's content was first saved under.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @param docID The document ID the content is saved under.
+ * @param url The URL whose page is a duplicate.
+ * @return True if the line was written, false otherwise.
+ */
+bool pageDirSaveAlias(const char* pageDirectory, const int docID, const char* url);
+
+/**
+ * @brief Forgets all recorded aliases, as a new crawl into the page directory begins.
+ *
+ * @param pageDirectory The path to the page directory.
+ */
+void pageDirClearAliases(const char* pageDirectory);
+
+/**
+ * @brief Moves the pages of another page directory (a segment) into this one, renumbered.
+ *
+ * The segment's document n becomes document offset+n here, so segments merged one after
+ * another, each at an offset just past the last, get disjoint docID ranges that together
+ * run from 1 with no gaps. The segment's aliases, manifest entries (see manifest.h) and
+ * validators are added to this directory's, renumbered the same way, and the emptied segment is removed.
+ *
+ * @param pageDirectory The path to the page directory the pages move into.
+ * @param segment The path to a page directory holding documents 1 to n, with no gaps.
+ * @param offset The docID just before the first one the segment's pages get.
+ * @param count Where to store n, the number of pages moved.
+ * @return True if every page, alias and validator was moved, false otherwise.
+ */
+bool pageDirMerge(const char* pageDirectory, const char* segment, const int offset, int* count);
+
+/**
+ * @brief Makes every page saved so far in the page directory durable (fsync).
+ *
+ * @param pageDirectory The path to the page directory.
+ * @return True if everything saved is on disk, false otherwise.
+ */
+bool pageDirSync(const char* pageDirectory);
+
+/**
+ * @brief Makes the page directory save every page from now on compressed, against a dictionary
+ *        trained on its first pages (see docstore.h); pageDirLoad expands them again.
+ *
+ * The choice stays with the page directory until pageDirTruncate removes every page.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @return True if done, false otherwise.
+ */
+bool pageDirCompress(const char* pageDirectory);
+
+/**
+ * @brief Removes every page numbered above lastDocID, as when a crawl goes back to a checkpoint.
+ *
+ * @param pageDirectory The path to the page directory.
+ * @param lastDocID The last document ID to keep; 0 removes every page.
+ * @return True if the pages were removed, false otherwise.
+ */
+bool pageDirTruncate(const char* pageDirectory, const int lastDocID);
+
 #endif // __PAGE_DIR_H_
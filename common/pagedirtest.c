@@ -0,0 +1,291 @@
+/**
+ * CS50 TSE, 2024
+ *
+ * pagedirtest.c -- testing program for the page directory and its docstore
+ *
+ * usage: ./pagedirtest pageDirectory
+ *        ./pagedirtest -l pageDirectory
+ *        ./pagedirtest -c pageDirectory1 pageDirectory2
+ *        ./pagedirtest -m pageDirectory
+ *
+ * Round-trips pages through an empty page directory: saves some, saves one again
+ * (replacing it), truncates, saves after the truncation, and reads pages saved the old way,
+ * one file per page, from a subdirectory 'legacy' of it.  Each step prints "ok" or what went
+ * wrong; the exit status is the number of steps that went wrong.
+ *
+ * With -l, lists the pages of a crawled page directory instead, one line per docID from 1:
+ * the fingerprint of its HTML, the HTML's length and its URL.  Sorted, the lists of two crawls
+ * of the same site are equal if the crawls saved the same pages, whatever their docIDs.
+ *
+ * With -c, compares two crawled page directories: every docID must load from both, up to the
+ * first missing from both, with the same URL, depth and HTML, byte for byte.  Prints how many
+ * documents are the same, or the first that is not; the exit status is 1 if one is not.
+ *
+ * With -m, lists what the page directory's manifest holds for each docID, as -l lists the pages
+ * themselves, so the two lists are equal if the manifest is right.  The exit status is 1 if there
+ * is no manifest for the pages saved now, or it is missing a docID.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include "pagedir.h"
+#include "fingerprint.h"
+#include "manifest.h"
+#include "webpage.h"
+#include "mem.h"
+
+/**************** local functions ****************/
+static bool save(const char *pageDirectory, const int docID, const char *url, const int depth,
+                 const char *html);
+static bool loads(const char *pageDirectory, const int docID, const char *url, const int depth,
+                  const char *html);
+static bool missing(const char *pageDirectory, const int docID);
+static int report(const char *step, const bool ok);
+static int list(const char *pageDirectory);
+static int compare(const char *pageDirectory1, const char *pageDirectory2);
+static int listManifest(const char *pageDirectory);
+
+/* pages to save: the second holds control and high bytes, the last is empty */
+static const char *URLS[] = {
+    "http://cs50tse.cs.dartmouth.edu/tse/letters/index.html",
+    "http://cs50tse.cs.dartmouth.edu/tse/letters/A.html",
+    "http://cs50tse.cs.dartmouth.edu/tse/letters/B.html",
+};
+static const char *HTMLS[] = {
+    "<html><title>home</title>\n<a href=A.html>A</a>\n</html>\n",
+    "<html>\n\n\tA \x01\x7f\xff page,\r\nwith blank lines\n\n</html>",
+    "",
+};
+
+
+/**
+ * Runs each step on the page directory given, which must exist and be empty.
+ */
+int main(const int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "-l") == 0) {
+        return list(argv[2]);
+    }
+    if (argc == 4 && strcmp(argv[1], "-c") == 0) {
+        return compare(argv[2], argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "-m") == 0) {
+        return listManifest(argv[2]);
+    }
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s pageDirectory\n", argv[0]);
+        fprintf(stderr, "       %s -l pageDirectory\n", argv[0]);
+        fprintf(stderr, "       %s -c pageDirectory1 pageDirectory2\n", argv[0]);
+        fprintf(stderr, "       %s -m pageDirectory\n", argv[0]);
+        exit(1);
+    }
+    const char *dir = argv[1];
+    if (!pageDirInit(dir)) {
+        fprintf(stderr, "ERROR: cannot initialize %s\n", dir);
+        exit(2);
+    }
+    int failed = 0;
+
+    // save: every page loads back as it was saved, and the next docID is missing
+    bool ok = true;
+    for (int i = 0; i < 3; i++) {
+        ok = save(dir, i + 1, URLS[i], i, HTMLS[i]) && ok;
+    }
+    for (int i = 0; i < 3; i++) {
+        ok = loads(dir, i + 1, URLS[i], i, HTMLS[i]) && ok;
+    }
+    failed += report("save", ok && missing(dir, 4));
+
+    // replace: saving a docID again replaces it, and leaves the others alone
+    ok = save(dir, 2, URLS[1], 5, "<html>the second version</html>")
+        && loads(dir, 2, URLS[1], 5, "<html>the second version</html>")
+        && loads(dir, 1, URLS[0], 0, HTMLS[0])
+        && loads(dir, 3, URLS[2], 2, HTMLS[2]);
+    failed += report("replace", ok);
+
+    // truncate: the pages after lastDocID are gone, those before it stay
+    ok = pageDirTruncate(dir, 1)
+        && loads(dir, 1, URLS[0], 0, HTMLS[0])
+        && missing(dir, 2) && missing(dir, 3);
+    failed += report("truncate", ok);
+
+    // and the docIDs cut off may be saved again
+    ok = save(dir, 2, URLS[2], 1, HTMLS[2])
+        && loads(dir, 2, URLS[2], 1, HTMLS[2])
+        && loads(dir, 1, URLS[0], 0, HTMLS[0])
+        && missing(dir, 3);
+    failed += report("save after truncate", ok);
+
+    // legacy: a page directory of one file per page, "URL\ndepth\nHTML\n", with no docstore
+    char legacy[strlen(dir) + 16];
+    sprintf(legacy, "%s/legacy", dir);
+    ok = mkdir(legacy, 0755) == 0 && pageDirInit(legacy);
+    for (int i = 0; ok && i < 2; i++) {
+        char file[strlen(legacy) + 16];
+        sprintf(file, "%s/%d", legacy, i + 1);
+        FILE *fp = fopen(file, "w");
+        ok = fp && fprintf(fp, "%s\n%d\n%s\n", URLS[i], i, HTMLS[i]) > 0;
+        ok = fp && fclose(fp) == 0 && ok;
+    }
+    ok = ok && loads(legacy, 1, URLS[0], 0, HTMLS[0])
+        && loads(legacy, 2, URLS[1], 1, HTMLS[1])
+        && missing(legacy, 3);
+    failed += report("legacy files", ok);
+
+    return failed;
+}
+
+/**
+ * Saves a page made of copies of url and html as docID; true if saved.
+ */
+static bool save(const char *pageDirectory, const int docID, const char *url, const int depth,
+                 const char *html) {
+    char *urlCopy = mem_malloc(strlen(url) + 1);
+    char *htmlCopy = mem_malloc(strlen(html) + 1);
+    if (!urlCopy || !htmlCopy) {
+        mem_free(urlCopy);
+        mem_free(htmlCopy);
+        return false;
+    }
+    strcpy(urlCopy, url);
+    strcpy(htmlCopy, html);
+    webpage_t *page = webpage_new(urlCopy, depth, htmlCopy);
+    bool ok = page && pageDirSave(page, pageDirectory, docID);
+    webpage_delete(page);
+    if (!ok) {
+        printf("cannot save document %d\n", docID);
+    }
+    return ok;
+}
+
+/**
+ * Loads docID; true if it is there, with exactly the URL, depth and HTML given.
+ */
+static bool loads(const char *pageDirectory, const int docID, const char *url, const int depth,
+                  const char *html) {
+    webpage_t *page = NULL;
+    int found = pageDirLoad(&page, pageDirectory, docID);
+    bool ok = found == 1 && strcmp(webpage_getURL(page), url) == 0
+        && webpage_getDepth(page) == depth
+        && webpage_getHTML(page) && strcmp(webpage_getHTML(page), html) == 0;
+    if (!ok) {
+        printf("document %d of %s does not load back as saved (found %d)\n",
+               docID, pageDirectory, found);
+    }
+    if (found == 1) {
+        webpage_delete(page);
+    }
+    return ok;
+}
+
+/**
+ * True if docID is reported missing, as the indexer's loop expects at the end of the pages.
+ */
+static bool missing(const char *pageDirectory, const int docID) {
+    webpage_t *page = NULL;
+    int found = pageDirLoad(&page, pageDirectory, docID);
+    if (found == 1) {
+        webpage_delete(page);
+    }
+    if (found != -1) {
+        printf("document %d of %s is not missing (found %d)\n", docID, pageDirectory, found);
+    }
+    return found == -1;
+}
+
+/**
+ * Prints a step's result; returns 1 if it went wrong, 0 if not.
+ */
+static int report(const char *step, const bool ok) {
+    printf("%s: %s\n", step, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+/**
+ * Prints each page of the page directory, up to the first docID missing; returns 1 if a page
+ * could not be read, or the directory is not a page directory, 0 if not.
+ */
+static int list(const char *pageDirectory) {
+    if (!pageDirValidate(pageDirectory)) {
+        fprintf(stderr, "ERROR: %s is not a page directory\n", pageDirectory);
+        return 1;
+    }
+    webpage_t *page = NULL;
+    int docID, found;
+    for (docID = 1; (found = pageDirLoad(&page, pageDirectory, docID)) == 1; docID++) {
+        const char *html = webpage_getHTML(page);
+        printf("%016" PRIx64 " %zu %s\n", fingerprint(html, strlen(html)), strlen(html),
+               webpage_getURL(page));
+        webpage_delete(page);
+    }
+    if (found == 0) {
+        fprintf(stderr, "ERROR: cannot read document %d of %s\n", docID, pageDirectory);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Loads each docID from both page directories in turn, and stops at the first that is not in
+ * both alike; returns 1 if there is one, or a directory is not a page directory, 0 if not.
+ */
+static int compare(const char *pageDirectory1, const char *pageDirectory2) {
+    if (!pageDirValidate(pageDirectory1) || !pageDirValidate(pageDirectory2)) {
+        fprintf(stderr, "ERROR: %s or %s is not a page directory\n", pageDirectory1,
+                pageDirectory2);
+        return 1;
+    }
+    for (int docID = 1; ; docID++) {
+        webpage_t *page1 = NULL, *page2 = NULL;
+        int found1 = pageDirLoad(&page1, pageDirectory1, docID);
+        int found2 = pageDirLoad(&page2, pageDirectory2, docID);
+        bool same = found1 == found2;
+        if (same && found1 == 1) {
+            const char *html1 = webpage_getHTML(page1), *html2 = webpage_getHTML(page2);
+            same = strcmp(webpage_getURL(page1), webpage_getURL(page2)) == 0
+                && webpage_getDepth(page1) == webpage_getDepth(page2)
+                && strlen(html1) == strlen(html2) && strcmp(html1, html2) == 0;
+        }
+        if (found1 == 1) {
+            webpage_delete(page1);
+        }
+        if (found2 == 1) {
+            webpage_delete(page2);
+        }
+        if (!same || found1 == 0) {
+            printf("document %d differs (found %d and %d)\n", docID, found1, found2);
+            return 1;
+        }
+        if (found1 == -1) {
+            printf("%d documents, the same in both\n", docID - 1);
+            return 0;
+        }
+    }
+}
+
+/**
+ * Prints what the manifest holds for each docID, in the form list prints; returns 1 if there is
+ * no manifest for the pages saved now, or a docID it covers is missing from it, 0 if not.
+ */
+static int listManifest(const char *pageDirectory) {
+    manifest_t *manifest = manifestOpen(pageDirectory);
+    if (manifest == NULL) {
+        fprintf(stderr, "ERROR: %s has no manifest of the pages saved in it\n", pageDirectory);
+        return 1;
+    }
+    int failed = 0;
+    for (int docID = 1; docID <= manifestCount(manifest); docID++) {
+        manifestEntry_t entry;
+        if (!manifestGet(manifest, docID, &entry)) {
+            fprintf(stderr, "ERROR: the manifest of %s has no document %d\n", pageDirectory, docID);
+            failed = 1;
+            break;
+        }
+        printf("%016" PRIx64 " %zu %s\n", entry.hash, entry.length, entry.url);
+    }
+    manifestClose(manifest);
+    return failed;
+}
@@ -0,0 +1,323 @@
+/*
+ * checkpoint.c - save and restore the state of a crawl
+ *
+ * see checkpoint.h for more information.
+ *
+ * The .checkpoint file is mostly text:
+ *
+ *     TSE checkpoint 4
+ *     seed <seedURL>
+ *     maxDepth <maxDepth>
+ *     lastID <lastID>
+ *     log .validators <bytes>
+ *     log .aliases <bytes>
+ *     log .manifest.log <bytes>
+ *     seen
+ *     <the seen-set, as written by seenset_save>
+ *     contents
+ *     <the dedup table, as written by dedup_save>
+ *     pages
+ *     <depth> <URL>          (one line per waiting page)
+ *     end
+ *
+ * The final "end" line shows the file is complete.  Loading checks it
+ * before inserting any page into the frontier, so a damaged checkpoint
+ * changes nothing.
+ *
+ * The "log" lines give the length of each of pagedir's append-only logs
+ * at the checkpoint; on resume they are cut back to it, since any line
+ * added later describes a page that is about to be fetched again.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // getline, fileno, fsync, truncate
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "pagedir.h"
+#include "seenset.h"
+#include "dedup.h"
+#include "frontier.h"
+#include "scheduler.h"
+#include "webpage.h"
+
+/**************** file-local types ****************/
+/* what scheduler_iterate carries to savePage */
+typedef struct pageWriter {
+  FILE* fp;
+  bool ok;
+} pageWriter_t;
+
+/**************** file-local constants ****************/
+static const char* HEADER = "TSE checkpoint 4";
+static const char* LOGS[] = {     // pagedir's append-only logs
+  ".validators",
+  ".aliases",
+  ".manifest.log",
+  NULL
+};
+
+/**************** local functions ****************/
+static char* pathOf(const char* pageDirectory, const char* name);
+static void savePage(void* arg, webpage_t* page);
+static char* readLine(FILE* fp, char** line, size_t* cap);
+static bool readPage(const char* line, int* depth, const char** url);
+static bool saveLogSizes(FILE* fp, const char* pageDirectory);
+static bool readLogSizes(FILE* fp, char** line, size_t* cap, long* sizes);
+static void truncateLogs(const char* pageDirectory, const long* sizes);
+
+/**************** checkpoint_save ****************/
+/* see checkpoint.h for description */
+bool
+checkpoint_save(const char* pageDirectory, const char* seedURL,
+                const int maxDepth, const int lastID,
+                const seenset_t* seen, const dedup_t* contents,
+                frontier_t* frontier, scheduler_t* scheduler)
+{
+  char* path = pathOf(pageDirectory, ".checkpoint");
+  char* temp = pathOf(pageDirectory, ".checkpoint.tmp");
+  FILE* fp = temp ? fopen(temp, "w") : NULL;
+  if (fp == NULL) {
+    free(path);
+    free(temp);
+    return false;
+  }
+
+  pageWriter_t writer = { fp, true };
+  writer.ok = fprintf(fp, "%s\nseed %s\nmaxDepth %d\nlastID %d\n",
+                      HEADER, seedURL, maxDepth, lastID) >= 0
+    && saveLogSizes(fp, pageDirectory)
+    && fprintf(fp, "seen\n") >= 0
+    && seenset_save(seen, fp)
+    && fprintf(fp, "contents\n") >= 0
+    && dedup_save(contents, fp)
+    && fprintf(fp, "pages\n") >= 0;
+  // the scheduler's pages left the frontier first, so they go first
+  if (writer.ok) {
+    scheduler_iterate(scheduler, &writer, savePage);
+  }
+  writer.ok = writer.ok
+    && frontier_save(frontier, fp)
+    && fprintf(fp, "end\n") >= 0
+    && fflush(fp) == 0
+    && fsync(fileno(fp)) == 0;
+  writer.ok = (fclose(fp) == 0) && writer.ok;
+
+  // only a complete checkpoint replaces the previous one
+  if (writer.ok) {
+    writer.ok = rename(temp, path) == 0;
+  }
+  if (!writer.ok) {
+    unlink(temp);
+  }
+  free(path);
+  free(temp);
+  return writer.ok;
+}
+
+/**************** checkpoint_load ****************/
+/* see checkpoint.h for description */
+checkpoint_status_t
+checkpoint_load(const char* pageDirectory, const char* seedURL,
+                const int maxDepth, const bool bloom, int* lastID,
+                seenset_t** seen, dedup_t** contents, frontier_t* frontier)
+{
+  char* path = pathOf(pageDirectory, ".checkpoint");
+  FILE* fp = path ? fopen(path, "r") : NULL;
+  free(path);
+  if (fp == NULL) {
+    return CHECKPOINT_NONE;
+  }
+
+  checkpoint_status_t status = CHECKPOINT_DAMAGED;
+  char* line = NULL;
+  size_t cap = 0;
+  int savedDepth, savedID;
+  long logSizes[sizeof(LOGS) / sizeof(LOGS[0])];
+  seenset_t* set = NULL;
+  dedup_t* dedup = NULL;
+
+  // the header, and whether it is for this crawl
+  if (readLine(fp, &line, &cap) == NULL || strcmp(line, HEADER) != 0
+      || readLine(fp, &line, &cap) == NULL || strncmp(line, "seed ", 5) != 0) {
+    goto done;
+  }
+  bool sameSeed = strcmp(line + 5, seedURL) == 0;
+  if (readLine(fp, &line, &cap) == NULL
+      || sscanf(line, "maxDepth %d", &savedDepth) != 1
+      || readLine(fp, &line, &cap) == NULL
+      || sscanf(line, "lastID %d", &savedID) != 1 || savedID < 0) {
+    goto done;
+  }
+  if (!sameSeed || savedDepth != maxDepth) {
+    status = CHECKPOINT_MISMATCH;
+    goto done;
+  }
+
+  // the logs' lengths, the seen-set and the dedup table
+  if (!readLogSizes(fp, &line, &cap, logSizes)
+      || readLine(fp, &line, &cap) == NULL || strcmp(line, "seen") != 0
+      || (set = seenset_load(fp, bloom)) == NULL
+      || readLine(fp, &line, &cap) == NULL || strcmp(line, "contents") != 0
+      || (dedup = dedup_load(fp)) == NULL
+      || readLine(fp, &line, &cap) == NULL || strcmp(line, "pages") != 0) {
+    goto done;
+  }
+
+  // check every page line, and the end, before taking any of them
+  long pagesStart = ftell(fp);
+  int depth;
+  const char* url;
+  while (readLine(fp, &line, &cap) != NULL && readPage(line, &depth, &url)) {
+  }
+  if (pagesStart < 0 || line == NULL || strcmp(line, "end") != 0
+      || fseek(fp, pagesStart, SEEK_SET) != 0) {
+    goto done;
+  }
+  while (readLine(fp, &line, &cap) != NULL && readPage(line, &depth, &url)) {
+    char* copy = strdup(url);
+    webpage_t* page = copy ? webpage_new(copy, depth, NULL) : NULL;
+    if (page == NULL) {
+      free(copy);
+    }
+    frontier_insert(frontier, page);
+  }
+
+  // pages saved after the checkpoint will be fetched again
+  pageDirTruncate(pageDirectory, savedID);
+  truncateLogs(pageDirectory, logSizes);
+  *lastID = savedID;
+  *seen = set;
+  *contents = dedup;
+  set = NULL;
+  dedup = NULL;
+  status = CHECKPOINT_OK;
+
+ done:
+  seenset_delete(set);
+  dedup_delete(dedup);
+  free(line);
+  fclose(fp);
+  return status;
+}
+
+/**************** checkpoint_remove ****************/
+/* see checkpoint.h for description */
+void
+checkpoint_remove(const char* pageDirectory)
+{
+  char* path = pathOf(pageDirectory, ".checkpoint");
+  if (path != NULL) {
+    unlink(path);
+    free(path);
+  }
+}
+
+/**************** local functions ****************/
+
+/* pathOf: the malloc'd path of a file in the pageDirectory, or NULL */
+static char*
+pathOf(const char* pageDirectory, const char* name)
+{
+  size_t len = strlen(pageDirectory) + strlen(name) + 2;
+  char* path = malloc(len);
+  if (path != NULL) {
+    snprintf(path, len, "%s/%s", pageDirectory, name);
+  }
+  return path;
+}
+
+/* savePage: scheduler_iterate helper; write one page line */
+static void
+savePage(void* arg, webpage_t* page)
+{
+  pageWriter_t* writer = arg;
+  if (writer->ok && fprintf(writer->fp, "%d %s\n", webpage_getDepth(page),
+                            webpage_getURL(page)) < 0) {
+    writer->ok = false;
+  }
+}
+
+/* readLine: read the next line into *line, without its newline;
+ * returns *line, or NULL at end of file (leaving *line empty).
+ */
+static char*
+readLine(FILE* fp, char** line, size_t* cap)
+{
+  if (getline(line, cap, fp) < 0) {
+    if (*line != NULL) {
+      (*line)[0] = '\0';
+    }
+    return NULL;
+  }
+  (*line)[strcspn(*line, "\n")] = '\0';
+  return *line;
+}
+
+/* readPage: parse a "depth URL" line; false if it is not one */
+static bool
+readPage(const char* line, int* depth, const char** url)
+{
+  int start = 0;
+  if (sscanf(line, "%d %n", depth, &start) < 1 || start == 0
+      || line[start] == '\0' || *depth < 0) {
+    return false;
+  }
+  *url = line + start;
+  return true;
+}
+
+/* saveLogSizes: write a "log" line with the length of each log */
+static bool
+saveLogSizes(FILE* fp, const char* pageDirectory)
+{
+  for (int i = 0; LOGS[i] != NULL; i++) {
+    char* path = pathOf(pageDirectory, LOGS[i]);
+    if (path == NULL) {
+      return false;
+    }
+    struct stat st;
+    long size = stat(path, &st) == 0 ? (long) st.st_size : 0;
+    free(path);
+    if (fprintf(fp, "log %s %ld\n", LOGS[i], size) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* readLogSizes: read the "log" lines, in the order saveLogSizes wrote them */
+static bool
+readLogSizes(FILE* fp, char** line, size_t* cap, long* sizes)
+{
+  for (int i = 0; LOGS[i] != NULL; i++) {
+    size_t nameLen = strlen(LOGS[i]);
+    if (readLine(fp, line, cap) == NULL || strncmp(*line, "log ", 4) != 0
+        || strncmp(*line + 4, LOGS[i], nameLen) != 0
+        || sscanf(*line + 4 + nameLen, " %ld", &sizes[i]) != 1 || sizes[i] < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* truncateLogs: cut each log back to its length at the checkpoint */
+static void
+truncateLogs(const char* pageDirectory, const long* sizes)
+{
+  for (int i = 0; LOGS[i] != NULL; i++) {
+    char* path = pathOf(pageDirectory, LOGS[i]);
+    struct stat st;
+    if (path != NULL && stat(path, &st) == 0 && st.st_size > sizes[i]) {
+      if (truncate(path, sizes[i]) != 0) {
+        fprintf(stderr, "Warning: unable to cut %s back to the checkpoint\n", path);
+      }
+    }
+    free(path);
+  }
+}
@@ -0,0 +1,79 @@
+/*
+ * checkpoint.h - header file for the crawler's 'checkpoint' module
+ *
+ * A checkpoint records everything a crawl needs to carry on after the
+ * crawler stops part way: the seed URL and maxDepth it was started
+ * with, the last docID handed out, the fingerprints of all URLs seen
+ * and of all page contents saved, and every page still waiting to be
+ * fetched.  It lives in the pageDirectory, next to the pages already
+ * saved, in one file named .checkpoint; a new one is written beside it
+ * and renamed over it, so a crash while saving leaves the previous
+ * checkpoint intact.
+ *
+ * The crawler saves a checkpoint only when no page is in flight, so the
+ * pages saved, the docID counter and the frontier all agree.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <stdbool.h>
+#include "seenset.h"
+#include "dedup.h"
+#include "frontier.h"
+#include "scheduler.h"
+
+/**************** global types ****************/
+/* outcome of checkpoint_load */
+typedef enum {
+  CHECKPOINT_OK,         // loaded
+  CHECKPOINT_NONE,       // there is no checkpoint
+  CHECKPOINT_MISMATCH,   // it is for another seedURL or maxDepth
+  CHECKPOINT_DAMAGED,    // it cannot be read
+} checkpoint_status_t;
+
+/**************** checkpoint_save ****************/
+/* Save a checkpoint of a crawl into its pageDirectory.
+ *
+ * Caller provides:
+ *   the crawl's pageDirectory, normalized seedURL and maxDepth;
+ *   lastID, the last docID handed out;
+ *   its seen-set and dedup table; its frontier, and its scheduler (whose
+ *   waiting pages are saved as part of the frontier).
+ * We return:
+ *   true if the checkpoint is safely on disk; false otherwise, in which
+ *   case any earlier checkpoint is left as it was.
+ */
+bool checkpoint_save(const char* pageDirectory, const char* seedURL,
+                     const int maxDepth, const int lastID,
+                     const seenset_t* seen, const dedup_t* contents,
+                     frontier_t* frontier, scheduler_t* scheduler);
+
+/**************** checkpoint_load ****************/
+/* Load the checkpoint in a pageDirectory, to resume that crawl.
+ *
+ * Caller provides:
+ *   the pageDirectory, normalized seedURL and maxDepth, which must match
+ *   the checkpoint's; bloom, as for seenset_new;
+ *   pointers for the results, and an empty frontier.
+ * We return:
+ *   CHECKPOINT_OK with *lastID, *seen and *contents set, and the waiting
+ *   pages inserted into the frontier; pages saved after the checkpoint,
+ *   and lines added to pagedir's logs since, are removed.  Otherwise one
+ *   of the other statuses, with nothing changed.
+ * Caller is responsible for:
+ *   later calling seenset_delete on *seen, and dedup_delete on *contents.
+ */
+checkpoint_status_t checkpoint_load(const char* pageDirectory,
+                                    const char* seedURL, const int maxDepth,
+                                    const bool bloom, int* lastID,
+                                    seenset_t** seen, dedup_t** contents,
+                                    frontier_t* frontier);
+
+/**************** checkpoint_remove ****************/
+/* Remove the checkpoint from a pageDirectory (the crawl is complete). */
+void checkpoint_remove(const char* pageDirectory);
+
+#endif // __CHECKPOINT_H
@@ -1,59 +1,422 @@
 /**
  * Chu Hui Ong, CS50 Winter 2024
- * 
- * crawler.c -- The TSE crawler is a standalone program that crawls the web 
- * and retrieves webpages starting from a "seed" URL. It parses the seed webpage, 
- * extracts any embedded URLs, then retrieves each of those pages, recursively, 
+ *
+ * crawler.c -- The TSE crawler is a standalone program that crawls the web
+ * and retrieves webpages starting from a "seed" URL. It parses the seed webpage,
+ * extracts any embedded URLs, then retrieves each of those pages, recursively,
  * but limiting its exploration to a given "depth".
- * 
+ *
+ * With -j N the crawl runs N fetch workers against one shared frontier and
+ * seen-set, so that time spent waiting on sockets overlaps across pages.
+ * With -e N a single thread keeps up to N non-blocking fetches in flight
+ * through the fetchloop module instead.
+ *
+ * Either way, pages pass from the frontier through a per-host scheduler,
+ * which spaces fetches from any one host at least -d seconds apart (1 by
+ * default) and lets pages from other hosts go immediately.  With -m
+ * min:max it also bounds each host's fetches in flight, starting at min
+ * and adapting between min and max as the host's fetches finish: the
+ * bound grows while they go well, and halves on a timeout, an overload
+ * status (429, 5xx) or a rise in latency.  That matters with -j or -e and
+ * a short -d, where a fixed number of fetches could swamp a slow host.
+ *
+ * URLs already met are remembered by 64-bit fingerprint in a seenset,
+ * with the smallest depth each was met at; a URL met again shallower is
+ * queued again, so pages found out of order are still crawled as deep as
+ * they should be.  -b puts a Bloom filter in front of it.  Pages waiting to be fetched are
+ * kept in a frontier that holds at most -f of them in memory and spills
+ * the rest to files in the pageDirectory; -o picks the order in which
+ * they leave it: fifo (the default), bfs (strictly by depth) or priority
+ * (by depth, plus a fairness term for hosts with many pages queued).
+ *
+ * Every -c seconds (60 by default; 0 turns it off) the crawler saves a
+ * checkpoint of its frontier, seen-set and docID counter in the
+ * pageDirectory.  Run again with --resume and the same arguments, it
+ * carries on from the latest checkpoint rather than starting over.
+ *
+ * Every saved page's ETag and Last-Modified validators are recorded too.
+ * With -u (--recrawl) the crawler crawls an existing pageDirectory again:
+ * a URL saved before is fetched conditionally, and keeps its docID; if the
+ * server answers 304 Not Modified, its saved copy is kept as it was (and
+ * scanned for links from disk).
+ *
+ * A fetched page whose body is byte-for-byte the same as a page already
+ * saved (found by a 64-bit content fingerprint) is not saved again; its
+ * URL is recorded as an alias of the first page's docID instead.
+ *
+ * Pages are saved behind the crawl's back: each one to save passes through
+ * a bounded queue to a writer thread, which writes the files and syncs
+ * them to disk every few seconds, so a fetcher waits on the disk only when
+ * the writer is a whole queue behind.  A checkpoint waits for the writer.
+ *
+ * With -x indexFilename the crawler also builds the index as it goes: each
+ * page the writer saves passes through another bounded queue to an index
+ * thread, and the index is written to indexFilename when the crawl is done,
+ * so the corpus need not be read back by the indexer.
+ *
+ * With -z the pages are saved compressed, against a dictionary trained on
+ * the first pages of the crawl (see dictionary.h); the pageDirectory then
+ * stays compressed, for a resumed crawl or a re-crawl, until a new crawl.
+ *
+ * Once every page is saved, the crawler writes a manifest of them -- each
+ * docID's URL, depth, length and content fingerprint, in one file that the
+ * querier maps into memory (see manifest.h) -- to the pageDirectory, from
+ * the entries recorded as each page was saved.
+ *
+ * With -t statsFilename the crawler keeps counts and timings as it goes --
+ * pages and bytes fetched, histograms of fetch, parse and save times, and
+ * failed fetches by class -- and writes them, with the sizes of the
+ * frontier, the scheduler and the seen-set, to statsFilename every second
+ * (see crawlstats.h); once the crawl is done, it prints them on stderr.
+ *
+ * -s sitePrefix makes the URLs under sitePrefix the internal ones, instead
+ * of those on the CS50 server, so the crawler can be run against a local
+ * test site (see ../bench).
+ *
+ * -a archiveFile records every response fetched, whole, into an append-only
+ * archive; -p archiveFile replays one, answering every fetch from it with
+ * no network, so that a crawl can be repeated on exactly the same input.
+ *
+ * With -n numProcesses the crawl is split among that many processes, each
+ * owning the hosts whose hash falls to it, and crawling into a pageDirectory
+ * of its own under this one; a URL found for another process's host is
+ * passed to it through a coordinator (see partition.h).  When the crawl is
+ * done, each partition's pages are moved into pageDirectory, numbered in a
+ * docID range of their own, one partition's range after another's.
+ *
 */
 
+#define _POSIX_C_SOURCE 200809L   // getopt, pthreads, mkdir
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "../libcs50/set.h"
 #include "../libcs50/hash.h"
 #include "../libcs50/mem.h"
 #include "../libcs50/hashtable.h"
 #include "../libcs50/bag.h"
 #include "../libcs50/webpage.h"
+#include "../libcs50/fetchloop.h"
+#include "../libcs50/archive.h"
 #include "../common/pagedir.h"
+#include "../common/manifest.h"
+#include "scheduler.h"
+#include "seenset.h"
+#include "frontier.h"
+#include "checkpoint.h"
+#include "revisit.h"
+#include "dedup.h"
+#include "pagequeue.h"
+#include "pagewriter.h"
+#include "crawlstats.h"
+#include "partition.h"
+#include "monotonic.h"
+#include "../common/fingerprint.h"
+#include "../common/index.h"
 #include <string.h>
 
 
+/**********************types**********************/
+/* state shared by all fetch workers; the frontier, the seen-set and the
+ * docID counter are only touched while holding 'lock' */
+typedef struct crawlState {
+  frontier_t* pagesToCrawl;  // frontier: pages waiting to be fetched
+  scheduler_t* scheduler;    // pages taken from the frontier, queued by host
+  seenset_t* pagesSeen;      // every URL ever added to the frontier, at its least depth
+  dedup_t* contents;         // fingerprint of every body saved, and its docID
+  char* pageDirectory;       // where fetched pages are saved
+  char* seedURL;             // normalized, as recorded in checkpoints
+  int maxDepth;              // do not scan pages at this depth
+  int lastID;                // last docID handed out
+  int busy;                  // workers holding a page they took from the frontier
+  double checkpointEvery;    // seconds between checkpoints (0: never)
+  double nextCheckpoint;     // when the next checkpoint is due
+  revisit_t* revisit;        // pages of the earlier crawl, if re-crawling; read-only
+  pagewriter_t* toSave;      // pages waiting to be written to pageDirectory; locks itself
+  pagequeue_t* toIndex;      // saved pages for the index thread (NULL: not indexing); locks itself
+  index_t* index;            // the index being built; only the index thread touches it
+  partition_t* partition;    // with -n, the part of the crawl this process does; locks itself
+  long received;             // URLs taken from the other partitions
+  long reported;             // 'received' when this partition last said it was idle
+  bool finished;             // the coordinator has ended the crawl
+  crawlstats_t* stats;       // with -t, counts and timings (else NULL); locks itself
+  char* statsFilename;       // with -t, where snapshots of them go
+  bool ended;                // every page is done; the stats thread may stop
+  pthread_cond_t statsWake;  // wakes the stats thread at the end, not 'wake', whose
+                             // signals are meant for the workers
+  pthread_mutex_t lock;      // guards all of the above
+  pthread_cond_t wake;       // frontier grew, or the crawl is finished
+} crawlState_t;
+
+/* crawl options from the command line */
+typedef struct crawlOptions {
+  int numWorkers;            // -j: fetch worker threads
+  int numConnections;        // -e: non-blocking fetches in flight (0: off)
+  double delay;              // -d: seconds between fetches from one host
+  bool bloom;                // -b: Bloom filter in front of the seen-set
+  long frontierPages;        // -f: most frontier pages kept in memory
+  frontier_order_t order;    // -o: order in which the frontier hands out pages
+  double checkpointEvery;    // -c: seconds between checkpoints (0: never)
+  bool resume;               // --resume: carry on from the last checkpoint
+  bool recrawl;              // -u: re-crawl the pageDirectory's pages conditionally
+  char* indexFilename;       // -x: build the index during the crawl, into this file
+  archive_t* archive;        // -a: record responses into it; -p: replay them from it
+  bool replay;               // -p: fetches are answered from the archive
+  int minPerHost;            // -m: bounds on each host's fetches in flight
+  int maxPerHost;            //     (0: no bounds)
+  int numProcesses;          // -n: partitions of the crawl, each a process
+  partition_t* partition;    // in a partition's process, its partition (else NULL)
+  char* statsFilename;       // -t: write stats to this file as the crawl goes
+  bool compress;             // -z: save pages compressed against a trained dictionary
+} crawlOptions_t;
+
+/* what crawlPartitioned passes to each partition's process */
+typedef struct partitionArg {
+  char* seedURL;
+  char* pageDirectory;       // the partition crawls into a directory under it
+  int maxDepth;
+  const crawlOptions_t* options;
+} partitionArg_t;
+
+static const int MAX_WORKERS = 64;   // upper bound for -j
+static const int MAX_CONNECTIONS = 1024;   // upper bound for -e
+static const double MAX_DELAY = 60.0;      // upper bound for -d
+static const int MAX_PER_HOST = 1024;      // upper bound for -m
+static const int MAX_PROCESSES = 64;       // upper bound for -n
+static const int SCHEDULER_WINDOW = 4096;  // most pages the scheduler holds at once
+static const size_t SEEN_EXPECTED = 1000;  // initial seen-set size; it grows
+static const long MAX_FRONTIER_PAGES = 100000000;  // upper bound for -f
+static const double MAX_CHECKPOINT = 86400.0;      // upper bound for -c
+static const int INDEX_QUEUE = 64;         // most saved pages waiting to be indexed
+static const int WRITE_QUEUE = 256;        // most pages waiting to be saved
+static const double STATS_EVERY = 1.0;     // seconds between stats snapshots
+
+/* what pageScan passes to scanURL for each URL on a page */
+typedef struct scanArg {
+  crawlState_t* state;
+  int depth;                 // depth of the page being scanned
+  char* URL;                 // the current link, normalized; reused for every link
+  size_t size;               // bytes allocated for URL
+} scanArg_t;
+
+
 /**********************function prototypes**********************/
 int main(const int argc, char* argv[]);
 static void parseArgs(const int argc, char* argv[],
-                      char** seedURL, char** pageDirectory, int* maxDepth);
-static void crawl(char* seedURL, char* pageDirectory, const int maxDepth);
-static void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen);
+                      char** seedURL, char** pageDirectory, int* maxDepth,
+                      crawlOptions_t* options);
+static void checkWritable(const char* filename, const char* what);
+static void crawl(char* seedURL, char* pageDirectory, const int maxDepth,
+                  const crawlOptions_t* options);
+static void crawlPartitioned(char* seedURL, char* pageDirectory, const int maxDepth,
+                             const crawlOptions_t* options);
+static void crawlPartition(void* arg, partition_t* partition);
+static char* partitionDirectory(const char* pageDirectory, const int index);
+static void* partitionWorker(void* arg);
+static bool awaitURLs(crawlState_t* state);
+static void* crawlWorker(void* arg);
+static void crawlEvents(crawlState_t* state, const int numConnections);
+static void prepareFetch(webpage_t* page, crawlState_t* state);
+static void fetchDone(webpage_t* page, crawlState_t* state);
+static bool processPage(webpage_t* page, crawlState_t* state);
+static void processUnchanged(webpage_t* page, crawlState_t* state);
+static bool saveLater(webpage_t* page, const int docID, const bool validators,
+                      const uint64_t content, crawlState_t* state);
+static bool indexLater(webpage_t* page, const int docID, crawlState_t* state);
+static void* indexWorker(void* arg);
+static void* statsWorker(void* arg);
+static crawlstats_gauges_t statsGauges(crawlState_t* state);
+static webpage_t* takeReady(crawlState_t* state, double* wait);
+static webpage_t* nextPage(crawlState_t* state);
+static void pageDone(crawlState_t* state);
+static bool checkpointDue(const crawlState_t* state);
+static void saveCheckpoint(crawlState_t* state);
+static void pageScan(webpage_t* page, const int depth, crawlState_t* state);
+static void scanURL(void* arg, const char* url);
 static void logr(const char *word, const int depth, const char *url);  // helper for tracking crawling progress and debugging
 
 
 /**********************main**********************/
 int main (const int argc, char* argv[]) {
-  // defensive code
-  if (argc == 4) {
-    // get maxDepth as an integer
-    int maxDepth = atoi(argv[3]);
-    // call parseArgs and crawl
-    parseArgs(argc, argv, &argv[1], &argv[2], &maxDepth);
-    char* URL = malloc(strlen(argv[1]) + 1);
-    if (URL != NULL) {
-      strcpy(URL, argv[1]);
-    }
-    crawl(URL, argv[2], maxDepth);
-    free(URL);
-    return 0;
+  char* seedURL = NULL;
+  char* pageDirectory = NULL;
+  int maxDepth = 0;
+  crawlOptions_t options = { .numWorkers = 1, .numConnections = 0, .delay = 1.0, .bloom = false,
+                             .frontierPages = 100000, .order = FRONTIER_FIFO,
+                             .checkpointEvery = 60.0, .resume = false, .recrawl = false,
+                             .indexFilename = NULL, .archive = NULL, .replay = false,
+                             .minPerHost = 0, .maxPerHost = 0,
+                             .numProcesses = 1, .partition = NULL, .statsFilename = NULL };
+  // parseArgs exits with a non-zero status on any bad argument
+  parseArgs(argc, argv, &seedURL, &pageDirectory, &maxDepth, &options);
+  char* URL = malloc(strlen(seedURL) + 1);
+  if (URL != NULL) {
+    strcpy(URL, seedURL);
+  }
+  if (options.numProcesses > 1) {
+    crawlPartitioned(URL, pageDirectory, maxDepth, &options);
+  } else {
+    crawl(URL, pageDirectory, maxDepth, &options);
   }
-  return 1;
+  free(URL);
+  return 0;
 }
 
 /**********************parseArgs**********************/
-void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory, int* maxDepth) {
-  // if there are 4 arguments, continue on
+/* usage: ./crawler [-j numWorkers | -e numConnections] [-d delay] [-b]
+ *                  [-f frontierPages] [-o fifo|bfs|priority]
+ *                  [-c checkpointSeconds] [-r | --resume] [-u | --recrawl]
+ *                  [-x indexFilename] [-s sitePrefix]
+ *                  [-a archiveFile | -p archiveFile] [-m [min:]max]
+ *                  [-n numProcesses] [-t statsFilename] [-z]
+ *                  seedURL pageDirectory maxDepth */
+static void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirectory,
+                      int* maxDepth, crawlOptions_t* options) {
+  // pick off the options first
+  static const struct option longOptions[] = {
+    { "resume",     no_argument,       NULL, 'r' },
+    { "checkpoint", required_argument, NULL, 'c' },
+    { "recrawl",    no_argument,       NULL, 'u' },
+    { "index",      required_argument, NULL, 'x' },
+    { "site",       required_argument, NULL, 's' },
+    { "record",     required_argument, NULL, 'a' },
+    { "replay",     required_argument, NULL, 'p' },
+    { "per-host",   required_argument, NULL, 'm' },
+    { "processes",  required_argument, NULL, 'n' },
+    { "stats",      required_argument, NULL, 't' },
+    { "compress",   no_argument,       NULL, 'z' },
+    { NULL, 0, NULL, 0 }
+  };
+  int opt;
+  while ((opt = getopt_long(argc, argv, "j:e:d:bf:o:c:rux:s:a:p:m:n:t:z", longOptions, NULL)) != -1) {
+    if (opt == 'j') {
+      options->numWorkers = atoi(optarg);
+      if (options->numWorkers < 1 || options->numWorkers > MAX_WORKERS) {
+        fprintf(stderr, "Number of workers should be between 1 and %d (inclusive)", MAX_WORKERS);
+        exit(4);
+      }
+    } else if (opt == 'e') {
+      options->numConnections = atoi(optarg);
+      if (options->numConnections < 1 || options->numConnections > MAX_CONNECTIONS) {
+        fprintf(stderr, "Number of connections should be between 1 and %d (inclusive)", MAX_CONNECTIONS);
+        exit(4);
+      }
+    } else if (opt == 'd') {
+      char* end;
+      options->delay = strtod(optarg, &end);
+      if (end == optarg || *end != '\0' || options->delay < 0 || options->delay > MAX_DELAY) {
+        fprintf(stderr, "Per-host delay should be between 0 and %g seconds (inclusive)", MAX_DELAY);
+        exit(4);
+      }
+    } else if (opt == 'b') {
+      options->bloom = true;
+    } else if (opt == 'f') {
+      options->frontierPages = atol(optarg);
+      if (options->frontierPages < 1 || options->frontierPages > MAX_FRONTIER_PAGES) {
+        fprintf(stderr, "Frontier pages in memory should be between 1 and %ld (inclusive)", MAX_FRONTIER_PAGES);
+        exit(4);
+      }
+    } else if (opt == 'o') {
+      if (strcmp(optarg, "fifo") == 0) {
+        options->order = FRONTIER_FIFO;
+      } else if (strcmp(optarg, "bfs") == 0) {
+        options->order = FRONTIER_BFS;
+      } else if (strcmp(optarg, "priority") == 0) {
+        options->order = FRONTIER_PRIORITY;
+      } else {
+        fprintf(stderr, "Frontier order should be fifo, bfs or priority");
+        exit(4);
+      }
+    } else if (opt == 'c') {
+      char* end;
+      options->checkpointEvery = strtod(optarg, &end);
+      if (end == optarg || *end != '\0' || options->checkpointEvery < 0
+          || options->checkpointEvery > MAX_CHECKPOINT) {
+        fprintf(stderr, "Checkpoint interval should be between 0 and %g seconds (inclusive)", MAX_CHECKPOINT);
+        exit(4);
+      }
+    } else if (opt == 'r') {
+      options->resume = true;
+    } else if (opt == 'u') {
+      options->recrawl = true;
+    } else if (opt == 'z') {
+      options->compress = true;
+    } else if (opt == 'x') {
+      options->indexFilename = optarg;   // opened only after the rest pass
+    } else if (opt == 's') {
+      // the seedURL, checked below, must be under it too
+      if (strncmp(optarg, "http://", 7) != 0) {
+        fprintf(stderr, "Site prefix should be an http:// URL");
+        exit(4);
+      }
+      webpage_setInternalPrefix(optarg);
+    } else if (opt == 'a' || opt == 'p') {
+      if (options->archive != NULL) {
+        fprintf(stderr, "Use either -a or -p, once");
+        exit(4);
+      }
+      options->replay = (opt == 'p');
+      options->archive = options->replay ? archive_load(optarg) : archive_create(optarg);
+      if (options->archive == NULL) {
+        fprintf(stderr, "Unable to %s the archive %s", options->replay ? "read" : "write", optarg);
+        exit(4);
+      }
+    } else if (opt == 'm') {
+      // "max" alone starts each host at one fetch
+      char* end;
+      long min = 1;
+      long max = strtol(optarg, &end, 10);
+      if (*end == ':' && end != optarg) {
+        min = max;
+        char* rest = end + 1;
+        max = strtol(rest, &end, 10);
+        if (end == rest) {
+          end = optarg;
+        }
+      }
+      if (end == optarg || *end != '\0' || min < 1 || max < min || max > MAX_PER_HOST) {
+        fprintf(stderr, "Fetches per host should be max or min:max, with 1 <= min <= max <= %d", MAX_PER_HOST);
+        exit(4);
+      }
+      options->minPerHost = min;
+      options->maxPerHost = max;
+    } else if (opt == 'n') {
+      options->numProcesses = atoi(optarg);
+      if (options->numProcesses < 1 || options->numProcesses > MAX_PROCESSES) {
+        fprintf(stderr, "Number of processes should be between 1 and %d (inclusive)", MAX_PROCESSES);
+        exit(4);
+      }
+    } else if (opt == 't') {
+      options->statsFilename = optarg;   // opened only after the rest pass
+    } else {
+      fprintf(stderr, "Usage: %s [-j numWorkers | -e numConnections] [-d delay] [-b] [-f frontierPages] [-o order] [-c checkpointSeconds] [-r | --resume] [-u | --recrawl] [-x indexFilename] [-s sitePrefix] [-a archiveFile | -p archiveFile] [-m [min:]max] [-n numProcesses] [-t statsFilename] [-z | --compress] seedURL pageDirectory maxDepth", argv[0]);
+      exit(1);
+    }
+  }
+  if (options->numWorkers > 1 && options->numConnections > 0) {
+    fprintf(stderr, "Use either -j or -e, not both");
+    exit(4);
+  }
+  // each partition keeps its own files; these would need them shared
+  if (options->numProcesses > 1 && (options->resume || options->recrawl
+                                    || options->indexFilename != NULL
+                                    || (options->archive != NULL && !options->replay))) {
+    fprintf(stderr, "Use -n with none of -r, -u, -x or -a");
+    exit(4);
+  }
+  // if there are 3 positional arguments, continue on
   // otherwise exit with non-zero status
-  if (argc == 4) {
+  if (argc - optind == 3) {
+    *seedURL = argv[optind];
+    *pageDirectory = argv[optind + 1];
+    *maxDepth = atoi(argv[optind + 2]);
     // normalize URL
     char *URL = normalizeURL(*seedURL);
     // if not internal URL then exit with non-zero status
@@ -63,7 +426,7 @@ void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirector
     }
     // free the URL
     free(URL);
-    bool exists = pagedir_init(*pageDirectory);
+    bool exists = pageDirInit(*pageDirectory);
     // if directory does not exist then exit with non-zero status
     if (exists == false) {
       fprintf(stderr, "Unable to create .crawler file in pageDirectory");
@@ -71,6 +434,9 @@ void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirector
     }
     // if all of the above is true and maxDepth is in range [1, 10], then return otherwise exit with non-zero status
     if (0 <= *maxDepth && *maxDepth <= 10) {
+      // only now, with every argument good, touch the output files
+      checkWritable(options->indexFilename, "index");
+      checkWritable(options->statsFilename, "stats");
       return;
     } else {
       fprintf(stderr, "Max depth should be between 0 and 10 (inclusive)");
@@ -82,79 +448,920 @@ void parseArgs(const int argc, char* argv[], char** seedURL, char** pageDirector
   }
 }
 
+/**********************checkWritable**********************/
+/* make sure an output file (if named) can be written before crawling
+ * for it; this empties it, so parseArgs calls it only once every
+ * argument has passed, and a usage error leaves the file alone */
+static void checkWritable(const char* filename, const char* what) {
+  if (filename == NULL) {
+    return;
+  }
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Unable to write the %s file %s", what, filename);
+    exit(4);
+  }
+  fclose(fp);
+}
+
 
 /**********************crawl**********************/
-void crawl(char* seedURL, char* pageDirectory, const int maxDepth) {
+void crawl(char* seedURL, char* pageDirectory, const int maxDepth,
+           const crawlOptions_t* options) {
+  crawlState_t state;
+  state.pageDirectory = pageDirectory;
+  state.maxDepth = maxDepth;
   // will be used to give file its name
-  int id = 0;
-  // create a new hashtable
-  hashtable_t *ht = hashtable_new(200); //number of slots as specified by specs
-  // insert the seedURL
-  hashtable_insert(ht, normalizeURL(seedURL), "const");
-  // create a new bag
-  bag_t *bag = bag_new();
-  // create a new webpage from the seedURL with depth 0 and null HTML
-  webpage_t *wbp = webpage_new((normalizeURL(seedURL)), 0, NULL);
-  // insert the webpage in the bag
-  bag_insert(bag, wbp);
-  // extract a webpage from the bag while the bag is not empty
+  state.lastID = 0;
+  state.busy = 0;
+  pthread_mutex_init(&state.lock, NULL);
+  // timed waits for the scheduler run on the monotonic clock
+  pthread_condattr_t wakeAttr;
+  pthread_condattr_init(&wakeAttr);
+  pthread_condattr_setclock(&wakeAttr, CLOCK_MONOTONIC);
+  pthread_cond_init(&state.wake, &wakeAttr);
+  pthread_cond_init(&state.statsWake, &wakeAttr);
+  pthread_condattr_destroy(&wakeAttr);
+  state.scheduler = scheduler_new(options->delay);
+  if (options->maxPerHost > 0) {
+    scheduler_setLimits(state.scheduler, options->minPerHost, options->maxPerHost);
+  }
+  state.seedURL = normalizeURL(seedURL);
+  state.checkpointEvery = options->checkpointEvery;
+  state.nextCheckpoint = monotonic_now() + state.checkpointEvery;
+  state.pagesSeen = NULL;
+  state.contents = NULL;
+  state.revisit = NULL;
+  state.toSave = NULL;
+  state.toIndex = NULL;
+  state.index = NULL;
+  state.partition = options->partition;
+  state.received = 0;
+  state.reported = -1;
+  state.finished = false;
+  state.stats = NULL;
+  state.statsFilename = options->statsFilename;
+  state.ended = false;
+  // with -a or -p, every fetch records into, or replays from, the archive
+  webpage_setArchive(options->archive, options->replay);
+  // create the frontier, spilling to the pageDirectory
+  state.pagesToCrawl = frontier_new(pageDirectory, options->frontierPages,
+                                     options->order);
+  if (state.pagesToCrawl == NULL) {
+    fprintf(stderr, "Unable to create the frontier");
+    exit(5);
+  }
+  if (options->resume) {
+    // refill the seen-set, dedup table, frontier and docID counter
+    // from the checkpoint
+    checkpoint_status_t status = checkpoint_load(pageDirectory, state.seedURL, maxDepth,
+                                                 options->bloom, &state.lastID,
+                                                 &state.pagesSeen, &state.contents,
+                                                 state.pagesToCrawl);
+    if (status == CHECKPOINT_NONE) {
+      fprintf(stderr, "No checkpoint in %s; starting a new crawl\n", pageDirectory);
+    } else if (status == CHECKPOINT_MISMATCH) {
+      fprintf(stderr, "The checkpoint in %s is for another seedURL or maxDepth\n", pageDirectory);
+      exit(7);
+    } else if (status == CHECKPOINT_DAMAGED) {
+      fprintf(stderr, "The checkpoint in %s is damaged\n", pageDirectory);
+      exit(7);
+    }
+  }
+  bool resumed = state.pagesSeen != NULL;
+  if (!resumed) {
+    // every alias is decided afresh, even when re-crawling
+    pageDirClearAliases(pageDirectory);
+    state.contents = dedup_new(SEEN_EXPECTED);
+  }
+  if (options->recrawl) {
+    // after the checkpoint, which may have removed some pages
+    state.revisit = revisit_load(pageDirectory);
+    if (state.revisit == NULL) {
+      fprintf(stderr, "Unable to read the earlier crawl in %s\n", pageDirectory);
+      exit(8);
+    }
+    // new pages are numbered after the old ones
+    if (state.lastID < revisit_lastID(state.revisit)) {
+      state.lastID = revisit_lastID(state.revisit);
+    }
+    if (!resumed) {
+      // a page with the body of an old one is a duplicate, even if it
+      // is fetched before the old one is revisited
+      for (int id = 1; id <= revisit_lastID(state.revisit); id++) {
+        dedup_insert(state.contents, revisit_content(state.revisit, id), id);
+      }
+    }
+  } else if (!resumed) {
+    // a new crawl: earlier pages, and their validators and manifest
+    // entries, no longer apply
+    pageDirTruncate(pageDirectory, 0);
+    pageDirClearValidators(pageDirectory);
+    manifestClear(pageDirectory);
+  }
+  if (options->compress && !pageDirCompress(pageDirectory)) {
+    fprintf(stderr, "Warning: pages will be saved uncompressed in %s\n", pageDirectory);
+  }
+  if (!resumed && state.partition != NULL) {
+    // the seedURL comes from the coordinator, to whichever partition owns it
+    state.pagesSeen = seenset_new(SEEN_EXPECTED, options->bloom);
+  } else if (!resumed) {
+    // create the seen-set, and insert the seedURL
+    state.pagesSeen = seenset_new(SEEN_EXPECTED, options->bloom);
+    seenset_insert(state.pagesSeen, state.seedURL, 0);
+    // create a new webpage from the seedURL with depth 0 and null HTML
+    char* seed = malloc(strlen(state.seedURL) + 1);
+    if (seed != NULL) {
+      strcpy(seed, state.seedURL);
+    }
+    webpage_t *wbp = webpage_new(seed, 0, NULL);
+    // insert the webpage in the bag
+    frontier_insert(state.pagesToCrawl, wbp);
+  }
+
+  // with -x, saved pages are indexed by a thread of their own as the crawl goes
+  pthread_t indexThread;
+  if (options->indexFilename != NULL) {
+    state.index = indexInit(IndexCoeff);
+    state.toIndex = pagequeue_new(INDEX_QUEUE);
+    if (state.index == NULL || state.toIndex == NULL
+        || pthread_create(&indexThread, NULL, indexWorker, &state) != 0) {
+      fprintf(stderr, "Unable to start the index thread");
+      exit(5);
+    }
+  }
+
+  // with -t, the counts are written out by a thread of their own as the crawl goes
+  pthread_t statsThread;
+  if (state.statsFilename != NULL) {
+    state.stats = crawlstats_new();
+    if (state.stats == NULL
+        || pthread_create(&statsThread, NULL, statsWorker, &state) != 0) {
+      fprintf(stderr, "Unable to start the stats thread");
+      exit(5);
+    }
+  }
+
+  // pages are saved by a thread of their own, then passed on to be indexed
+  state.toSave = pagewriter_new(pageDirectory, WRITE_QUEUE, state.toIndex, state.stats);
+  if (state.toSave == NULL) {
+    fprintf(stderr, "Unable to start the page writer");
+    exit(5);
+  }
+
+  // a partition takes URLs from the others on a thread of its own
+  pthread_t receiver;
+  if (state.partition != NULL && pthread_create(&receiver, NULL, partitionWorker, &state) != 0) {
+    fprintf(stderr, "Unable to start the partition's receiving thread");
+    exit(5);
+  }
+
+  if (options->numConnections > 0) {
+    crawlEvents(&state, options->numConnections);
+  } else {
+    // start the extra workers; the calling thread is worker number one
+    pthread_t workers[MAX_WORKERS];
+    int started = 0;
+    for (int i = 1; i < options->numWorkers; i++) {
+      if (pthread_create(&workers[started], NULL, crawlWorker, &state) != 0) {
+        fprintf(stderr, "Unable to start fetch worker %d; continuing with %d\n", i, started + 1);
+        break;
+      }
+      started++;
+    }
+    crawlWorker(&state);
+    for (int i = 0; i < started; i++) {
+      pthread_join(workers[i], NULL);
+    }
+    // the workers' kept-alive connections are no longer needed
+    webpage_closeConnections();
+  }
+  if (state.partition != NULL) {
+    pthread_join(receiver, NULL);
+  }
+  // every page is saved before the index thread may look for the rest on disk
+  if (!pagewriter_close(state.toSave)) {
+    fprintf(stderr, "Warning: some pages could not be saved in %s\n", pageDirectory);
+  }
+  if (state.stats != NULL) {
+    // a last snapshot, once every page is saved, and the same on stderr
+    pthread_mutex_lock(&state.lock);
+    state.ended = true;
+    pthread_cond_signal(&state.statsWake);
+    pthread_mutex_unlock(&state.lock);
+    pthread_join(statsThread, NULL);
+    crawlstats_gauges_t gauges = statsGauges(&state);
+    crawlstats_print(state.stats, stderr, &gauges);
+    if (!crawlstats_write(state.stats, state.statsFilename, &gauges)) {
+      fprintf(stderr, "Warning: unable to write the stats file %s\n", state.statsFilename);
+    }
+    crawlstats_delete(state.stats);
+  }
+  // a partition's pages are listed once they are merged, by crawlPartitioned
+  if (state.partition == NULL && !manifestWrite(pageDirectory)) {
+    fprintf(stderr, "Warning: unable to write the manifest of %s\n", pageDirectory);
+  }
+  // the crawl is complete, so there is nothing to resume
+  checkpoint_remove(pageDirectory);
+  if (state.toIndex != NULL) {
+    // let the index thread finish, then write the index out
+    pagequeue_close(state.toIndex);
+    pthread_join(indexThread, NULL);
+    indexSave(state.index, options->indexFilename);
+    indexDelete(state.index);
+    pagequeue_delete(state.toIndex);
+  }
+  webpage_setArchive(NULL, false);
+  if (!archive_close(options->archive)) {
+    fprintf(stderr, "Warning: some responses could not be written to the archive\n");
+  }
+
+  // delete the seen-set
+  seenset_delete(state.pagesSeen);
+  dedup_delete(state.contents);
+  // delete the frontier
+  frontier_delete(state.pagesToCrawl, webpage_delete);
+  scheduler_delete(state.scheduler, webpage_delete);
+  revisit_delete(state.revisit);
+  free(state.seedURL);
+  pthread_cond_destroy(&state.wake);
+  pthread_cond_destroy(&state.statsWake);
+  pthread_mutex_destroy(&state.lock);
+}
+
+
+/**********************crawlPartitioned**********************/
+/* with -n: run the crawl in numProcesses partitions, each crawling into a
+ * directory of its own under pageDirectory; then move their pages into
+ * pageDirectory, each partition's numbered just after the one before's */
+static void crawlPartitioned(char* seedURL, char* pageDirectory, const int maxDepth,
+                             const crawlOptions_t* options) {
+  int count = options->numProcesses;
+  for (int i = 0; i < count; i++) {
+    // each partition starts empty, so its pages alone are merged
+    char* dir = partitionDirectory(pageDirectory, i);
+    bool made = dir != NULL && (mkdir(dir, 0755) == 0 || errno == EEXIST) && pageDirInit(dir);
+    if (made) {
+      pageDirTruncate(dir, 0);
+    }
+    free(dir);
+    if (!made) {
+      fprintf(stderr, "Unable to create a directory for partition %d in %s", i, pageDirectory);
+      exit(6);
+    }
+  }
+
+  char* seed = normalizeURL(seedURL);
+  partitionArg_t arg = { .seedURL = seedURL, .pageDirectory = pageDirectory,
+                         .maxDepth = maxDepth, .options = options };
+  bool ok = seed != NULL && partition_coordinate(count, seed, &arg, crawlPartition);
+  free(seed);
+  archive_close(options->archive);
+  if (!ok) {
+    fprintf(stderr, "A partition of the crawl failed; its pages are left in %s/.partition.*\n",
+            pageDirectory);
+    exit(9);
+  }
+
+  // one docID range after another, replacing any earlier crawl's pages
+  pageDirTruncate(pageDirectory, 0);
+  pageDirClearAliases(pageDirectory);
+  pageDirClearValidators(pageDirectory);
+  manifestClear(pageDirectory);
+  int offset = 0;
+  for (int i = 0; i < count; i++) {
+    char* dir = partitionDirectory(pageDirectory, i);
+    int moved = 0;
+    if (dir == NULL || !pageDirMerge(pageDirectory, dir, offset, &moved)) {
+      fprintf(stderr, "Warning: unable to move every page of partition %d into %s\n",
+              i, pageDirectory);
+    }
+    free(dir);
+    offset += moved;
+  }
+  if (!manifestWrite(pageDirectory)) {
+    fprintf(stderr, "Warning: unable to write the manifest of %s\n", pageDirectory);
+  }
+}
+
+
+/**********************crawlPartition**********************/
+/* in a partition's own process: crawl its hosts into its own directory */
+static void crawlPartition(void* arg, partition_t* partition) {
+  partitionArg_t* part = arg;
+  crawlOptions_t options = *part->options;
+  options.partition = partition;
+  // a checkpoint could not hold the URLs on their way between partitions
+  options.checkpointEvery = 0;
+  // each partition writes its own stats, to statsFilename.<index>
+  char* statsFilename = NULL;
+  if (options.statsFilename != NULL) {
+    statsFilename = malloc(strlen(options.statsFilename) + 16);
+    if (statsFilename == NULL) {
+      exit(5);
+    }
+    sprintf(statsFilename, "%s.%d", options.statsFilename, partition_index(partition));
+    options.statsFilename = statsFilename;
+  }
+  // the partitions share stdout, so write the log a whole line at a time
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  char* dir = partitionDirectory(part->pageDirectory, partition_index(partition));
+  if (dir == NULL) {
+    exit(5);
+  }
+  crawl(part->seedURL, dir, part->maxDepth, &options);
+  free(dir);
+  free(statsFilename);
+}
+
+
+/**********************partitionDirectory**********************/
+/* the directory partition 'index' crawls into: pageDirectory/.partition.<index>;
+ * malloc'd, or NULL if out of memory */
+static char* partitionDirectory(const char* pageDirectory, const int index) {
+  char* dir = malloc(strlen(pageDirectory) + 32);
+  if (dir != NULL) {
+    sprintf(dir, "%s/.partition.%d", pageDirectory, index);
+  }
+  return dir;
+}
+
+
+/**********************partitionWorker**********************/
+/* a partition's receiving thread: add each URL the coordinator sends to
+ * the frontier, if new or shallower than before, until the crawl is over;
+ * URLs arrive in no particular order, so a URL may come deeper first */
+static void* partitionWorker(void* arg) {
+  crawlState_t* state = arg;
+  char* URL;
+  int depth;
+  while ((URL = partition_receive(state->partition, &depth)) != NULL) {
+    pthread_mutex_lock(&state->lock);
+    if (seenset_insert(state->pagesSeen, URL, depth)) {
+      frontier_insert(state->pagesToCrawl, webpage_new(URL, depth, NULL));
+    } else {
+      free(URL);
+    }
+    // counted only once it is in the frontier, so that an idle partition
+    // never reports a URL it has not crawled
+    state->received++;
+    pthread_cond_signal(&state->wake);
+    pthread_mutex_unlock(&state->lock);
+  }
+  pthread_mutex_lock(&state->lock);
+  state->finished = true;
+  pthread_cond_broadcast(&state->wake);
+  pthread_mutex_unlock(&state->lock);
+  return NULL;
+}
+
+
+/**********************crawlWorker**********************/
+/* extract a webpage from the frontier until the crawl is finished;
+ * fetching, saving and scanning all happen outside the lock */
+static void* crawlWorker(void* arg) {
+  crawlState_t* state = arg;
   webpage_t *page;
-  while ((page = bag_extract(bag)) != NULL) {
+  while ((page = nextPage(state)) != NULL) {
     // fetch the HTML for the webpage
-    if (webpage_fetch(page)) {
-      // print the log status
-      logr("Fetched", webpage_getDepth(page), webpage_getURL(page));
-      // save the webpage in pageDirectory
-      pagedir_save(page, pageDirectory, ++id);
-      // if the webpage's depth is less than the maxDepth
-      if (webpage_getDepth(page) < maxDepth) {
-        // scan the webpage
-        logr("Scanning", webpage_getDepth(page), webpage_getURL(page));
-        pageScan(page, bag, ht);
-      }
-    }
-    // delete the webpage
+    prepareFetch(page, state);
+    bool kept = false;
+    bool fetched = webpage_fetch(page);
+    fetchDone(page, state);
+    if (fetched) {
+      kept = processPage(page, state);
+    } else if (webpage_isUnchanged(page)) {
+      processUnchanged(page, state);
+    }
+    // delete the webpage, unless it went on to be indexed
+    if (!kept) {
+      webpage_delete(page);
+    }
+    pageDone(state);
+  }
+  return NULL;
+}
+
+
+/**********************crawlEvents**********************/
+/* single-threaded crawl: keep the fetchloop topped up from the frontier,
+ * and process pages in the order their fetches complete */
+static void crawlEvents(crawlState_t* state, const int numConnections) {
+  fetchloop_t* loop = fetchloop_new(numConnections);
+  if (loop == NULL) {
+    fprintf(stderr, "Unable to start the fetch loop\n");
+    return;
+  }
+  for (;;) {
+    // start as many fetches as the loop and the scheduler allow
+    webpage_t* page;
+    double wait = -1;    // stays -1 if the loop is full
+    // a checkpoint waits until nothing is in flight, so start no more fetches
+    bool due = checkpointDue(state);
+    if (due && fetchloop_pending(loop) == 0) {
+      saveCheckpoint(state);
+      due = false;
+    }
+    while (!due && fetchloop_pending(loop) < numConnections) {
+      // a partition's receiving thread adds to the frontier too
+      pthread_mutex_lock(&state->lock);
+      page = takeReady(state, &wait);
+      pthread_mutex_unlock(&state->lock);
+      if (page == NULL) {
+        break;
+      }
+      prepareFetch(page, state);
+      if (!fetchloop_add(loop, page)) {
+        fetchDone(page, state);
+        webpage_delete(page);
+      }
+      wait = -1;
+    }
+    if (fetchloop_pending(loop) == 0) {
+      // nothing in flight and nothing waiting means nothing left to find,
+      // unless other partitions may yet send some
+      if (wait < 0) {
+        pthread_mutex_lock(&state->lock);
+        bool more = awaitURLs(state);
+        pthread_mutex_unlock(&state->lock);
+        if (!more) {
+          break;
+        }
+        continue;
+      }
+      struct timespec ts = { (time_t) wait, (long) ((wait - (time_t) wait) * 1e9) };
+      nanosleep(&ts, NULL);
+      continue;
+    }
+    // wait for a fetch to finish, or for the next host to become ready
+    bool fetched;
+    if ((page = fetchloop_next(loop, &fetched, wait)) == NULL) {
+      continue;
+    }
+    fetchDone(page, state);
+    bool kept = false;
+    if (fetched) {
+      kept = processPage(page, state);
+    } else if (webpage_isUnchanged(page)) {
+      processUnchanged(page, state);
+    }
+    if (!kept) {
+      webpage_delete(page);
+    }
+  }
+  fetchloop_delete(loop);
+}
+
+
+/**********************prepareFetch**********************/
+/* when re-crawling, make the fetch of a page saved before conditional */
+static void prepareFetch(webpage_t* page, crawlState_t* state) {
+  const char* etag;
+  const char* lastModified;
+  if (revisit_find(state->revisit, webpage_getURL(page), &etag, &lastModified) > 0) {
+    webpage_setValidators(page, etag, lastModified);
+  }
+}
+
+
+/**********************fetchDone**********************/
+/* tell the scheduler how the fetch of a page it handed out went, so that
+ * it can adapt the host's limit: no response at all, or one saying the
+ * server is overloaded, counts against the host.  Wake a waiting worker
+ * if a host held back at its limit may be fetched from again */
+static void fetchDone(webpage_t* page, crawlState_t* state) {
+  int status = webpage_getStatus(page);
+  bool ok = status != 0 && status != 429 && status < 500;
+  if (state->stats != NULL) {
+    const char* html = webpage_getHTML(page);
+    crawlstats_fetched(state->stats, status, webpage_getFetchTime(page),
+                       (status == 200 && html != NULL) ? strlen(html) : 0);
+  }
+  pthread_mutex_lock(&state->lock);
+  if (scheduler_done(state->scheduler, webpage_getURL(page),
+                     webpage_getFetchTime(page), ok)) {
+    pthread_cond_signal(&state->wake);
+  }
+  pthread_mutex_unlock(&state->lock);
+}
+
+
+/**********************processPage**********************/
+/* a page was fetched: give it a docID (its old one, if re-crawling a page
+ * saved before), or, if the same body was saved already, record it as an
+ * alias of that page; scan it if not too deep; then pass it on to be saved
+ * with its validators (and indexed).  Returns true if it was, in which
+ * case the writer now owns the page.  A page already claimed by a copy
+ * met deeper is only scanned, at this depth */
+static bool processPage(webpage_t* page, crawlState_t* state) {
+  const char* html = webpage_getHTML(page);
+  uint64_t content = fingerprint(html, strlen(html));
+  int id = revisit_find(state->revisit, webpage_getURL(page), NULL, NULL);
+  bool known = id > 0;
+  int first = 0;
+  bool scan = webpage_getDepth(page) < state->maxDepth;
+  pthread_mutex_lock(&state->lock);
+  bool claimed = seenset_claim(state->pagesSeen, webpage_getURL(page));
+  if (!claimed) {
+    // a copy met deeper was fetched first, and saved: this one is fetched
+    // again only to scan it at its depth, unless it is itself stale now
+    scan = scan && webpage_getDepth(page) <= seenset_depth(state->pagesSeen,
+                                                           webpage_getURL(page));
+  } else if (known) {
+    // it keeps its docID, whatever else has the same body; if the body
+    // changed, the old one no longer stands for this page
+    uint64_t old = revisit_content(state->revisit, id);
+    if (old != content) {
+      dedup_remove(state->contents, old, id);
+      dedup_insert(state->contents, content, id);
+    }
+  } else if ((first = dedup_find(state->contents, content)) == 0) {
+    // claim a unique docID for this page
+    id = ++state->lastID;
+    dedup_insert(state->contents, content, id);
+  }
+  pthread_mutex_unlock(&state->lock);
+  // print the log status
+  logr("Fetched", webpage_getDepth(page), webpage_getURL(page));
+  if (first > 0) {
+    logr("Duplicate", webpage_getDepth(page), webpage_getURL(page));
+    if (!pagewriter_alias(state->toSave, first, webpage_getURL(page))) {
+      pageDirSaveAlias(state->pageDirectory, first, webpage_getURL(page));
+    }
+  }
+  // if the webpage's depth is less than the maxDepth (a duplicate is scanned
+  // too, since its relative links may resolve differently at another URL)
+  if (scan) {
+    // scan the webpage
+    logr("Scanning", webpage_getDepth(page), webpage_getURL(page));
+    double start = monotonic_now();
+    pageScan(page, webpage_getDepth(page), state);
+    crawlstats_time(state->stats, CRAWLSTATS_PARSE, monotonic_now() - start);
+  }
+  // scanning leaves the HTML as it was, so the page itself is saved; the
+  // writer may delete it at once, so only once it is scanned.  A page
+  // saved before loses any validators it no longer has
+  bool validators = known || webpage_getETag(page) != NULL
+                    || webpage_getLastModified(page) != NULL;
+  return claimed && first == 0 && saveLater(page, id, validators, content, state);
+}
+
+
+/**********************processUnchanged**********************/
+/* a page saved before is unchanged (HTTP 304): keep its docID and file,
+ * scan the saved copy if not too deep, and index it if building the index
+ * (unless a copy met deeper did so already) */
+static void processUnchanged(webpage_t* page, crawlState_t* state) {
+  int id = revisit_find(state->revisit, webpage_getURL(page), NULL, NULL);
+  logr("Unchanged", webpage_getDepth(page), webpage_getURL(page));
+  bool scan = webpage_getDepth(page) < state->maxDepth;
+  pthread_mutex_lock(&state->lock);
+  bool index = seenset_claim(state->pagesSeen, webpage_getURL(page)) && state->toIndex != NULL;
+  pthread_mutex_unlock(&state->lock);
+  if (id == 0 || (!scan && !index)) {
+    return;
+  }
+  webpage_t* saved = NULL;
+  if (pageDirLoad(&saved, state->pageDirectory, id) != 1) {
+    return;
+  }
+  if (webpage_getHTML(saved) == NULL) {
+    webpage_delete(saved);
+    return;
+  }
+  if (scan) {
+    // scan it at the depth it was found at this time
+    logr("Scanning", webpage_getDepth(page), webpage_getURL(page));
+    double start = monotonic_now();
+    pageScan(saved, webpage_getDepth(page), state);
+    crawlstats_time(state->stats, CRAWLSTATS_PARSE, monotonic_now() - start);
+  }
+  if (!index || !indexLater(saved, id, state)) {
+    webpage_delete(saved);
+  }
+}
+
+
+/**********************saveLater**********************/
+/* pass a page, with the fingerprint of its body, on to the writer, waiting
+ * while it is WRITE_QUEUE pages behind; should the writer not take it, save
+ * it here and now.  Returns true if the page went on, to the writer or the
+ * index thread */
+static bool saveLater(webpage_t* page, const int docID, const bool validators,
+                      const uint64_t content, crawlState_t* state) {
+  if (pagewriter_save(state->toSave, page, docID, validators, content)) {
+    return true;
+  }
+  double start = monotonic_now();
+  bool saved = pageDirSave(page, state->pageDirectory, docID);
+  if (saved && validators) {
+    saved = pageDirSaveValidators(state->pageDirectory, docID, webpage_getETag(page),
+                                  webpage_getLastModified(page));
+  }
+  if (saved) {
+    manifestRecord(state->pageDirectory, docID, webpage_getURL(page), webpage_getDepth(page),
+                   strlen(webpage_getHTML(page)), content);
+  }
+  crawlstats_time(state->stats, CRAWLSTATS_SAVE, monotonic_now() - start);
+  if (!saved) {
+    crawlstats_error(state->stats, CRAWLSTATS_UNSAVED);
+  }
+  return indexLater(page, docID, state);
+}
+
+
+/**********************indexLater**********************/
+/* pass a saved page on to the index thread, waiting while it is INDEX_QUEUE
+ * pages behind; returns true if it took the page, false if not indexing */
+static bool indexLater(webpage_t* page, const int docID, crawlState_t* state) {
+  return state->toIndex != NULL && pagequeue_put(state->toIndex, page, docID);
+}
+
+
+/**********************indexWorker**********************/
+/* the index thread: index each page as it comes off the queue.  Once the
+ * crawl is over, the pages it did not send -- those saved before a resumed
+ * checkpoint, or left from an earlier crawl and not reached by a re-crawl --
+ * are read back from the pageDirectory, so the index covers every docID */
+static void* indexWorker(void* arg) {
+  crawlState_t* state = arg;
+  bool* indexed = NULL;      // indexed[id]: docID id is in the index
+  int size = 0;              // length of indexed[]
+  webpage_t* page;
+  int id;
+  while ((page = pagequeue_take(state->toIndex, &id)) != NULL) {
+    if (indexPage(state->index, page, id) != 0) {
+      fprintf(stderr, "Warning: unable to index document %d\n", id);
+    }
     webpage_delete(page);
+    if (id >= size) {
+      int newSize = size > 0 ? size : 1024;
+      while (newSize <= id) {
+        newSize *= 2;
+      }
+      bool* grown = realloc(indexed, newSize * sizeof(bool));
+      if (grown == NULL) {
+        fprintf(stderr, "Warning: document %d may be indexed twice\n", id);
+        continue;
+      }
+      memset(grown + size, 0, (newSize - size) * sizeof(bool));
+      indexed = grown;
+      size = newSize;
+    }
+    indexed[id] = true;
+  }
+
+  // the queue is closed, so the crawl and its docIDs are final
+  pthread_mutex_lock(&state->lock);
+  int lastID = state->lastID;
+  pthread_mutex_unlock(&state->lock);
+  for (id = 1; id <= lastID; id++) {
+    if (id < size && indexed[id]) {
+      continue;
+    }
+    int found = pageDirLoad(&page, state->pageDirectory, id);
+    if (found == 1) {
+      if (indexPage(state->index, page, id) != 0) {
+        fprintf(stderr, "Warning: unable to index document %d\n", id);
+      }
+      webpage_delete(page);
+    } else if (found == 0) {
+      // saved, but unreadable: the index will lack it
+      fprintf(stderr, "Warning: unable to read document %d to index it\n", id);
+    }
+  }
+  free(indexed);
+  return NULL;
+}
+
+
+/**********************statsWorker**********************/
+/* the stats thread: write a snapshot of the stats every STATS_EVERY
+ * seconds until every page is done */
+static void* statsWorker(void* arg) {
+  crawlState_t* state = arg;
+  pthread_mutex_lock(&state->lock);
+  while (!state->ended) {
+    double due = monotonic_now() + STATS_EVERY;
+    struct timespec until = { (time_t) due, (long) ((due - (time_t) due) * 1e9) };
+    while (!state->ended && monotonic_now() < due) {
+      pthread_cond_timedwait(&state->statsWake, &state->lock, &until);
+    }
+    if (state->ended) {
+      break;
+    }
+    pthread_mutex_unlock(&state->lock);
+    crawlstats_gauges_t gauges = statsGauges(state);
+    if (!crawlstats_write(state->stats, state->statsFilename, &gauges)) {
+      fprintf(stderr, "Warning: unable to write the stats file %s\n", state->statsFilename);
+    }
+    pthread_mutex_lock(&state->lock);
+  }
+  pthread_mutex_unlock(&state->lock);
+  return NULL;
+}
+
+
+/**********************statsGauges**********************/
+/* the sizes of the frontier, the scheduler and the seen-set, now */
+static crawlstats_gauges_t statsGauges(crawlState_t* state) {
+  pthread_mutex_lock(&state->lock);
+  crawlstats_gauges_t gauges = { .frontier = frontier_size(state->pagesToCrawl),
+                                 .scheduler = scheduler_size(state->scheduler),
+                                 .seen = seenset_size(state->pagesSeen) };
+  pthread_mutex_unlock(&state->lock);
+  return gauges;
+}
+
+
+/**********************takeReady**********************/
+/* return a page whose host may be fetched now, moving pages from the
+ * frontier into the scheduler (up to its window) only until one is ready,
+ * so the rest keep their place in the frontier's order; if none, *wait is
+ * the seconds until one will be (-1: both are empty).  A page queued again
+ * shallower since is dropped as it leaves the frontier.  Caller holds the
+ * lock, or is the only thread. */
+static webpage_t* takeReady(crawlState_t* state, double* wait) {
+  webpage_t* page;
+  while ((page = scheduler_extract(state->scheduler, wait)) == NULL
+         && scheduler_size(state->scheduler) < SCHEDULER_WINDOW
+         && (page = frontier_extract(state->pagesToCrawl)) != NULL) {
+    int least = seenset_depth(state->pagesSeen, webpage_getURL(page));
+    if (least >= 0 && webpage_getDepth(page) > least) {
+      webpage_delete(page);
+    } else {
+      scheduler_insert(state->scheduler, page);
+    }
+  }
+  return page;
+}
+
+
+/**********************nextPage**********************/
+/* take a page that may be fetched now, waiting while there is none but
+ * one will become ready, or other workers may still add some;
+ * NULL means the crawl is finished */
+static webpage_t* nextPage(crawlState_t* state) {
+  pthread_mutex_lock(&state->lock);
+  webpage_t* page;
+  double wait;
+  for (;;) {
+    // a checkpoint waits until no worker holds a page
+    if (checkpointDue(state)) {
+      if (state->busy > 0) {
+        pthread_cond_wait(&state->wake, &state->lock);
+        continue;
+      }
+      saveCheckpoint(state);
+    }
+    if ((page = takeReady(state, &wait)) != NULL) {
+      break;
+    }
+    if (wait >= 0) {
+      // the next host is not ready yet; sleep until it is (or we are woken)
+      double due = monotonic_now() + wait;
+      struct timespec until = { (time_t) due, (long) ((due - (time_t) due) * 1e9) };
+      pthread_cond_timedwait(&state->wake, &state->lock, &until);
+    } else if (state->busy > 0) {
+      pthread_cond_wait(&state->wake, &state->lock);
+    } else if (!awaitURLs(state)) {
+      break;
+    }
   }
-  // delete the hashtable
-  hashtable_delete(ht, NULL);
-  // delete the bag
-  bag_delete(bag, webpage_delete);
+  if (page != NULL) {
+    state->busy++;
+  } else {
+    // nothing left and nobody can add more: release the other waiters
+    pthread_cond_broadcast(&state->wake);
+  }
+  pthread_mutex_unlock(&state->lock);
+  return page;
+}
+
+
+/**********************awaitURLs**********************/
+/* nothing is left to fetch and no page is in flight: a partition tells the
+ * coordinator so (once for each count of URLs received) and waits for more
+ * URLs, or for the end.  Returns false if the crawl is over, or true to
+ * look for pages again.  Caller holds the lock */
+static bool awaitURLs(crawlState_t* state) {
+  if (state->partition == NULL || state->finished) {
+    return false;
+  }
+  if (frontier_size(state->pagesToCrawl) > 0) {
+    // some came in while the lock was free
+    return true;
+  }
+  if (state->reported != state->received) {
+    partition_idle(state->partition, state->received);
+    state->reported = state->received;
+  }
+  pthread_cond_wait(&state->wake, &state->lock);
+  return true;
+}
+
+
+/**********************pageDone**********************/
+/* the worker has finished with its page; wake everyone if this was the last
+ * busy worker, since the frontier can no longer grow */
+static void pageDone(crawlState_t* state) {
+  pthread_mutex_lock(&state->lock);
+  if (--state->busy == 0) {
+    pthread_cond_broadcast(&state->wake);
+  }
+  pthread_mutex_unlock(&state->lock);
+}
+
+
+/**********************checkpointDue**********************/
+/* whether it is time to save a checkpoint; caller holds the lock, or is
+ * the only thread */
+static bool checkpointDue(const crawlState_t* state) {
+  return state->checkpointEvery > 0 && monotonic_now() >= state->nextCheckpoint;
+}
+
+
+/**********************saveCheckpoint**********************/
+/* save a checkpoint of the crawl; no page may be in flight.  Caller holds
+ * the lock, or is the only thread.  A failure is reported, and the crawl
+ * carries on with the previous checkpoint (if any) left in place */
+static void saveCheckpoint(crawlState_t* state) {
+  // the checkpoint counts every docID handed out as saved, so every page
+  // passed to the writer must be on disk first
+  if (!pagewriter_sync(state->toSave)) {
+    fprintf(stderr, "Warning: some pages could not be saved in %s\n", state->pageDirectory);
+  }
+  if (!checkpoint_save(state->pageDirectory, state->seedURL, state->maxDepth,
+                       state->lastID, state->pagesSeen, state->contents,
+                       state->pagesToCrawl, state->scheduler)) {
+    fprintf(stderr, "Warning: unable to save a checkpoint in %s\n", state->pageDirectory);
+  }
+  state->nextCheckpoint = monotonic_now() + state->checkpointEvery;
 }
 
 
 /**********************pageScan**********************/
-void pageScan(webpage_t* page, bag_t* pagesToCrawl, hashtable_t* pagesSeen) {
-  int pos = 0;
-  char* result;
-  // get all the URLs on a page
-  while ((result = webpage_getNextURL(page, &pos)) != NULL) {
-    logr("Found", webpage_getDepth(page), result);
-    // if URL is internal then continue
-    // otherwise print extrn url, ignore
-    if (isInternalURL(normalizeURL(result))) {
-      // if unique URL, continue
-      // otherwise print duplicate url, ignore
-      bool isInHt = hashtable_insert(pagesSeen, normalizeURL(result), "const");
-      if (isInHt) {
-        char* URL = malloc(strlen(result) + 1);
-        if (URL != NULL) {
-          strcpy(URL, result);
-        }
-        // add the new page found on the current page with +1 depth to the bag
-        int depth = webpage_getDepth(page) + 1;
-        webpage_t *wbpg = webpage_new(normalizeURL(URL), depth, NULL);
-        bag_insert(pagesToCrawl, wbpg);
-        logr("Added", webpage_getDepth(page), result);
-      } else {
-        logr("IgnDupl", webpage_getDepth(page), result);
+/* find all the URLs on a page found at the given depth, and add those that
+ * are internal and new to the frontier, one deeper */
+static void pageScan(webpage_t* page, const int depth, crawlState_t* state) {
+  scanArg_t scan = { .state = state, .depth = depth, .URL = NULL, .size = 0 };
+  webpage_scanURLs(page, &scan, scanURL);
+  free(scan.URL);
+  // the URLs for other partitions go on before this page is done
+  if (state->partition != NULL) {
+    partition_flush(state->partition);
+  }
+}
+
+
+/**********************scanURL**********************/
+/* one URL that pageScan found */
+static void scanURL(void* arg, const char* result) {
+  scanArg_t* scan = arg;
+  crawlState_t* state = scan->state;
+  logr("Found", scan->depth, result);
+  // normalizing never makes a URL longer, so URL need only be as big
+  size_t need = strlen(result) + 1;
+  if (need > scan->size) {
+    char* grown = realloc(scan->URL, need);
+    if (grown != NULL) {
+      scan->URL = grown;
+      scan->size = need;
+    }
+  }
+  // if URL is internal then continue
+  // otherwise print extrn url, ignore
+  if (scan->URL != NULL && normalizeURLInto(result, scan->URL, scan->size) == URL_INTERNAL) {
+    // if unique URL, continue
+    // otherwise print duplicate url, ignore
+    // with -n, only URLs on this partition's hosts are crawled here
+    bool ours = partition_owns(state->partition, scan->URL);
+    pthread_mutex_lock(&state->lock);
+    bool isInHt = seenset_insert(state->pagesSeen, scan->URL, scan->depth + 1);
+    if (isInHt && ours) {
+      // add the new page found on the current page with +1 depth to the bag
+      // (again, if it was only met deeper before); only such a URL is copied
+      char* copy = malloc(strlen(scan->URL) + 1);
+      if (copy != NULL) {
+        strcpy(copy, scan->URL);
       }
+      webpage_t *wbpg = webpage_new(copy, scan->depth + 1, NULL);
+      frontier_insert(state->pagesToCrawl, wbpg);
+      pthread_cond_signal(&state->wake);
     }
-    else {
-      logr("IgnExtn", webpage_getDepth(page), result);
+    pthread_mutex_unlock(&state->lock);
+    if (isInHt && !ours) {
+      // seen here, so it is passed on only once at each depth
+      partition_forward(state->partition, scan->depth + 1, scan->URL);
+      logr("Forwarded", scan->depth, result);
+    } else if (isInHt) {
+      logr("Added", scan->depth, result);
+    } else {
+      logr("IgnDupl", scan->depth, result);
     }
-    // free the result string
-    free(result);
+  }
+  else {
+    logr("IgnExtn", scan->depth, result);
   }
 }
 
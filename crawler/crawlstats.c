@@ -0,0 +1,263 @@
+/*
+ * crawlstats.c - counts and timings of a crawl
+ *
+ * see crawlstats.h for more information.
+ *
+ * Each histogram is an array of counts, one per bucket, with the sum and
+ * the maximum of what went in; recording is a short search of the bucket
+ * bounds and a few additions, under the one mutex.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "crawlstats.h"
+#include "monotonic.h"
+
+/**************** file-local constants ****************/
+/* upper bounds of the histogram buckets, in ms; the last bucket has none */
+static const double BOUNDS[] = {
+  0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1, 2, 5, 10, 20, 50,
+  100, 200, 500, 1000, 2000, 5000, 10000,
+};
+#define NUM_BOUNDS ((int) (sizeof(BOUNDS) / sizeof(BOUNDS[0])))
+#define NUM_BUCKETS (NUM_BOUNDS + 1)
+
+static const char* TIMING_NAMES[CRAWLSTATS_NUM_TIMINGS] = { "fetch", "parse", "save" };
+static const char* ERROR_NAMES[CRAWLSTATS_NUM_ERRORS] = {
+  "network", "redirect", "client", "throttled", "server", "save",
+};
+
+/**************** file-local types ****************/
+typedef struct histogram {
+  long counts[NUM_BUCKETS];
+  long count;
+  double sum;               // ms
+  double max;               // ms
+} histogram_t;
+
+/**************** global types ****************/
+struct crawlstats {
+  double start;             // when the crawl started
+  long pages;               // 200s
+  long long bytes;          // bytes of the pages
+  long unchanged;           // 304s
+  long errors[CRAWLSTATS_NUM_ERRORS];
+  histogram_t timings[CRAWLSTATS_NUM_TIMINGS];
+  double lastTime;          // when crawlstats_write last ran
+  long lastPages;           // pages then
+  long long lastBytes;      // bytes then
+  pthread_mutex_t lock;     // guards all of the above
+};
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static void record(histogram_t* histogram, const double seconds);
+static double percentile(const histogram_t* histogram, const double fraction);
+static void report(crawlstats_t* stats, FILE* fp, const crawlstats_gauges_t* gauges,
+                   const double time);
+
+/**************** crawlstats_new ****************/
+/* see crawlstats.h for description */
+crawlstats_t*
+crawlstats_new(void)
+{
+  crawlstats_t* stats = calloc(1, sizeof(crawlstats_t));
+  if (stats == NULL) {
+    return NULL;
+  }
+  stats->start = stats->lastTime = monotonic_now();
+  pthread_mutex_init(&stats->lock, NULL);
+  return stats;
+}
+
+/**************** crawlstats_fetched ****************/
+/* see crawlstats.h for description */
+void
+crawlstats_fetched(crawlstats_t* stats, const int status, const double seconds,
+                   const size_t bytes)
+{
+  if (stats == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&stats->lock);
+  record(&stats->timings[CRAWLSTATS_FETCH], seconds);
+  if (status == 200) {
+    stats->pages++;
+    stats->bytes += bytes;
+  } else if (status == 304) {
+    stats->unchanged++;
+  } else if (status == 0) {
+    stats->errors[CRAWLSTATS_NETWORK]++;
+  } else if (status >= 300 && status < 400) {
+    stats->errors[CRAWLSTATS_REDIRECT]++;
+  } else if (status == 429 || status == 503) {
+    stats->errors[CRAWLSTATS_THROTTLED]++;
+  } else if (status >= 400 && status < 500) {
+    stats->errors[CRAWLSTATS_CLIENT]++;
+  } else {
+    stats->errors[CRAWLSTATS_SERVER]++;
+  }
+  pthread_mutex_unlock(&stats->lock);
+}
+
+/**************** crawlstats_time ****************/
+/* see crawlstats.h for description */
+void
+crawlstats_time(crawlstats_t* stats, const crawlstats_timing_t stage, const double seconds)
+{
+  if (stats == NULL || stage < 0 || stage >= CRAWLSTATS_NUM_TIMINGS) {
+    return;
+  }
+  pthread_mutex_lock(&stats->lock);
+  record(&stats->timings[stage], seconds);
+  pthread_mutex_unlock(&stats->lock);
+}
+
+/**************** crawlstats_error ****************/
+/* see crawlstats.h for description */
+void
+crawlstats_error(crawlstats_t* stats, const crawlstats_error_t error)
+{
+  if (stats == NULL || error < 0 || error >= CRAWLSTATS_NUM_ERRORS) {
+    return;
+  }
+  pthread_mutex_lock(&stats->lock);
+  stats->errors[error]++;
+  pthread_mutex_unlock(&stats->lock);
+}
+
+/**************** crawlstats_write ****************/
+/* see crawlstats.h for description */
+bool
+crawlstats_write(crawlstats_t* stats, const char* filename,
+                 const crawlstats_gauges_t* gauges)
+{
+  if (stats == NULL || filename == NULL || gauges == NULL) {
+    return false;
+  }
+  char temp[strlen(filename) + 5];
+  sprintf(temp, "%s.tmp", filename);
+  FILE* fp = fopen(temp, "w");
+  if (fp == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&stats->lock);
+  double time = monotonic_now();
+  report(stats, fp, gauges, time);
+  stats->lastTime = time;
+  stats->lastPages = stats->pages;
+  stats->lastBytes = stats->bytes;
+  pthread_mutex_unlock(&stats->lock);
+  bool ok = !ferror(fp);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(temp, filename) != 0) {
+    remove(temp);
+    return false;
+  }
+  return true;
+}
+
+/**************** crawlstats_print ****************/
+/* see crawlstats.h for description */
+void
+crawlstats_print(crawlstats_t* stats, FILE* fp, const crawlstats_gauges_t* gauges)
+{
+  if (stats == NULL || fp == NULL || gauges == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&stats->lock);
+  report(stats, fp, gauges, monotonic_now());
+  pthread_mutex_unlock(&stats->lock);
+}
+
+/**************** crawlstats_delete ****************/
+/* see crawlstats.h for description */
+void
+crawlstats_delete(crawlstats_t* stats)
+{
+  if (stats != NULL) {
+    pthread_mutex_destroy(&stats->lock);
+    free(stats);
+  }
+}
+
+/**************** record ****************/
+/* add one time, in seconds, to a histogram */
+static void
+record(histogram_t* histogram, const double seconds)
+{
+  double ms = seconds * 1000.0;
+  int bucket = 0;
+  while (bucket < NUM_BOUNDS && ms > BOUNDS[bucket]) {
+    bucket++;
+  }
+  histogram->counts[bucket]++;
+  histogram->count++;
+  histogram->sum += ms;
+  if (ms > histogram->max) {
+    histogram->max = ms;
+  }
+}
+
+/**************** percentile ****************/
+/* the upper bound of the bucket holding the given fraction of a
+ * histogram's times (the maximum, for the last bucket); 0 if empty */
+static double
+percentile(const histogram_t* histogram, const double fraction)
+{
+  long rank = (long) (fraction * (histogram->count - 1)) + 1;
+  long seen = 0;
+  for (int bucket = 0; bucket < NUM_BOUNDS; bucket++) {
+    seen += histogram->counts[bucket];
+    if (seen >= rank) {
+      return BOUNDS[bucket] < histogram->max ? BOUNDS[bucket] : histogram->max;
+    }
+  }
+  return histogram->max;
+}
+
+/**************** report ****************/
+/* print a snapshot, in the form given in crawlstats.h, as of 'time';
+ * caller holds the lock */
+static void
+report(crawlstats_t* stats, FILE* fp, const crawlstats_gauges_t* gauges, const double time)
+{
+  double elapsed = time - stats->start;
+  double recent = time - stats->lastTime;
+  fprintf(fp, "elapsed %.3f\n", elapsed);
+  fprintf(fp, "pages %ld %.1f %.1f\n", stats->pages,
+          elapsed > 0 ? stats->pages / elapsed : 0,
+          recent > 0 ? (stats->pages - stats->lastPages) / recent : 0);
+  fprintf(fp, "bytes %lld %.0f %.0f\n", stats->bytes,
+          elapsed > 0 ? stats->bytes / elapsed : 0,
+          recent > 0 ? (stats->bytes - stats->lastBytes) / recent : 0);
+  fprintf(fp, "unchanged %ld\n", stats->unchanged);
+  fprintf(fp, "frontier %ld\nscheduler %ld\nseen %ld\n",
+          gauges->frontier, gauges->scheduler, gauges->seen);
+  for (int i = 0; i < CRAWLSTATS_NUM_TIMINGS; i++) {
+    const histogram_t* h = &stats->timings[i];
+    fprintf(fp, "%sMs %ld %.3f %.3f %.3f %.3f %.3f\n", TIMING_NAMES[i], h->count,
+            h->count > 0 ? h->sum / h->count : 0,
+            percentile(h, 0.50), percentile(h, 0.90), percentile(h, 0.99), h->max);
+  }
+  for (int i = 0; i < CRAWLSTATS_NUM_TIMINGS; i++) {
+    fprintf(fp, "%sBuckets", TIMING_NAMES[i]);
+    for (int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+      if (bucket < NUM_BOUNDS) {
+        fprintf(fp, " %g:%ld", BOUNDS[bucket], stats->timings[i].counts[bucket]);
+      } else {
+        fprintf(fp, " inf:%ld", stats->timings[i].counts[bucket]);
+      }
+    }
+    fprintf(fp, "\n");
+  }
+  fprintf(fp, "errors");
+  for (int i = 0; i < CRAWLSTATS_NUM_ERRORS; i++) {
+    fprintf(fp, " %s %ld", ERROR_NAMES[i], stats->errors[i]);
+  }
+  fprintf(fp, "\n");
+}
@@ -0,0 +1,124 @@
+/*
+ * crawlstats.h - header file for the crawler's 'crawlstats' module
+ *
+ * A 'crawlstats' keeps running counts of what a crawl has done and how
+ * long it took: pages and bytes fetched, histograms of the time spent
+ * fetching, parsing and saving each page, and failed fetches by class.
+ * Together with the sizes of the crawl's queues, which the caller passes
+ * in, it writes them out as a snapshot -- to a file, every few seconds
+ * during a long crawl, or once at the end as a summary:
+ *
+ *     elapsed <seconds>
+ *     pages <n> <per second> <per second since the last snapshot>
+ *     bytes <n> <per second> <per second since the last snapshot>
+ *     unchanged <n>
+ *     frontier <n>
+ *     scheduler <n>
+ *     seen <n>
+ *     fetchMs <count> <mean> <p50> <p90> <p99> <max>
+ *     parseMs <count> <mean> <p50> <p90> <p99> <max>
+ *     saveMs <count> <mean> <p50> <p90> <p99> <max>
+ *     fetchBuckets <upper bound>:<count> ...
+ *     parseBuckets <upper bound>:<count> ...
+ *     saveBuckets <upper bound>:<count> ...
+ *     errors network <n> redirect <n> client <n> throttled <n> server <n> save <n>
+ *
+ * Times are in milliseconds, kept in buckets whose upper bounds run 1, 2,
+ * 5 by tens from 0.01 ms to 10 s (and one for anything longer); so a
+ * percentile is the upper bound of the bucket it falls in, while the mean
+ * and the maximum are exact.
+ *
+ * Like the pagequeue, a crawlstats locks for itself: every worker records
+ * into one.  Every function ignores a NULL crawlstats, so a crawl without
+ * stats just passes NULL.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __CRAWLSTATS_H
+#define __CRAWLSTATS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct crawlstats crawlstats_t;  // opaque to users of the module
+
+/* the stages of a page that are timed */
+typedef enum {
+  CRAWLSTATS_FETCH,          // fetching it (see crawlstats_fetched)
+  CRAWLSTATS_PARSE,          // scanning it for links
+  CRAWLSTATS_SAVE,           // writing it to the pageDirectory
+  CRAWLSTATS_NUM_TIMINGS
+} crawlstats_timing_t;
+
+/* the classes of failure counted */
+typedef enum {
+  CRAWLSTATS_NETWORK,        // no response: lookup, connection or timeout
+  CRAWLSTATS_REDIRECT,       // 3xx other than 304, which is not followed
+  CRAWLSTATS_CLIENT,         // 4xx other than 429
+  CRAWLSTATS_THROTTLED,      // 429 or 503: the server is turning us away
+  CRAWLSTATS_SERVER,         // any other 5xx, or a status we do not know
+  CRAWLSTATS_UNSAVED,        // a page could not be written
+  CRAWLSTATS_NUM_ERRORS
+} crawlstats_error_t;
+
+/* the sizes of the crawl's queues, at the time of a snapshot */
+typedef struct crawlstats_gauges {
+  long frontier;             // pages waiting in the frontier
+  long scheduler;            // pages waiting in the scheduler
+  long seen;                 // URLs in the seen-set
+} crawlstats_gauges_t;
+
+/**************** crawlstats_new ****************/
+/* Create a new crawlstats, with every count zero and the clock started.
+ *
+ * We return:
+ *   pointer to a new crawlstats, or NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling crawlstats_delete.
+ */
+crawlstats_t* crawlstats_new(void);
+
+/**************** crawlstats_fetched ****************/
+/* Record a fetch that has finished.
+ *
+ * Caller provides:
+ *   the HTTP status (0 if there was no response), the seconds the fetch
+ *   took, and the bytes of the page it brought (0 unless 200).
+ * We do:
+ *   time it; count a 200 as a page, a 304 as unchanged, and anything
+ *   else as an error of its class.
+ */
+void crawlstats_fetched(crawlstats_t* stats, const int status, const double seconds,
+                        const size_t bytes);
+
+/**************** crawlstats_time ****************/
+/* Add the seconds one page spent in one stage to that stage's histogram. */
+void crawlstats_time(crawlstats_t* stats, const crawlstats_timing_t stage,
+                     const double seconds);
+
+/**************** crawlstats_error ****************/
+/* Count one failure of the given class. */
+void crawlstats_error(crawlstats_t* stats, const crawlstats_error_t error);
+
+/**************** crawlstats_write ****************/
+/* Write a snapshot to filename, replacing the last one whole (it is
+ * written aside and renamed into place, so a reader never sees half of
+ * one).  The recent rates are those since the last crawlstats_write.
+ * False if the file could not be written.
+ */
+bool crawlstats_write(crawlstats_t* stats, const char* filename,
+                      const crawlstats_gauges_t* gauges);
+
+/**************** crawlstats_print ****************/
+/* Print a snapshot to fp, as a summary; the recent rates are those since
+ * the last crawlstats_write.
+ */
+void crawlstats_print(crawlstats_t* stats, FILE* fp, const crawlstats_gauges_t* gauges);
+
+/**************** crawlstats_delete ****************/
+/* Free the crawlstats.  NULL is ignored. */
+void crawlstats_delete(crawlstats_t* stats);
+
+#endif // __CRAWLSTATS_H
@@ -0,0 +1,162 @@
+/*
+ * dedup.c - the crawler's table of page contents already saved
+ *
+ * see dedup.h for more information.
+ *
+ * The table is an fptable (see fptable.h) of content fingerprints,
+ * whose value is the docID each was saved under.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "dedup.h"
+#include "fptable.h"
+
+/**************** global types ****************/
+struct dedup {
+  fptable_t table;          // content fingerprints, each with its docID
+};
+
+/**************** local functions ****************/
+static int* docIDs(const dedup_t* dedup);
+
+/**************** dedup_new ****************/
+/* see dedup.h for description */
+dedup_t*
+dedup_new(const size_t expected)
+{
+  dedup_t* dedup = malloc(sizeof(dedup_t));
+  if (dedup == NULL) {
+    return NULL;
+  }
+  if (!fptable_init(&dedup->table, expected, sizeof(int))) {
+    free(dedup);
+    return NULL;
+  }
+  return dedup;
+}
+
+/**************** dedup_find ****************/
+/* see dedup.h for description */
+int
+dedup_find(const dedup_t* dedup, const uint64_t content)
+{
+  if (dedup == NULL || content == 0) {
+    return 0;
+  }
+  size_t i = fptable_find(&dedup->table, content);
+  return i == FPTABLE_ABSENT ? 0 : docIDs(dedup)[i];
+}
+
+/**************** dedup_insert ****************/
+/* see dedup.h for description */
+bool
+dedup_insert(dedup_t* dedup, const uint64_t content, const int docID)
+{
+  if (dedup == NULL || content == 0 || docID < 1
+      || dedup_find(dedup, content) != 0) {
+    return false;
+  }
+  if (!fptable_makeRoom(&dedup->table)) {
+    return false;
+  }
+  docIDs(dedup)[fptable_place(&dedup->table, content)] = docID;
+  return true;
+}
+
+/**************** dedup_remove ****************/
+/* see dedup.h for description */
+bool
+dedup_remove(dedup_t* dedup, const uint64_t content, const int docID)
+{
+  if (dedup == NULL || content == 0) {
+    return false;
+  }
+  size_t i = fptable_find(&dedup->table, content);
+  if (i == FPTABLE_ABSENT || docIDs(dedup)[i] != docID) {
+    return false;
+  }
+  fptable_remove(&dedup->table, i);
+  return true;
+}
+
+/**************** dedup_size ****************/
+/* see dedup.h for description */
+size_t
+dedup_size(const dedup_t* dedup)
+{
+  return dedup ? dedup->table.size : 0;
+}
+
+/**************** dedup_save ****************/
+/* see dedup.h for description
+ *
+ * The format is the number of entries, then each entry as its
+ * fingerprint and its docID; every number is 8 bytes, least
+ * significant first.
+ */
+bool
+dedup_save(const dedup_t* dedup, FILE* fp)
+{
+  if (dedup == NULL || fp == NULL || !fptable_writeWord(fp, dedup->table.size)) {
+    return false;
+  }
+  for (size_t i = 0; i <= dedup->table.mask; i++) {
+    if (dedup->table.slots[i] != 0
+        && (!fptable_writeWord(fp, dedup->table.slots[i])
+            || !fptable_writeWord(fp, docIDs(dedup)[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************** dedup_load ****************/
+/* see dedup.h for description */
+dedup_t*
+dedup_load(FILE* fp)
+{
+  uint64_t count;
+  if (fp == NULL || !fptable_readWord(fp, &count) || !fptable_fits(fp, count, 16)) {
+    return NULL;                    // more than the file holds
+  }
+  dedup_t* dedup = dedup_new(count);
+  if (dedup == NULL) {
+    return NULL;
+  }
+  for (uint64_t n = 0; n < count; n++) {
+    uint64_t content, docID;
+    size_t i;
+    if (!fptable_readWord(fp, &content) || !fptable_readWord(fp, &docID)
+        || content == 0 || docID < 1 || docID > INT32_MAX
+        || (i = fptable_place(&dedup->table, content)) == FPTABLE_ABSENT) {
+      dedup_delete(dedup);          // short, or not entries at all
+      return NULL;
+    }
+    docIDs(dedup)[i] = (int) docID;
+  }
+  return dedup;
+}
+
+/**************** dedup_delete ****************/
+/* see dedup.h for description */
+void
+dedup_delete(dedup_t* dedup)
+{
+  if (dedup != NULL) {
+    fptable_free(&dedup->table);
+    free(dedup);
+  }
+}
+
+/**************** local functions ****************/
+
+/* docIDs: the docIDs, one per table slot */
+static int*
+docIDs(const dedup_t* dedup)
+{
+  return dedup->table.values;
+}
@@ -0,0 +1,97 @@
+/*
+ * dedup.h - header file for the crawler's 'dedup' module
+ *
+ * A 'dedup' table remembers the content of every page the crawler has
+ * saved, as a 64-bit fingerprint of its body (see common/fingerprint.h),
+ * together with the docID it was saved under.  A page whose body is
+ * byte-for-byte the same as one already saved -- a mirror, or the same
+ * page under another query string -- is found in the table, and need not
+ * be saved, indexed or returned by the querier a second time.
+ *
+ * Two different bodies with the same fingerprint would be mistaken for
+ * one; at 64 bits that is vanishingly unlikely for any feasible crawl.
+ *
+ * The table does not lock; the crawler calls it under its own lock.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __DEDUP_H
+#define __DEDUP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**************** global types ****************/
+typedef struct dedup dedup_t;  // opaque to users of the module
+
+/**************** dedup_new ****************/
+/* Create a new (empty) table.
+ *
+ * Caller provides:
+ *   expected, a guess at how many pages it will hold (it grows as needed).
+ * We return:
+ *   pointer to a new table, or NULL if error.
+ * Caller is responsible for:
+ *   later calling dedup_delete.
+ */
+dedup_t* dedup_new(const size_t expected);
+
+/**************** dedup_find ****************/
+/* Return the docID saved with this content fingerprint, or 0 if none. */
+int dedup_find(const dedup_t* dedup, const uint64_t content);
+
+/**************** dedup_insert ****************/
+/* Record that the page with this content fingerprint is saved as docID.
+ *
+ * Caller provides:
+ *   valid table; content, a fingerprint from common/fingerprint.h
+ *   (never 0); docID > 0.
+ * We return:
+ *   true if recorded; false if the fingerprint was already there (it
+ *   keeps its first docID), on bad arguments, or out of memory.
+ */
+bool dedup_insert(dedup_t* dedup, const uint64_t content, const int docID);
+
+/**************** dedup_remove ****************/
+/* Forget a fingerprint, if it is recorded with this docID (say, because
+ * the page saved as docID has since changed).
+ *
+ * We return:
+ *   true if it was removed; false otherwise.
+ */
+bool dedup_remove(dedup_t* dedup, const uint64_t content, const int docID);
+
+/**************** dedup_size ****************/
+/* Return the number of fingerprints in the table. */
+size_t dedup_size(const dedup_t* dedup);
+
+/**************** dedup_save ****************/
+/* Write the table to an open file, in a form dedup_load reads back
+ * (on any machine).
+ *
+ * We return:
+ *   true if all was written; false otherwise.
+ */
+bool dedup_save(const dedup_t* dedup, FILE* fp);
+
+/**************** dedup_load ****************/
+/* Read back a table written by dedup_save.
+ *
+ * Caller provides:
+ *   fp open for reading, positioned where dedup_save began writing.
+ * We return:
+ *   pointer to a new table, with fp positioned just past it; or NULL if
+ *   the data are damaged or out of memory.
+ * Caller is responsible for:
+ *   later calling dedup_delete.
+ */
+dedup_t* dedup_load(FILE* fp);
+
+/**************** dedup_delete ****************/
+/* Delete the table.  A NULL table is ignored. */
+void dedup_delete(dedup_t* dedup);
+
+#endif // __DEDUP_H
@@ -0,0 +1,200 @@
+/*
+ * fptable.c - the open-addressed fingerprint table under seenset and dedup
+ *
+ * see fptable.h for more information.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fileno
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "fptable.h"
+
+/**************** file-local constants ****************/
+static const size_t MIN_SLOTS = 1024;   // smallest table we make
+
+/**************** local functions ****************/
+static bool makeArrays(fptable_t* table, const size_t numSlots);
+static unsigned char* valueAt(const fptable_t* table, const size_t slot);
+
+/**************** fptable_init ****************/
+/* see fptable.h for description */
+bool
+fptable_init(fptable_t* table, const size_t expected, const size_t valueSize)
+{
+  // enough slots to hold 'expected' entries below the 3/4 limit
+  size_t numSlots = MIN_SLOTS;
+  while (numSlots / 4 * 3 < expected) {
+    if (numSlots > SIZE_MAX / 2 / (sizeof(uint64_t) + valueSize)) {
+      return false;                 // more than memory could ever hold
+    }
+    numSlots *= 2;
+  }
+  table->valueSize = valueSize;
+  table->size = 0;
+  return makeArrays(table, numSlots);
+}
+
+/**************** fptable_find ****************/
+/* see fptable.h for description */
+size_t
+fptable_find(const fptable_t* table, const uint64_t fp)
+{
+  for (size_t i = fp & table->mask; table->slots[i] != 0; i = (i + 1) & table->mask) {
+    if (table->slots[i] == fp) {
+      return i;
+    }
+  }
+  return FPTABLE_ABSENT;
+}
+
+/**************** fptable_place ****************/
+/* see fptable.h for description */
+size_t
+fptable_place(fptable_t* table, const uint64_t fp)
+{
+  size_t i = fp & table->mask;
+  while (table->slots[i] != 0) {
+    if (table->slots[i] == fp) {
+      return FPTABLE_ABSENT;
+    }
+    i = (i + 1) & table->mask;
+  }
+  table->slots[i] = fp;
+  table->size++;
+  return i;
+}
+
+/**************** fptable_makeRoom ****************/
+/* see fptable.h for description */
+bool
+fptable_makeRoom(fptable_t* table)
+{
+  if (table->size + 1 <= (table->mask + 1) / 4 * 3) {
+    return true;
+  }
+  fptable_t old = *table;
+  if ((old.mask + 1) > SIZE_MAX / 4 / (sizeof(uint64_t) + old.valueSize)
+      || !makeArrays(table, (old.mask + 1) * 2)) {
+    *table = old;
+    return false;
+  }
+  table->size = 0;
+  for (size_t i = 0; i <= old.mask; i++) {
+    if (old.slots[i] != 0) {
+      size_t slot = fptable_place(table, old.slots[i]);
+      memcpy(valueAt(table, slot), valueAt(&old, i), old.valueSize);
+    }
+  }
+  fptable_free(&old);
+  return true;
+}
+
+/**************** fptable_remove ****************/
+/* see fptable.h for description */
+void
+fptable_remove(fptable_t* table, const size_t slot)
+{
+  // close the gap: move back any later entry whose home slot does not
+  // lie cyclically in (gap, j]
+  size_t gap = slot;
+  for (size_t j = (slot + 1) & table->mask; table->slots[j] != 0;
+       j = (j + 1) & table->mask) {
+    size_t home = table->slots[j] & table->mask;
+    if (((j - home) & table->mask) >= ((j - gap) & table->mask)) {
+      table->slots[gap] = table->slots[j];
+      memcpy(valueAt(table, gap), valueAt(table, j), table->valueSize);
+      gap = j;
+    }
+  }
+  table->slots[gap] = 0;
+  memset(valueAt(table, gap), 0, table->valueSize);
+  table->size--;
+}
+
+/**************** fptable_free ****************/
+/* see fptable.h for description */
+void
+fptable_free(fptable_t* table)
+{
+  if (table != NULL) {
+    free(table->slots);
+    free(table->values);
+    table->slots = NULL;
+    table->values = NULL;
+  }
+}
+
+/**************** fptable_writeWord ****************/
+/* see fptable.h for description */
+bool
+fptable_writeWord(FILE* fp, const uint64_t word)
+{
+  unsigned char bytes[8];
+  for (int i = 0; i < 8; i++) {
+    bytes[i] = (word >> (8 * i)) & 0xff;
+  }
+  return fwrite(bytes, 1, 8, fp) == 8;
+}
+
+/**************** fptable_readWord ****************/
+/* see fptable.h for description */
+bool
+fptable_readWord(FILE* fp, uint64_t* word)
+{
+  unsigned char bytes[8];
+  if (fread(bytes, 1, 8, fp) != 8) {
+    return false;
+  }
+  *word = 0;
+  for (int i = 7; i >= 0; i--) {
+    *word = (*word << 8) | bytes[i];
+  }
+  return true;
+}
+
+/**************** fptable_fits ****************/
+/* see fptable.h for description */
+bool
+fptable_fits(FILE* fp, const uint64_t count, const size_t entryBytes)
+{
+  struct stat status;
+  long at = ftell(fp);
+  if (at < 0 || fstat(fileno(fp), &status) != 0 || !S_ISREG(status.st_mode)) {
+    return count <= SIZE_MAX / entryBytes;
+  }
+  return status.st_size >= at && count <= (uint64_t) (status.st_size - at) / entryBytes;
+}
+
+/**************** local functions ****************/
+
+/* makeArrays: give the table numSlots empty slots and values; on
+ * failure the table's arrays are untouched.
+ */
+static bool
+makeArrays(fptable_t* table, const size_t numSlots)
+{
+  uint64_t* slots = calloc(numSlots, sizeof(uint64_t));
+  void* values = calloc(numSlots, table->valueSize);
+  if (slots == NULL || values == NULL) {
+    free(slots);
+    free(values);
+    return false;
+  }
+  table->slots = slots;
+  table->values = values;
+  table->mask = numSlots - 1;
+  return true;
+}
+
+/* valueAt: where a slot's value is */
+static unsigned char*
+valueAt(const fptable_t* table, const size_t slot)
+{
+  return (unsigned char*) table->values + slot * table->valueSize;
+}
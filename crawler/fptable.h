@@ -0,0 +1,111 @@
+/*
+ * fptable.h - header file for the crawler's 'fptable' module
+ *
+ * An 'fptable' is the open-addressed table of 64-bit fingerprints (see
+ * common/fingerprint.h) that both the seenset and the dedup table are
+ * built on, each fingerprint with a fixed-size value beside it: a mark
+ * byte for the seenset, a docID for dedup.  The table is a power-of-two
+ * array of fingerprints, probed linearly from the slot named by the
+ * fingerprint's low bits; 0 marks an empty slot (fingerprints are never
+ * 0).  A parallel array holds the values, so probing touches only the
+ * fingerprints.  When the table would pass 3/4 full it doubles, and
+ * every entry is placed again.  Removal shifts later entries of the same
+ * probe run back into the gap, so no tombstones are needed.
+ *
+ * Unlike the crawler's other modules the struct is not opaque: each
+ * user embeds one, and reads its slots and values directly.
+ *
+ * The module also holds the word I/O that both users save and load
+ * their tables with: 8-byte numbers, least significant byte first, so
+ * a saved table reads back on any machine.
+ *
+ * The table does not lock; its users are called under the crawler's lock.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __FPTABLE_H
+#define __FPTABLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**************** global types ****************/
+typedef struct fptable {
+  uint64_t* slots;          // fingerprints; 0 means empty
+  void* values;             // valueSize bytes per slot
+  size_t valueSize;
+  size_t mask;              // number of slots - 1
+  size_t size;              // slots in use
+} fptable_t;
+
+/* the slot number for no slot */
+#define FPTABLE_ABSENT ((size_t) -1)
+
+/**************** fptable_init ****************/
+/* Make an empty table.
+ *
+ * Caller provides:
+ *   table to fill in; expected, a guess at how many entries it will hold
+ *   (it grows as needed); valueSize, the bytes kept with each entry.
+ * We return:
+ *   true if made; false if out of memory, or if 'expected' entries could
+ *   never fit in memory.
+ * Caller is responsible for:
+ *   later calling fptable_free.
+ */
+bool fptable_init(fptable_t* table, const size_t expected, const size_t valueSize);
+
+/**************** fptable_find ****************/
+/* Return the slot holding the fingerprint, or FPTABLE_ABSENT. */
+size_t fptable_find(const fptable_t* table, const uint64_t fp);
+
+/**************** fptable_place ****************/
+/* Put a fingerprint in the first free slot of its probe sequence.
+ *
+ * Caller provides:
+ *   a table with room for one more (see fptable_makeRoom); fp, not 0.
+ * We return:
+ *   the slot it now holds, whose value the caller fills in; or
+ *   FPTABLE_ABSENT if it was in the table already.
+ */
+size_t fptable_place(fptable_t* table, const uint64_t fp);
+
+/**************** fptable_makeRoom ****************/
+/* Make sure one more entry fits below the 3/4 limit, doubling the table
+ * (and placing every entry again, with its value) if need be.
+ *
+ * We return:
+ *   true if there is room; false if out of memory, in which case the
+ *   table is left as it was.  The caller can tell from the mask whether
+ *   the table grew.
+ */
+bool fptable_makeRoom(fptable_t* table);
+
+/**************** fptable_remove ****************/
+/* Empty a slot that holds an entry, closing the gap it leaves. */
+void fptable_remove(fptable_t* table, const size_t slot);
+
+/**************** fptable_free ****************/
+/* Free the table's arrays (not the table itself). */
+void fptable_free(fptable_t* table);
+
+/**************** fptable_writeWord ****************/
+/* Write 8 bytes, least significant first; true if written. */
+bool fptable_writeWord(FILE* fp, const uint64_t word);
+
+/**************** fptable_readWord ****************/
+/* Read 8 bytes written by fptable_writeWord; true if read. */
+bool fptable_readWord(FILE* fp, uint64_t* word);
+
+/**************** fptable_fits ****************/
+/* Could count entries of entryBytes each still be in the file, after
+ * where fp stands?  A loader checks a saved count with this before it
+ * sizes a table for it.  A file whose size cannot be told (a pipe, say)
+ * may hold any number that memory could; the reads will find out.
+ */
+bool fptable_fits(FILE* fp, const uint64_t count, const size_t entryBytes);
+
+#endif // __FPTABLE_H
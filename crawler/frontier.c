@@ -0,0 +1,615 @@
+/*
+ * frontier.c - the crawler's disk-spilling queue of pages to fetch
+ *
+ * see frontier.h for more information.
+ *
+ * The frontier is an array of buckets indexed by priority level, lowest
+ * first; in FIFO order there is just bucket 0.  Each bucket is a
+ * first-in, first-out queue that spills to disk, and extraction takes
+ * from the lowest non-empty bucket.  A cursor remembers the lowest
+ * bucket that may hold pages, so extraction does not rescan empty ones.
+ *
+ * Within a bucket, the in-memory ('hot') pages sit in a ring buffer.
+ * While the whole frontier holds fewer than maxInMemory pages in memory,
+ * a new page goes to the ring; otherwise it goes to disk, and the
+ * bucket's later pages follow it there for as long as any of its pages
+ * are on disk, so pages leave each bucket in the order they came.  When
+ * a ring runs dry it is refilled from its bucket's oldest segment file,
+ * a batch at a time.
+ *
+ * Segment files are numbered in order of creation within each bucket.
+ * At most one per bucket is open for writing; it is closed once it holds
+ * SEGMENT_PAGES pages, or when the reader catches up with it, so no file
+ * is ever read and written at once.  A segment is unlinked as soon as it
+ * has been read to the end.  The number of pages written to each segment
+ * is remembered, so that a segment that turns out short or unreadable is
+ * simply written off.
+ *
+ * If a segment cannot be written at all, pages stay in memory beyond
+ * maxInMemory rather than being lost; they may then leave a little out
+ * of order.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // getline, strdup
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "frontier.h"
+#include "webpage.h"
+#include "hashtable.h"
+#include "mem.h"
+
+/**************** file-local types ****************/
+typedef struct queue {
+  long key;                 // the bucket's priority level
+  webpage_t** ring;         // in-memory pages, oldest at ring[head]
+  size_t ringCap, head, count;
+  size_t* segPages;         // pages written to each segment, by number
+  size_t segCap;
+  long nextSeg;             // number of the next segment to create
+  FILE* writer;             // segment being appended to, or NULL
+  long writeSeg;            // its number
+  FILE* reader;             // segment being read back, or NULL
+  long readSeg;             // oldest segment not yet read to the end
+  size_t readPages;         // pages read so far from readSeg
+  size_t onDisk;            // pages on disk not yet read back
+} queue_t;
+
+/**************** global types ****************/
+struct frontier {
+  char* dir;                // where segment files go
+  size_t maxInMemory;       // most pages in all rings, normally
+  frontier_order_t order;
+  queue_t** buckets;        // by priority level; NULL if never used
+  size_t numBuckets;
+  size_t low;               // no bucket below this holds any page
+  size_t inMemory;          // pages in all rings
+  size_t size;              // pages in all buckets, in memory or on disk
+  hashtable_t* hosts;       // PRIORITY: host name -> pages waiting (int*)
+  char* line;               // getline buffer for the readers
+  size_t lineCap;
+  bool warned;              // have we complained about the disk?
+};
+
+/**************** file-local constants ****************/
+static const size_t SEGMENT_PAGES = 65536;   // pages per segment file
+static const size_t FIRST_RING = 64;         // initial ring capacity
+static const size_t REFILL_MIN = 64;         // least pages read per refill
+static const int HOST_SHARE = 100;   // PRIORITY: a host's pages per level
+static const long MAX_BUCKETS = 4096;        // priority levels beyond are merged
+static const int HOST_SLOTS = 499;           // hashtable slots for host names
+static const size_t MAX_HOST = 256;          // longest host name we keep apart
+
+/**************** local functions ****************/
+static int* hostCount(frontier_t* frontier, const webpage_t* page);
+static long priority(frontier_t* frontier, const webpage_t* page, const int* queued);
+static queue_t* bucket(frontier_t* frontier, const long key);
+static bool push(frontier_t* frontier, queue_t* q, webpage_t* page);
+static bool spill(frontier_t* frontier, queue_t* q, webpage_t* page);
+static void refill(frontier_t* frontier, queue_t* q);
+static void finishSegment(frontier_t* frontier, queue_t* q);
+static char* segmentName(const frontier_t* frontier, const queue_t* q,
+                         const long seg);
+static void queueDelete(frontier_t* frontier, queue_t* q,
+                        void (*itemdelete)(void* item));
+static bool copySegment(const char* name, const size_t skip, FILE* fp);
+static void removeStale(const char* dir);
+static void countDelete(void* item);
+
+/**************** frontier_new ****************/
+/* see frontier.h for description */
+frontier_t*
+frontier_new(const char* spillDirectory, const size_t maxInMemory,
+             const frontier_order_t order)
+{
+  if (spillDirectory == NULL || maxInMemory == 0
+      || (order != FRONTIER_FIFO && order != FRONTIER_BFS
+          && order != FRONTIER_PRIORITY)) {
+    return NULL;
+  }
+  frontier_t* frontier = mem_malloc(sizeof(frontier_t));
+  if (frontier == NULL) {
+    return NULL;
+  }
+  memset(frontier, 0, sizeof(frontier_t));
+  frontier->dir = strdup(spillDirectory);
+  if (order == FRONTIER_PRIORITY) {
+    frontier->hosts = hashtable_new(HOST_SLOTS);
+  }
+  if (frontier->dir == NULL || (order == FRONTIER_PRIORITY && frontier->hosts == NULL)) {
+    free(frontier->dir);
+    mem_free(frontier);
+    return NULL;
+  }
+  frontier->maxInMemory = maxInMemory;
+  frontier->order = order;
+  removeStale(spillDirectory);
+  return frontier;
+}
+
+/**************** frontier_insert ****************/
+/* see frontier.h for description */
+void
+frontier_insert(frontier_t* frontier, webpage_t* page)
+{
+  if (frontier == NULL || page == NULL) {
+    return;
+  }
+  int* queued = hostCount(frontier, page);
+  queue_t* q = bucket(frontier, priority(frontier, page, queued));
+  if (q == NULL) {
+    webpage_delete(page);
+    return;
+  }
+
+  bool kept;
+  if (q->onDisk == 0 && frontier->inMemory < frontier->maxInMemory) {
+    kept = push(frontier, q, page);
+  } else {
+    kept = spill(frontier, q, page);
+  }
+  if (!kept) {
+    // no room on disk (or no memory for a bigger ring): last resort
+    if (!frontier->warned) {
+      fprintf(stderr, "frontier: cannot spill pages to %s; keeping them in memory\n",
+              frontier->dir);
+      frontier->warned = true;
+    }
+    if (!push(frontier, q, page)) {
+      webpage_delete(page);
+      return;
+    }
+  }
+
+  frontier->size++;
+  if (queued != NULL) {
+    (*queued)++;
+  }
+  if ((size_t) q->key < frontier->low) {
+    frontier->low = q->key;
+  }
+}
+
+/**************** frontier_extract ****************/
+/* see frontier.h for description */
+webpage_t*
+frontier_extract(frontier_t* frontier)
+{
+  if (frontier == NULL) {
+    return NULL;
+  }
+  for (; frontier->low < frontier->numBuckets; frontier->low++) {
+    queue_t* q = frontier->buckets[frontier->low];
+    if (q == NULL) {
+      continue;
+    }
+    if (q->count == 0) {
+      refill(frontier, q);
+    }
+    if (q->count > 0) {
+      webpage_t* page = q->ring[q->head];
+      q->head = (q->head + 1) % q->ringCap;
+      q->count--;
+      frontier->inMemory--;
+      frontier->size--;
+      int* queued = hostCount(frontier, page);
+      if (queued != NULL && *queued > 0) {
+        (*queued)--;
+      }
+      return page;
+    }
+  }
+  return NULL;
+}
+
+/**************** frontier_size ****************/
+/* see frontier.h for description */
+size_t
+frontier_size(const frontier_t* frontier)
+{
+  return frontier ? frontier->size : 0;
+}
+
+/**************** frontier_save ****************/
+/* see frontier.h for description */
+bool
+frontier_save(frontier_t* frontier, FILE* fp)
+{
+  if (frontier == NULL || fp == NULL) {
+    return false;
+  }
+  for (size_t k = 0; k < frontier->numBuckets; k++) {
+    queue_t* q = frontier->buckets[k];
+    if (q == NULL) {
+      continue;
+    }
+    // the ring holds the bucket's oldest pages...
+    for (size_t i = 0; i < q->count; i++) {
+      webpage_t* page = q->ring[(q->head + i) % q->ringCap];
+      if (fprintf(fp, "%d %s\n", webpage_getDepth(page), webpage_getURL(page)) < 0) {
+        return false;
+      }
+    }
+    // ...and its segments the rest, less what was already read back
+    if (q->writer != NULL && fflush(q->writer) != 0) {
+      return false;
+    }
+    for (long seg = q->readSeg; seg < q->nextSeg; seg++) {
+      char* name = segmentName(frontier, q, seg);
+      bool copied = name != NULL
+        && copySegment(name, seg == q->readSeg ? q->readPages : 0, fp);
+      free(name);
+      if (!copied) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**************** frontier_delete ****************/
+/* see frontier.h for description */
+void
+frontier_delete(frontier_t* frontier, void (*itemdelete)(void* item))
+{
+  if (frontier == NULL) {
+    return;
+  }
+  for (size_t k = 0; k < frontier->numBuckets; k++) {
+    if (frontier->buckets[k] != NULL) {
+      queueDelete(frontier, frontier->buckets[k], itemdelete);
+    }
+  }
+  if (frontier->hosts != NULL) {
+    hashtable_delete(frontier->hosts, countDelete);
+  }
+  free(frontier->buckets);
+  free(frontier->line);
+  free(frontier->dir);
+  mem_free(frontier);
+}
+
+/**************** local functions ****************/
+
+/* hostCount: PRIORITY: the count of the pages from the page's host
+ * waiting in the frontier, made (0) if need be; NULL in other orders,
+ * or if out of memory.  frontier_insert counts a page in, and
+ * frontier_extract out, so pages reloaded from a checkpoint, which go
+ * into a new frontier, are counted once.
+ */
+static int*
+hostCount(frontier_t* frontier, const webpage_t* page)
+{
+  if (frontier->order != FRONTIER_PRIORITY) {
+    return NULL;
+  }
+  const char* url = webpage_getURL(page);
+  const char* start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  size_t len = strcspn(start, ":/?#");
+  char host[MAX_HOST];
+  if (len >= sizeof(host)) {
+    len = sizeof(host) - 1;
+  }
+  memcpy(host, start, len);
+  host[len] = '\0';
+
+  int* queued = hashtable_find(frontier->hosts, host);
+  if (queued == NULL && (queued = malloc(sizeof(int))) != NULL) {
+    *queued = 0;
+    if (!hashtable_insert(frontier->hosts, host, queued)) {
+      free(queued);
+      queued = NULL;
+    }
+  }
+  return queued;
+}
+
+/* priority: the bucket a page belongs in, by the frontier's order;
+ * 'queued' is hostCount's count for it, before it is counted in.
+ */
+static long
+priority(frontier_t* frontier, const webpage_t* page, const int* queued)
+{
+  long key = 0;
+  if (frontier->order == FRONTIER_BFS) {
+    key = webpage_getDepth(page);
+  } else if (frontier->order == FRONTIER_PRIORITY) {
+    // fairness: every HOST_SHARE pages waiting from one host push that
+    // host's later pages one level further back
+    key = webpage_getDepth(page) + (queued ? *queued / HOST_SHARE : 0);
+  }
+  if (key < 0) {
+    key = 0;
+  }
+  return key < MAX_BUCKETS ? key : MAX_BUCKETS - 1;
+}
+
+/* bucket: the queue for priority level key, made if need be; NULL if
+ * out of memory.
+ */
+static queue_t*
+bucket(frontier_t* frontier, const long key)
+{
+  if ((size_t) key >= frontier->numBuckets) {
+    size_t num = frontier->numBuckets ? frontier->numBuckets : 16;
+    while (num <= (size_t) key) {
+      num *= 2;
+    }
+    queue_t** buckets = realloc(frontier->buckets, num * sizeof(queue_t*));
+    if (buckets == NULL) {
+      return NULL;
+    }
+    for (size_t k = frontier->numBuckets; k < num; k++) {
+      buckets[k] = NULL;
+    }
+    frontier->buckets = buckets;
+    frontier->numBuckets = num;
+  }
+  if (frontier->buckets[key] == NULL) {
+    queue_t* q = calloc(1, sizeof(queue_t));
+    if (q == NULL) {
+      return NULL;
+    }
+    q->key = key;
+    q->writeSeg = -1;
+    frontier->buckets[key] = q;
+  }
+  return frontier->buckets[key];
+}
+
+/* push: add a page at the back of a bucket's ring, growing it if full;
+ * false if out of memory.
+ */
+static bool
+push(frontier_t* frontier, queue_t* q, webpage_t* page)
+{
+  if (q->count == q->ringCap) {
+    size_t cap = q->ringCap ? q->ringCap * 2 : FIRST_RING;
+    webpage_t** ring = malloc(cap * sizeof(webpage_t*));
+    if (ring == NULL) {
+      return false;
+    }
+    // unwrap the old ring into the front of the new one
+    for (size_t i = 0; i < q->count; i++) {
+      ring[i] = q->ring[(q->head + i) % q->ringCap];
+    }
+    free(q->ring);
+    q->ring = ring;
+    q->ringCap = cap;
+    q->head = 0;
+  }
+  q->ring[(q->head + q->count) % q->ringCap] = page;
+  q->count++;
+  frontier->inMemory++;
+  return true;
+}
+
+/* spill: append a page to the bucket's segment being written, starting
+ * a new segment if there is none; on success the page is deleted.
+ */
+static bool
+spill(frontier_t* frontier, queue_t* q, webpage_t* page)
+{
+  if (q->writer == NULL) {
+    long seg = q->nextSeg;
+    if ((size_t) seg >= q->segCap) {
+      size_t cap = q->segCap ? q->segCap * 2 : 16;
+      size_t* segPages = realloc(q->segPages, cap * sizeof(size_t));
+      if (segPages == NULL) {
+        return false;
+      }
+      q->segPages = segPages;
+      q->segCap = cap;
+    }
+    char* name = segmentName(frontier, q, seg);
+    if (name == NULL) {
+      return false;
+    }
+    q->writer = fopen(name, "w");
+    free(name);
+    if (q->writer == NULL) {
+      return false;
+    }
+    q->segPages[seg] = 0;
+    q->writeSeg = seg;
+    q->nextSeg++;
+  }
+
+  if (fprintf(q->writer, "%d %s\n", webpage_getDepth(page), webpage_getURL(page)) < 0) {
+    return false;
+  }
+  q->segPages[q->writeSeg]++;
+  q->onDisk++;
+  if (q->segPages[q->writeSeg] >= SEGMENT_PAGES) {
+    fclose(q->writer);
+    q->writer = NULL;
+  }
+  webpage_delete(page);
+  return true;
+}
+
+/* refill: read a batch of a bucket's pages back from disk into its ring;
+ * as many as fit in the memory budget, but at least REFILL_MIN.
+ */
+static void
+refill(frontier_t* frontier, queue_t* q)
+{
+  size_t want = frontier->maxInMemory > frontier->inMemory
+    ? frontier->maxInMemory - frontier->inMemory : 0;
+  if (want < REFILL_MIN) {
+    want = REFILL_MIN;
+  }
+
+  while (q->count < want && q->onDisk > 0) {
+    if (q->reader == NULL) {
+      if (q->writer != NULL && q->writeSeg == q->readSeg) {
+        // caught up with the writer; later spills start a new segment
+        fclose(q->writer);
+        q->writer = NULL;
+      }
+      char* name = segmentName(frontier, q, q->readSeg);
+      q->reader = name ? fopen(name, "r") : NULL;
+      free(name);
+      q->readPages = 0;
+      if (q->reader == NULL) {
+        finishSegment(frontier, q);
+        continue;
+      }
+    }
+
+    if (getline(&frontier->line, &frontier->lineCap, q->reader) < 0) {
+      finishSegment(frontier, q);
+      continue;
+    }
+    q->readPages++;
+    q->onDisk--;
+    frontier->size--;               // counted again if push succeeds
+
+    int depth;
+    int urlStart = 0;
+    char* line = frontier->line;
+    line[strcspn(line, "\n")] = '\0';
+    if (sscanf(line, "%d %n", &depth, &urlStart) < 1 || urlStart == 0
+        || line[urlStart] == '\0') {
+      continue;                     // damaged line; skip it
+    }
+    char* url = strdup(line + urlStart);
+    webpage_t* page = url ? webpage_new(url, depth, NULL) : NULL;
+    if (page != NULL && push(frontier, q, page)) {
+      frontier->size++;
+    } else if (page != NULL) {
+      webpage_delete(page);
+    } else {
+      free(url);
+    }
+  }
+}
+
+/* finishSegment: done with the segment a bucket is reading (fully read,
+ * or not readable at all); write off any of its pages we did not get
+ * back, and remove its file.
+ */
+static void
+finishSegment(frontier_t* frontier, queue_t* q)
+{
+  long seg = q->readSeg;
+  if (q->reader != NULL) {
+    fclose(q->reader);
+    q->reader = NULL;
+  }
+  size_t lost = q->segPages[seg] - q->readPages;
+  if (lost > q->onDisk) {
+    lost = q->onDisk;
+  }
+  q->onDisk -= lost;
+  frontier->size -= lost;
+
+  char* name = segmentName(frontier, q, seg);
+  if (name != NULL) {
+    unlink(name);
+    free(name);
+  }
+  q->readSeg++;
+  q->readPages = 0;
+}
+
+/* segmentName: the malloc'd file name of a bucket's segment number seg,
+ * or NULL if out of memory.
+ */
+static char*
+segmentName(const frontier_t* frontier, const queue_t* q, const long seg)
+{
+  size_t len = strlen(frontier->dir) + 48;
+  char* name = malloc(len);
+  if (name != NULL) {
+    snprintf(name, len, "%s/.frontier.%ld.%ld", frontier->dir, q->key, seg);
+  }
+  return name;
+}
+
+/* queueDelete: free a bucket, its pages, and its segment files */
+static void
+queueDelete(frontier_t* frontier, queue_t* q, void (*itemdelete)(void* item))
+{
+  for (size_t i = 0; i < q->count; i++) {
+    webpage_t* page = q->ring[(q->head + i) % q->ringCap];
+    if (itemdelete != NULL) {
+      (*itemdelete)(page);
+    }
+  }
+  if (q->writer != NULL) {
+    fclose(q->writer);
+  }
+  if (q->reader != NULL) {
+    fclose(q->reader);
+  }
+  for (long seg = q->readSeg; seg < q->nextSeg; seg++) {
+    char* name = segmentName(frontier, q, seg);
+    if (name != NULL) {
+      unlink(name);
+      free(name);
+    }
+  }
+  free(q->ring);
+  free(q->segPages);
+  free(q);
+}
+
+/* copySegment: copy a segment file's lines, but for the first 'skip',
+ * to fp; a segment that is gone (written off) copies as empty.
+ */
+static bool
+copySegment(const char* name, const size_t skip, FILE* fp)
+{
+  FILE* in = fopen(name, "r");
+  if (in == NULL) {
+    return true;
+  }
+  char* line = NULL;
+  size_t cap = 0;
+  bool ok = true;
+  for (size_t n = 0; ok && getline(&line, &cap, in) >= 0; n++) {
+    if (n >= skip) {
+      ok = fputs(line, fp) >= 0;
+    }
+  }
+  free(line);
+  fclose(in);
+  return ok;
+}
+
+/* removeStale: remove segment files left in dir by an earlier frontier */
+static void
+removeStale(const char* dir)
+{
+  DIR* d = opendir(dir);
+  if (d == NULL) {
+    return;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(d)) != NULL) {
+    if (strncmp(entry->d_name, ".frontier.", 10) == 0) {
+      size_t len = strlen(dir) + strlen(entry->d_name) + 2;
+      char* name = malloc(len);
+      if (name != NULL) {
+        snprintf(name, len, "%s/%s", dir, entry->d_name);
+        unlink(name);
+        free(name);
+      }
+    }
+  }
+  closedir(d);
+}
+
+/* countDelete: free a host's page count */
+static void
+countDelete(void* item)
+{
+  free(item);
+}
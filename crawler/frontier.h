@@ -0,0 +1,106 @@
+/*
+ * frontier.h - header file for the crawler's 'frontier' module
+ *
+ * A 'frontier' holds the pages the crawler has found but not yet handed
+ * to the scheduler.  Only a bounded number of them stay in memory; the
+ * rest are spilled, as one short line of text per page ("depth URL"), to
+ * append-only segment files on disk, and are read back a batch at a time
+ * as the in-memory pages run out.  A crawl of millions of URLs thus needs
+ * memory for only about 'maxInMemory' pages, and the disk is only ever
+ * written and read sequentially.
+ *
+ * The frontier hands pages out in one of three orders:
+ *   FRONTIER_FIFO      first in, first out;
+ *   FRONTIER_BFS       strictly by depth, shallowest first, and first in,
+ *                      first out within a depth;
+ *   FRONTIER_PRIORITY  by depth plus a per-host fairness term, which
+ *                      grows with the number of pages from the same host
+ *                      already waiting in the frontier; a host with many
+ *                      pages thus cannot crowd out the shallow pages of
+ *                      other hosts.
+ * The last two are kept as one queue per priority level ('buckets'), so
+ * every operation stays cheap however many pages are waiting.
+ *
+ * Pages in the frontier have no html; only their URL and depth are kept.
+ *
+ * The frontier does not lock; the crawler calls it under its own lock.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __FRONTIER_H
+#define __FRONTIER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct frontier frontier_t;  // opaque to users of the module
+
+/* the order in which pages leave the frontier */
+typedef enum {
+  FRONTIER_FIFO,
+  FRONTIER_BFS,
+  FRONTIER_PRIORITY,
+} frontier_order_t;
+
+/**************** frontier_new ****************/
+/* Create a new (empty) frontier.
+ *
+ * Caller provides:
+ *   spillDirectory, an existing writable directory for the segment files
+ *   (named .frontier.K.N); maxInMemory > 0, the most pages to keep in
+ *   memory; order, one of the frontier_order_t values above.
+ * We return:
+ *   pointer to a new frontier, or NULL if error.
+ * Caller is responsible for:
+ *   later calling frontier_delete, which removes the segment files.
+ *   Segment files an earlier frontier left in the directory (say, after a
+ *   crash) are removed first.
+ */
+frontier_t* frontier_new(const char* spillDirectory, const size_t maxInMemory,
+                         const frontier_order_t order);
+
+/**************** frontier_insert ****************/
+/* Add a page to the frontier.
+ *
+ * Caller provides:
+ *   valid frontier; a page with a URL and no html.
+ * We guarantee:
+ *   the page belongs to the frontier from now on; if it is spilled to
+ *   disk it is deleted, and frontier_extract later makes a new one with
+ *   the same URL and depth.  A NULL frontier or page is ignored.
+ *   If the disk cannot be written, the page stays in memory instead
+ *   (and a warning is printed once).
+ */
+void frontier_insert(frontier_t* frontier, webpage_t* page);
+
+/**************** frontier_extract ****************/
+/* Remove and return the next page in the frontier's order, or NULL if
+ * the frontier is empty.  The caller is responsible for the page.
+ */
+webpage_t* frontier_extract(frontier_t* frontier);
+
+/**************** frontier_size ****************/
+/* Return the number of pages in the frontier, in memory or on disk. */
+size_t frontier_size(const frontier_t* frontier);
+
+/**************** frontier_save ****************/
+/* Write every page in the frontier, in the order they would leave it,
+ * to an open file, one "depth URL" line per page.  The frontier itself
+ * is not changed.
+ *
+ * We return:
+ *   true if all was written; false on any error.
+ */
+bool frontier_save(frontier_t* frontier, FILE* fp);
+
+/**************** frontier_delete ****************/
+/* Delete the frontier, calling itemdelete (if not NULL) on each page
+ * still in memory; pages still on disk are dropped with their files.
+ */
+void frontier_delete(frontier_t* frontier, void (*itemdelete)(void* item));
+
+#endif // __FRONTIER_H
@@ -0,0 +1,22 @@
+/*
+ * monotonic.c - seconds on the monotonic clock
+ *
+ * see monotonic.h for more information.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // clock_gettime
+
+#include <time.h>
+#include "monotonic.h"
+
+/**************** monotonic_now ****************/
+/* see monotonic.h for description */
+double
+monotonic_now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,20 @@
+/*
+ * monotonic.h - header file for the crawler's 'monotonic' module
+ *
+ * The one clock the crawler's modules time things by: seconds on the
+ * monotonic clock, which never jumps when the wall clock is set, so
+ * deadlines, delays and durations stay right.  Only differences between
+ * two readings mean anything.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __MONOTONIC_H
+#define __MONOTONIC_H
+
+/**************** monotonic_now ****************/
+/* Return the time on the monotonic clock, in seconds.
+ */
+double monotonic_now(void);
+
+#endif // __MONOTONIC_H
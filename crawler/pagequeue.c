@@ -0,0 +1,140 @@
+/*
+ * pagequeue.c - a bounded queue of pages between threads
+ *
+ * see pagequeue.h for more information.
+ *
+ * The pages sit in a ring of 'capacity' entries; one mutex guards it,
+ * with one condition for producers waiting for room and one for the
+ * consumer waiting for a page.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "pagequeue.h"
+#include "webpage.h"
+
+/**************** file-local types ****************/
+typedef struct entry {
+  webpage_t* page;
+  int docID;
+} entry_t;
+
+/**************** global types ****************/
+struct pagequeue {
+  entry_t* ring;
+  int capacity;
+  int head;                 // index of the oldest page
+  int count;                // pages in the ring
+  bool closed;
+  pthread_mutex_t lock;
+  pthread_cond_t notFull;
+  pthread_cond_t notEmpty;
+};
+
+/**************** pagequeue_new ****************/
+/* see pagequeue.h for description */
+pagequeue_t*
+pagequeue_new(const int capacity)
+{
+  if (capacity < 1) {
+    return NULL;
+  }
+  pagequeue_t* queue = malloc(sizeof(pagequeue_t));
+  if (queue == NULL) {
+    return NULL;
+  }
+  queue->ring = malloc(capacity * sizeof(entry_t));
+  if (queue->ring == NULL) {
+    free(queue);
+    return NULL;
+  }
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->count = 0;
+  queue->closed = false;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->notFull, NULL);
+  pthread_cond_init(&queue->notEmpty, NULL);
+  return queue;
+}
+
+/**************** pagequeue_put ****************/
+/* see pagequeue.h for description */
+bool
+pagequeue_put(pagequeue_t* queue, webpage_t* page, const int docID)
+{
+  if (queue == NULL || page == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == queue->capacity && !queue->closed) {
+    pthread_cond_wait(&queue->notFull, &queue->lock);
+  }
+  bool put = !queue->closed;
+  if (put) {
+    int tail = (queue->head + queue->count) % queue->capacity;
+    queue->ring[tail].page = page;
+    queue->ring[tail].docID = docID;
+    queue->count++;
+    pthread_cond_signal(&queue->notEmpty);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return put;
+}
+
+/**************** pagequeue_take ****************/
+/* see pagequeue.h for description */
+webpage_t*
+pagequeue_take(pagequeue_t* queue, int* docID)
+{
+  if (queue == NULL || docID == NULL) {
+    return NULL;
+  }
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->closed) {
+    pthread_cond_wait(&queue->notEmpty, &queue->lock);
+  }
+  webpage_t* page = NULL;
+  if (queue->count > 0) {
+    page = queue->ring[queue->head].page;
+    *docID = queue->ring[queue->head].docID;
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->notFull);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return page;
+}
+
+/**************** pagequeue_close ****************/
+/* see pagequeue.h for description */
+void
+pagequeue_close(pagequeue_t* queue)
+{
+  if (queue != NULL) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->notFull);
+    pthread_cond_broadcast(&queue->notEmpty);
+    pthread_mutex_unlock(&queue->lock);
+  }
+}
+
+/**************** pagequeue_delete ****************/
+/* see pagequeue.h for description */
+void
+pagequeue_delete(pagequeue_t* queue)
+{
+  if (queue != NULL) {
+    for (int i = 0; i < queue->count; i++) {
+      webpage_delete(queue->ring[(queue->head + i) % queue->capacity].page);
+    }
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->notFull);
+    pthread_cond_destroy(&queue->notEmpty);
+    free(queue->ring);
+    free(queue);
+  }
+}
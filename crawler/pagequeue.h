@@ -0,0 +1,70 @@
+/*
+ * pagequeue.h - header file for the crawler's 'pagequeue' module
+ *
+ * A 'pagequeue' carries saved pages, with their docIDs, from the threads
+ * that fetch them to the one thread that indexes them, in the order they
+ * were put.  It holds at most a fixed number of pages: a producer that
+ * finds it full waits until the consumer has taken one, so the fetchers
+ * never run more than that far ahead of the index and memory stays
+ * bounded however large the crawl.
+ *
+ * Unlike the crawler's other modules the queue locks for itself, since
+ * its whole purpose is to be shared between threads.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __PAGEQUEUE_H
+#define __PAGEQUEUE_H
+
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct pagequeue pagequeue_t;  // opaque to users of the module
+
+/**************** pagequeue_new ****************/
+/* Create a new (empty) queue.
+ *
+ * Caller provides:
+ *   capacity > 0, the most pages the queue holds at once.
+ * We return:
+ *   pointer to a new queue, or NULL if error.
+ * Caller is responsible for:
+ *   later calling pagequeue_delete.
+ */
+pagequeue_t* pagequeue_new(const int capacity);
+
+/**************** pagequeue_put ****************/
+/* Add a page to the end of the queue, waiting while it is full.
+ *
+ * Caller provides:
+ *   valid queue; a page with its HTML; the docID it was saved under.
+ * We return:
+ *   true if the queue now owns the page; false if the queue was closed
+ *   or the arguments are bad, in which case the caller still owns it.
+ */
+bool pagequeue_put(pagequeue_t* queue, webpage_t* page, const int docID);
+
+/**************** pagequeue_take ****************/
+/* Remove the page at the front of the queue, waiting while it is empty.
+ *
+ * We return:
+ *   the page, with its docID in *docID; or NULL once the queue is closed
+ *   and every page put before has been taken.
+ * Caller is responsible for:
+ *   later calling webpage_delete on the page.
+ */
+webpage_t* pagequeue_take(pagequeue_t* queue, int* docID);
+
+/**************** pagequeue_close ****************/
+/* Close the queue: no more pages may be put, and pagequeue_take returns
+ * NULL as soon as the queue runs empty.
+ */
+void pagequeue_close(pagequeue_t* queue);
+
+/**************** pagequeue_delete ****************/
+/* Delete the queue and any pages still in it.  A NULL queue is ignored. */
+void pagequeue_delete(pagequeue_t* queue);
+
+#endif // __PAGEQUEUE_H
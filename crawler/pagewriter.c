@@ -0,0 +1,389 @@
+/*
+ * pagewriter.c - save pages to disk on a thread of their own
+ *
+ * see pagewriter.h for more information.
+ *
+ * Jobs -- a page to save, or an alias to record -- sit in a ring of
+ * 'capacity' entries under one mutex, as in the pagequeue.  The writer
+ * thread takes every job waiting at once, and writes them with the lock
+ * free, so the fetchers can fill the ring again meanwhile.
+ *
+ * Pages are written through the pagedir module, into the pageDirectory's
+ * docstore; a sync has pagedir sync that, then reopens the aliases, the
+ * validators and the manifest's log to fsync them (which makes a file's data durable
+ * whichever descriptor asks), then syncs the directory.
+ *
+ * Counters of jobs put, written and synced let pagewriter_sync wait for
+ * exactly the jobs put before it was called.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fsync, pthread_condattr_setclock
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "pagewriter.h"
+#include "pagequeue.h"
+#include "webpage.h"
+#include "crawlstats.h"
+#include "pagedir.h"
+#include "manifest.h"
+#include "monotonic.h"
+
+/**************** file-local types ****************/
+typedef struct job {
+  webpage_t* page;          // the page to save, or NULL for an alias
+  char* url;                // the alias's URL, or NULL for a page
+  int docID;
+  bool validators;          // record the page's validators too
+  uint64_t hash;            // fingerprint of the page's HTML, for the manifest
+} job_t;
+
+/**************** global types ****************/
+struct pagewriter {
+  char* pageDirectory;
+  pagequeue_t* next;        // where written pages go on to, or NULL
+  crawlstats_t* stats;      // where write times go, or NULL
+  job_t* ring;
+  job_t* batch;             // the writer thread's: jobs taken from the ring
+  int capacity;
+  int head;                 // index of the oldest job
+  int count;                // jobs in the ring
+  long put;                 // jobs put so far
+  long written;             // jobs written so far
+  long synced;              // jobs written and synced so far
+  long syncTarget;          // jobs some caller wants synced
+  bool failed;              // some write has failed
+  bool closed;
+  int unsynced;             // the writer thread's: pages written since the last sync
+  bool aliasesDirty;        // the writer thread's: aliases written since the last sync
+  bool validatorsDirty;     // likewise, validators
+  bool manifestDirty;       // likewise, manifest entries
+  double lastSync;          // the writer thread's: when it last synced
+  pthread_t thread;
+  pthread_mutex_t lock;     // guards the ring, the counters, failed and closed
+  pthread_cond_t notFull;
+  pthread_cond_t notEmpty;  // a job was put, a sync wanted, or the writer closed
+  pthread_cond_t progress;  // jobs were synced
+};
+
+/**************** file-local constants ****************/
+static const double SYNC_INTERVAL = 2.0;  // most seconds a written page waits for a sync
+static const int SYNC_PAGES = 512;        // most pages written between syncs
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool put(pagewriter_t* writer, job_t* job);
+static void* writerThread(void* arg);
+static bool writeJob(pagewriter_t* writer, job_t* job);
+static bool syncFiles(pagewriter_t* writer);
+static bool syncFile(const char* pageDirectory, const char* name);
+
+/**************** pagewriter_new ****************/
+/* see pagewriter.h for description */
+pagewriter_t*
+pagewriter_new(const char* pageDirectory, const int capacity, pagequeue_t* next,
+               crawlstats_t* stats)
+{
+  if (pageDirectory == NULL || capacity < 1) {
+    return NULL;
+  }
+  pagewriter_t* writer = calloc(1, sizeof(pagewriter_t));
+  if (writer == NULL) {
+    return NULL;
+  }
+  writer->pageDirectory = malloc(strlen(pageDirectory) + 1);
+  writer->ring = malloc(capacity * sizeof(job_t));
+  writer->batch = malloc(capacity * sizeof(job_t));
+  if (writer->pageDirectory == NULL || writer->ring == NULL || writer->batch == NULL) {
+    free(writer->pageDirectory);
+    free(writer->ring);
+    free(writer->batch);
+    free(writer);
+    return NULL;
+  }
+  strcpy(writer->pageDirectory, pageDirectory);
+  writer->next = next;
+  writer->stats = stats;
+  writer->capacity = capacity;
+  writer->lastSync = monotonic_now();
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->notFull, NULL);
+  pthread_cond_init(&writer->progress, NULL);
+  // the writer's timed waits run on the monotonic clock
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&writer->notEmpty, &attr);
+  pthread_condattr_destroy(&attr);
+  if (pthread_create(&writer->thread, NULL, writerThread, writer) != 0) {
+    writer->closed = true;
+    pagewriter_close(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+/**************** pagewriter_save ****************/
+/* see pagewriter.h for description */
+bool
+pagewriter_save(pagewriter_t* writer, webpage_t* page, const int docID,
+                const bool validators, const uint64_t hash)
+{
+  if (writer == NULL || page == NULL || webpage_getHTML(page) == NULL || docID < 1) {
+    return false;
+  }
+  job_t job = { .page = page, .url = NULL, .docID = docID, .validators = validators,
+                .hash = hash };
+  return put(writer, &job);
+}
+
+/**************** pagewriter_alias ****************/
+/* see pagewriter.h for description */
+bool
+pagewriter_alias(pagewriter_t* writer, const int docID, const char* url)
+{
+  if (writer == NULL || url == NULL || docID < 1) {
+    return false;
+  }
+  job_t job = { .page = NULL, .url = malloc(strlen(url) + 1), .docID = docID };
+  if (job.url == NULL) {
+    return false;
+  }
+  strcpy(job.url, url);
+  if (!put(writer, &job)) {
+    free(job.url);
+    return false;
+  }
+  return true;
+}
+
+/**************** pagewriter_sync ****************/
+/* see pagewriter.h for description */
+bool
+pagewriter_sync(pagewriter_t* writer)
+{
+  if (writer == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&writer->lock);
+  long target = writer->put;
+  if (writer->syncTarget < target) {
+    writer->syncTarget = target;
+    pthread_cond_signal(&writer->notEmpty);
+  }
+  while (writer->synced < target) {
+    pthread_cond_wait(&writer->progress, &writer->lock);
+  }
+  bool ok = !writer->failed;
+  pthread_mutex_unlock(&writer->lock);
+  return ok;
+}
+
+/**************** pagewriter_close ****************/
+/* see pagewriter.h for description */
+bool
+pagewriter_close(pagewriter_t* writer)
+{
+  if (writer == NULL) {
+    return true;
+  }
+  pthread_mutex_lock(&writer->lock);
+  bool started = !writer->closed;
+  writer->closed = true;
+  pthread_cond_signal(&writer->notEmpty);
+  pthread_mutex_unlock(&writer->lock);
+  if (started) {
+    // it writes and syncs everything left before it returns
+    pthread_join(writer->thread, NULL);
+  }
+  bool ok = !writer->failed;
+  pthread_mutex_destroy(&writer->lock);
+  pthread_cond_destroy(&writer->notFull);
+  pthread_cond_destroy(&writer->notEmpty);
+  pthread_cond_destroy(&writer->progress);
+  free(writer->pageDirectory);
+  free(writer->ring);
+  free(writer->batch);
+  free(writer);
+  return ok;
+}
+
+/**************** put ****************/
+/* add a job to the end of the ring, waiting while it is full; false if
+ * the writer is closed */
+static bool
+put(pagewriter_t* writer, job_t* job)
+{
+  pthread_mutex_lock(&writer->lock);
+  while (writer->count == writer->capacity && !writer->closed) {
+    pthread_cond_wait(&writer->notFull, &writer->lock);
+  }
+  bool ok = !writer->closed;
+  if (ok) {
+    writer->ring[(writer->head + writer->count) % writer->capacity] = *job;
+    writer->count++;
+    writer->put++;
+    pthread_cond_signal(&writer->notEmpty);
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return ok;
+}
+
+/**************** writerThread ****************/
+/* the writer thread: take every job waiting, write them, and sync when
+ * a sync is due or wanted; once closed, finish the ring, sync, and end */
+static void*
+writerThread(void* arg)
+{
+  pagewriter_t* writer = arg;
+  pthread_mutex_lock(&writer->lock);
+  for (;;) {
+    // wait for a job or a sync, or until written files are due a sync
+    while (writer->count == 0 && !writer->closed && writer->syncTarget <= writer->synced) {
+      if (writer->unsynced == 0 && !writer->aliasesDirty && !writer->validatorsDirty
+          && !writer->manifestDirty) {
+        pthread_cond_wait(&writer->notEmpty, &writer->lock);
+        continue;
+      }
+      double due = writer->lastSync + SYNC_INTERVAL;
+      if (monotonic_now() >= due) {
+        break;
+      }
+      struct timespec until = { (time_t) due, (long) ((due - (time_t) due) * 1e9) };
+      pthread_cond_timedwait(&writer->notEmpty, &writer->lock, &until);
+    }
+    int n = writer->count;
+    for (int i = 0; i < n; i++) {
+      writer->batch[i] = writer->ring[(writer->head + i) % writer->capacity];
+    }
+    writer->head = (writer->head + n) % writer->capacity;
+    writer->count = 0;
+    pthread_cond_broadcast(&writer->notFull);
+    pthread_mutex_unlock(&writer->lock);
+
+    bool ok = true;
+    for (int i = 0; i < n; i++) {
+      ok = writeJob(writer, &writer->batch[i]) && ok;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->written += n;
+    writer->failed = writer->failed || !ok;
+    bool last = writer->closed && writer->count == 0;
+    if (last || writer->syncTarget > writer->synced
+        || writer->unsynced >= SYNC_PAGES || monotonic_now() >= writer->lastSync + SYNC_INTERVAL) {
+      long written = writer->written;
+      pthread_mutex_unlock(&writer->lock);
+      ok = syncFiles(writer);
+      pthread_mutex_lock(&writer->lock);
+      writer->failed = writer->failed || !ok;
+      writer->synced = written;
+      pthread_cond_broadcast(&writer->progress);
+    }
+    if (last) {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&writer->lock);
+  return NULL;
+}
+
+/**************** writeJob ****************/
+/* write one job, then pass its page on or delete it; false on error,
+ * which is reported */
+static bool
+writeJob(pagewriter_t* writer, job_t* job)
+{
+  bool ok;
+  if (job->page == NULL) {
+    ok = pageDirSaveAlias(writer->pageDirectory, job->docID, job->url);
+    writer->aliasesDirty = true;
+    if (!ok) {
+      crawlstats_error(writer->stats, CRAWLSTATS_UNSAVED);
+      fprintf(stderr, "Warning: unable to record %s as an alias in %s\n",
+              job->url, writer->pageDirectory);
+    }
+    free(job->url);
+    return ok;
+  }
+
+  webpage_t* page = job->page;
+  double start = monotonic_now();
+  ok = pageDirSave(page, writer->pageDirectory, job->docID);
+  if (ok && job->validators) {
+    ok = pageDirSaveValidators(writer->pageDirectory, job->docID, webpage_getETag(page),
+                               webpage_getLastModified(page));
+    writer->validatorsDirty = true;
+  }
+  if (ok) {
+    // without its entry, manifestWrite reads the page back instead
+    manifestRecord(writer->pageDirectory, job->docID, webpage_getURL(page),
+                   webpage_getDepth(page), strlen(webpage_getHTML(page)), job->hash);
+    writer->manifestDirty = true;
+  }
+  crawlstats_time(writer->stats, CRAWLSTATS_SAVE, monotonic_now() - start);
+  if (!ok) {
+    crawlstats_error(writer->stats, CRAWLSTATS_UNSAVED);
+    fprintf(stderr, "Warning: unable to save document %d in %s\n",
+            job->docID, writer->pageDirectory);
+  }
+  writer->unsynced++;
+  if (writer->next == NULL || !pagequeue_put(writer->next, page, job->docID)) {
+    webpage_delete(page);
+  }
+  return ok;
+}
+
+/**************** syncFiles ****************/
+/* make everything written since the last sync durable; false on error */
+static bool
+syncFiles(pagewriter_t* writer)
+{
+  bool ok = true;
+  if (writer->unsynced > 0) {
+    ok = pageDirSync(writer->pageDirectory);
+  }
+  if (writer->aliasesDirty) {
+    ok = syncFile(writer->pageDirectory, ".aliases") && ok;
+  }
+  if (writer->validatorsDirty) {
+    ok = syncFile(writer->pageDirectory, ".validators") && ok;
+  }
+  if (writer->manifestDirty) {
+    ok = syncFile(writer->pageDirectory, ".manifest.log") && ok;
+  }
+  // the directory holds the new files' names
+  if (writer->unsynced > 0 || writer->aliasesDirty || writer->validatorsDirty
+      || writer->manifestDirty) {
+    ok = syncFile(writer->pageDirectory, ".") && ok;
+  }
+  writer->unsynced = 0;
+  writer->aliasesDirty = writer->validatorsDirty = writer->manifestDirty = false;
+  writer->lastSync = monotonic_now();
+  if (!ok) {
+    fprintf(stderr, "Warning: unable to sync the pages written to %s\n", writer->pageDirectory);
+  }
+  return ok;
+}
+
+/**************** syncFile ****************/
+/* fsync pageDirectory/name; false on error */
+static bool
+syncFile(const char* pageDirectory, const char* name)
+{
+  char path[strlen(pageDirectory) + strlen(name) + 2];
+  sprintf(path, "%s/%s", pageDirectory, name);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  return (close(fd) == 0) && ok;
+}
@@ -0,0 +1,89 @@
+/*
+ * pagewriter.h - header file for the crawler's 'pagewriter' module
+ *
+ * A 'pagewriter' saves pages to the pageDirectory behind the crawl's
+ * back.  The threads that fetch pages put each one to save, with its
+ * docID, in a bounded queue, and go straight on with the next fetch; one
+ * writer thread takes them off in batches and writes them to the
+ * docstore, with any alias, validators and manifest entry that go with
+ * them.  So a fetcher waits on the
+ * disk only when the writer is a whole queue behind.
+ *
+ * What is written is made durable (fsync'd) every few seconds, or every
+ * few hundred pages, whichever comes first, and on pagewriter_sync, which
+ * a checkpoint calls so that it never counts a page not yet on disk.
+ *
+ * A written page may go on to a pagequeue -- the index thread's -- so
+ * that the page, already in memory, need not be read back to be indexed.
+ * The time each page took to write, and any failure, go to a crawlstats.
+ *
+ * Like the pagequeue, a pagewriter locks for itself.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __PAGEWRITER_H
+#define __PAGEWRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "webpage.h"
+#include "pagequeue.h"
+#include "crawlstats.h"
+
+/**************** global types ****************/
+typedef struct pagewriter pagewriter_t;  // opaque to users of the module
+
+/**************** pagewriter_new ****************/
+/* Create a writer, and start its thread.
+ *
+ * Caller provides:
+ *   the pageDirectory to save into; capacity > 0, the most pages waiting
+ *   to be written at once; next, a queue each page goes on to once it is
+ *   written (or NULL, to delete it then); stats, to record into (or NULL).
+ * We return:
+ *   pointer to a new writer, or NULL if error.
+ * Caller is responsible for:
+ *   later calling pagewriter_close, before closing 'next'.
+ */
+pagewriter_t* pagewriter_new(const char* pageDirectory, const int capacity,
+                             pagequeue_t* next, crawlstats_t* stats);
+
+/**************** pagewriter_save ****************/
+/* Save a page as document docID, waiting while the queue is full.
+ *
+ * Caller provides:
+ *   valid writer; a page with its HTML; its docID; validators, true to
+ *   record the page's ETag and Last-Modified too (clearing them if it
+ *   has none); hash, the fingerprint of its HTML, for its manifest entry
+ *   (see common/manifest.h).
+ * We return:
+ *   true if the writer now owns the page; false if the arguments are bad,
+ *   or the writer is closed, in which case the caller still owns it.
+ */
+bool pagewriter_save(pagewriter_t* writer, webpage_t* page, const int docID,
+                     const bool validators, const uint64_t hash);
+
+/**************** pagewriter_alias ****************/
+/* Record url as an alias of document docID (see pageDirSaveAlias),
+ * waiting while the queue is full.  The url is copied.  False on bad
+ * arguments, or if out of memory.
+ */
+bool pagewriter_alias(pagewriter_t* writer, const int docID, const char* url);
+
+/**************** pagewriter_sync ****************/
+/* Wait until everything put so far is written and on disk.
+ *
+ * We return:
+ *   true if every write so far succeeded; false if any failed (each one
+ *   is also reported on stderr as it happens).
+ */
+bool pagewriter_sync(pagewriter_t* writer);
+
+/**************** pagewriter_close ****************/
+/* Write out and sync whatever is left, stop the thread, and free the
+ * writer.  NULL is ignored.  Returns as pagewriter_sync does.
+ */
+bool pagewriter_close(pagewriter_t* writer);
+
+#endif // __PAGEWRITER_H
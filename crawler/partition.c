@@ -0,0 +1,384 @@
+/*
+ * partition.c - split a crawl among processes by host
+ *
+ * see partition.h for more information.
+ *
+ * The coordinator keeps, for each partition, the number of URLs it has
+ * sent it and whether it last said it was idle having taken all of them.
+ * A partition writes the URLs it passes on before it says it is idle,
+ * on the same socket, so by the time the coordinator reads "I", it has
+ * routed every URL that partition found, and marked their owners busy.
+ * So once every partition is idle, with its count matching, no URL is
+ * left anywhere, and the crawl is over.
+ *
+ * The coordinator reads its sockets raw, through poll, and writes them
+ * through stdio, flushing after each round of reads.  A partition's
+ * receiving thread does nothing but take URLs in, so a partition always
+ * drains what the coordinator writes to it, and the coordinator never
+ * blocks for long on a write.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // fdopen, getline
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "partition.h"
+#include "fingerprint.h"
+
+/**************** global types ****************/
+struct partition {
+  int index;                // this partition's number
+  int count;                // number of partitions
+  FILE* in;                 // from the coordinator; only the receiver reads it
+  FILE* out;                // to the coordinator
+  char* line;               // the line last received
+  size_t lineSize;          // bytes allocated for it
+  pthread_mutex_t lock;     // guards out
+};
+
+/**************** file-local types ****************/
+/* the coordinator's view of one partition */
+typedef struct member {
+  pid_t pid;                // its process, or 0 if not started
+  int fd;                   // our end of its socket, or -1
+  FILE* out;                // writes to it, through fd
+  char* buf;                // bytes read from it, not yet a whole line
+  size_t len, size;         // bytes in buf, and allocated
+  long delivered;           // URLs sent to it
+  bool idle;                // idle, having taken every URL sent to it
+} member_t;
+
+/**************** file-local constants ****************/
+static const size_t READ_BLOCK = 16384;  // bytes read from a partition at once
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static size_t hostLength(const char* url, const char** host);
+static bool startMembers(member_t* members, const int count, void* arg,
+                         void (*crawlfunc)(void* arg, partition_t* partition));
+static bool readMember(member_t* members, const int count, const int i);
+static void route(member_t* members, const int count, const int i, char* line);
+static void deliver(member_t* member, const int depth, const char* url);
+
+/**************** partition_coordinate ****************/
+/* see partition.h for description */
+bool
+partition_coordinate(const int count, const char* seedURL, void* arg,
+                     void (*crawlfunc)(void* arg, partition_t* partition))
+{
+  if (count < 1 || seedURL == NULL || crawlfunc == NULL) {
+    return false;
+  }
+  member_t* members = calloc(count, sizeof(member_t));
+  struct pollfd* fds = calloc(count, sizeof(struct pollfd));
+  if (members == NULL || fds == NULL) {
+    free(members);
+    free(fds);
+    return false;
+  }
+  // a partition that fails must not take the coordinator with it
+  signal(SIGPIPE, SIG_IGN);
+  bool ok = startMembers(members, count, arg, crawlfunc);
+
+  // the seed starts the crawl; then route until every partition is idle
+  if (ok) {
+    deliver(&members[partition_owner(seedURL, count)], 0, seedURL);
+  }
+  bool over = !ok;
+  while (!over) {
+    for (int i = 0; i < count; i++) {
+      fflush(members[i].out);
+      fds[i].fd = members[i].fd;
+      fds[i].events = POLLIN;
+    }
+    if (poll(fds, count, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ok = false;
+      break;
+    }
+    for (int i = 0; ok && i < count; i++) {
+      if (fds[i].revents != 0) {
+        // a partition that goes away before the end has failed
+        ok = readMember(members, count, i);
+      }
+    }
+    if (!ok) {
+      break;
+    }
+    over = true;
+    for (int i = 0; i < count; i++) {
+      over = over && members[i].idle;
+    }
+  }
+
+  // tell them all it is over (a partition that failed is told too, and
+  // ends early), and wait for them
+  for (int i = 0; i < count; i++) {
+    if (members[i].out != NULL) {
+      fputs("Q\n", members[i].out);
+      fclose(members[i].out);
+    } else if (members[i].fd >= 0) {
+      close(members[i].fd);
+    }
+    if (members[i].pid > 0) {
+      int status;
+      if (waitpid(members[i].pid, &status, 0) < 0
+          || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        ok = false;
+      }
+    }
+    free(members[i].buf);
+  }
+  free(members);
+  free(fds);
+  return ok;
+}
+
+/**************** partition_owner ****************/
+/* see partition.h for description */
+int
+partition_owner(const char* url, const int count)
+{
+  if (url == NULL || count <= 1) {
+    return 0;
+  }
+  const char* host;
+  size_t len = hostLength(url, &host);
+  return (int) (fingerprint(host, len) % (uint64_t) count);
+}
+
+/**************** partition_index ****************/
+/* see partition.h for description */
+int
+partition_index(const partition_t* partition)
+{
+  return partition ? partition->index : 0;
+}
+
+/**************** partition_owns ****************/
+/* see partition.h for description */
+bool
+partition_owns(const partition_t* partition, const char* url)
+{
+  return partition == NULL || partition_owner(url, partition->count) == partition->index;
+}
+
+/**************** partition_forward ****************/
+/* see partition.h for description */
+bool
+partition_forward(partition_t* partition, const int depth, const char* url)
+{
+  if (partition == NULL || url == NULL || strchr(url, '\n') != NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&partition->lock);
+  bool ok = fprintf(partition->out, "U %d %s\n", depth, url) > 0;
+  pthread_mutex_unlock(&partition->lock);
+  return ok;
+}
+
+/**************** partition_flush ****************/
+/* see partition.h for description */
+bool
+partition_flush(partition_t* partition)
+{
+  if (partition == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&partition->lock);
+  bool ok = fflush(partition->out) == 0;
+  pthread_mutex_unlock(&partition->lock);
+  return ok;
+}
+
+/**************** partition_idle ****************/
+/* see partition.h for description */
+bool
+partition_idle(partition_t* partition, const long received)
+{
+  if (partition == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&partition->lock);
+  bool ok = fprintf(partition->out, "I %ld\n", received) > 0
+            && fflush(partition->out) == 0;
+  pthread_mutex_unlock(&partition->lock);
+  return ok;
+}
+
+/**************** partition_receive ****************/
+/* see partition.h for description */
+char*
+partition_receive(partition_t* partition, int* depth)
+{
+  if (partition == NULL || depth == NULL) {
+    return NULL;
+  }
+  ssize_t len;
+  while ((len = getline(&partition->line, &partition->lineSize, partition->in)) > 0) {
+    char* line = partition->line;
+    if (line[len - 1] == '\n') {
+      line[--len] = '\0';
+    }
+    if (line[0] == 'Q') {
+      break;
+    }
+    // "U <depth> <URL>"
+    char* url;
+    long d = (line[0] == 'U' && line[1] == ' ') ? strtol(line + 2, &url, 10) : -1;
+    if (d >= 0 && url != line + 2 && *url == ' ' && url[1] != '\0') {
+      char* copy = malloc(strlen(url + 1) + 1);
+      if (copy != NULL) {
+        strcpy(copy, url + 1);
+        *depth = (int) d;
+        return copy;
+      }
+    }
+  }
+  return NULL;
+}
+
+/**************** hostLength ****************/
+/* the host[:port] of a URL: *host points to it, and we return its length;
+ * the same way the scheduler tells hosts apart */
+static size_t
+hostLength(const char* url, const char** host)
+{
+  const char* start = strstr(url, "://");
+  *host = start ? start + 3 : url;
+  return strcspn(*host, "/?#");
+}
+
+/**************** startMembers ****************/
+/* fork the partitions, each with a socket back to us; false if any
+ * could not be started, in which case those that were will see the
+ * coordinator go away, and end */
+static bool
+startMembers(member_t* members, const int count, void* arg,
+             void (*crawlfunc)(void* arg, partition_t* partition))
+{
+  // a child must not repeat output the coordinator has buffered
+  fflush(NULL);
+  for (int i = 0; i < count; i++) {
+    members[i].fd = -1;
+  }
+  for (int i = 0; i < count; i++) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+      return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(sv[0]);
+      close(sv[1]);
+      return false;
+    }
+    if (pid == 0) {
+      // the child: keep only its own socket
+      close(sv[0]);
+      for (int j = 0; j < i; j++) {
+        close(members[j].fd);
+      }
+      partition_t partition = { .index = i, .count = count,
+                                .line = NULL, .lineSize = 0 };
+      partition.in = fdopen(sv[1], "r");
+      partition.out = fdopen(dup(sv[1]), "w");
+      if (partition.in == NULL || partition.out == NULL) {
+        exit(1);
+      }
+      pthread_mutex_init(&partition.lock, NULL);
+      (*crawlfunc)(arg, &partition);
+      bool flushed = fflush(partition.out) == 0;
+      fclose(partition.in);
+      fclose(partition.out);
+      free(partition.line);
+      pthread_mutex_destroy(&partition.lock);
+      exit(flushed ? 0 : 1);
+    }
+    close(sv[1]);
+    members[i].pid = pid;
+    members[i].fd = sv[0];
+  }
+  for (int i = 0; i < count; i++) {
+    if ((members[i].out = fdopen(members[i].fd, "w")) == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************** readMember ****************/
+/* read what partition i has sent, and act on each whole line; false if
+ * it has gone away, or we are out of memory */
+static bool
+readMember(member_t* members, const int count, const int i)
+{
+  member_t* member = &members[i];
+  if (member->size - member->len < READ_BLOCK) {
+    size_t size = member->size + READ_BLOCK;
+    char* buf = realloc(member->buf, size);
+    if (buf == NULL) {
+      return false;
+    }
+    member->buf = buf;
+    member->size = size;
+  }
+  ssize_t got = read(member->fd, member->buf + member->len, member->size - member->len);
+  if (got <= 0) {
+    return got < 0 && errno == EINTR;
+  }
+  member->len += got;
+
+  char* line = member->buf;
+  char* newline;
+  while ((newline = memchr(line, '\n', member->buf + member->len - line)) != NULL) {
+    *newline = '\0';
+    route(members, count, i, line);
+    line = newline + 1;
+  }
+  member->len -= line - member->buf;
+  memmove(member->buf, line, member->len);
+  return true;
+}
+
+/**************** route ****************/
+/* act on one line from partition i: pass a URL on to its owner, or note
+ * that i is idle */
+static void
+route(member_t* members, const int count, const int i, char* line)
+{
+  char* rest;
+  long n = (line[1] == ' ') ? strtol(line + 2, &rest, 10) : -1;
+  if (n < 0 || rest == line + 2) {
+    return;
+  }
+  if (line[0] == 'U' && *rest == ' ' && rest[1] != '\0') {
+    deliver(&members[partition_owner(rest + 1, count)], (int) n, rest + 1);
+  } else if (line[0] == 'I' && *rest == '\0') {
+    members[i].idle = (n == members[i].delivered);
+  }
+}
+
+/**************** deliver ****************/
+/* send a URL to the partition that owns it, which is then busy until it
+ * says otherwise */
+static void
+deliver(member_t* member, const int depth, const char* url)
+{
+  fprintf(member->out, "U %d %s\n", depth, url);
+  member->delivered++;
+  member->idle = false;
+}
@@ -0,0 +1,110 @@
+/*
+ * partition.h - header file for the crawler's 'partition' module
+ *
+ * A crawl may be split among several processes, its 'partitions'.  Each
+ * host belongs to exactly one of them, picked by a hash of its name, so
+ * every partition fetches, and spaces out its fetches to, its own hosts
+ * only.  A partition that finds a URL on a host it does not own passes
+ * it on; a coordinator routes it to the owner.
+ *
+ * The coordinator starts the partitions, each as a child process with a
+ * stream socket back to the coordinator, and ends the crawl once every
+ * partition has run out of work with no URL still on its way to any of
+ * them.  Everything between them goes over those sockets, in lines:
+ *
+ *   partition to coordinator:
+ *     U <depth> <URL>     a URL found, for the partition that owns its host
+ *     I <received>        nothing left to fetch, having taken <received> URLs
+ *   coordinator to partition:
+ *     U <depth> <URL>     a URL this partition owns
+ *     Q                   the crawl is over
+ *
+ * Nothing in this depends on the processes sharing a machine: the owner
+ * of a host is the same everywhere, and the sockets could as well be TCP
+ * connections to partitions on other nodes.
+ *
+ * A partition locks for itself: its crawler's workers all forward URLs
+ * through it, while one thread of its own takes URLs in.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __PARTITION_H
+#define __PARTITION_H
+
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct partition partition_t;  // opaque to users of the module
+
+/**************** partition_coordinate ****************/
+/* Run a crawl split among count partitions, and coordinate it.
+ *
+ * Caller provides:
+ *   count >= 1 partitions; the seedURL, normalized, which goes to its
+ *   owner to start the crawl; crawlfunc, which runs one partition's crawl
+ *   and returns once partition_receive has returned NULL; and arg, passed
+ *   to crawlfunc untouched.
+ * We do:
+ *   fork count child processes; in each, call crawlfunc(arg, partition)
+ *   and exit.  Meanwhile route the URLs they pass on, until the crawl is
+ *   over, then wait for them all to exit.
+ * We return:
+ *   true if every partition ran to the end of the crawl and exited with
+ *   status 0; false if any could not be started, or failed.
+ */
+bool partition_coordinate(const int count, const char* seedURL, void* arg,
+                          void (*crawlfunc)(void* arg, partition_t* partition));
+
+/**************** partition_owner ****************/
+/* Return the partition, from 0 to count-1, that owns the host of url. */
+int partition_owner(const char* url, const int count);
+
+/**************** partition_index ****************/
+/* Return this partition's number, from 0 to the number of partitions - 1. */
+int partition_index(const partition_t* partition);
+
+/**************** partition_owns ****************/
+/* Return true if url's host belongs to this partition. */
+bool partition_owns(const partition_t* partition, const char* url);
+
+/**************** partition_forward ****************/
+/* Pass on a URL that another partition owns.
+ *
+ * Caller provides:
+ *   valid partition; the depth the URL was found at plus one; the URL,
+ *   normalized.
+ * We return:
+ *   true if it was sent, or buffered to send; false on error, or if the
+ *   URL holds a newline.
+ * Note:
+ *   URLs are buffered; partition_flush sends them on.
+ */
+bool partition_forward(partition_t* partition, const int depth, const char* url);
+
+/**************** partition_flush ****************/
+/* Send on every URL buffered by partition_forward; false on error. */
+bool partition_flush(partition_t* partition);
+
+/**************** partition_idle ****************/
+/* Tell the coordinator that this partition has nothing left to fetch,
+ * and has taken 'received' URLs from partition_receive so far.  Any URLs
+ * buffered go first.  The crawl is over once every partition is idle
+ * having taken every URL sent to it.  False on error.
+ */
+bool partition_idle(partition_t* partition, const long received);
+
+/**************** partition_receive ****************/
+/* Wait for the next URL this partition owns.
+ *
+ * We return:
+ *   the URL, and in *depth its depth; or NULL once the crawl is over, or
+ *   if the coordinator has gone away.
+ * Caller is responsible for:
+ *   later calling free on the URL.
+ * Note:
+ *   only one thread may receive.
+ */
+char* partition_receive(partition_t* partition, int* depth);
+
+#endif // __PARTITION_H
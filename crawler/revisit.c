@@ -0,0 +1,209 @@
+/*
+ * revisit.c - what an earlier crawl saved, for a re-crawl to revisit
+ *
+ * see revisit.h for more information.
+ *
+ * Pages are read in docID order until the first missing one, into an
+ * array indexed by docID that also holds each page's body fingerprint and
+ * validators; then every URL goes into a hashtable whose items point into
+ * the array.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "revisit.h"
+#include "pagedir.h"
+#include "fingerprint.h"
+#include "hashtable.h"
+#include "webpage.h"
+
+/**************** file-local types ****************/
+typedef struct page {
+  int docID;
+  uint64_t content;         // fingerprint of the saved body
+  char* etag;               // or NULL
+  char* lastModified;       // or NULL
+} page_t;
+
+/**************** global types ****************/
+struct revisit {
+  page_t* pages;            // pages[docID], for 1 <= docID <= lastID
+  int lastID;
+  hashtable_t* byURL;       // URL -> page_t*
+};
+
+/**************** file-local constants ****************/
+static const int FIRST_PAGES = 1024;   // initial capacity of 'pages'
+
+/**************** local functions ****************/
+static void takeValidators(void* arg, const int docID,
+                           const char* etag, const char* lastModified);
+static char* copyOf(const char* str);
+static char* readPage(const char* pageDirectory, const int docID, uint64_t* content);
+
+/**************** revisit_load ****************/
+/* see revisit.h for description */
+revisit_t*
+revisit_load(const char* pageDirectory)
+{
+  revisit_t* revisit = calloc(1, sizeof(revisit_t));
+  if (revisit == NULL) {
+    return NULL;
+  }
+
+  // every URL and body fingerprint, by docID
+  int capacity = FIRST_PAGES;
+  char** urls = malloc(capacity * sizeof(char*));
+  uint64_t* contents = malloc(capacity * sizeof(uint64_t));
+  char* url = NULL;
+  uint64_t content;
+  while (urls != NULL && contents != NULL
+         && (url = readPage(pageDirectory, revisit->lastID + 1, &content)) != NULL) {
+    if (revisit->lastID + 1 == capacity) {
+      char** biggerURLs = realloc(urls, 2 * capacity * sizeof(char*));
+      urls = biggerURLs ? biggerURLs : urls;
+      uint64_t* biggerContents = realloc(contents, 2 * capacity * sizeof(uint64_t));
+      contents = biggerContents ? biggerContents : contents;
+      if (biggerURLs == NULL || biggerContents == NULL) {
+        free(url);
+        break;
+      }
+      capacity *= 2;
+    }
+    revisit->lastID++;
+    urls[revisit->lastID] = url;
+    contents[revisit->lastID] = content;
+  }
+
+  // their validators, and the URL index
+  bool ok = urls != NULL && contents != NULL && url == NULL;
+  revisit->pages = ok ? calloc(revisit->lastID + 1, sizeof(page_t)) : NULL;
+  revisit->byURL = revisit->pages ? hashtable_new(revisit->lastID / 2 + 1) : NULL;
+  ok = revisit->byURL != NULL && pageDirLoadValidators(pageDirectory, revisit, takeValidators);
+  for (int id = 1; id <= revisit->lastID; id++) {
+    if (ok) {
+      revisit->pages[id].docID = id;
+      revisit->pages[id].content = contents[id];
+      hashtable_insert(revisit->byURL, urls[id], &revisit->pages[id]);
+    }
+    free(urls[id]);
+  }
+  free(urls);
+  free(contents);
+  if (!ok) {
+    revisit_delete(revisit);
+    return NULL;
+  }
+  return revisit;
+}
+
+/**************** revisit_find ****************/
+/* see revisit.h for description */
+int
+revisit_find(revisit_t* revisit, const char* url,
+             const char** etag, const char** lastModified)
+{
+  if (revisit == NULL || url == NULL) {
+    return 0;
+  }
+  page_t* page = hashtable_find(revisit->byURL, url);
+  if (page == NULL) {
+    return 0;
+  }
+  if (etag != NULL) {
+    *etag = page->etag;
+  }
+  if (lastModified != NULL) {
+    *lastModified = page->lastModified;
+  }
+  return page->docID;
+}
+
+/**************** revisit_content ****************/
+/* see revisit.h for description */
+uint64_t
+revisit_content(const revisit_t* revisit, const int docID)
+{
+  if (revisit == NULL || docID < 1 || docID > revisit->lastID) {
+    return 0;
+  }
+  return revisit->pages[docID].content;
+}
+
+/**************** revisit_lastID ****************/
+/* see revisit.h for description */
+int
+revisit_lastID(const revisit_t* revisit)
+{
+  return revisit ? revisit->lastID : 0;
+}
+
+/**************** revisit_delete ****************/
+/* see revisit.h for description */
+void
+revisit_delete(revisit_t* revisit)
+{
+  if (revisit == NULL) {
+    return;
+  }
+  if (revisit->pages != NULL) {
+    for (int id = 1; id <= revisit->lastID; id++) {
+      free(revisit->pages[id].etag);
+      free(revisit->pages[id].lastModified);
+    }
+  }
+  // the items point into 'pages', which is freed below
+  hashtable_delete(revisit->byURL, NULL);
+  free(revisit->pages);
+  free(revisit);
+}
+
+/**************** local functions ****************/
+
+/* takeValidators: pageDirLoadValidators helper; a later line for the
+ * same docID replaces an earlier one */
+static void
+takeValidators(void* arg, const int docID,
+               const char* etag, const char* lastModified)
+{
+  revisit_t* revisit = arg;
+  if (docID > revisit->lastID) {
+    return;                   // a page that is no longer there
+  }
+  page_t* page = &revisit->pages[docID];
+  free(page->etag);
+  free(page->lastModified);
+  page->etag = copyOf(etag);
+  page->lastModified = copyOf(lastModified);
+}
+
+/* copyOf: a malloc'd copy of str, or NULL if str is NULL (or no memory) */
+static char*
+copyOf(const char* str)
+{
+  char* copy = str ? malloc(strlen(str) + 1) : NULL;
+  if (copy != NULL) {
+    strcpy(copy, str);
+  }
+  return copy;
+}
+
+/* readPage: the URL of a saved page (malloc'd), with the fingerprint of
+ * its body in *content; NULL if there is no such page (or no memory).
+ * The saved copy is the body as fetched, so the fingerprints match. */
+static char*
+readPage(const char* pageDirectory, const int docID, uint64_t* content)
+{
+  webpage_t* page = NULL;
+  if (pageDirLoad(&page, pageDirectory, docID) != 1) {
+    return NULL;
+  }
+  const char* body = webpage_getHTML(page) ? webpage_getHTML(page) : "";
+  *content = fingerprint(body, strlen(body));
+  char* url = copyOf(webpage_getURL(page));
+  webpage_delete(page);
+  return url;
+}
@@ -0,0 +1,66 @@
+/*
+ * revisit.h - header file for the crawler's 'revisit' module
+ *
+ * A 'revisit' table remembers what an earlier crawl saved in a
+ * pageDirectory: the URL of every docID, a fingerprint of its body, and
+ * the ETag and Last-Modified validators each page was served with.  A
+ * re-crawl looks each URL up before fetching it, so it can ask the
+ * server for the page only if it has changed, and so a page found again
+ * keeps its old docID and file.
+ *
+ * The table is built once, before the crawl starts, and never changes
+ * afterwards, so any number of workers may look URLs up at once.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __REVISIT_H
+#define __REVISIT_H
+
+#include <stdint.h>
+
+/**************** global types ****************/
+typedef struct revisit revisit_t;  // opaque to users of the module
+
+/**************** revisit_load ****************/
+/* Build the table from the pages and validators in a pageDirectory.
+ *
+ * Caller provides:
+ *   a valid pageDirectory, whose pages are numbered from 1 with no gaps.
+ * We return:
+ *   pointer to a new table (empty, if the directory has no pages);
+ *   NULL if out of memory or the validators cannot be read.
+ * Caller is responsible for:
+ *   later calling revisit_delete.
+ */
+revisit_t* revisit_load(const char* pageDirectory);
+
+/**************** revisit_find ****************/
+/* Look up a URL saved by the earlier crawl.
+ *
+ * Caller provides:
+ *   valid table; url, normalized as the crawler saves it;
+ *   etag and lastModified, where to put the page's validators.
+ * We return:
+ *   the page's docID, with *etag and *lastModified set (NULL for a
+ *   validator the page was not served with); or 0 if the URL is not
+ *   in the table.  The strings belong to the table.
+ */
+int revisit_find(revisit_t* revisit, const char* url,
+                 const char** etag, const char** lastModified);
+
+/**************** revisit_content ****************/
+/* Return the fingerprint (see common/fingerprint.h) of the body saved as
+ * docID, or 0 if there is no such page.
+ */
+uint64_t revisit_content(const revisit_t* revisit, const int docID);
+
+/**************** revisit_lastID ****************/
+/* Return the highest docID in the table (0 if it is empty). */
+int revisit_lastID(const revisit_t* revisit);
+
+/**************** revisit_delete ****************/
+/* Delete the table.  A NULL table is ignored. */
+void revisit_delete(revisit_t* revisit);
+
+#endif // __REVISIT_H
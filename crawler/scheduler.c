@@ -0,0 +1,440 @@
+/*
+ * scheduler.c - the crawler's per-host politeness scheduler
+ *
+ * see scheduler.h for more information.
+ *
+ * Each host has a FIFO of waiting pages and the earliest time it may
+ * be contacted again.  Hosts that have pages waiting sit in a binary
+ * min-heap ordered by that time, so the next host due is always at the
+ * top; each host is in the heap at most once.  The hosts themselves are
+ * found by name through a hashtable, and are kept (with their clocks)
+ * even while they have nothing queued.
+ *
+ * Each host also counts its fetches in flight.  With limits set, a host
+ * may have at most floor(limit) of them, and 'limit' is adjusted AIMD
+ * fashion as fetches finish: it grows by one per fetch while the host
+ * has never been cut back (slow start), then by 1/limit per fetch (about
+ * one per round of fetches), and is halved on an error, or when the
+ * host's smoothed latency rises well above the lowest it has shown.  A
+ * cut waits a smoothed latency after the last, so one burst of trouble
+ * halves it only once.  A host at its limit leaves the heap, even with
+ * pages queued, and goes back as soon as a fetch finishes; so while it is
+ * out, scheduler_iterate and scheduler_delete find pages through the
+ * hashtable, not the heap.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "scheduler.h"
+#include "hashtable.h"
+#include "webpage.h"
+#include "mem.h"
+#include "monotonic.h"
+
+/**************** file-local types ****************/
+typedef struct qnode {
+  webpage_t* page;
+  struct qnode* next;
+} qnode_t;
+
+typedef struct host {
+  qnode_t* head;            // oldest waiting page
+  qnode_t* tail;            // newest waiting page
+  double readyAt;           // earliest time of the next fetch
+  bool inHeap;              // is the host in the heap?
+  int inFlight;             // pages handed out and not yet done
+  double limit;             // most fetches in flight, once rounded down
+  bool cut;                 // has the limit ever been cut back?
+  double cutUntil;          // no further cut before this time
+  double latency;           // smoothed latency of its fetches (0: none yet)
+  double minLatency;        // lowest latency it has shown
+} host_t;
+
+/* what scheduler_iterate and scheduler_delete pass to each host */
+typedef struct visit {
+  void* arg;
+  void (*itemfunc)(void* arg, webpage_t* page);
+  void (*itemdelete)(void* item);
+} visit_t;
+
+/**************** global types ****************/
+struct scheduler {
+  hashtable_t* hosts;       // host name -> host_t
+  host_t** heap;            // hosts with pages waiting, by readyAt
+  int heapSize, heapCap;
+  int size;                 // pages waiting
+  double delay;             // seconds between fetches from one host
+  int minLimit, maxLimit;   // bounds on each host's limit (0: no limits)
+};
+
+/**************** file-local constants ****************/
+static const int HOST_SLOTS = 499;     // hashtable slots for host names
+static const size_t MAX_HOST = 256;    // longest host[:port] we keep apart
+static const double LATENCY_GAIN = 0.125;  // weight of each fetch in 'latency'
+static const double LATENCY_RATIO = 2.0;   // latency above this many times
+static const double LATENCY_SLACK = 0.010; //   the least, plus this, is a cut
+
+/**************** local functions ****************/
+static void hostOf(const char* url, char* buf, const size_t size);
+static bool canFetch(const scheduler_t* sched, const host_t* host);
+static void adjustLimit(scheduler_t* sched, host_t* host,
+                        const double latency, const bool ok);
+static void iteratePages(void* arg, const char* key, void* item);
+static void deletePages(void* arg, const char* key, void* item);
+static void heapPush(scheduler_t* sched, host_t* host);
+static host_t* heapPop(scheduler_t* sched);
+static void hostDelete(void* item);
+
+/**************** scheduler_new ****************/
+/* see scheduler.h for description */
+scheduler_t*
+scheduler_new(const double delay)
+{
+  scheduler_t* sched = mem_malloc(sizeof(scheduler_t));
+  if (sched == NULL) {
+    return NULL;
+  }
+  sched->hosts = hashtable_new(HOST_SLOTS);
+  if (sched->hosts == NULL) {
+    mem_free(sched);
+    return NULL;
+  }
+  sched->heap = NULL;
+  sched->heapSize = sched->heapCap = 0;
+  sched->size = 0;
+  sched->delay = delay > 0 ? delay : 0;
+  sched->minLimit = sched->maxLimit = 0;
+  return sched;
+}
+
+/**************** scheduler_setLimits ****************/
+/* see scheduler.h for description */
+bool
+scheduler_setLimits(scheduler_t* sched, const int minLimit, const int maxLimit)
+{
+  if (sched == NULL || minLimit < 1 || maxLimit < minLimit) {
+    return false;
+  }
+  sched->minLimit = minLimit;
+  sched->maxLimit = maxLimit;
+  return true;
+}
+
+/**************** scheduler_insert ****************/
+/* see scheduler.h for description */
+void
+scheduler_insert(scheduler_t* sched, webpage_t* page)
+{
+  if (sched == NULL || page == NULL) {
+    return;
+  }
+  char name[MAX_HOST];
+  hostOf(webpage_getURL(page), name, sizeof(name));
+
+  host_t* host = hashtable_find(sched->hosts, name);
+  if (host == NULL) {
+    host = mem_assert(mem_malloc(sizeof(host_t)), "scheduler host");
+    host->head = host->tail = NULL;
+    host->readyAt = 0;
+    host->inHeap = false;
+    host->inFlight = 0;
+    host->limit = sched->minLimit;
+    host->cut = false;
+    host->cutUntil = 0;
+    host->latency = host->minLatency = 0;
+    hashtable_insert(sched->hosts, name, host);
+  }
+
+  qnode_t* node = mem_assert(mem_malloc(sizeof(qnode_t)), "scheduler node");
+  node->page = page;
+  node->next = NULL;
+  if (host->tail == NULL) {
+    host->head = host->tail = node;
+  } else {
+    host->tail->next = node;
+    host->tail = node;
+  }
+  sched->size++;
+  if (!host->inHeap && canFetch(sched, host)) {
+    heapPush(sched, host);
+  }
+}
+
+/**************** scheduler_extract ****************/
+/* see scheduler.h for description */
+webpage_t*
+scheduler_extract(scheduler_t* sched, double* wait)
+{
+  if (sched == NULL || wait == NULL) {
+    return NULL;
+  }
+  double t = monotonic_now();
+  host_t* host = NULL;
+  while (sched->heapSize > 0) {
+    host = sched->heap[0];
+    if (canFetch(sched, host)) {
+      break;
+    }
+    // its limit was cut while it waited in the heap
+    heapPop(sched);
+    host = NULL;
+  }
+  if (host == NULL) {
+    *wait = -1;
+    return NULL;
+  }
+  if (host->readyAt > t) {
+    *wait = host->readyAt - t;
+    return NULL;
+  }
+
+  heapPop(sched);
+  qnode_t* node = host->head;
+  host->head = node->next;
+  if (host->head == NULL) {
+    host->tail = NULL;
+  }
+  host->readyAt = t + sched->delay;
+  host->inFlight++;
+  if (canFetch(sched, host)) {
+    heapPush(sched, host);
+  }
+  webpage_t* page = node->page;
+  mem_free(node);
+  sched->size--;
+  *wait = 0;
+  return page;
+}
+
+/**************** scheduler_done ****************/
+/* see scheduler.h for description */
+bool
+scheduler_done(scheduler_t* sched, const char* url, const double latency, const bool ok)
+{
+  if (sched == NULL || url == NULL) {
+    return false;
+  }
+  char name[MAX_HOST];
+  hostOf(url, name, sizeof(name));
+  host_t* host = hashtable_find(sched->hosts, name);
+  if (host == NULL || host->inFlight == 0) {
+    return false;
+  }
+  host->inFlight--;
+  if (sched->maxLimit > 0) {
+    adjustLimit(sched, host, latency, ok);
+  }
+  if (!host->inHeap && canFetch(sched, host)) {
+    heapPush(sched, host);
+    return true;
+  }
+  return false;
+}
+
+/**************** scheduler_limit ****************/
+/* see scheduler.h for description */
+int
+scheduler_limit(scheduler_t* sched, const char* url)
+{
+  if (sched == NULL || url == NULL || sched->maxLimit == 0) {
+    return 0;
+  }
+  char name[MAX_HOST];
+  hostOf(url, name, sizeof(name));
+  host_t* host = hashtable_find(sched->hosts, name);
+  return host ? (int) host->limit : sched->minLimit;
+}
+
+/**************** scheduler_size ****************/
+/* see scheduler.h for description */
+int
+scheduler_size(const scheduler_t* sched)
+{
+  return sched ? sched->size : 0;
+}
+
+/**************** scheduler_iterate ****************/
+/* see scheduler.h for description */
+void
+scheduler_iterate(scheduler_t* sched, void* arg,
+                  void (*itemfunc)(void* arg, webpage_t* page))
+{
+  if (sched == NULL || itemfunc == NULL) {
+    return;
+  }
+  // a host at its limit has pages waiting, but is not in the heap
+  visit_t visit = { .arg = arg, .itemfunc = itemfunc, .itemdelete = NULL };
+  hashtable_iterate(sched->hosts, &visit, iteratePages);
+}
+
+/**************** scheduler_delete ****************/
+/* see scheduler.h for description */
+void
+scheduler_delete(scheduler_t* sched, void (*itemdelete)(void* item))
+{
+  if (sched == NULL) {
+    return;
+  }
+  visit_t visit = { .arg = NULL, .itemfunc = NULL, .itemdelete = itemdelete };
+  hashtable_iterate(sched->hosts, &visit, deletePages);
+  hashtable_delete(sched->hosts, hostDelete);
+  free(sched->heap);
+  mem_free(sched);
+}
+
+/**************** local functions ****************/
+
+/* hostOf: copy the host[:port] part of a URL into buf; URLs we cannot
+ * parse all share the empty host name, which is harmless.
+ */
+static void
+hostOf(const char* url, char* buf, const size_t size)
+{
+  buf[0] = '\0';
+  if (url == NULL) {
+    return;
+  }
+  const char* start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  size_t len = strcspn(start, "/?#");
+  if (len >= size) {
+    len = size - 1;
+  }
+  memcpy(buf, start, len);
+  buf[len] = '\0';
+}
+
+/* canFetch: whether the host has a page waiting and room for one more
+ * fetch in flight */
+static bool
+canFetch(const scheduler_t* sched, const host_t* host)
+{
+  int slots = (sched->maxLimit > 0) ? (int) host->limit : INT_MAX;
+  return host->head != NULL && host->inFlight < slots;
+}
+
+/* adjustLimit: a fetch from the host has finished, taking 'latency'
+ * seconds; raise the host's limit, or cut it if the fetch failed or the
+ * host is slowing down */
+static void
+adjustLimit(scheduler_t* sched, host_t* host, const double latency, const bool ok)
+{
+  double t = monotonic_now();
+  if (ok) {
+    if (host->latency == 0) {
+      host->latency = host->minLatency = latency;
+    } else {
+      host->latency += LATENCY_GAIN * (latency - host->latency);
+      if (latency < host->minLatency) {
+        host->minLatency = latency;
+      }
+    }
+  }
+  bool slow = host->latency > LATENCY_RATIO * host->minLatency + LATENCY_SLACK;
+  if ((!ok || slow) && t >= host->cutUntil) {
+    // multiplicative decrease, once per round of fetches
+    host->limit /= 2;
+    host->cut = true;
+    host->cutUntil = t + host->latency;
+  } else if (ok && !slow) {
+    // additive increase; faster until the first cut
+    host->limit += host->cut ? 1.0 / host->limit : 1.0;
+  }
+  if (host->limit < sched->minLimit) {
+    host->limit = sched->minLimit;
+  } else if (host->limit > sched->maxLimit) {
+    host->limit = sched->maxLimit;
+  }
+}
+
+/* iteratePages: hashtable_iterate helper for scheduler_iterate; call the
+ * caller's itemfunc on each page waiting for one host */
+static void
+iteratePages(void* arg, const char* key, void* item)
+{
+  visit_t* visit = arg;
+  host_t* host = item;
+  for (qnode_t* node = host->head; node != NULL; node = node->next) {
+    (*visit->itemfunc)(visit->arg, node->page);
+  }
+}
+
+/* deletePages: hashtable_iterate helper for scheduler_delete; empty one
+ * host's queue, calling the caller's itemdelete (if not NULL) on each page */
+static void
+deletePages(void* arg, const char* key, void* item)
+{
+  void (*itemdelete)(void* item) = ((visit_t*) arg)->itemdelete;
+  host_t* host = item;
+  while (host->head != NULL) {
+    qnode_t* node = host->head;
+    host->head = node->next;
+    if (itemdelete != NULL) {
+      (*itemdelete)(node->page);
+    }
+    mem_free(node);
+  }
+  host->tail = NULL;
+}
+
+/* heapPush: add a host to the heap */
+static void
+heapPush(scheduler_t* sched, host_t* host)
+{
+  if (sched->heapSize == sched->heapCap) {
+    int cap = sched->heapCap ? sched->heapCap * 2 : 64;
+    sched->heap = mem_assert(realloc(sched->heap, cap * sizeof(host_t*)), "scheduler heap");
+    sched->heapCap = cap;
+  }
+  int i = sched->heapSize++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (sched->heap[parent]->readyAt <= host->readyAt) {
+      break;
+    }
+    sched->heap[i] = sched->heap[parent];
+    i = parent;
+  }
+  sched->heap[i] = host;
+  host->inHeap = true;
+}
+
+/* heapPop: remove and return the host that is due first */
+static host_t*
+heapPop(scheduler_t* sched)
+{
+  host_t* top = sched->heap[0];
+  host_t* last = sched->heap[--sched->heapSize];
+  int i = 0;
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= sched->heapSize) {
+      break;
+    }
+    if (child + 1 < sched->heapSize
+        && sched->heap[child + 1]->readyAt < sched->heap[child]->readyAt) {
+      child++;
+    }
+    if (last->readyAt <= sched->heap[child]->readyAt) {
+      break;
+    }
+    sched->heap[i] = sched->heap[child];
+    i = child;
+  }
+  if (sched->heapSize > 0) {
+    sched->heap[i] = last;
+  }
+  top->inHeap = false;
+  return top;
+}
+
+/* hostDelete: free a host_t; its queue is already empty */
+static void
+hostDelete(void* item)
+{
+  mem_free(item);
+}
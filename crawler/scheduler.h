@@ -0,0 +1,124 @@
+/*
+ * scheduler.h - header file for the crawler's 'scheduler' module
+ *
+ * A 'scheduler' holds pages waiting to be fetched, queued by host, and
+ * enforces a minimum delay between two fetches from the same host.
+ * Pages from a host that was contacted recently wait their turn; pages
+ * from any other host are handed out immediately.  Within one host,
+ * pages come out in the order they went in.
+ *
+ * Optionally, the scheduler also bounds how many fetches each host has
+ * in flight at once, and adapts that bound to how the host copes: each
+ * finished fetch is reported with its latency and whether it succeeded,
+ * and the host's limit rises slowly while its fetches go well, and is
+ * halved when they fail or slow down (AIMD, as TCP does with its window).
+ *
+ * The scheduler does not lock; the crawler calls it under its own lock.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct scheduler scheduler_t;  // opaque to users of the module
+
+/**************** scheduler_new ****************/
+/* Create a new (empty) scheduler.
+ *
+ * Caller provides:
+ *   delay, the minimum number of seconds between two fetches from one
+ *   host; 0 means no delay at all.
+ * We return:
+ *   pointer to a new scheduler, or NULL if error.
+ * Caller is responsible for:
+ *   later calling scheduler_delete.
+ */
+scheduler_t* scheduler_new(const double delay);
+
+/**************** scheduler_setLimits ****************/
+/* Limit the fetches in flight from each host, and adapt the limits.
+ *
+ * Caller provides:
+ *   valid scheduler, before any page is inserted; 1 <= minLimit <= maxLimit.
+ * We return:
+ *   true if the limits are set; false on bad arguments.
+ * We guarantee:
+ *   each host starts with minLimit fetches at a time, and never has fewer
+ *   nor more than maxLimit.  Without limits, a host may have any number
+ *   of fetches in flight, and scheduler_done only counts them.
+ */
+bool scheduler_setLimits(scheduler_t* sched, const int minLimit, const int maxLimit);
+
+/**************** scheduler_insert ****************/
+/* Queue a page behind any others from the same host.
+ *
+ * Caller provides:
+ *   valid scheduler, and a page with a URL.
+ * We guarantee:
+ *   a NULL scheduler or page is ignored; the page belongs to the scheduler
+ *   until scheduler_extract returns it.
+ */
+void scheduler_insert(scheduler_t* sched, webpage_t* page);
+
+/**************** scheduler_extract ****************/
+/* Return a page whose host may be contacted now.
+ *
+ * Caller provides:
+ *   valid scheduler; wait pointing to a double.
+ * We return:
+ *   the oldest page of the host that has waited longest, if that host's
+ *   delay has passed and it is below its limit; the host's clock
+ *   restarts now.  Otherwise NULL, with *wait set to the seconds until
+ *   some host will be ready, or to -1 if the scheduler is empty or every
+ *   host with pages waiting is at its limit (scheduler_done says when
+ *   that changes).
+ */
+webpage_t* scheduler_extract(scheduler_t* sched, double* wait);
+
+/**************** scheduler_done ****************/
+/* Report that the fetch of a page from scheduler_extract has finished.
+ *
+ * Caller provides:
+ *   valid scheduler; the page's URL; the seconds the fetch took; and
+ *   whether it went well: false for no response, or one saying the
+ *   server is overloaded (429, 5xx).
+ * We return:
+ *   true if this let a host, held back at its limit, have pages fetched
+ *   again, so that a caller waiting on the scheduler should look again;
+ *   false otherwise.
+ * Caller is responsible for:
+ *   reporting every page extracted exactly once, fetched or not.
+ */
+bool scheduler_done(scheduler_t* sched, const char* url,
+                    const double latency, const bool ok);
+
+/**************** scheduler_limit ****************/
+/* Return the number of fetches the host of url may have in flight now,
+ * or 0 if the scheduler has no limits.
+ */
+int scheduler_limit(scheduler_t* sched, const char* url);
+
+/**************** scheduler_size ****************/
+/* Return the number of pages waiting in the scheduler. */
+int scheduler_size(const scheduler_t* sched);
+
+/**************** scheduler_iterate ****************/
+/* Call itemfunc(arg, page) on every page waiting in the scheduler, host
+ * by host, oldest first within a host.  The pages stay in the scheduler,
+ * and itemfunc must not change them.
+ */
+void scheduler_iterate(scheduler_t* sched, void* arg,
+                       void (*itemfunc)(void* arg, webpage_t* page));
+
+/**************** scheduler_delete ****************/
+/* Delete the scheduler, calling itemdelete (if not NULL) on each page
+ * still waiting.
+ */
+void scheduler_delete(scheduler_t* sched, void (*itemdelete)(void* item));
+
+#endif // __SCHEDULER_H
@@ -0,0 +1,303 @@
+/*
+ * seenset.c - the crawler's set of URLs already met
+ *
+ * see seenset.h for more information.
+ *
+ * The table is an fptable (see fptable.h) of URL fingerprints, whose
+ * value is a mark byte per slot: the URL's smallest depth in the low
+ * seven bits, and whether its page is claimed in the top one.  Nothing
+ * is ever removed.
+ *
+ * The Bloom filter has 8 bits per table slot and sets BLOOM_PROBES bits
+ * per URL, picked by double hashing from the two halves of a remixed
+ * fingerprint (the raw low bits already choose the table slot).
+ * It is rebuilt from the table's fingerprints whenever the table grows,
+ * so it keeps its false-positive rate (under 1% even when the table is
+ * fullest) at any size.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "seenset.h"
+#include "fptable.h"
+#include "fingerprint.h"
+#include "mem.h"
+
+/**************** global types ****************/
+struct seenset {
+  fptable_t table;          // fingerprints, each with its mark byte
+  unsigned char* bloom;     // Bloom filter bits, or NULL for none
+};
+
+/**************** file-local constants ****************/
+static const int BLOOM_PROBES = 5;      // bits set per URL
+static const uint64_t BLOOM_MIX = 0x9e3779b97f4a7c15ULL;  // odd multiplier
+static const unsigned char CLAIMED = 0x80;   // mark bit: the page is claimed
+static const int MAX_DEPTH = 0x7f;           // deeper is kept as this
+
+/**************** local functions ****************/
+static size_t find(const seenset_t* set, const uint64_t fp);
+static bool place(seenset_t* set, const uint64_t fp, const unsigned char mark);
+static bool grow(seenset_t* set);
+static unsigned char* marks(const seenset_t* set);
+static void bloomAdd(seenset_t* set, const uint64_t fp);
+static bool bloomHas(const seenset_t* set, const uint64_t fp);
+
+/**************** seenset_new ****************/
+/* see seenset.h for description */
+seenset_t*
+seenset_new(const size_t expected, const bool bloom)
+{
+  seenset_t* set = mem_malloc(sizeof(seenset_t));
+  if (set == NULL) {
+    return NULL;
+  }
+  if (!fptable_init(&set->table, expected, 1)) {
+    mem_free(set);
+    return NULL;
+  }
+  set->bloom = bloom ? calloc(set->table.mask + 1, 1) : NULL;
+  if (bloom && set->bloom == NULL) {
+    fptable_free(&set->table);
+    mem_free(set);
+    return NULL;
+  }
+  return set;
+}
+
+/**************** seenset_insert ****************/
+/* see seenset.h for description */
+bool
+seenset_insert(seenset_t* set, const char* url, const int depth)
+{
+  if (set == NULL || url == NULL || depth < 0) {
+    return false;
+  }
+  uint64_t fp = fingerprintString(url);
+  unsigned char mark = depth < MAX_DEPTH ? depth : MAX_DEPTH;
+  size_t i = find(set, fp);
+  if (i != FPTABLE_ABSENT) {
+    // met again: only a smaller depth is news, and the claim stays
+    if (mark >= (marks(set)[i] & ~CLAIMED)) {
+      return false;
+    }
+    marks(set)[i] = (marks(set)[i] & CLAIMED) | mark;
+    return true;
+  }
+
+  if (!grow(set)) {
+    return false;
+  }
+  return place(set, fp, mark);
+}
+
+/**************** seenset_contains ****************/
+/* see seenset.h for description */
+bool
+seenset_contains(const seenset_t* set, const char* url)
+{
+  if (set == NULL || url == NULL) {
+    return false;
+  }
+  return find(set, fingerprintString(url)) != FPTABLE_ABSENT;
+}
+
+/**************** seenset_depth ****************/
+/* see seenset.h for description */
+int
+seenset_depth(const seenset_t* set, const char* url)
+{
+  if (set == NULL || url == NULL) {
+    return -1;
+  }
+  size_t i = find(set, fingerprintString(url));
+  return i == FPTABLE_ABSENT ? -1 : (marks(set)[i] & ~CLAIMED);
+}
+
+/**************** seenset_claim ****************/
+/* see seenset.h for description */
+bool
+seenset_claim(seenset_t* set, const char* url)
+{
+  if (set == NULL || url == NULL) {
+    return false;
+  }
+  size_t i = find(set, fingerprintString(url));
+  if (i == FPTABLE_ABSENT || (marks(set)[i] & CLAIMED) != 0) {
+    return false;
+  }
+  marks(set)[i] |= CLAIMED;
+  return true;
+}
+
+/**************** seenset_size ****************/
+/* see seenset.h for description */
+size_t
+seenset_size(const seenset_t* set)
+{
+  return set ? set->table.size : 0;
+}
+
+/**************** seenset_save ****************/
+/* see seenset.h for description
+ *
+ * The format is the number of fingerprints, then the fingerprints, each
+ * as 8 bytes, least significant first, and followed by its mark byte.
+ */
+bool
+seenset_save(const seenset_t* set, FILE* fp)
+{
+  if (set == NULL || fp == NULL || !fptable_writeWord(fp, set->table.size)) {
+    return false;
+  }
+  for (size_t i = 0; i <= set->table.mask; i++) {
+    if (set->table.slots[i] != 0
+        && (!fptable_writeWord(fp, set->table.slots[i])
+            || putc(marks(set)[i], fp) == EOF)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************** seenset_load ****************/
+/* see seenset.h for description */
+seenset_t*
+seenset_load(FILE* fp, const bool bloom)
+{
+  uint64_t count;
+  if (fp == NULL || !fptable_readWord(fp, &count) || !fptable_fits(fp, count, 9)) {
+    return NULL;                    // more than the file holds
+  }
+  seenset_t* set = seenset_new(count, bloom);
+  if (set == NULL) {
+    return NULL;
+  }
+  for (uint64_t n = 0; n < count; n++) {
+    uint64_t fp64;
+    int mark;
+    if (!fptable_readWord(fp, &fp64) || fp64 == 0 || (mark = getc(fp)) == EOF
+        || !place(set, fp64, mark)) {
+      seenset_delete(set);        // short, or not fingerprints at all
+      return NULL;
+    }
+  }
+  return set;
+}
+
+/**************** seenset_delete ****************/
+/* see seenset.h for description */
+void
+seenset_delete(seenset_t* set)
+{
+  if (set != NULL) {
+    fptable_free(&set->table);
+    free(set->bloom);
+    mem_free(set);
+  }
+}
+
+/**************** local functions ****************/
+
+/* find: the slot holding the fingerprint, or FPTABLE_ABSENT if it is
+ * not in the set.  A Bloom filter miss answers without touching the table.
+ */
+static size_t
+find(const seenset_t* set, const uint64_t fp)
+{
+  if (set->bloom != NULL && !bloomHas(set, fp)) {
+    return FPTABLE_ABSENT;
+  }
+  return fptable_find(&set->table, fp);
+}
+
+/* place: put a new fingerprint, with its mark, in the table and the
+ * Bloom filter; returns false if it was there already.  The table must
+ * have room.
+ */
+static bool
+place(seenset_t* set, const uint64_t fp, const unsigned char mark)
+{
+  size_t i = fptable_place(&set->table, fp);
+  if (i == FPTABLE_ABSENT) {
+    return false;
+  }
+  marks(set)[i] = mark;
+  if (set->bloom != NULL) {
+    bloomAdd(set, fp);
+  }
+  return true;
+}
+
+/* grow: make room in the table for one more URL; if the table doubles,
+ * so does the Bloom filter, rebuilt from the fingerprints.  On failure
+ * the set is left as it was.
+ */
+static bool
+grow(seenset_t* set)
+{
+  size_t oldSlots = set->table.mask + 1;
+  if (set->table.size + 1 <= oldSlots / 4 * 3) {
+    return true;
+  }
+  unsigned char* bloom = NULL;
+  if (set->bloom != NULL && (bloom = calloc(oldSlots * 2, 1)) == NULL) {
+    return false;
+  }
+  if (!fptable_makeRoom(&set->table)) {
+    free(bloom);
+    return false;
+  }
+  if (set->bloom != NULL) {
+    free(set->bloom);
+    set->bloom = bloom;
+    for (size_t i = 0; i <= set->table.mask; i++) {
+      if (set->table.slots[i] != 0) {
+        bloomAdd(set, set->table.slots[i]);
+      }
+    }
+  }
+  return true;
+}
+
+/* marks: the mark bytes, one per table slot */
+static unsigned char*
+marks(const seenset_t* set)
+{
+  return set->table.values;
+}
+
+/* bloomAdd: set the fingerprint's bits in the Bloom filter */
+static void
+bloomAdd(seenset_t* set, const uint64_t fp)
+{
+  size_t bits = (set->table.mask + 1) * 8;
+  uint64_t h = fp * BLOOM_MIX;        // decorrelate from the table slot
+  uint64_t h1 = h >> 32;
+  uint64_t h2 = (h & 0xffffffff) | 1;
+  for (int k = 0; k < BLOOM_PROBES; k++) {
+    size_t bit = (h1 + k * h2) & (bits - 1);
+    set->bloom[bit / 8] |= 1 << (bit % 8);
+  }
+}
+
+/* bloomHas: are all the fingerprint's bits set in the Bloom filter? */
+static bool
+bloomHas(const seenset_t* set, const uint64_t fp)
+{
+  size_t bits = (set->table.mask + 1) * 8;
+  uint64_t h = fp * BLOOM_MIX;        // decorrelate from the table slot
+  uint64_t h1 = h >> 32;
+  uint64_t h2 = (h & 0xffffffff) | 1;
+  for (int k = 0; k < BLOOM_PROBES; k++) {
+    size_t bit = (h1 + k * h2) & (bits - 1);
+    if ((set->bloom[bit / 8] & (1 << (bit % 8))) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,123 @@
+/*
+ * seenset.h - header file for the crawler's 'seenset' module
+ *
+ * A 'seenset' remembers which URLs the crawler has already met, so each
+ * is queued only once.  It stores only a 64-bit fingerprint of each URL
+ * (see common/fingerprint.h), in an open-addressed table that doubles as
+ * it fills: about 12 to 23 bytes per URL, whatever the URLs' lengths,
+ * and a lookup costs the same at a thousand URLs as at a hundred million.
+ *
+ * With each URL it keeps the smallest depth the URL was met at, and
+ * whether a copy of its page has been claimed (given a docID, or taken
+ * as saved before).  When pages are found out of order -- by several
+ * workers, or by partitions whose URLs arrive in any order -- a URL can
+ * be met first deeper than it is; meeting it again shallower lets it be
+ * queued again, so that its links are followed as far as they should be,
+ * and the claim keeps its page from being saved twice.
+ *
+ * Two different URLs with the same fingerprint would be mistaken for
+ * one; at 64 bits that is vanishingly unlikely for any feasible crawl.
+ *
+ * Optionally a Bloom filter sits in front of the table, one byte per
+ * table slot.  A URL the filter has never seen is rejected from that
+ * small bit array alone, without touching the much larger table, which
+ * helps when most lookups are for new URLs and the table outgrows the
+ * CPU caches.
+ *
+ * The seenset does not lock; the crawler calls it under its own lock.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __SEENSET_H
+#define __SEENSET_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**************** global types ****************/
+typedef struct seenset seenset_t;  // opaque to users of the module
+
+/**************** seenset_new ****************/
+/* Create a new (empty) seenset.
+ *
+ * Caller provides:
+ *   expected, a guess at how many URLs it will hold (it grows as needed);
+ *   bloom, whether to put a Bloom filter in front of the table.
+ * We return:
+ *   pointer to a new seenset, or NULL if error.
+ * Caller is responsible for:
+ *   later calling seenset_delete.
+ */
+seenset_t* seenset_new(const size_t expected, const bool bloom);
+
+/**************** seenset_insert ****************/
+/* Add a URL to the set, met at the given depth.
+ *
+ * Caller provides:
+ *   valid seenset; url, normalized, so equal pages have equal URLs;
+ *   depth, 0 or more, at which it was met.
+ * We return:
+ *   true if the URL was new, or had been met only deeper (it is now in
+ *   the set at this depth): either way it should be queued at this depth;
+ *   false if it was already there at this depth or less, or on bad
+ *   arguments or out of memory.
+ */
+bool seenset_insert(seenset_t* set, const char* url, const int depth);
+
+/**************** seenset_depth ****************/
+/* Return the smallest depth the URL was met at, or -1 if it is not in
+ * the set.  A queued copy of the URL deeper than that is stale. */
+int seenset_depth(const seenset_t* set, const char* url);
+
+/**************** seenset_claim ****************/
+/* Claim a URL's page, as a copy of it is fetched.
+ *
+ * Caller provides:
+ *   valid seenset; url, in the set.
+ * We return:
+ *   true the first time the URL is claimed, when its page should be saved;
+ *   false after that, when a copy of the page was saved already (or if
+ *   the URL is not in the set).
+ */
+bool seenset_claim(seenset_t* set, const char* url);
+
+/**************** seenset_contains ****************/
+/* Return true if the URL is in the set. */
+bool seenset_contains(const seenset_t* set, const char* url);
+
+/**************** seenset_size ****************/
+/* Return the number of URLs in the set. */
+size_t seenset_size(const seenset_t* set);
+
+/**************** seenset_save ****************/
+/* Write the set's fingerprints, depths and claims to an open file, in a form seenset_load
+ * reads back (on any machine).
+ *
+ * Caller provides:
+ *   valid seenset; fp open for writing (binary data).
+ * We return:
+ *   true if all was written; false otherwise.
+ */
+bool seenset_save(const seenset_t* set, FILE* fp);
+
+/**************** seenset_load ****************/
+/* Read back a set written by seenset_save.
+ *
+ * Caller provides:
+ *   fp open for reading, positioned where seenset_save began writing;
+ *   bloom, as for seenset_new.
+ * We return:
+ *   pointer to a new seenset holding the saved URLs, with fp positioned
+ *   just past them; or NULL if the data are damaged or out of memory.
+ * Caller is responsible for:
+ *   later calling seenset_delete.
+ */
+seenset_t* seenset_load(FILE* fp, const bool bloom);
+
+/**************** seenset_delete ****************/
+/* Delete the seenset.  A NULL set is ignored. */
+void seenset_delete(seenset_t* set);
+
+#endif // __SEENSET_H
@@ -15,6 +15,15 @@
 
 chmod +x testing.sh # change mode of .out file to executable
 
+# pages saved in a page directory: one 16-byte docstore table entry each
+savedPages() {
+  if [ -f "$1/.docstore" ]; then
+    echo $(( $(wc -c < "$1/.docstore") / 16 ))
+  else
+    echo 0
+  fi
+}
+
 #  make parent directory outside cralwer to hold all new directories made in this test
 mkdir ../tse-output
 
@@ -77,7 +86,7 @@ echo "Error-handling: Insufficient/ Too many  arguments"
  if [ $? -ne 0 ]; then
     echo >&2 "Error : n invalid server (non-existent"
  fi
- ls ../tse-output/argstest-depth/ | wc -l
+ savedPages ../tse-output/argstest-depth
  echo # Blank line
 
 # 4 arguments + valid server, non-existent page
@@ -87,7 +96,7 @@ echo "Error-handling: Insufficient/ Too many  arguments"
  if [ $? -ne 0 ]; then
     echo >&2 "Error : n a valid server but non-existent page"
  fi
- ls ../tse-output/argstest-depth/ | wc -l
+ savedPages ../tse-output/argstest-depth
  echo # Blank line
 
 # 4 arguments + negative page depth
@@ -97,7 +106,7 @@ echo "Error-handling: Insufficient/ Too many  arguments"
  if [ $? -ne 0 ]; then
     echo >&2 "Error : invalid depth (negative depth)"
  fi
- ls ../tse-output/argstest-depth/ | wc -l
+ savedPages ../tse-output/argstest-depth
  echo # Blank line
 
 # Invalid directory - NULL 
@@ -129,7 +138,7 @@ echo "Error-handling: Insufficient/ Too many  arguments"
     echo >&2 "Error : Directory must be writable"
  fi
 
- ls ../tse-output/notWriteable/ | wc -l
+ savedPages ../tse-output/notWriteable
  echo # Blank line
 
 
@@ -152,7 +161,7 @@ if [ $? -ne 0 ];then
      exit 1
  fi
 
-ls ../tse-output/simple-depth-2/ | wc -l
+savedPages ../tse-output/simple-depth-2
 
 # closed set of cross-linked pages
 
@@ -166,7 +175,7 @@ echo "Testing letters html at depth 4 (contains loops). Expect 8 files. "
     exit 1
  fi
 
-ls ../tse-output/crossletters-depth-4/ | wc -l
+savedPages ../tse-output/crossletters-depth-4
 
 echo
 echo "=================================================================================="
@@ -187,7 +196,7 @@ if [ $? -ne 0 ];then
     exit 1
 fi
 
-ls ../tse-output/letters-depth-0/ | wc -l
+savedPages ../tse-output/letters-depth-0
 
 
 # at depth 1
@@ -201,7 +210,7 @@ echo "Expect 2 files from Letters html at Depth 1 "
     exit 1
  fi
 
-ls ../tse-output/letters-depth-1/ | wc -l
+savedPages ../tse-output/letters-depth-1
 
 # at depth 2
 echo
@@ -214,7 +223,7 @@ echo "Expect 3 files from Letters html at Depth 2 "
      exit 1
  fi
 
-ls ../tse-output/letters-depth-2/ | wc -l
+savedPages ../tse-output/letters-depth-2
 
 # # at depth 3
 echo
@@ -227,7 +236,7 @@ echo "Expect 6 files from Letters html at Depth 3 "
     exit 1
  fi
 
-ls ../tse-output/letters-depth-3/ | wc -l
+savedPages ../tse-output/letters-depth-3
 
 # # at depth 4
 echo
@@ -240,7 +249,7 @@ echo "Expect 8 files from Letters html at Depth 4 "
     exit 1
  fi
 
-ls ../tse-output/letters-depth-4/ | wc -l
+savedPages ../tse-output/letters-depth-4
 
 echo
 echo "================================================================================================"
@@ -260,7 +269,7 @@ echo "Section  3 Testing cont.: Repeating with a different seed page in the same
     exit 1
  fi
 
-ls ../tse-output/BHTML-depth-0/ | wc -l
+savedPages ../tse-output/BHTML-depth-0
 
 # at B html at depth 1
  echo
@@ -273,7 +282,7 @@ ls ../tse-output/BHTML-depth-0/ | wc -l
     exit 1
  fi
  
- ls ../tse-output/BHTML-depth-1/ | wc -l
+ savedPages ../tse-output/BHTML-depth-1
 
  # at B html at depth 2
  echo
@@ -286,7 +295,7 @@ ls ../tse-output/BHTML-depth-0/ | wc -l
     exit 1
  fi
 
-ls ../tse-output/BHTML-depth-2/ | wc -l
+savedPages ../tse-output/BHTML-depth-2
 
  # at B html at depth 3
  echo
@@ -299,7 +308,7 @@ ls ../tse-output/BHTML-depth-2/ | wc -l
     exit 1
  fi
 
-ls ../tse-output/BHTML-depth-3/ | wc -l
+savedPages ../tse-output/BHTML-depth-3
 
 # at B html at depth 4
  echo
@@ -312,7 +321,7 @@ ls ../tse-output/BHTML-depth-3/ | wc -l
     exit 1
  fi
 
-ls ../tse-output/BHTML-depth-4/ | wc -l
+savedPages ../tse-output/BHTML-depth-4
 
  # at B html at depth 5
  echo
@@ -325,7 +334,7 @@ ls ../tse-output/BHTML-depth-4/ | wc -l
     exit 1
  fi
 
- ls ../tse-output/BHTML-depth-5/ | wc -l
+ savedPages ../tse-output/BHTML-depth-5
 
 echo
 echo "================================================================================="
@@ -346,7 +355,7 @@ echo "Expect 1 file from toscrape html at Depth 0."
    exit 1
  fi
 
-ls ../tse-output/toscrape-depth-0/ | wc -l
+savedPages ../tse-output/toscrape-depth-0
 
 
  # at depth 1
@@ -361,7 +370,7 @@ echo "Expect 73 file from toscrape html at Depth 1."
     exit 1
  fi
 
-ls ../tse-output/toscrape-depth-1/ | wc -l
+savedPages ../tse-output/toscrape-depth-1
 
  # at depth 2
 echo
@@ -374,7 +383,7 @@ echo "Expect 585 file from toscrape html at Depth 2."
     exit 1
  fi
 
-ls ../tse-output/toscrape-depth-2/ | wc -l
+savedPages ../tse-output/toscrape-depth-2
 
 #  # at depth 3
 # echo
@@ -387,7 +396,7 @@ ls ../tse-output/toscrape-depth-2/ | wc -l
 #     exit 1
 #  fi
 
-# ls ../tse-output/toscrape-depth-3/ | wc -l
+# savedPages ../tse-output/toscrape-depth-3
 
 echo
 echo "=============================================================================="
@@ -407,7 +416,7 @@ echo "Expect 1 file from Wikipedia html at Depth 0."
   exit 1
  fi
 
-ls ../tse-output/wikipedia-depth-0/ | wc -l
+savedPages ../tse-output/wikipedia-depth-0
 
 # at depth 1
 echo
@@ -420,7 +429,7 @@ echo "Expect 7 file from Wikipedia html at Depth 1."
   exit 1
 fi
 
-ls ../tse-output/wikipedia-depth-1/ | wc -l
+savedPages ../tse-output/wikipedia-depth-1
 
 #  # at depth 2
 # echo
@@ -433,12 +442,414 @@ ls ../tse-output/wikipedia-depth-1/ | wc -l
 #     exit 1
 #   fi
 
-# ls ../tse-output/wikipedia-depth-2/ | wc -l
+# savedPages ../tse-output/wikipedia-depth-2
+
+#************************************* docstore round trip ************************************#
+echo
+echo "=================================================================================="
+echo "Section 6 Testing: Saving pages to the docstore and loading them back"
+echo " Expect each step ok: save, replace, truncate, save after truncate, and legacy files (one per page)"
+
+make -C ../common pagedirtest > /dev/null
+rm -rf ../tse-output/docstore-roundtrip && mkdir ../tse-output/docstore-roundtrip
+../common/pagedirtest ../tse-output/docstore-roundtrip
+if [ $? -ne 0 ]; then
+    echo >&2 "Error: Failed test of the docstore round trip"
+    exit 1
+fi
+
+#************************************* local site ************************************#
+echo
+echo "=================================================================================="
+echo "Section 7 Testing: Crawling a local site, served by ../bench/siteserver over 2 hosts"
+echo " Every crawl of it to depth 4 should save the same 341 pages, however it is run"
+
+# the site, and a crawl of it into ../tse-output/$1 with the crawler options that follow
+SITEPORT=8097
+SEED=http://127.0.0.1:$SITEPORT/tse/0.html
+siteCrawl() {
+  local dir=../tse-output/$1
+  shift
+  rm -rf "$dir" && mkdir "$dir"
+  ./crawler -d 0 -c 0 "$@" -s http://127.0.0.1: "$SEED" "$dir" 4 > /dev/null
+}
+
+# the pages saved in ../tse-output/$1, whatever their docIDs: fingerprint, length and URL
+pageList() {
+  ../common/pagedirtest -l "../tse-output/$1" | sort
+}
+
+# stop the server, if one is running; what it served goes to ../tse-output/siteserver.out
+server=
+siteStop() {
+  if [ -n "$server" ]; then
+    kill -TERM $server
+    wait $server
+    server=
+  fi
+}
+
+# (re)start the server, with the siteserver options given, once the last one has stopped
+siteServe() {
+  siteStop
+  ../bench/siteserver -p $SITEPORT -n 400 -f 4 -H 2 -l 5 "$@" \
+      > ../tse-output/siteserver.out 2> /dev/null &
+  server=$!
+  for i in $(seq 100); do
+    if (exec 3<> "/dev/tcp/127.0.0.1/$SITEPORT") 2> /dev/null; then
+      break
+    fi
+    sleep 0.1
+  done
+}
+
+# a count the stopped server reported: served requests, pages, notModified, ...
+served() {
+  awk -v what="$1" '$1 == what { print $2 }' ../tse-output/siteserver.out
+}
+
+# stop the server, and fail with the message given
+siteFail() {
+  siteStop
+  echo >&2 "Error: $1"
+  exit 1
+}
+
+# seconds since the epoch, to the nanosecond
+clock() {
+  date +%s.%N
+}
+
+make -C ../bench > /dev/null
+siteServe
+
+echo
+echo " Crawling it sequentially"
+siteCrawl site-sequential || siteFail "Failed sequential crawl of the local site"
+savedPages ../tse-output/site-sequential
+pageList site-sequential > ../tse-output/site-sequential.list
+
+echo
+echo " Crawling it with 8 workers (-j 8). Expect the same pages as the sequential crawl"
+siteCrawl site-workers -j 8 || siteFail "Failed crawl of the local site with -j 8"
+savedPages ../tse-output/site-workers
+pageList site-workers | cmp -s - ../tse-output/site-sequential.list \
+    || siteFail "-j 8 saved other pages than the sequential crawl"
+echo " same pages"
+
+echo
+echo " Crawling it with 32 fetches in flight (-e 32). Expect the same pages as the sequential crawl"
+siteCrawl site-events -e 32 || siteFail "Failed crawl of the local site with -e 32"
+savedPages ../tse-output/site-events
+pageList site-events | cmp -s - ../tse-output/site-sequential.list \
+    || siteFail "-e 32 saved other pages than the sequential crawl"
+echo " same pages"
+
+echo
+echo " Killing a crawl (kill -9) once it has taken a checkpoint, and resuming it (-r)"
+echo " Expect it killed partway, and the same pages as the sequential crawl once resumed"
+dir=../tse-output/site-resumed
+rm -rf $dir && mkdir $dir
+./crawler -d 0 -c 0.2 -s http://127.0.0.1: "$SEED" $dir 4 > /dev/null &
+crawler=$!
+for i in $(seq 100); do
+  if [ -f $dir/.checkpoint ]; then
+    break
+  fi
+  sleep 0.1
+done
+# (quietly: bash reports a job it sees killed on its own stderr)
+{ kill -9 $crawler; wait $crawler; } 2> /dev/null
+saved=$(savedPages $dir)
+if [ -f $dir/.checkpoint ] && [ "$saved" -lt 341 ]; then
+  echo " killed partway"
+else
+  siteFail "the crawl to resume ended before it could be killed, with $saved pages"
+fi
+./crawler -d 0 -c 0.2 -r -s http://127.0.0.1: "$SEED" $dir 4 > /dev/null \
+    || siteFail "Failed to resume the killed crawl"
+savedPages $dir
+pageList site-resumed | cmp -s - ../tse-output/site-sequential.list \
+    || siteFail "the resumed crawl saved other pages than the sequential crawl"
+echo " same pages"
+
+echo
+echo " Crawling it sequentially, saving pages compressed (-z)"
+echo " Expect the pages smaller on disk, and each to load back as the sequential crawl saved it"
+siteCrawl site-compressed -z || siteFail "Failed crawl of the local site with -z"
+savedPages ../tse-output/site-compressed
+stored() {
+  cat "$1"/.docstore.[0-9]* | wc -c
+}
+[ $(stored ../tse-output/site-compressed) -lt $(stored ../tse-output/site-sequential) ] \
+    || siteFail "-z saved the pages no smaller"
+echo " smaller on disk"
+../common/pagedirtest -c ../tse-output/site-sequential ../tse-output/site-compressed \
+    || siteFail "-z saved pages that do not load back as the sequential crawl's"
+
+echo
+echo " Crawling it to depth 2 with 8 workers, at most one fetch every 0.1s from each host (-d 0.1)"
+echo " Expect the 21 pages to take at least 0.9s: 2 hosts, at least 10 fetches spaced out on each"
+dir=../tse-output/site-polite
+rm -rf $dir && mkdir $dir
+start=$(clock)
+./crawler -d 0.1 -c 0 -j 8 -s http://127.0.0.1: "$SEED" $dir 2 > /dev/null \
+    || siteFail "Failed crawl of the local site with -d 0.1"
+end=$(clock)
+savedPages $dir
+awk -v start=$start -v end=$end 'BEGIN { exit !(end - start >= 0.9) }' \
+    || siteFail "-d 0.1 fetched from a host more often than every 0.1s"
+echo " spaced out"
+
+echo
+echo " Crawling it sequentially again, on a freshly started server"
+echo " Expect the 341 pages over no more than a connection or two per host, kept alive and reused"
+siteServe
+siteCrawl site-keepalive || siteFail "Failed crawl of the local site for keep-alive"
+siteStop
+savedPages ../tse-output/site-keepalive
+[ "$(served pages)" -eq 341 ] && [ "$(served connections)" -le 4 ] \
+    || siteFail "the crawl opened $(served connections) connections for $(served pages) pages"
+echo " connections reused"
+
+echo
+echo " Crawling the site from one host named localhost, with 8 workers (-j 8) and with -e 32"
+echo " Expect 341 pages each time, the same in both, with the name looked up through the resolver"
+siteServe -H 1
+for opts in "-j 8" "-e 32"; do
+  dir=../tse-output/site-localhost${opts// /}
+  rm -rf $dir && mkdir $dir
+  ./crawler -d 0 -c 0 $opts -s http://localhost:$SITEPORT/ http://localhost:$SITEPORT/tse/0.html \
+      $dir 4 > /dev/null || siteFail "Failed crawl of localhost with $opts"
+  savedPages $dir
+done
+pageList site-localhost-j8 | cmp -s - <(pageList site-localhost-e32) \
+    || siteFail "-j 8 and -e 32 saved other pages from localhost"
+echo " same pages"
+
+echo
+echo " Crawling from a seed whose host does not resolve"
+echo " Expect no pages, and no error"
+dir=../tse-output/site-unresolved
+rm -rf $dir && mkdir $dir
+./crawler -d 0 -c 0 -e 4 -s http://nosuchhost.invalid/ http://nosuchhost.invalid/tse/0.html \
+    $dir 4 > /dev/null || siteFail "Failed crawl from a host that does not resolve"
+savedPages $dir
+
+echo
+echo " Crawling it sequentially, with -j 8 and with -e 32, from a server that sends every page chunked"
+echo " Expect the same pages as the sequential crawl each time"
+siteServe -c
+for opts in "" "-j 8" "-e 32"; do
+  name=site-chunked${opts// /}
+  siteCrawl $name $opts || siteFail "Failed crawl of the chunked site with '$opts'"
+  savedPages ../tse-output/$name
+  pageList $name | cmp -s - ../tse-output/site-sequential.list \
+      || siteFail "the chunked site crawled with '$opts' saved other pages"
+done
+echo " same pages"
+
+echo
+echo " Crawling it with a Bloom filter in front of the seen-set (-b), sequentially and with -j 8"
+echo " Expect the same pages as the sequential crawl each time"
+siteServe
+for opts in "-b" "-b -j 8"; do
+  name=site-bloom${opts// /}
+  siteCrawl $name $opts || siteFail "Failed crawl of the local site with '$opts'"
+  savedPages ../tse-output/$name
+  pageList $name | cmp -s - ../tse-output/site-sequential.list \
+      || siteFail "'$opts' saved other pages than the sequential crawl"
+done
+echo " same pages"
+
+echo
+echo " Crawling it in depth order (-o bfs) and by priority (-o priority), sequentially and with -j 8"
+echo " Expect the same pages as the sequential crawl each time"
+for opts in "-o bfs" "-o bfs -j 8" "-o priority" "-o priority -j 8"; do
+  name=site-order${opts// /}
+  siteCrawl $name $opts || siteFail "Failed crawl of the local site with '$opts'"
+  savedPages ../tse-output/$name
+  pageList $name | cmp -s - ../tse-output/site-sequential.list \
+      || siteFail "'$opts' saved other pages than the sequential crawl"
+done
+echo " same pages"
+
+echo
+echo " Re-crawling a copy of the sequential crawl (-u), on a freshly started server"
+echo " Expect every page asked for with its ETag and answered 304, and the copy left as it was"
+dir=../tse-output/site-recrawled
+rm -rf $dir && cp -r ../tse-output/site-sequential $dir
+siteServe
+./crawler -d 0 -c 0 -u -s http://127.0.0.1: "$SEED" $dir 4 > ../tse-output/site-recrawled.log \
+    || siteFail "Failed re-crawl of the local site"
+siteStop
+unchanged=$(grep -c "Unchanged: " ../tse-output/site-recrawled.log)
+echo "$unchanged unchanged, $(served notModified) not modified, $(served pages) pages sent"
+[ $unchanged -eq 341 ] && [ $(served notModified) -eq 341 ] && [ $(served pages) -eq 0 ] \
+    || siteFail "the re-crawl did not find every page unchanged"
+../common/pagedirtest -c ../tse-output/site-sequential $dir \
+    || siteFail "the re-crawl changed the saved pages"
+
+echo
+echo " Crawling it sequentially and with -j 8 from a server that serves every page again as ?copy (-D)"
+echo " Expect 341 pages each time, and each copy recorded in .aliases under the docID of its page"
+siteServe -D
+for opts in "" "-j 8"; do
+  name=site-copies${opts// /}
+  dir=../tse-output/$name
+  siteCrawl $name $opts || siteFail "Failed crawl of the site with copies with '$opts'"
+  savedPages $dir
+  [ $(savedPages $dir) -eq 341 ] || siteFail "'$opts' saved a copy of a page as a page of its own"
+  # docID, then URL, of each page; then each alias must name the same page as its docID
+  ../common/pagedirtest -l $dir | awk '{ print NR "\t" $3 }' \
+      | awk -F '\t' 'NR == FNR { url[$1] = $2; next }
+                     { n++; sub(/\?copy$/, "", url[$1]); sub(/\?copy$/, "", $2) }
+                     url[$1] != $2 { bad++ } END { print n + 0 " aliases"; exit bad > 0 || n == 0 }' \
+          - $dir/.aliases \
+      || siteFail "'$opts' recorded an alias under the docID of another page"
+done
+
+echo
+echo " Crawling it sequentially while recording every response (-a), then replaying that with no server (-p)"
+echo " Expect the replayed crawl to save the recorded crawl's pages, under the same docIDs"
+archive=../tse-output/site.archive
+rm -f $archive
+siteServe
+siteCrawl site-recorded -a $archive || siteFail "Failed crawl of the local site with -a"
+savedPages ../tse-output/site-recorded
+siteStop
+siteCrawl site-replayed -p $archive || siteFail "Failed replay of the recorded crawl"
+savedPages ../tse-output/site-replayed
+../common/pagedirtest -c ../tse-output/site-recorded ../tse-output/site-replayed \
+    || siteFail "the replay saved other pages than the recorded crawl"
+
+echo
+echo " Crawling it with -j 8 and with -e 32, one fetch in flight per host (-m 1), from a server"
+echo " that answers 2 requests at once and turns any more away (-k 2)"
+echo " Expect the 2 hosts never to overload it, and the same pages as the sequential crawl each time"
+for opts in "-j 8" "-e 32"; do
+  name=site-perhost${opts// /}
+  siteServe -k 2
+  siteCrawl $name $opts -m 1 || siteFail "Failed crawl of the local site with '$opts -m 1'"
+  siteStop
+  savedPages ../tse-output/$name
+  [ $(served overloaded) -eq 0 ] \
+      || siteFail "'$opts -m 1' had $(served overloaded) requests turned away"
+  pageList $name | cmp -s - ../tse-output/site-sequential.list \
+      || siteFail "'$opts -m 1' saved other pages than the sequential crawl"
+done
+echo " none turned away, same pages"
+
+echo
+echo " Crawling it split between 3 processes by host (-n 3), each with -j 4"
+echo " The 2 hosts fall to different processes (and the third has none), so expect URLs forwarded"
+echo " between them, and the same pages as the sequential crawl"
+siteServe
+dir=../tse-output/site-partitioned
+rm -rf $dir && mkdir $dir
+./crawler -d 0 -c 0 -n 3 -j 4 -s http://127.0.0.1: "$SEED" $dir 4 > ../tse-output/site-partitioned.log \
+    || siteFail "Failed crawl of the local site with -n 3"
+savedPages $dir
+grep -q "Forwarded: " ../tse-output/site-partitioned.log \
+    || siteFail "-n 3 forwarded no URL from one partition to another"
+pageList site-partitioned | cmp -s - ../tse-output/site-sequential.list \
+    || siteFail "-n 3 saved other pages than the sequential crawl"
+echo " forwarded, same pages"
+
+echo
+echo " Crawling it sequentially, and with -e 32, from a server that sends every page gzip-coded (-z),"
+echo " and then gzip-coded and chunked (-z -c)"
+echo " Expect fewer bytes sent than the pages hold, and each page saved as the sequential crawl saved it"
+html=$(awk '{ bytes += $2 } END { print bytes }' ../tse-output/site-sequential.list)
+for serve in "-z" "-z -c"; do
+  for opts in "" "-e 32"; do
+    name=site-gzip${serve// /}${opts// /}
+    siteServe $serve
+    siteCrawl $name $opts || siteFail "Failed crawl of the '$serve' site with '$opts'"
+    siteStop
+    [ $(served bytes) -lt $html ] \
+        || siteFail "the '$serve' site sent $(served bytes) bytes for $html bytes of pages"
+    pageList $name | cmp -s - ../tse-output/site-sequential.list \
+        || siteFail "the '$serve' site crawled with '$opts' saved other pages"
+  done
+  ../common/pagedirtest -c ../tse-output/site-sequential ../tse-output/site-gzip${serve// /} \
+      || siteFail "the '$serve' site saved pages that differ from the sequential crawl's"
+done
+echo " fewer bytes, same pages"
+
+echo
+echo " Crawling a site of 2000 pages to depth 5 with -e 32: many times the 256 pages the writer queues"
+echo " Expect every page fetched to be saved, under docIDs 1 to 1365 with none missing"
+siteServe -n 2000 -l 0
+dir=../tse-output/site-writer
+rm -rf $dir && mkdir $dir
+./crawler -d 0 -c 0 -e 32 -s http://127.0.0.1: "$SEED" $dir 5 > ../tse-output/site-writer.log \
+    || siteFail "Failed crawl of the 2000-page site"
+siteStop
+fetched=$(grep -c "Fetched: " ../tse-output/site-writer.log)
+echo "$fetched fetched, $(savedPages $dir) saved"
+listed=$(../common/pagedirtest -l $dir | wc -l)
+[ $fetched -eq 1365 ] && [ $(savedPages $dir) -eq $fetched ] && [ $listed -eq $fetched ] \
+    || siteFail "of $fetched pages fetched, $(savedPages $dir) were saved and $listed load back"
+
+echo
+echo " Crawling it with -e 32 and live statistics (-t), then with -j 8 from a server that turns"
+echo " away all but 2 requests at once (-k 2)"
+echo " Expect the pages and bytes the server sent, no errors the first time, and the second time"
+echo " as many throttled fetches as requests turned away"
+stats=../tse-output/site.stats
+siteServe
+siteCrawl site-stats -e 32 -t $stats 2> /dev/null || siteFail "Failed crawl of the local site with -t"
+siteStop
+# a field of the stats file: counted <first word of its line> <field number>
+counted() {
+  awk -v what="$1" -v field="$2" '$1 == what { print $field }' $stats
+}
+echo "pages $(counted pages 2), bytes $(counted bytes 2); $(grep errors $stats)"
+[ $(counted pages 2) -eq $(served pages) ] && [ $(counted bytes 2) -eq $(served bytes) ] \
+    && [ $(counted fetchMs 2) -eq $(served pages) ] \
+    && [ "$(grep errors $stats)" = "errors network 0 redirect 0 client 0 throttled 0 server 0 save 0" ] \
+    || siteFail "-t counted other than the server sent"
+siteServe -k 2
+siteCrawl site-throttled -j 8 -t $stats 2> /dev/null || siteFail "Failed crawl of the -k 2 site with -t"
+siteStop
+[ $(counted errors 9) -eq $(served overloaded) ] && [ $(counted pages 2) -eq $(served pages) ] \
+    || siteFail "-t counted $(counted errors 9) throttled for $(served overloaded) turned away"
+echo " as many throttled as turned away"
+
+echo
+echo " Reading the manifest of the crawls above: sequential, -e 32 of 1365 pages, -n 3, -z and -u"
+echo " Expect it to hold, for each docID, the URL, length and fingerprint of the page saved there"
+for name in site-sequential site-writer site-partitioned site-compressed site-recrawled; do
+  ../common/pagedirtest -m ../tse-output/$name \
+      | cmp -s - <(../common/pagedirtest -l ../tse-output/$name) \
+      || siteFail "the manifest of $name does not match its pages"
+done
+echo " every manifest matches"
+
+siteStop
+
+#************************************* linkscan ************************************#
+echo
+echo "=================================================================================="
+echo "Section 8 Testing: Finding links 32 (AVX2) and 16 (SSE2) bytes at a time, and one at a time"
+echo " Expect the same matches from each way ../libcs50/linkscan.c can be built"
+
+make -C ../libcs50 linkscantests > /dev/null
+../libcs50/linkscantest-scalar > ../tse-output/linkscan-scalar.out
+../libcs50/linkscantest-sse2 > ../tse-output/linkscan-sse2.out
+../libcs50/linkscantest > ../tse-output/linkscan.out
+if [ $? -ne 0 ] || ! cmp -s ../tse-output/linkscan.out ../tse-output/linkscan-scalar.out \
+    || ! cmp -s ../tse-output/linkscan-sse2.out ../tse-output/linkscan-scalar.out; then
+    echo >&2 "Error: linkscan finds other links 16 or 32 bytes at a time than one at a time"
+    exit 1
+fi
+cat ../tse-output/linkscan-scalar.out
 
 # report end of testing
 echo
 echo "================================================================================="
-echo "Section 6:  Reporting  end of testing "
+echo "Section 9:  Reporting  end of testing "
 
 echo " Testing Complete."
 
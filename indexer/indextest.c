@@ -39,27 +39,16 @@ int main(int argc, char *argv[])
     char* oldIndexFilename = argv[1];
     char* newIndexFilename = argv[2];
 
-    // initiate index from num of lines in file
-    index_t* index = NULL;
-    FILE* fp;
-    if ((fp = fopen(oldIndexFilename, "r")) == NULL) {
-        fprintf(stderr, "ERROR: Cannot open file %s\n", oldIndexFilename);
-        fclose(fp);
+    /* load index from oldIndexFilename*/
+    index_t* index = indexLoad(oldIndexFilename);
+    if (index == NULL) {
+        fprintf(stderr, "ERROR: Cannot load index from %s\n", oldIndexFilename);
         exit(3);
     }
-    // if succesful, determine length of file
-    const int size = file_numLines(fp);
-    fclose(fp);
-    // initialize index to length of file (same as num of words)
-    index = index_new(size);
-    
-    /* load index from oldIndexFilename*/
-    index_load(index, oldIndexFilename);
 
     /* writes index to newIndexFilename */
-    index_save(index, newIndexFilename);
-    index_delete(index);
-    mem_free(index);
+    indexSave(index, newIndexFilename);
+    indexDelete(index);
 
     return 0; // exit status
 }
\ No newline at end of file
@@ -192,3 +192,34 @@ echo
 
 
 
+### Test the index the crawler builds as it crawls (-x) against the indexer's ###
+echo "Testing crawler -x on a local site, served by ../bench/siteserver over 2 hosts"
+echo -e "\ncrawling it with 8 workers and -x, then indexing the pages it saved ..."
+make -C ../crawler > /dev/null
+make -C ../bench > /dev/null
+../bench/siteserver -p 8098 -n 400 -f 4 -H 2 > /dev/null 2>&1 &
+server=$!
+for i in $(seq 100); do
+    if (exec 3<> /dev/tcp/127.0.0.1/8098) 2> /dev/null; then
+        break
+    fi
+    sleep 0.1
+done
+rm -rf ../tse-output/site-index
+mkdir ../tse-output/site-index
+../crawler/crawler -d 0 -c 0 -j 8 -x ../tse-output/site-index/crawler.ndx -s http://127.0.0.1: http://127.0.0.1:8098/tse/0.html ../tse-output/site-index 4 > /dev/null
+kill -TERM $server
+wait $server
+./indexer ../tse-output/site-index ../tse-output/site-index/index.ndx
+# the pages may be indexed in any order, so compare one "word docID count" line per pair
+pairs() { awk '{ for (i = 2; i < NF; i += 2) print $1, $i, $(i+1) }' "$1" | sort; }
+var="$(diff <(pairs ../tse-output/site-index/index.ndx) <(pairs ../tse-output/site-index/crawler.ndx))"
+if [ -z "$var" ] && [ -s ../tse-output/site-index/crawler.ndx ]
+then
+      echo -e "\noutput matches!"
+else
+      echo -e "\nError: OUTPUT DOES NOT MATCH"
+fi
+# cleanup
+# rm -r ../tse-output/site-index
+echo
@@ -0,0 +1,306 @@
+/*
+ * archive.c - record HTTP responses to a file, and replay them
+ *
+ * see archive.h for more information.
+ *
+ * A recorded archive is just a FILE* opened for appending; each response
+ * is written whole under the lock, so the records of concurrent fetches
+ * never interleave.
+ *
+ * A loaded archive is the whole file in one buffer.  Each record's URL
+ * line is cut off with a NUL in place, and the records point into the
+ * buffer, so loading copies nothing.  A hashtable maps each URL to the
+ * records made for it, chained in the order they were recorded, and to
+ * the one the next replay of the URL gets.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "archive.h"
+#include "http.h"
+#include "hashtable.h"
+
+/**************** file-local types ****************/
+typedef struct record {
+  const char* url;          // the URL it answered, inside the archive's data
+  const char* message;      // the response, likewise
+  size_t len;               // its length
+  int next;                 // next record for the same URL, or -1
+} record_t;
+
+typedef struct entry {
+  int last;                 // the URL's latest record
+  int cursor;               // the record its next replay gets
+} entry_t;
+
+/**************** global types ****************/
+struct archive {
+  FILE* fp;                 // recording: the file appended to; else NULL
+  bool failed;              // recording: some write has failed
+  char* data;               // replaying: the whole file
+  record_t* records;        // replaying: every record, in file order
+  hashtable_t* urls;        // replaying: URL -> entry_t
+  int count;                // responses loaded, or recorded so far
+  pthread_mutex_t lock;     // guards all of the above
+};
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static archive_t* newArchive(void);
+static char* readFile(const char* filename, size_t* size);
+static bool indexRecords(archive_t* archive, const size_t size);
+
+/**************** archive_create ****************/
+/* see archive.h for description */
+archive_t*
+archive_create(const char* filename)
+{
+  if (filename == NULL) {
+    return NULL;
+  }
+  archive_t* archive = newArchive();
+  if (archive == NULL) {
+    return NULL;
+  }
+  archive->fp = fopen(filename, "a");
+  if (archive->fp == NULL) {
+    archive_close(archive);
+    return NULL;
+  }
+  return archive;
+}
+
+/**************** archive_load ****************/
+/* see archive.h for description */
+archive_t*
+archive_load(const char* filename)
+{
+  if (filename == NULL) {
+    return NULL;
+  }
+  archive_t* archive = newArchive();
+  if (archive == NULL) {
+    return NULL;
+  }
+  size_t size;
+  archive->data = readFile(filename, &size);
+  if (archive->data == NULL || !indexRecords(archive, size)) {
+    archive_close(archive);
+    return NULL;
+  }
+  return archive;
+}
+
+/**************** archive_put ****************/
+/* see archive.h for description */
+bool
+archive_put(archive_t* archive, const char* url, const http_response_t* resp)
+{
+  if (archive == NULL || archive->fp == NULL || url == NULL
+      || strchr(url, '\n') != NULL) {
+    return false;
+  }
+  size_t len;
+  char* message = http_response_message(resp, &len);
+  if (message == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&archive->lock);
+  bool written = fprintf(archive->fp, "@%zu %s\n", len, url) > 0
+                 && fwrite(message, 1, len, archive->fp) == len
+                 && fputc('\n', archive->fp) != EOF;
+  if (written) {
+    archive->count++;
+  } else {
+    archive->failed = true;
+  }
+  pthread_mutex_unlock(&archive->lock);
+  free(message);
+  return written;
+}
+
+/**************** archive_replay ****************/
+/* see archive.h for description */
+http_response_t*
+archive_replay(archive_t* archive, const char* url)
+{
+  if (archive == NULL || archive->urls == NULL || url == NULL) {
+    return NULL;
+  }
+  pthread_mutex_lock(&archive->lock);
+  const record_t* record = NULL;
+  entry_t* entry = hashtable_find(archive->urls, url);
+  if (entry != NULL) {
+    record = &archive->records[entry->cursor];
+    if (record->next >= 0) {
+      entry->cursor = record->next;
+    }
+  }
+  pthread_mutex_unlock(&archive->lock);
+  if (record == NULL) {
+    return NULL;
+  }
+
+  // the record is read-only from here on, so parse it unlocked
+  http_response_t* resp = http_response_new();
+  if (resp != NULL
+      && http_response_feed(resp, record->message, record->len, NULL) != HTTP_DONE) {
+    http_response_delete(resp);
+    resp = NULL;
+  }
+  return resp;
+}
+
+/**************** archive_count ****************/
+/* see archive.h for description */
+int
+archive_count(archive_t* archive)
+{
+  if (archive == NULL) {
+    return 0;
+  }
+  pthread_mutex_lock(&archive->lock);
+  int count = archive->count;
+  pthread_mutex_unlock(&archive->lock);
+  return count;
+}
+
+/**************** archive_close ****************/
+/* see archive.h for description */
+bool
+archive_close(archive_t* archive)
+{
+  if (archive == NULL) {
+    return true;
+  }
+  bool ok = !archive->failed;
+  if (archive->fp != NULL && fclose(archive->fp) != 0) {
+    ok = false;
+  }
+  if (archive->urls != NULL) {
+    hashtable_delete(archive->urls, free);
+  }
+  free(archive->records);
+  free(archive->data);
+  pthread_mutex_destroy(&archive->lock);
+  free(archive);
+  return ok;
+}
+
+/**************** newArchive ****************/
+/* an archive with nothing in it, or NULL if out of memory */
+static archive_t*
+newArchive(void)
+{
+  archive_t* archive = malloc(sizeof(archive_t));
+  if (archive == NULL) {
+    return NULL;
+  }
+  archive->fp = NULL;
+  archive->failed = false;
+  archive->data = NULL;
+  archive->records = NULL;
+  archive->urls = NULL;
+  archive->count = 0;
+  pthread_mutex_init(&archive->lock, NULL);
+  return archive;
+}
+
+/**************** readFile ****************/
+/* the whole of a file, in a malloc'd buffer with a NUL after it, and its
+ * length in *size; or NULL if it cannot be read */
+static char*
+readFile(const char* filename, size_t* size)
+{
+  FILE* fp = fopen(filename, "r");
+  if (fp == NULL) {
+    return NULL;
+  }
+  char* data = NULL;
+  long length;
+  if (fseek(fp, 0, SEEK_END) == 0 && (length = ftell(fp)) >= 0
+      && fseek(fp, 0, SEEK_SET) == 0 && (data = malloc(length + 1)) != NULL) {
+    if (fread(data, 1, length, fp) == (size_t)length) {
+      data[length] = '\0';
+      *size = length;
+    } else {
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(fp);
+  return data;
+}
+
+/**************** indexRecords ****************/
+/* find the records in archive->data, up to the first damaged one, and
+ * map their URLs to them; false if out of memory */
+static bool
+indexRecords(archive_t* archive, const size_t size)
+{
+  char* data = archive->data;
+  int capacity = 0;
+  size_t pos = 0;
+  while (pos < size && data[pos] == '@' && isdigit((unsigned char)data[pos + 1])) {
+    // "@<length> <URL>\n"
+    char* newline = memchr(data + pos, '\n', size - pos);
+    if (newline == NULL) {
+      break;
+    }
+    char* end;
+    unsigned long long len = strtoull(data + pos + 1, &end, 10);
+    if (*end != ' ' || end + 1 == newline) {
+      break;
+    }
+    // then the response, and its newline
+    size_t start = newline + 1 - data;
+    if (len >= size - start || data[start + len] != '\n') {
+      break;
+    }
+    if (archive->count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      record_t* records = realloc(archive->records, capacity * sizeof(record_t));
+      if (records == NULL) {
+        return false;
+      }
+      archive->records = records;
+    }
+    *newline = '\0';                    // ends the URL
+    record_t* record = &archive->records[archive->count++];
+    record->url = end + 1;
+    record->message = data + start;
+    record->len = len;
+    record->next = -1;
+    pos = start + len + 1;
+  }
+
+  archive->urls = hashtable_new(archive->count / 2 + 1);
+  if (archive->urls == NULL) {
+    return false;
+  }
+  for (int i = 0; i < archive->count; i++) {
+    const char* url = archive->records[i].url;
+    entry_t* entry = hashtable_find(archive->urls, url);
+    if (entry != NULL) {
+      archive->records[entry->last].next = i;
+      entry->last = i;
+    } else {
+      entry = malloc(sizeof(entry_t));
+      if (entry == NULL) {
+        return false;
+      }
+      entry->last = entry->cursor = i;
+      if (!hashtable_insert(archive->urls, url, entry)) {
+        free(entry);
+        return false;
+      }
+    }
+  }
+  return true;
+}
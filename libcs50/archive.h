@@ -0,0 +1,107 @@
+/*
+ * archive.h - header file for the 'archive' module
+ *
+ * An 'archive' is a file of HTTP responses, each kept with the URL it
+ * answered, so that a crawl can be run again later against exactly the
+ * same pages, with no network.  A crawl records into an archive by
+ * appending each response as it arrives; another crawl replays it, being
+ * answered from the archive at memory speed.
+ *
+ * A response is kept whole -- status, headers and body -- as one HTTP/1.1
+ * message whose body is framed by Content-Length (see http_response_message),
+ * after a line naming its length and its URL:
+ *
+ *     @<length> <URL>
+ *     <length bytes: the response>
+ *
+ * followed by a newline, so an archive reads well enough in a pager.
+ * Recording only ever appends, so one archive may hold several crawls.
+ *
+ * Like the pagequeue and the resolver, an archive locks for itself: the
+ * fetch workers share one.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __ARCHIVE_H
+#define __ARCHIVE_H
+
+#include <stdbool.h>
+#include "http.h"
+
+/**************** global types ****************/
+typedef struct archive archive_t;  // opaque to users of the module
+
+/**************** archive_create ****************/
+/* Open an archive to record into.
+ *
+ * Caller provides:
+ *   the archive's filename; an existing archive is appended to.
+ * We return:
+ *   pointer to a new archive, or NULL if the file cannot be opened for
+ *   appending or we are out of memory.
+ * Caller is responsible for:
+ *   later calling archive_close, which writes out the last responses.
+ */
+archive_t* archive_create(const char* filename);
+
+/**************** archive_load ****************/
+/* Read a whole archive into memory, to replay.
+ *
+ * Caller provides:
+ *   the archive's filename.
+ * We return:
+ *   pointer to a new archive, or NULL if the file cannot be read or we
+ *   are out of memory.  Should the archive end in a damaged record, say
+ *   because its crawl was killed while writing it, the records before
+ *   that one are kept and the rest ignored.
+ * Caller is responsible for:
+ *   later calling archive_close.
+ */
+archive_t* archive_load(const char* filename);
+
+/**************** archive_put ****************/
+/* Record one response.
+ *
+ * Caller provides:
+ *   an archive from archive_create; the URL fetched; its response,
+ *   complete (HTTP_DONE) and with its body not yet taken.
+ * We return:
+ *   true if the response was written; false on any error, or if the URL
+ *   holds a newline.
+ */
+bool archive_put(archive_t* archive, const char* url, const http_response_t* resp);
+
+/**************** archive_replay ****************/
+/* Answer a fetch of url from the archive.
+ *
+ * Caller provides:
+ *   an archive from archive_load; the URL to fetch.
+ * We return:
+ *   a complete response (HTTP_DONE), as was recorded for url; or NULL if
+ *   none was, or if out of memory.  A URL recorded more than once gets
+ *   its responses in the order they were recorded, the last one again
+ *   once they are used up; each archive_load starts from the first.
+ *   So a re-crawl (whose fetches are conditional) is best recorded into
+ *   an archive of its own, to be replayed on its own.
+ * Caller is responsible for:
+ *   later calling http_response_delete.
+ */
+http_response_t* archive_replay(archive_t* archive, const char* url);
+
+/**************** archive_count ****************/
+/* Return the number of responses in a loaded archive, or recorded so far
+ * into a created one.
+ */
+int archive_count(archive_t* archive);
+
+/**************** archive_close ****************/
+/* Finish writing a recorded archive, and free it.  NULL is ignored.
+ *
+ * We return:
+ *   true if every response recorded reached the file; false if any write
+ *   failed.
+ */
+bool archive_close(archive_t* archive);
+
+#endif // __ARCHIVE_H
@@ -0,0 +1,703 @@
+/*
+ * fetchloop - event-driven fetching of many web pages from one thread
+ *
+ * See fetchloop.h for usage.
+ *
+ * Each page in flight has a conn_t that walks through four phases:
+ * RESOLVING (the host's address is being looked up), CONNECTING
+ * (non-blocking connect, wait for writability), SENDING (write the GET
+ * request), and RECEIVING (feed every readable byte to an
+ * http_response_t until it says DONE).  All sockets share one epoll
+ * instance; the conn_t itself is the epoll user data, so an event leads
+ * straight to its connection.  Finished connections move to a FIFO of
+ * completed pages that fetchloop_next hands back one at a time.
+ *
+ * getaddrinfo blocks, so a host the resolver's cache cannot answer at
+ * once is looked up on a thread of its own.  The thread puts its answer
+ * on the loop's list of answered lookups and wakes the loop through an
+ * eventfd in the same epoll set (with NULL user data); the loop then
+ * starts connecting.  A connection given up on while its lookup runs
+ * just lets go of the lookup, which the loop frees when it is answered.
+ *
+ * The archive given to webpage_setArchive applies here too: a response
+ * is recorded as soon as it is complete, and when replaying, a page is
+ * answered from the archive -- and so done -- as soon as it is added.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _GNU_SOURCE       // epoll, SOCK_NONBLOCK, strdup
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "fetchloop.h"
+#include "http.h"
+#include "resolver.h"
+#include "webpage.h"
+#include "archive.h"
+
+/**************** file-local types ****************/
+typedef enum { C_RESOLVING, C_CONNECTING, C_SENDING, C_RECEIVING } cphase_t;
+
+typedef struct lookup {
+  struct fetchloop* loop;       // the loop to give the answer to
+  struct conn* conn;            // who wants it; NULL once given up on (loop thread only)
+  char* hostname;
+  int port;
+  struct sockaddr_in addr;      // the answer, if 'found'
+  bool found;
+  struct lookup* next;          // in the loop's list of answered lookups
+} lookup_t;
+
+typedef struct conn {
+  webpage_t* page;              // the page being fetched
+  char* html;                   // body, once fetched successfully
+  char* etag;                   // validators the server sent with it
+  char* lastModified;
+  bool unchanged;               // the server answered 304
+  int status;                   // HTTP status of the response (0: none)
+  double started;               // when the fetch was added
+  double finished;              // when it finished, successfully or not
+  char* request;                // the GET request
+  size_t reqLen, reqSent;
+  http_response_t* resp;        // parser for the response
+  struct sockaddr_in addr;      // where to connect
+  lookup_t* lookup;             // while RESOLVING, the lookup under way
+  int fd;                       // socket, or -1
+  int tries;                    // connection attempts so far
+  bool answered;                // have we received any response bytes?
+  cphase_t phase;
+  double deadline;              // give up on this attempt at this time, unless it progresses
+  struct conn* prev;            // links in the active list
+  struct conn* next;            // links in the active or done list
+} conn_t;
+
+/**************** global types ****************/
+struct fetchloop {
+  int epfd;                     // the epoll instance
+  int maxConnections;
+  int pending;                  // pages held: active + done
+  conn_t* active;               // connections in flight
+  conn_t* doneHead;             // finished, not yet returned (FIFO)
+  conn_t* doneTail;
+  int wakefd;                   // eventfd the lookup threads wake us with
+  pthread_mutex_t lock;         // guards the three below
+  pthread_cond_t idle;          // signalled when a lookup thread ends
+  int lookups;                  // lookup threads still running
+  lookup_t* answered;           // lookups answered, not yet taken
+};
+
+/**************** file-local constants ****************/
+static const int MAX_TRY = 3;            // maximum attempts to connect
+static const double TIMEOUT = 30.0;      // seconds an attempt may go without progress
+static const int MAX_EVENTS = 64;        // events taken per epoll_wait
+static const size_t READ_BLOCK = 16384;  // bytes read per recv
+
+/**************** local functions ****************/
+static void startLookup(fetchloop_t* loop, conn_t* c, char* hostname, const int port);
+static void* lookupThread(void* arg);
+static void takeAnswers(fetchloop_t* loop);
+static void connectTo(fetchloop_t* loop, conn_t* c, const bool found);
+static bool startConnect(fetchloop_t* loop, conn_t* c);
+static void handleEvent(fetchloop_t* loop, conn_t* c, const unsigned events);
+static bool sendRequest(fetchloop_t* loop, conn_t* c);
+static void receive(fetchloop_t* loop, conn_t* c);
+static void complete(fetchloop_t* loop, conn_t* c);
+static void retryOrFail(fetchloop_t* loop, conn_t* c);
+static void finish(fetchloop_t* loop, conn_t* c, const bool success);
+static void closeSocket(fetchloop_t* loop, conn_t* c);
+static void takeValidators(conn_t* c);
+static void expire(fetchloop_t* loop);
+static double now(void);
+
+/**************** fetchloop_new ****************/
+/* see fetchloop.h for description */
+fetchloop_t*
+fetchloop_new(const int maxConnections)
+{
+  if (maxConnections < 1) {
+    return NULL;
+  }
+  fetchloop_t* loop = calloc(1, sizeof(fetchloop_t));
+  if (loop == NULL) {
+    return NULL;
+  }
+  loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+  loop->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+  if (loop->epfd < 0 || loop->wakefd < 0
+      || epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wakefd, &ev) < 0) {
+    if (loop->epfd >= 0) {
+      close(loop->epfd);
+    }
+    if (loop->wakefd >= 0) {
+      close(loop->wakefd);
+    }
+    free(loop);
+    return NULL;
+  }
+  pthread_mutex_init(&loop->lock, NULL);
+  pthread_cond_init(&loop->idle, NULL);
+  loop->maxConnections = maxConnections;
+  return loop;
+}
+
+/**************** fetchloop_add ****************/
+/* see fetchloop.h for description */
+bool
+fetchloop_add(fetchloop_t* loop, webpage_t* page)
+{
+  if (loop == NULL || page == NULL || webpage_getURL(page) == NULL
+      || webpage_getHTML(page) != NULL || loop->pending >= loop->maxConnections) {
+    return false;
+  }
+
+  conn_t* c = calloc(1, sizeof(conn_t));
+  if (c == NULL) {
+    return false;
+  }
+  c->page = page;
+  c->fd = -1;
+  c->started = now();
+  c->deadline = c->started + TIMEOUT;
+  loop->pending++;
+
+  // link it into the active list before anything can finish it
+  c->next = loop->active;
+  if (loop->active != NULL) {
+    loop->active->prev = c;
+  }
+  loop->active = c;
+
+  // when replaying an archive, it answers at once
+  bool replay;
+  archive_t* archive = webpage_getArchive(&replay);
+  if (archive != NULL && replay) {
+    webpage_setUnchanged(page, false);
+    c->resp = archive_replay(archive, webpage_getURL(page));
+    if (c->resp == NULL) {
+      finish(loop, c, false);
+    } else {
+      complete(loop, c);
+    }
+    return true;
+  }
+
+  // work out where to connect and what to ask for
+  char* hostname;
+  char* pathname;
+  int port;
+  if (!http_splitURL(webpage_getURL(page), &hostname, &port, &pathname)) {
+    finish(loop, c, false);
+    return true;
+  }
+  // conditional, if the page has validators
+  webpage_setUnchanged(page, false);
+  c->request = http_request(hostname, pathname, false,
+                            webpage_getETag(page), webpage_getLastModified(page));
+  if (c->request != NULL) {
+    c->reqLen = strlen(c->request);
+  }
+
+  free(pathname);
+  bool found;
+  if (c->request == NULL) {
+    free(hostname);
+    finish(loop, c, false);
+  } else if (resolver_cached(hostname, port, &c->addr, &found)) {
+    free(hostname);
+    connectTo(loop, c, found);
+  } else {
+    startLookup(loop, c, hostname, port);
+  }
+  return true;
+}
+
+/**************** fetchloop_next ****************/
+/* see fetchloop.h for description */
+webpage_t*
+fetchloop_next(fetchloop_t* loop, bool* fetched, const double timeout)
+{
+  if (loop == NULL || fetched == NULL) {
+    return NULL;
+  }
+
+  struct epoll_event events[MAX_EVENTS];
+  double giveUp = (timeout >= 0) ? now() + timeout : -1;
+  while (loop->doneHead == NULL && loop->active != NULL) {
+    // wake at least once a second to notice connections that time out
+    int ms = 1000;
+    if (giveUp >= 0) {
+      double left = giveUp - now();
+      if (left <= 0) {
+        ms = 0;                       // still poll once before giving up
+      } else if (left < 1.0) {
+        ms = (int) (left * 1000) + 1;
+      }
+    }
+    int n = epoll_wait(loop->epfd, events, MAX_EVENTS, ms);
+    if (n < 0 && errno != EINTR) {
+      // the loop itself is broken: fail everything in flight
+      while (loop->active != NULL) {
+        finish(loop, loop->active, false);
+      }
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.ptr == NULL) {
+        takeAnswers(loop);
+      } else {
+        handleEvent(loop, events[i].data.ptr, events[i].events);
+      }
+    }
+    expire(loop);
+    if (loop->doneHead == NULL && giveUp >= 0 && now() >= giveUp) {
+      return NULL;
+    }
+  }
+
+  conn_t* c = loop->doneHead;
+  if (c == NULL) {
+    return NULL;
+  }
+  loop->doneHead = c->next;
+  if (loop->doneHead == NULL) {
+    loop->doneTail = NULL;
+  }
+  loop->pending--;
+
+  webpage_t* page = c->page;
+  *fetched = false;
+  if (c->html != NULL) {
+    // rebuild the page around its html; webpage_t is opaque to us
+    char* url = strdup(webpage_getURL(page));
+    webpage_t* full = url ? webpage_new(url, webpage_getDepth(page), c->html) : NULL;
+    if (full != NULL) {
+      webpage_delete(page);
+      page = full;
+      webpage_setValidators(page, c->etag, c->lastModified);
+      *fetched = true;
+    } else {
+      free(url);
+      free(c->html);
+    }
+  } else if (c->unchanged) {
+    // a 304 that repeats no validators leaves the page's own in place
+    webpage_setUnchanged(page, true);
+    if (c->etag != NULL || c->lastModified != NULL) {
+      webpage_setValidators(page, c->etag, c->lastModified);
+    }
+  }
+  webpage_setFetchResult(page, c->status, c->finished - c->started);
+  free(c->etag);
+  free(c->lastModified);
+  free(c);
+  return page;
+}
+
+/**************** fetchloop_pending ****************/
+/* see fetchloop.h for description */
+int
+fetchloop_pending(const fetchloop_t* loop)
+{
+  return loop ? loop->pending : 0;
+}
+
+/**************** fetchloop_delete ****************/
+/* see fetchloop.h for description */
+void
+fetchloop_delete(fetchloop_t* loop)
+{
+  if (loop == NULL) {
+    return;
+  }
+  while (loop->active != NULL) {
+    finish(loop, loop->active, false);
+  }
+  bool fetched;
+  webpage_t* page;
+  while ((page = fetchloop_next(loop, &fetched, -1)) != NULL) {
+    webpage_delete(page);
+  }
+
+  // the lookup threads still running were given up on; wait them out
+  pthread_mutex_lock(&loop->lock);
+  while (loop->lookups > 0) {
+    pthread_cond_wait(&loop->idle, &loop->lock);
+  }
+  pthread_mutex_unlock(&loop->lock);
+  takeAnswers(loop);
+  pthread_cond_destroy(&loop->idle);
+  pthread_mutex_destroy(&loop->lock);
+  close(loop->wakefd);
+  close(loop->epfd);
+  free(loop);
+}
+
+/**************** local functions ****************/
+
+/* startLookup: look hostname up on a thread of its own, which takes it;
+ * the connection waits, RESOLVING, until takeAnswers hands it the
+ * answer.  If no thread can be started, look it up here and now.
+ */
+static void
+startLookup(fetchloop_t* loop, conn_t* c, char* hostname, const int port)
+{
+  lookup_t* lookup = calloc(1, sizeof(lookup_t));
+  if (lookup == NULL) {
+    free(hostname);
+    finish(loop, c, false);
+    return;
+  }
+  lookup->loop = loop;
+  lookup->conn = c;
+  lookup->hostname = hostname;
+  lookup->port = port;
+  c->phase = C_RESOLVING;
+  c->lookup = lookup;
+
+  pthread_mutex_lock(&loop->lock);
+  loop->lookups++;
+  pthread_mutex_unlock(&loop->lock);
+  pthread_attr_t attr;
+  pthread_t thread;
+  bool started = pthread_attr_init(&attr) == 0;
+  if (started) {
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    started = pthread_create(&thread, &attr, lookupThread, lookup) == 0;
+    pthread_attr_destroy(&attr);
+  }
+  if (!started) {
+    pthread_mutex_lock(&loop->lock);
+    loop->lookups--;
+    pthread_mutex_unlock(&loop->lock);
+    c->lookup = NULL;
+    bool found = resolver_lookup(hostname, port, &c->addr);
+    free(hostname);
+    free(lookup);
+    connectTo(loop, c, found);
+  }
+}
+
+/* lookupThread: resolve a lookup's host, then hand the answer to the
+ * loop and wake it.  The loop waits for every such thread before it is
+ * freed, so it is still there to take the answer.
+ */
+static void*
+lookupThread(void* arg)
+{
+  lookup_t* lookup = arg;
+  lookup->found = resolver_lookup(lookup->hostname, lookup->port, &lookup->addr);
+
+  fetchloop_t* loop = lookup->loop;
+  uint64_t one = 1;
+  pthread_mutex_lock(&loop->lock);
+  lookup->next = loop->answered;
+  loop->answered = lookup;
+  if (write(loop->wakefd, &one, sizeof(one)) < 0) {
+    // the counter is already nonzero: the loop will wake anyway
+  }
+  loop->lookups--;
+  pthread_cond_broadcast(&loop->idle);
+  pthread_mutex_unlock(&loop->lock);
+  return NULL;
+}
+
+/* takeAnswers: start connecting each connection whose lookup has been
+ * answered, and free the lookups.
+ */
+static void
+takeAnswers(fetchloop_t* loop)
+{
+  uint64_t count;
+  if (read(loop->wakefd, &count, sizeof(count)) < 0) {
+    // nothing to read: some earlier call took the answers
+  }
+  pthread_mutex_lock(&loop->lock);
+  lookup_t* answered = loop->answered;
+  loop->answered = NULL;
+  pthread_mutex_unlock(&loop->lock);
+
+  while (answered != NULL) {
+    lookup_t* lookup = answered;
+    answered = lookup->next;
+    conn_t* c = lookup->conn;
+    if (c != NULL) {
+      c->lookup = NULL;
+      c->addr = lookup->addr;
+      connectTo(loop, c, lookup->found);
+    }
+    free(lookup->hostname);
+    free(lookup);
+  }
+}
+
+/* connectTo: start connecting, once the host's address is known;
+ * fail the fetch if the host did not resolve.
+ */
+static void
+connectTo(fetchloop_t* loop, conn_t* c, const bool found)
+{
+  if (!found) {
+    finish(loop, c, false);
+  } else if (!startConnect(loop, c)) {
+    retryOrFail(loop, c);
+  }
+}
+
+/* startConnect: open a non-blocking socket and begin connecting;
+ * the connection completes when epoll reports the socket writable.
+ */
+static bool
+startConnect(fetchloop_t* loop, conn_t* c)
+{
+  c->tries++;
+  c->phase = C_CONNECTING;
+  c->reqSent = 0;
+  c->answered = false;
+  c->deadline = now() + TIMEOUT;
+  http_response_delete(c->resp);
+  c->resp = http_response_new();
+  if (c->resp == NULL) {
+    return false;
+  }
+
+  c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (c->fd < 0) {
+    return false;
+  }
+  if (connect(c->fd, (struct sockaddr*) &c->addr, sizeof(c->addr)) < 0
+      && errno != EINPROGRESS) {
+    closeSocket(loop, c);
+    return false;
+  }
+  struct epoll_event ev = { .events = EPOLLOUT, .data.ptr = c };
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, c->fd, &ev) < 0) {
+    closeSocket(loop, c);
+    return false;
+  }
+  return true;
+}
+
+/* handleEvent: advance one connection after epoll says it is ready */
+static void
+handleEvent(fetchloop_t* loop, conn_t* c, const unsigned events)
+{
+  if (c->phase == C_CONNECTING) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+      retryOrFail(loop, c);
+      return;
+    }
+    c->phase = C_SENDING;
+  }
+  if (c->phase == C_SENDING) {
+    if (!sendRequest(loop, c)) {
+      retryOrFail(loop, c);
+    }
+    return;
+  }
+  if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+    receive(loop, c);
+  }
+}
+
+/* sendRequest: write as much of the request as the socket takes; once
+ * it is all sent, switch to waiting for the response.
+ */
+static bool
+sendRequest(fetchloop_t* loop, conn_t* c)
+{
+  while (c->reqSent < c->reqLen) {
+    ssize_t n = send(c->fd, c->request + c->reqSent, c->reqLen - c->reqSent,
+                     MSG_NOSIGNAL);
+    if (n < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    c->reqSent += n;
+    c->deadline = now() + TIMEOUT;
+  }
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+  if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, c->fd, &ev) < 0) {
+    return false;
+  }
+  c->phase = C_RECEIVING;
+  return true;
+}
+
+/* receive: drain the socket into the response parser */
+static void
+receive(fetchloop_t* loop, conn_t* c)
+{
+  char buf[READ_BLOCK];
+  for (;;) {
+    ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+    http_state_t state;
+    if (n > 0) {
+      c->answered = true;
+      c->deadline = now() + TIMEOUT;  // a slow page is fine while it is still arriving
+      state = http_response_feed(c->resp, buf, n, NULL);
+    } else if (n == 0) {
+      state = http_response_eof(c->resp);
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return;                         // wait for more
+    } else if (errno == EINTR) {
+      continue;
+    } else {
+      state = HTTP_ERROR;
+    }
+
+    if (state == HTTP_DONE) {
+      // record the response as it came, before its body is taken
+      archive_t* archive = webpage_getArchive(NULL);
+      if (archive != NULL) {
+        archive_put(archive, webpage_getURL(c->page), c->resp);
+      }
+      complete(loop, c);
+      return;
+    }
+    if (state == HTTP_ERROR) {
+      if (c->answered) {
+        finish(loop, c, false);
+      } else {
+        retryOrFail(loop, c);         // e.g., reset before any reply
+      }
+      return;
+    }
+  }
+}
+
+/* complete: the whole response is in; take the html, or note a 304 */
+static void
+complete(fetchloop_t* loop, conn_t* c)
+{
+  int status = http_response_status(c->resp);
+  bool ok = status == 200;
+  c->status = status;
+  if (ok) {
+    c->html = http_response_takeBody(c->resp, NULL);
+  }
+  c->unchanged = status == 304 && (webpage_getETag(c->page) != NULL
+                                   || webpage_getLastModified(c->page) != NULL);
+  if ((ok && c->html != NULL) || c->unchanged) {
+    takeValidators(c);
+  }
+  finish(loop, c, ok && c->html != NULL);
+}
+
+/* retryOrFail: the current attempt failed before the server answered */
+static void
+retryOrFail(fetchloop_t* loop, conn_t* c)
+{
+  closeSocket(loop, c);
+  while (c->tries < MAX_TRY) {
+    if (startConnect(loop, c)) {
+      return;
+    }
+    closeSocket(loop, c);
+  }
+  finish(loop, c, false);
+}
+
+/* finish: move a connection from the active list to the done list */
+static void
+finish(fetchloop_t* loop, conn_t* c, const bool success)
+{
+  if (c->lookup != NULL) {
+    // let go of the lookup; takeAnswers frees it when it is answered
+    c->lookup->conn = NULL;
+    c->lookup = NULL;
+  }
+  closeSocket(loop, c);
+  c->finished = now();
+  http_response_delete(c->resp);
+  c->resp = NULL;
+  free(c->request);
+  c->request = NULL;
+  if (!success) {
+    free(c->html);
+    c->html = NULL;
+  }
+
+  // unlink from the active list
+  if (c->prev != NULL) {
+    c->prev->next = c->next;
+  } else {
+    loop->active = c->next;
+  }
+  if (c->next != NULL) {
+    c->next->prev = c->prev;
+  }
+
+  // append to the done list
+  c->prev = NULL;
+  c->next = NULL;
+  if (loop->doneTail != NULL) {
+    loop->doneTail->next = c;
+  } else {
+    loop->doneHead = c;
+  }
+  loop->doneTail = c;
+}
+
+/* takeValidators: keep the validators the server sent, for the page */
+static void
+takeValidators(conn_t* c)
+{
+  const char* etag = http_response_header(c->resp, "ETag");
+  const char* lastModified = http_response_header(c->resp, "Last-Modified");
+  c->etag = etag ? strdup(etag) : NULL;
+  c->lastModified = lastModified ? strdup(lastModified) : NULL;
+}
+
+/* closeSocket: forget the socket, if any */
+static void
+closeSocket(fetchloop_t* loop, conn_t* c)
+{
+  if (c->fd >= 0) {
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+  }
+}
+
+/* expire: give up on attempts that have gone TIMEOUT seconds without
+ * resolving, connecting, sending or receiving anything */
+static void
+expire(fetchloop_t* loop)
+{
+  double t = now();
+  conn_t* c = loop->active;
+  while (c != NULL) {
+    conn_t* next = c->next;
+    if (c->deadline <= t) {
+      if (c->answered || c->phase == C_RESOLVING) {
+        finish(loop, c, false);
+      } else {
+        retryOrFail(loop, c);
+      }
+    }
+    c = next;
+  }
+}
+
+/* now: monotonic time in seconds */
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
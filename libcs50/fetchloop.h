@@ -0,0 +1,90 @@
+/*
+ * fetchloop - event-driven fetching of many web pages from one thread
+ *
+ * A fetchloop keeps up to 'maxConnections' non-blocking HTTP requests in
+ * flight at once, multiplexed with epoll (so: Linux only).  The caller
+ * adds pages whose HTML has not yet been fetched, and later takes them
+ * back, one at a time, as their fetches complete -- in whatever order
+ * the servers answer.  Responses are parsed incrementally by the http
+ * module as bytes arrive; no thread ever blocks on a socket.  A host
+ * the resolver has not cached is looked up on a short-lived thread of
+ * its own, so the loop never waits on a name server either (callers
+ * must link with -pthread).
+ *
+ * Compared with webpage_fetch(), which ties up its calling thread for
+ * the whole request, one fetchloop can keep hundreds of requests going.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __FETCHLOOP_H
+#define __FETCHLOOP_H
+
+#include <stdbool.h>
+#include "webpage.h"
+
+/**************** global types ****************/
+typedef struct fetchloop fetchloop_t;  // opaque to users of the module
+
+/**************** fetchloop_new ****************/
+/* Create a new fetchloop.
+ *
+ * Caller provides:
+ *   maxConnections > 0, the most requests to keep in flight at once.
+ * We return:
+ *   pointer to a new fetchloop, or NULL on error.
+ * Caller is responsible for:
+ *   later calling fetchloop_delete.
+ */
+fetchloop_t* fetchloop_new(const int maxConnections);
+
+/**************** fetchloop_add ****************/
+/* Start fetching a page.
+ *
+ * Caller provides:
+ *   a page as for webpage_fetch(): a URL, and a NULL html.
+ * We return:
+ *   true if the loop adopted the page; it comes back from fetchloop_next.
+ *   false if the loop already holds maxConnections pages (or bad args);
+ *   the page then still belongs to the caller.
+ * Notes:
+ *   responses are recorded into, or answered from, the archive given to
+ *   webpage_setArchive, as for webpage_fetch().
+ */
+bool fetchloop_add(fetchloop_t* loop, webpage_t* page);
+
+/**************** fetchloop_next ****************/
+/* Wait for the next page whose fetch has finished.
+ *
+ * Caller provides:
+ *   valid loop; 'fetched' pointing to a bool;
+ *   timeout, the most seconds to wait, or a negative number to wait
+ *   until some fetch finishes.
+ * We return:
+ *   a page the caller added earlier, or NULL if the loop holds no pages
+ *   or the timeout passed first.
+ *   *fetched is true if the fetch succeeded (HTTP 200): the returned page
+ *   then has its html, and may be a different webpage_t with the same
+ *   url and depth.  Otherwise *fetched is false and the page comes back
+ *   as it was added.
+ *   Pages with validators are fetched conditionally, as by webpage_fetch:
+ *   after a 304, *fetched is false and webpage_isUnchanged(page) is true.
+ *   Either way the page carries the validators the server sent, and
+ *   webpage_getStatus and webpage_getFetchTime say how its fetch went.
+ * Caller is responsible for:
+ *   the returned page, typically webpage_delete() when done with it.
+ */
+webpage_t* fetchloop_next(fetchloop_t* loop, bool* fetched, const double timeout);
+
+/**************** fetchloop_pending ****************/
+/* Return the number of pages added and not yet returned by fetchloop_next.
+ */
+int fetchloop_pending(const fetchloop_t* loop);
+
+/**************** fetchloop_delete ****************/
+/* Abandon any fetches in progress, delete their pages, and free the loop.
+ * A NULL loop is ignored.
+ */
+void fetchloop_delete(fetchloop_t* loop);
+
+#endif // __FETCHLOOP_H
@@ -23,7 +23,7 @@ file_numLines(FILE* fp)
   rewind(fp);
 
   int nlines = 0;
-  char c = '\0';
+  int c = '\0';     // int, so a 0xff byte is not taken for EOF
   while ( (c = fgetc(fp)) != EOF) {
     if (c == '\n') {
       nlines++;
@@ -71,13 +71,15 @@ file_readUntil(FILE* fp, int (*stopfunc)(int c))
   // Read characters from file until stop-character or EOF, 
   // expanding the buffer when needed to hold more.
   int pos;
-  char c;
+  int c;      // int, so a 0xff byte is not taken for EOF
   for (pos = 0; (c = fgetc(fp)) != EOF && !(*stopfunc)(c); pos++) {
     // We need to save buf[pos+1] for the terminating null
     // and buf[len-1] is the last usable slot, 
     // so if pos+1 is past that slot, we need to grow the buffer.
+    // Double it, so reading n characters costs O(n) copying, not O(n^2).
     if (pos+1 > len-1) {
-      char* newbuf = realloc(buf, ++len * sizeof(char));
+      len *= 2;
+      char* newbuf = realloc(buf, len * sizeof(char));
       if (newbuf == NULL) {
         free(buf);
         return NULL;
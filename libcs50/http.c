@@ -0,0 +1,837 @@
+/*
+ * http - incremental parser for HTTP/1.x responses
+ *
+ * See http.h for usage.
+ *
+ * The parser is a small state machine driven by http_response_feed().
+ * Lines (status, headers, chunk sizes, trailers) are assembled in 'line'
+ * until their newline arrives; body bytes are appended to 'body', whose
+ * capacity doubles as needed so that ingest stays linear in body size.
+ * A gzip- or deflate-coded body goes through a zlib inflater on its way
+ * into 'body', piece by piece, so the coded body is never held whole.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _POSIX_C_SOURCE 200809L   // strndup, strcasecmp
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <zlib.h>
+#include "http.h"
+
+/**************** file-local types ****************/
+typedef enum {
+  P_STATUS,       // reading the status line
+  P_HEADER,       // reading header lines up to the blank line
+  P_BODY,         // reading Content-Length bytes of body
+  P_EOFBODY,      // reading body until the server closes
+  P_CHUNKSIZE,    // reading a chunk-size line
+  P_CHUNKDATA,    // reading the data of one chunk
+  P_CHUNKEND,     // reading the CRLF that follows chunk data
+  P_TRAILER,      // reading trailer lines up to the blank line
+  P_DONE,
+  P_ERROR,
+} phase_t;
+
+typedef struct header {
+  char* name;
+  char* value;
+} header_t;
+
+/**************** global types ****************/
+struct http_response {
+  phase_t phase;          // where we are in the response
+  int status;             // status code, once known
+  int minor;              // HTTP/1.<minor>
+  char* line;             // partial line being assembled
+  size_t lineLen, lineCap;
+  bool lineDone;          // line holds a whole line already handed out
+  header_t* headers;      // headers of the final (non-1xx) response
+  int numHeaders, headerCap;
+  char* body;             // body received so far, always null-terminated
+  size_t bodyLen, bodyCap;
+  size_t remaining;       // bytes left in the body or the current chunk
+  z_stream* inflater;     // decodes a coded body as it arrives, else NULL
+  bool inflated;          // the inflater has reached the end of its stream
+  bool mayBeRaw;          // deflate-coded: may turn out to have no zlib wrapper
+  Bytef firstByte;        // the coded body's first byte, for starting over
+};
+
+/**************** file-local constants ****************/
+static const size_t MAX_LINE = 64 * 1024;      // longest header line we accept
+static const int MAX_HEADERS = 256;            // most headers we accept
+static const size_t FIRST_BODY = 4096;         // initial body capacity
+static const size_t MAX_PRESIZE = 16 << 20;    // most we trust a declared length
+static const size_t CODED_RATIO = 4;           // room for a coded body, per byte
+static const size_t MAX_DECODED = 64 << 20;    // most a coded body may decode to
+
+/**************** local functions ****************/
+static bool safeValue(const char* value);
+static int takeLine(http_response_t* resp, const char* data, const size_t len,
+                    size_t* pos);
+static bool parseStatus(http_response_t* resp);
+static bool addHeader(http_response_t* resp);
+static void clearHeaders(http_response_t* resp);
+static void headersDone(http_response_t* resp);
+static bool reserveBody(http_response_t* resp, size_t len, const bool exact);
+static bool appendBody(http_response_t* resp, const char* data, const size_t len);
+static bool startDecoding(http_response_t* resp);
+static bool decodeBody(http_response_t* resp, const char* data, const size_t len);
+static bool finishBody(http_response_t* resp);
+static bool headerHas(const http_response_t* resp, const char* name,
+                      const char* token);
+
+/**************** http_response_new ****************/
+/* see http.h for description */
+http_response_t*
+http_response_new(void)
+{
+  http_response_t* resp = calloc(1, sizeof(http_response_t));
+  if (resp == NULL) {
+    return NULL;
+  }
+  resp->phase = P_STATUS;
+  return resp;
+}
+
+/**************** http_response_feed ****************/
+/* see http.h for description */
+http_state_t
+http_response_feed(http_response_t* resp, const char* data, const size_t len,
+                   size_t* used)
+{
+  size_t pos = 0;
+  if (resp == NULL || (data == NULL && len > 0)) {
+    if (used != NULL) {
+      *used = 0;
+    }
+    return HTTP_ERROR;
+  }
+
+  while (pos < len && resp->phase != P_DONE && resp->phase != P_ERROR) {
+    int got = 0;
+    size_t n;
+    switch (resp->phase) {
+    case P_STATUS:
+      if ((got = takeLine(resp, data, len, &pos)) <= 0) {
+        break;
+      }
+      if (resp->lineLen == 0) {
+        break;                      // tolerate blank lines before the status
+      }
+      resp->phase = parseStatus(resp) ? P_HEADER : P_ERROR;
+      break;
+
+    case P_HEADER:
+      if ((got = takeLine(resp, data, len, &pos)) <= 0) {
+        break;
+      }
+      if (resp->lineLen == 0) {
+        headersDone(resp);
+      } else if (!addHeader(resp)) {
+        resp->phase = P_ERROR;
+      }
+      break;
+
+    case P_BODY:
+    case P_CHUNKDATA:
+      n = len - pos;
+      if (n > resp->remaining) {
+        n = resp->remaining;
+      }
+      if (!decodeBody(resp, data + pos, n)) {
+        resp->phase = P_ERROR;
+        break;
+      }
+      pos += n;
+      resp->remaining -= n;
+      if (resp->remaining == 0) {
+        resp->phase = (resp->phase == P_BODY) ? P_DONE : P_CHUNKEND;
+      }
+      break;
+
+    case P_EOFBODY:
+      if (!decodeBody(resp, data + pos, len - pos)) {
+        resp->phase = P_ERROR;
+        break;
+      }
+      pos = len;
+      break;
+
+    case P_CHUNKSIZE:
+      if ((got = takeLine(resp, data, len, &pos)) <= 0) {
+        break;
+      }
+      {
+        char* end;
+        unsigned long size = strtoul(resp->line, &end, 16);
+        if (end == resp->line || (*end != '\0' && *end != ';' && !isspace(*end))) {
+          resp->phase = P_ERROR;
+        } else if (size == 0) {
+          resp->phase = P_TRAILER;
+        } else if (!reserveBody(resp, resp->bodyLen
+                               + (size < MAX_PRESIZE ? size : MAX_PRESIZE), false)) {
+          resp->phase = P_ERROR;
+        } else {
+          resp->remaining = size;
+          resp->phase = P_CHUNKDATA;
+        }
+      }
+      break;
+
+    case P_CHUNKEND:
+      if ((got = takeLine(resp, data, len, &pos)) <= 0) {
+        break;
+      }
+      resp->phase = (resp->lineLen == 0) ? P_CHUNKSIZE : P_ERROR;
+      break;
+
+    case P_TRAILER:
+      if ((got = takeLine(resp, data, len, &pos)) <= 0) {
+        break;
+      }
+      if (resp->lineLen == 0) {
+        resp->phase = P_DONE;
+      }
+      break;
+
+    default:
+      break;
+    }
+    if (got < 0) {
+      resp->phase = P_ERROR;
+    }
+  }
+
+  if (resp->phase == P_DONE && !finishBody(resp)) {
+    resp->phase = P_ERROR;
+  }
+  if (used != NULL) {
+    *used = pos;
+  }
+  if (resp->phase == P_DONE) {
+    return HTTP_DONE;
+  }
+  return (resp->phase == P_ERROR) ? HTTP_ERROR : HTTP_MORE;
+}
+
+/**************** http_response_eof ****************/
+/* see http.h for description */
+http_state_t
+http_response_eof(http_response_t* resp)
+{
+  if (resp == NULL) {
+    return HTTP_ERROR;
+  }
+  if ((resp->phase == P_EOFBODY || resp->phase == P_DONE) && finishBody(resp)) {
+    resp->phase = P_DONE;
+    return HTTP_DONE;
+  }
+  resp->phase = P_ERROR;
+  return HTTP_ERROR;
+}
+
+/**************** getters ****************/
+/* see http.h for description */
+int
+http_response_status(const http_response_t* resp)
+{
+  return resp ? resp->status : 0;
+}
+
+const char*
+http_response_header(const http_response_t* resp, const char* name)
+{
+  if (resp == NULL || name == NULL) {
+    return NULL;
+  }
+  for (int i = 0; i < resp->numHeaders; i++) {
+    if (strcasecmp(resp->headers[i].name, name) == 0) {
+      return resp->headers[i].value;
+    }
+  }
+  return NULL;
+}
+
+bool
+http_response_keepAlive(const http_response_t* resp)
+{
+  if (resp == NULL || resp->phase != P_DONE) {
+    return false;
+  }
+  if (http_response_header(resp, "Content-Length") == NULL
+      && !headerHas(resp, "Transfer-Encoding", "chunked")
+      && resp->status != 204 && resp->status != 304) {
+    return false;                     // body ran until the close
+  }
+  if (headerHas(resp, "Connection", "close")) {
+    return false;
+  }
+  return resp->minor >= 1 || headerHas(resp, "Connection", "keep-alive");
+}
+
+/**************** http_response_takeBody ****************/
+/* see http.h for description */
+char*
+http_response_takeBody(http_response_t* resp, size_t* len)
+{
+  if (resp == NULL) {
+    return NULL;
+  }
+  char* body = resp->body;
+  if (body == NULL) {
+    body = calloc(1, sizeof(char));   // no body: hand back an empty string
+  }
+  if (len != NULL) {
+    *len = resp->bodyLen;
+  }
+  resp->body = NULL;
+  resp->bodyLen = resp->bodyCap = 0;
+  return body;
+}
+
+/**************** http_response_message ****************/
+/* see http.h for description */
+char*
+http_response_message(const http_response_t* resp, size_t* len)
+{
+  if (resp == NULL || len == NULL || resp->phase != P_DONE) {
+    return NULL;
+  }
+  // only the framing headers are dropped; Content-Length is put back
+  bool hasBody = resp->status != 204 && resp->status != 304;
+  size_t size = strlen("HTTP/1.1 999 \r\n") + strlen("Content-Length: \r\n") + 20
+                + strlen("\r\n") + resp->bodyLen + 1;
+  for (int i = 0; i < resp->numHeaders; i++) {
+    size += strlen(resp->headers[i].name) + strlen(resp->headers[i].value) + 4;
+  }
+  char* message = malloc(size);
+  if (message == NULL) {
+    return NULL;
+  }
+  size_t used = sprintf(message, "HTTP/1.1 %d \r\n", resp->status);
+  for (int i = 0; i < resp->numHeaders; i++) {
+    const char* name = resp->headers[i].name;
+    if (strcasecmp(name, "Content-Length") != 0
+        && strcasecmp(name, "Transfer-Encoding") != 0
+        && strcasecmp(name, "Connection") != 0
+        && strcasecmp(name, "Keep-Alive") != 0) {
+      used += sprintf(message + used, "%s: %s\r\n", name, resp->headers[i].value);
+    }
+  }
+  if (hasBody) {
+    used += sprintf(message + used, "Content-Length: %zu\r\n", resp->bodyLen);
+  }
+  used += sprintf(message + used, "\r\n");
+  if (hasBody && resp->bodyLen > 0) {
+    memcpy(message + used, resp->body, resp->bodyLen);
+    used += resp->bodyLen;
+  }
+  message[used] = '\0';
+  *len = used;
+  return message;
+}
+
+/**************** http_response_delete ****************/
+/* see http.h for description */
+void
+http_response_delete(http_response_t* resp)
+{
+  if (resp != NULL) {
+    clearHeaders(resp);
+    free(resp->headers);
+    free(resp->line);
+    free(resp->body);
+    if (resp->inflater != NULL) {
+      inflateEnd(resp->inflater);
+      free(resp->inflater);
+    }
+    free(resp);
+  }
+}
+
+/**************** http_splitURL ****************/
+/* see http.h for description */
+bool
+http_splitURL(const char* url, char** hostname, int* port, char** pathname)
+{
+  if (url == NULL || hostname == NULL || port == NULL || pathname == NULL
+      || strncasecmp(url, "http://", 7) != 0) {
+    return false;
+  }
+
+  const char* host = url + 7;
+  const char* hostEnd = host + strcspn(host, ":/");
+  const char* end = hostEnd;
+  if (end == host) {
+    return false;                     // no hostname at all
+  }
+
+  *port = 80;
+  if (*end == ':') {                  // explicit port
+    char* after;
+    long p = strtol(end + 1, &after, 10);
+    if (after == end + 1 || p <= 0 || p > 65535) {
+      return false;
+    }
+    *port = (int) p;
+    end = after;
+  }
+  if (*end != '\0' && *end != '/') {
+    return false;
+  }
+
+  *hostname = strndup(host, hostEnd - host);
+  *pathname = strdup(*end == '\0' ? "/" : end);
+  if (*hostname == NULL || *pathname == NULL) {
+    free(*hostname);
+    free(*pathname);
+    return false;
+  }
+  return true;
+}
+
+/**************** http_request ****************/
+/* see http.h for description */
+char*
+http_request(const char* hostname, const char* pathname, const bool keepAlive,
+             const char* etag, const char* lastModified)
+{
+  if (hostname == NULL || pathname == NULL
+      || !safeValue(hostname) || !safeValue(pathname)
+      || (etag != NULL && !safeValue(etag))
+      || (lastModified != NULL && !safeValue(lastModified))) {
+    return NULL;
+  }
+
+  const char* format = "GET %s HTTP/1.1\r\nHost: %s\r\nAccept-Encoding: gzip, deflate\r\n"
+                       "%s%s%s%s%s%sConnection: %s\r\n\r\n";
+  const char* connection = keepAlive ? "keep-alive" : "close";
+  const char* ifNoneMatch[] = { "", "", "" };
+  const char* ifModifiedSince[] = { "", "", "" };
+  if (etag != NULL) {
+    ifNoneMatch[0] = "If-None-Match: ";
+    ifNoneMatch[1] = etag;
+    ifNoneMatch[2] = "\r\n";
+  }
+  if (lastModified != NULL) {
+    ifModifiedSince[0] = "If-Modified-Since: ";
+    ifModifiedSince[1] = lastModified;
+    ifModifiedSince[2] = "\r\n";
+  }
+  int len = snprintf(NULL, 0, format, pathname, hostname,
+                     ifNoneMatch[0], ifNoneMatch[1], ifNoneMatch[2],
+                     ifModifiedSince[0], ifModifiedSince[1], ifModifiedSince[2],
+                     connection);
+  char* request = len < 0 ? NULL : malloc(len + 1);
+  if (request != NULL) {
+    snprintf(request, len + 1, format, pathname, hostname,
+             ifNoneMatch[0], ifNoneMatch[1], ifNoneMatch[2],
+             ifModifiedSince[0], ifModifiedSince[1], ifModifiedSince[2],
+             connection);
+  }
+  return request;
+}
+
+/**************** local functions ****************/
+
+/* safeValue: true if a string may go into a request line or header,
+ * that is, it holds no CR or LF to end the line early.
+ */
+static bool
+safeValue(const char* value)
+{
+  return value[strcspn(value, "\r\n")] == '\0';
+}
+
+/* takeLine: move bytes from data[*pos] into resp->line through the next
+ * newline.  Returns 1 when a whole line (without its CR LF) is ready,
+ * 0 when the data ran out first, and -1 if the line is too long.
+ */
+static int
+takeLine(http_response_t* resp, const char* data, const size_t len, size_t* pos)
+{
+  if (resp->lineDone) {
+    resp->lineLen = 0;                // previous call handed out a line
+    resp->lineDone = false;
+  }
+  const char* start = data + *pos;
+  const char* nl = memchr(start, '\n', len - *pos);
+  size_t n = nl ? (size_t)(nl - start) + 1 : len - *pos;
+
+  if (resp->lineLen + n + 1 > resp->lineCap) {
+    if (resp->lineLen + n + 1 > MAX_LINE) {
+      return -1;
+    }
+    size_t cap = resp->lineCap ? resp->lineCap : 256;
+    while (cap < resp->lineLen + n + 1) {
+      cap *= 2;
+    }
+    char* line = realloc(resp->line, cap);
+    if (line == NULL) {
+      return -1;
+    }
+    resp->line = line;
+    resp->lineCap = cap;
+  }
+  memcpy(resp->line + resp->lineLen, start, n);
+  resp->lineLen += n;
+  resp->line[resp->lineLen] = '\0';
+  *pos += n;
+
+  if (nl == NULL) {
+    return 0;
+  }
+  // strip the line ending; lineLen then excludes it
+  resp->lineLen--;
+  if (resp->lineLen > 0 && resp->line[resp->lineLen - 1] == '\r') {
+    resp->lineLen--;
+  }
+  resp->line[resp->lineLen] = '\0';
+  resp->lineDone = true;
+  return 1;
+}
+
+/* parseStatus: "HTTP/1.x NNN reason" */
+static bool
+parseStatus(http_response_t* resp)
+{
+  int major, minor, status;
+  if (sscanf(resp->line, "HTTP/%d.%d %3d", &major, &minor, &status) != 3
+      || major != 1 || status < 100 || status > 999) {
+    return false;
+  }
+  resp->minor = minor;
+  resp->status = status;
+  return true;
+}
+
+/* addHeader: split "Name: value" and remember it; a line starting with
+ * a blank continues the previous header's value (obsolete line folding).
+ */
+static bool
+addHeader(http_response_t* resp)
+{
+  char* line = resp->line;
+  if (*line == ' ' || *line == '\t') {
+    if (resp->numHeaders == 0) {
+      return false;
+    }
+    header_t* last = &resp->headers[resp->numHeaders - 1];
+    while (*line == ' ' || *line == '\t') {
+      line++;
+    }
+    size_t oldLen = strlen(last->value);
+    char* value = realloc(last->value, oldLen + strlen(line) + 2);
+    if (value == NULL) {
+      return false;
+    }
+    sprintf(value + oldLen, " %s", line);
+    last->value = value;
+    return true;
+  }
+
+  char* colon = strchr(line, ':');
+  if (colon == NULL || colon == line || resp->numHeaders >= MAX_HEADERS) {
+    return false;
+  }
+  if (resp->numHeaders == resp->headerCap) {
+    int cap = resp->headerCap ? resp->headerCap * 2 : 16;
+    header_t* headers = realloc(resp->headers, cap * sizeof(header_t));
+    if (headers == NULL) {
+      return false;
+    }
+    resp->headers = headers;
+    resp->headerCap = cap;
+  }
+
+  // trim blanks around the value
+  char* value = colon + 1;
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  char* end = value + strlen(value);
+  while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+    end--;
+  }
+
+  header_t* h = &resp->headers[resp->numHeaders];
+  h->name = strndup(line, colon - line);
+  h->value = strndup(value, end - value);
+  if (h->name == NULL || h->value == NULL) {
+    free(h->name);
+    free(h->value);
+    return false;
+  }
+  resp->numHeaders++;
+  return true;
+}
+
+/* clearHeaders: forget all headers, keeping the array */
+static void
+clearHeaders(http_response_t* resp)
+{
+  for (int i = 0; i < resp->numHeaders; i++) {
+    free(resp->headers[i].name);
+    free(resp->headers[i].value);
+  }
+  resp->numHeaders = 0;
+}
+
+/* headersDone: the blank line ended the headers; decide how the body
+ * is framed.
+ */
+static void
+headersDone(http_response_t* resp)
+{
+  if (resp->status >= 100 && resp->status < 200) {
+    // interim response (e.g., 100 Continue); the real one follows
+    clearHeaders(resp);
+    resp->status = 0;
+    resp->phase = P_STATUS;
+    return;
+  }
+  if (resp->status == 204 || resp->status == 304) {
+    resp->phase = P_DONE;             // these never carry a body
+    return;
+  }
+  if (!startDecoding(resp)) {
+    resp->phase = P_ERROR;
+    return;
+  }
+  if (headerHas(resp, "Transfer-Encoding", "chunked")) {
+    resp->phase = P_CHUNKSIZE;
+    return;
+  }
+  const char* length = http_response_header(resp, "Content-Length");
+  if (length != NULL) {
+    char* end;
+    unsigned long long n = strtoull(length, &end, 10);
+    if (end == length || *end != '\0') {
+      resp->phase = P_ERROR;
+    } else if (n == 0) {
+      resp->phase = P_DONE;
+    } else if (resp->inflater != NULL
+               && !reserveBody(resp, n < MAX_PRESIZE / CODED_RATIO
+                                     ? n * CODED_RATIO : MAX_PRESIZE, false)) {
+      resp->phase = P_ERROR;
+    } else if (resp->inflater == NULL
+               && !reserveBody(resp, n < MAX_PRESIZE ? n : MAX_PRESIZE, true)) {
+      resp->phase = P_ERROR;
+    } else {
+      resp->remaining = (size_t) n;
+      resp->phase = P_BODY;
+    }
+    return;
+  }
+  resp->phase = P_EOFBODY;
+}
+
+/* reserveBody: make room for a body of len bytes (plus its null).
+ * With 'exact', len is the declared size of the whole body, so allocate
+ * just that; otherwise at least double, so growth stays linear overall.
+ * Callers reserving for a declared size believe it only up to
+ * MAX_PRESIZE; a bigger body still fits, by doubling, as it arrives.
+ */
+static bool
+reserveBody(http_response_t* resp, size_t len, const bool exact)
+{
+  if (len + 1 <= resp->bodyCap) {
+    return true;
+  }
+  size_t cap = len + 1;
+  if (!exact) {
+    size_t doubled = resp->bodyCap ? resp->bodyCap * 2 : FIRST_BODY;
+    if (cap < doubled) {
+      cap = doubled;
+    }
+  }
+  char* body = realloc(resp->body, cap);
+  if (body == NULL) {
+    return false;
+  }
+  resp->body = body;
+  resp->bodyCap = cap;
+  return true;
+}
+
+/* appendBody: add bytes to the body, growing it as needed */
+static bool
+appendBody(http_response_t* resp, const char* data, const size_t len)
+{
+  if (resp->bodyLen + len + 1 > resp->bodyCap
+      && !reserveBody(resp, resp->bodyLen + len, false)) {
+    return false;
+  }
+  memcpy(resp->body + resp->bodyLen, data, len);
+  resp->bodyLen += len;
+  resp->body[resp->bodyLen] = '\0';
+  return true;
+}
+
+/* startDecoding: if the body is gzip- or deflate-coded, set up an
+ * inflater for it, and drop Content-Encoding, which will no longer hold
+ * once the body is decoded; false if out of memory.  Any other coding
+ * (which we never ask for), or more than one coding applied in turn
+ * ("gzip, br"), is left alone, and the body kept as it came.
+ */
+static bool
+startDecoding(http_response_t* resp)
+{
+  const char* coding = NULL;
+  for (int i = 0; i < resp->numHeaders; i++) {
+    if (strcasecmp(resp->headers[i].name, "Content-Encoding") == 0) {
+      if (coding != NULL || strchr(resp->headers[i].value, ',') != NULL) {
+        return true;                  // stacked codings
+      }
+      coding = resp->headers[i].value;
+    }
+  }
+  if (coding == NULL
+      || (strcasecmp(coding, "gzip") != 0 && strcasecmp(coding, "x-gzip") != 0
+          && strcasecmp(coding, "deflate") != 0)) {
+    return true;
+  }
+  // "deflate" should be a zlib stream, but many servers send it raw
+  resp->mayBeRaw = strcasecmp(coding, "deflate") == 0;
+  resp->inflater = calloc(1, sizeof(z_stream));
+  // 15 + 32: the largest window, with a gzip or zlib wrapper, detected
+  if (resp->inflater == NULL || inflateInit2(resp->inflater, 15 + 32) != Z_OK) {
+    free(resp->inflater);
+    resp->inflater = NULL;
+    return false;
+  }
+  for (int i = 0; i < resp->numHeaders; i++) {
+    if (strcasecmp(resp->headers[i].name, "Content-Encoding") == 0) {
+      free(resp->headers[i].name);
+      free(resp->headers[i].value);
+      memmove(&resp->headers[i], &resp->headers[i + 1],
+              (resp->numHeaders - i - 1) * sizeof(header_t));
+      resp->numHeaders--;
+      i--;
+    }
+  }
+  return true;
+}
+
+/* decodeBody: add body bytes, as they came on the wire, to the body;
+ * through the inflater if there is one.  Bytes after the end of the
+ * coded stream are ignored.  False if the coding is damaged, if it
+ * decodes to more than MAX_DECODED bytes, or if out of memory.
+ *
+ * A deflate-coded body whose first two bytes are not a zlib header is
+ * started over as raw deflate, once; the header is checked within those
+ * two bytes, so only the first byte can have come in an earlier call.
+ */
+static bool
+decodeBody(http_response_t* resp, const char* data, const size_t len)
+{
+  z_stream* z = resp->inflater;
+  if (z == NULL) {
+    return appendBody(resp, data, len);
+  }
+  if (resp->inflated || len == 0) {
+    return true;
+  }
+  uLong before = z->total_in;
+  if (before == 0) {
+    resp->firstByte = (Bytef) data[0];
+  }
+  z->next_in = (Bytef*) data;
+  z->avail_in = len;
+  do {
+    if (resp->bodyLen >= MAX_DECODED) {
+      return false;                   // far more than any page: a bomb
+    }
+    if (resp->bodyCap - resp->bodyLen < FIRST_BODY
+        && !reserveBody(resp, resp->bodyLen + FIRST_BODY, false)) {
+      return false;
+    }
+    size_t room = resp->bodyCap - resp->bodyLen - 1;    // room for the null
+    if (room > MAX_DECODED - resp->bodyLen) {
+      room = MAX_DECODED - resp->bodyLen;
+    }
+    z->next_out = (Bytef*) resp->body + resp->bodyLen;
+    z->avail_out = room;
+    int status = inflate(z, Z_NO_FLUSH);
+    resp->bodyLen += room - z->avail_out;
+    resp->body[resp->bodyLen] = '\0';
+    if (status == Z_DATA_ERROR && resp->mayBeRaw && z->total_out == 0
+        && before <= 1) {
+      // no zlib header: start over, without one
+      resp->mayBeRaw = false;
+      if (inflateReset2(z, -15) != Z_OK) {
+        return false;
+      }
+      if (before == 1) {
+        z->next_in = &resp->firstByte;
+        z->avail_in = 1;
+        if (inflate(z, Z_NO_FLUSH) != Z_OK) {
+          return false;
+        }
+      }
+      z->next_in = (Bytef*) data;
+      z->avail_in = len;
+      continue;
+    }
+    if (status == Z_STREAM_END) {
+      resp->inflated = true;
+    } else if (status != Z_OK && status != Z_BUF_ERROR) {
+      return false;
+    }
+    // a full output buffer may leave more to come out, even with no input
+  } while (!resp->inflated && (z->avail_in > 0 || z->avail_out == 0));
+  if (resp->bodyLen >= MAX_DECODED && !resp->inflated) {
+    return false;
+  }
+  return true;
+}
+
+/* finishBody: the body is all in; false if its coded stream was cut
+ * short.  An empty body is fine, coded or not.
+ */
+static bool
+finishBody(http_response_t* resp)
+{
+  z_stream* z = resp->inflater;
+  if (z == NULL) {
+    return true;
+  }
+  bool ok = resp->inflated || z->total_in == 0;
+  inflateEnd(z);
+  free(z);
+  resp->inflater = NULL;
+  return ok;
+}
+
+/* headerHas: does the named header's comma-separated value list contain
+ * the given token (case-insensitive)?
+ */
+static bool
+headerHas(const http_response_t* resp, const char* name, const char* token)
+{
+  const char* value = http_response_header(resp, name);
+  if (value == NULL) {
+    return false;
+  }
+  size_t tlen = strlen(token);
+  for (const char* p = value; *p != '\0'; ) {
+    while (*p == ' ' || *p == '\t' || *p == ',') {
+      p++;
+    }
+    size_t n = strcspn(p, ", \t;");
+    if (n == tlen && strncasecmp(p, token, tlen) == 0) {
+      return true;
+    }
+    p += n;
+    while (*p != '\0' && *p != ',') {
+      p++;                            // skip any ;parameters
+    }
+  }
+  return false;
+}
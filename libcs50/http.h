@@ -0,0 +1,162 @@
+/*
+ * http - incremental parser for HTTP/1.x responses
+ *
+ * An http_response_t is fed the bytes of one response as they arrive,
+ * in pieces of any size, and works out for itself where the status line,
+ * the headers and the body begin and end.  The body may be delimited by
+ * Content-Length, by chunked transfer-coding, or by the server closing
+ * the connection; in every case the caller ends up with the plain body
+ * in one null-terminated buffer.
+ *
+ * Requests ask for gzip or deflate content-coding.  A body that comes
+ * coded is decoded (with zlib) as it arrives, and its Content-Encoding
+ * header dropped, so from then on the response reads as if the server
+ * had sent the page plain: the body, the headers, and the message that
+ * http_response_message writes back out.  A deflate body without the
+ * zlib wrapper, as some servers send it, is decoded too.  A coded body
+ * that decodes to more than 64MB is an error.  A body with several
+ * codings applied in turn ("gzip, br") is kept as it came, header and all.
+ *
+ * Because it never blocks and never reads from a socket itself, the same
+ * parser serves both the blocking webpage_fetch() and the event-driven
+ * fetchloop module.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __HTTP_H
+#define __HTTP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**************** global types ****************/
+typedef struct http_response http_response_t;  // opaque to users of the module
+
+/* result of feeding bytes to the parser */
+typedef enum {
+  HTTP_MORE,     // response incomplete; feed more bytes
+  HTTP_DONE,     // response complete; later bytes belong to someone else
+  HTTP_ERROR,    // malformed response; discard it and the connection
+} http_state_t;
+
+/**************** http_response_new ****************/
+/* Create a parser for one response.
+ *
+ * We return:
+ *   pointer to a new parser, or NULL if out of memory.
+ * Caller is responsible for:
+ *   later calling http_response_delete.
+ */
+http_response_t* http_response_new(void);
+
+/**************** http_response_feed ****************/
+/* Feed the next 'len' bytes of the response.
+ *
+ * Caller provides:
+ *   valid parser; data pointing to len readable bytes (len may be 0).
+ *   used, if not NULL, receives the number of bytes the parser consumed;
+ *   this is less than len only when the response completed early.
+ * We return:
+ *   HTTP_MORE, HTTP_DONE or HTTP_ERROR, as above.
+ *   Once DONE or ERROR, further calls consume nothing and return the same.
+ */
+http_state_t http_response_feed(http_response_t* resp, const char* data,
+                                const size_t len, size_t* used);
+
+/**************** http_response_eof ****************/
+/* Tell the parser that the server closed the connection.
+ *
+ * We return:
+ *   HTTP_DONE if the body was delimited by the close (no Content-Length,
+ *   not chunked), or the response was already complete;
+ *   HTTP_ERROR if the response had been cut short.
+ */
+http_state_t http_response_eof(http_response_t* resp);
+
+/**************** http_response_status ****************/
+/* Return the status code (e.g., 200), or 0 if the status line has not
+ * been parsed yet.
+ */
+int http_response_status(const http_response_t* resp);
+
+/**************** http_response_header ****************/
+/* Return the value of the named header (case-insensitive), or NULL.
+ *
+ * The returned string belongs to the parser and lives until
+ * http_response_delete.  Leading and trailing blanks are removed.
+ * If a header appears more than once, the first one wins.
+ */
+const char* http_response_header(const http_response_t* resp, const char* name);
+
+/**************** http_response_keepAlive ****************/
+/* Return true if, once DONE, the connection may carry another request:
+ * the body was self-delimited and the server did not ask to close.
+ */
+bool http_response_keepAlive(const http_response_t* resp);
+
+/**************** http_response_takeBody ****************/
+/* Hand the body over to the caller.
+ *
+ * We return:
+ *   a malloc'd, null-terminated buffer holding the body (possibly empty),
+ *   and its length in *len if len is not NULL; NULL if out of memory.
+ * Caller is responsible for:
+ *   later free()ing the buffer; the parser no longer refers to it.
+ */
+char* http_response_takeBody(http_response_t* resp, size_t* len);
+
+/**************** http_response_message ****************/
+/* Write a complete response back out as one HTTP/1.1 message.
+ *
+ * Caller provides:
+ *   a parser that has returned HTTP_DONE, whose body has not been taken.
+ * We return:
+ *   a malloc'd buffer holding the status line, the headers and the body,
+ *   and its length in *len; NULL if the response is not complete, or if
+ *   out of memory.  The body is framed by Content-Length, whatever framed
+ *   it on the wire, so feeding the message to a new parser gives back the
+ *   same status, headers and body.  The reason phrase is not kept.
+ * Caller is responsible for:
+ *   later free()ing the buffer.
+ */
+char* http_response_message(const http_response_t* resp, size_t* len);
+
+/**************** http_response_delete ****************/
+/* Free the parser and anything it still holds.  NULL is ignored. */
+void http_response_delete(http_response_t* resp);
+
+/**************** http_splitURL ****************/
+/* Split an absolute http URL into its hostname, port and pathname.
+ *
+ * Caller provides:
+ *   url of the form http://host[:port][/pathname], already normalized.
+ * We return:
+ *   true on success, with *hostname and *pathname pointing to new strings
+ *   and *port set (80 if the URL names none); false otherwise.
+ * Caller is responsible for:
+ *   free()ing *hostname and *pathname after a successful call.
+ */
+bool http_splitURL(const char* url, char** hostname, int* port, char** pathname);
+
+/**************** http_request ****************/
+/* Build a GET request.
+ *
+ * Caller provides:
+ *   hostname and pathname, as from http_splitURL;
+ *   keepAlive, whether to ask the server to keep the connection open;
+ *   etag and lastModified, validators from an earlier fetch of the page,
+ *   or NULL; each one given is sent as If-None-Match or If-Modified-Since
+ *   respectively, so the server may answer 304 if the page is unchanged.
+ *   The request always carries Accept-Encoding: gzip, deflate.
+ * We return:
+ *   the request as a malloc'd string; NULL if out of memory, or if any
+ *   argument holds a CR or LF.
+ * Caller is responsible for:
+ *   later free()ing the request.
+ */
+char* http_request(const char* hostname, const char* pathname, const bool keepAlive,
+                   const char* etag, const char* lastModified);
+
+#endif // __HTTP_H
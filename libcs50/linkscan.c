@@ -0,0 +1,214 @@
+/*
+ * linkscan.c - find the start of links in HTML, many bytes at a time
+ *
+ * see linkscan.h for more information.
+ *
+ * Each pattern is found in two steps.  A fast pass looks for its first
+ * two characters -- '<' then 'a', or 'h' then 'r' -- or for the first
+ * followed by whitespace, which covers a pattern broken up by spaces.
+ * Each candidate is then checked byte by byte, and the search goes on
+ * after it if the rest does not match.  In HTML most '<' open some other
+ * tag, so the fast pass skips nearly all of them.
+ *
+ * The vector passes compare a block of bytes at p, and the block one byte
+ * further on, with the characters wanted; the second block may read the
+ * NUL at 'end', but never past it.  The few bytes left over at the end of
+ * the HTML are tested one at a time.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "linkscan.h"
+
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(LINKSCAN_SCALAR)
+#include <immintrin.h>
+#define LINKSCAN_X86
+#ifndef LINKSCAN_SSE2
+#define LINKSCAN_AVX2
+#endif
+#endif
+
+/**************** local functions ****************/
+/* not visible outside this file */
+static bool isSpace(const char c);
+static const char* skipSpace(const char* p);
+static const char* findPair(const char* p, const char* end,
+                            const char fold, const char first, const char second);
+static const char* pairScalar(const char* p, const char* end,
+                              const char fold, const char first, const char second);
+#ifdef LINKSCAN_X86
+static const char* pairSSE2(const char* p, const char* end,
+                            const char fold, const char first, const char second);
+#endif
+#ifdef LINKSCAN_AVX2
+static const char* pairAVX2(const char* p, const char* end,
+                            const char fold, const char first, const char second);
+#endif
+
+/**************** linkscan_anchor ****************/
+/* see linkscan.h for description */
+const char*
+linkscan_anchor(const char* from, const char* end)
+{
+  if (from == NULL || end == NULL) {
+    return NULL;
+  }
+  for (const char* p = from; (p = findPair(p, end, 0, '<', 'a')) != NULL; p++) {
+    if ((*skipSpace(p + 1) | 0x20) == 'a') {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+/**************** linkscan_href ****************/
+/* see linkscan.h for description */
+const char*
+linkscan_href(const char* from, const char* end, const char** value)
+{
+  static const char pattern[] = "href=";
+
+  if (from == NULL || end == NULL || value == NULL) {
+    return NULL;
+  }
+  for (const char* p = from; (p = findPair(p, end, 0x20, 'h', 'r')) != NULL; p++) {
+    const char* q = p + 1;
+    int i;
+    for (i = 1; pattern[i] != '\0'; i++) {
+      q = skipSpace(q);
+      // fold letters to lower case, but not the '=' (0x1d would fold to it)
+      char c = (pattern[i] == '=') ? *q : (*q | 0x20);
+      if (c != pattern[i]) {
+        break;
+      }
+      q++;
+    }
+    if (pattern[i] == '\0') {
+      *value = q;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+/**************** isSpace ****************/
+/* whether c is whitespace, as isspace() has it in the C locale */
+static bool
+isSpace(const char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**************** skipSpace ****************/
+/* the first non-whitespace character at or after p; the NUL ends it */
+static const char*
+skipSpace(const char* p)
+{
+  while (isSpace(*p)) {
+    p++;
+  }
+  return p;
+}
+
+/**************** findPair ****************/
+/* The first p in [p, end) where (p[0] | fold) == first, and p[1] is
+ * 'second' in either case or is whitespace; or NULL if none.
+ * 'second' must be a lower-case letter.
+ */
+static const char*
+findPair(const char* p, const char* end,
+         const char fold, const char first, const char second)
+{
+#ifdef LINKSCAN_X86
+#ifdef LINKSCAN_AVX2
+  if (__builtin_cpu_supports("avx2")) {
+    return pairAVX2(p, end, fold, first, second);
+  }
+#endif
+  return pairSSE2(p, end, fold, first, second);
+#else
+  return pairScalar(p, end, fold, first, second);
+#endif
+}
+
+/**************** pairScalar ****************/
+/* findPair, one byte at a time */
+static const char*
+pairScalar(const char* p, const char* end,
+           const char fold, const char first, const char second)
+{
+  for (; p < end; p++) {
+    if ((p[0] | fold) == first && ((p[1] | 0x20) == second || isSpace(p[1]))) {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#ifdef LINKSCAN_X86
+/**************** pairSSE2 ****************/
+/* findPair, 16 bytes at a time */
+static const char*
+pairSSE2(const char* p, const char* end,
+         const char fold, const char first, const char second)
+{
+  const __m128i vfold = _mm_set1_epi8(fold);
+  const __m128i vfirst = _mm_set1_epi8(first);
+  const __m128i vlower = _mm_set1_epi8(0x20);
+  const __m128i vsecond = _mm_set1_epi8(second);
+  const __m128i vspace = _mm_set1_epi8(' ');
+  const __m128i vtab = _mm_set1_epi8('\t');
+  const __m128i vspan = _mm_set1_epi8('\r' - '\t');
+
+  for (; end - p >= 16; p += 16) {
+    __m128i here = _mm_loadu_si128((const __m128i*)p);
+    __m128i next = _mm_loadu_si128((const __m128i*)(p + 1));
+    __m128i isFirst = _mm_cmpeq_epi8(_mm_or_si128(here, vfold), vfirst);
+    // '\t' to '\r' are those for which next - '\t', unsigned, is at most the span
+    __m128i offset = _mm_sub_epi8(next, vtab);
+    __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(offset, vspan), offset);
+    __m128i isSecond = _mm_or_si128(_mm_cmpeq_epi8(_mm_or_si128(next, vlower), vsecond),
+                                    _mm_or_si128(_mm_cmpeq_epi8(next, vspace), isControl));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_and_si128(isFirst, isSecond));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return pairScalar(p, end, fold, first, second);
+}
+#endif
+
+#ifdef LINKSCAN_AVX2
+/**************** pairAVX2 ****************/
+/* findPair, 32 bytes at a time; called only on CPUs with AVX2 */
+__attribute__((target("avx2")))
+static const char*
+pairAVX2(const char* p, const char* end,
+         const char fold, const char first, const char second)
+{
+  const __m256i vfold = _mm256_set1_epi8(fold);
+  const __m256i vfirst = _mm256_set1_epi8(first);
+  const __m256i vlower = _mm256_set1_epi8(0x20);
+  const __m256i vsecond = _mm256_set1_epi8(second);
+  const __m256i vspace = _mm256_set1_epi8(' ');
+  const __m256i vtab = _mm256_set1_epi8('\t');
+  const __m256i vspan = _mm256_set1_epi8('\r' - '\t');
+
+  for (; end - p >= 32; p += 32) {
+    __m256i here = _mm256_loadu_si256((const __m256i*)p);
+    __m256i next = _mm256_loadu_si256((const __m256i*)(p + 1));
+    __m256i isFirst = _mm256_cmpeq_epi8(_mm256_or_si256(here, vfold), vfirst);
+    __m256i offset = _mm256_sub_epi8(next, vtab);
+    __m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, vspan), offset);
+    __m256i isSecond = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_or_si256(next, vlower), vsecond),
+                                       _mm256_or_si256(_mm256_cmpeq_epi8(next, vspace), isControl));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(isFirst, isSecond));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return pairSSE2(p, end, fold, first, second);
+}
+#endif
@@ -0,0 +1,47 @@
+/*
+ * linkscan.h - header file for the 'linkscan' module
+ *
+ * 'linkscan' finds the two patterns that mark a link in HTML -- the "<a"
+ * that opens an anchor and the "href=" within it -- many bytes at a time.
+ * Both are matched the way webpage_getNextURL matches them once it has
+ * squeezed the whitespace out of the page: case-insensitively, and with
+ * any whitespace allowed between their characters.  The HTML is never
+ * changed.
+ *
+ * On x86-64 the search tests 32 bytes at a time with AVX2 where the CPU
+ * has it, and 16 at a time with SSE2 where not, or when built with
+ * -DLINKSCAN_SSE2; elsewhere, or when built with -DLINKSCAN_SCALAR, it
+ * tests one byte at a time.  Every way finds the same matches, which
+ * linkscantest.c checks by building each of them.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __LINKSCAN_H
+#define __LINKSCAN_H
+
+/**************** linkscan_anchor ****************/
+/* Find the first "<a" at or after 'from'.
+ *
+ * Caller provides:
+ *   from <= end, where *end is the NUL that ends the HTML.
+ * We return:
+ *   pointer to the '<' of the first "<a" or "<A" in [from, end), which
+ *   may have whitespace between its '<' and its 'a'; or NULL if none.
+ */
+const char* linkscan_anchor(const char* from, const char* end);
+
+/**************** linkscan_href ****************/
+/* Find the first "href=" at or after 'from'.
+ *
+ * Caller provides:
+ *   from <= end, where *end is the NUL that ends the HTML;
+ *   value, where we store the end of the match.
+ * We return:
+ *   pointer to the 'h' of the first "href=", in any case and with any
+ *   whitespace between its characters, in [from, end), and *value just
+ *   after its '='; or NULL if none.
+ */
+const char* linkscan_href(const char* from, const char* end, const char** value);
+
+#endif // __LINKSCAN_H
@@ -0,0 +1,151 @@
+/*
+ * linkscantest.c - test program for the 'linkscan' module
+ *
+ * usage: ./linkscantest
+ *
+ * Scans some edge-case HTML for every "<a" and "href=" in it, and prints
+ * where each match starts (and, for "href=", where its value starts), one
+ * line per case.  It then scans a few short pieces of HTML placed after
+ * every number of bytes from 0 to 95, so each piece falls at every spot of
+ * a 16- and 32-byte block and ends its buffer exactly, and prints what
+ * those scans found in all.
+ *
+ * The Makefile builds it three ways: as linkscan.c is built for the
+ * crawler (linkscantest), with -DLINKSCAN_SSE2 (linkscantest-sse2) and
+ * with -DLINKSCAN_SCALAR (linkscantest-scalar).  Every way should print
+ * the same.
+ *
+ * CS50 TSE, 2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "linkscan.h"
+
+/* edge cases: each buffer ends where its string does */
+static const char* cases[] = {
+  "<a href=\"A.html\">A</a>",
+  "< a href = \"B.html\">B</a>",
+  "<\tA\n HREF\t=\r\n'C.html'>C</A>",
+  "<\v a \f h r e f = D.html>",
+  "<abbr title=x><area href=E.html>",
+  "<b>h r e f = not in an anchor</b><p>ahref=</p>",
+  "<a hre=F.html><a hreff=G.html><a href H.html>",
+  "<p>\xff\xe1\xc1<\x81 hr\xc5" "f=</p>",
+  "text ending in <",
+  "text ending in <a",
+  "text ending in < \n\t",
+  "<a href=",
+  "<a hre",
+  "",
+};
+
+/* pieces placed after each number of bytes */
+static const char* pieces[] = {
+  "<a href=u>",
+  "< a\thref =u",
+  "<A",
+  "<",
+  "href=",
+  "h\nREF\r=",
+  "hr",
+};
+static const int MAX_PADDING = 96;
+static const int CASES = sizeof(cases) / sizeof(cases[0]);
+static const int PIECES = sizeof(pieces) / sizeof(pieces[0]);
+
+/**************** local functions ****************/
+static char* copy(const char* text, const int padding);
+static int scan(const char* html, const int padding, const bool print);
+
+int
+main(void)
+{
+  for (int i = 0; i < CASES; i++) {
+    char* html = copy(cases[i], 0);
+    if (html == NULL) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    printf("case %d:", i + 1);
+    scan(html, 0, true);
+    printf("\n");
+    free(html);
+  }
+
+  int matches = 0;
+  for (int i = 0; i < PIECES; i++) {
+    for (int padding = 0; padding < MAX_PADDING; padding++) {
+      char* html = copy(pieces[i], padding);
+      if (html == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+      }
+      matches += scan(html, padding, false);
+      free(html);
+    }
+  }
+  printf("%d pieces after 0 to %d bytes: %d matches, none in the padding\n",
+         PIECES, MAX_PADDING - 1, matches);
+  return 0;
+}
+
+/**************** copy ****************/
+/* A buffer of exactly padding bytes of text and then the given text,
+ * with its NUL; so a scan that reads past the NUL reads past the buffer.
+ * The padding holds no pattern.  NULL if out of memory.
+ */
+static char*
+copy(const char* text, const int padding)
+{
+  size_t length = strlen(text);
+  char* html = malloc(padding + length + 1);
+  if (html != NULL) {
+    for (int i = 0; i < padding; i++) {
+      html[i] = "lorem ipsum, <p>dolor sit.\n"[i % 27];
+    }
+    memcpy(html + padding, text, length + 1);
+  }
+  return html;
+}
+
+/**************** scan ****************/
+/* Finds every "<a" and "href=" in html; prints them if asked, and
+ * otherwise checks that none starts before 'padding'.
+ * Returns the number found, or fails the test if one is misplaced.
+ */
+static int
+scan(const char* html, const int padding, const bool print)
+{
+  const char* end = html + strlen(html);
+  const char* p;
+  int found = 0;
+
+  if (print) {
+    printf(" anchors");
+  }
+  for (p = html; (p = linkscan_anchor(p, end)) != NULL; p++, found++) {
+    if (print) {
+      printf(" %ld", (long)(p - html));
+    } else if (p - html < padding) {
+      fprintf(stderr, "\"<a\" found at %ld in the padding\n", (long)(p - html));
+      exit(2);
+    }
+  }
+
+  if (print) {
+    printf("; hrefs");
+  }
+  const char* value;
+  for (p = html; (p = linkscan_href(p, end, &value)) != NULL; p++, found++) {
+    if (print) {
+      printf(" %ld=%ld", (long)(p - html), (long)(value - html));
+    } else if (p - html < padding) {
+      fprintf(stderr, "\"href=\" found at %ld in the padding\n", (long)(p - html));
+      exit(2);
+    }
+  }
+  return found;
+}
@@ -0,0 +1,221 @@
+/*
+ * resolver - process-wide cache of hostname lookups
+ *
+ * See resolver.h for usage.
+ *
+ * The cache is a fixed array of hash buckets, each a list of entries,
+ * all under one mutex.  An entry is never freed once made (a crawl meets
+ * few distinct hosts); when it expires it is simply refreshed in place.
+ * While one thread refreshes an entry, the entry is marked 'resolving'
+ * and any other thread wanting that host waits on a condition variable
+ * rather than starting a lookup of its own.  The lookup itself runs
+ * outside the mutex, so lookups of different hosts overlap.
+ *
+ * CS50 TSE, 2024
+ */
+
+#define _GNU_SOURCE       // strdup
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "resolver.h"
+#include "hash.h"
+
+/**************** file-local types ****************/
+typedef struct entry {
+  char* hostname;               // the name looked up
+  struct in_addr ip;            // its address, if 'found'
+  bool found;                   // did the name resolve?
+  bool resolving;               // is some thread looking it up right now?
+  double expires;               // when the answer goes stale
+  struct entry* next;           // next in the bucket
+} entry_t;
+
+/**************** file-local constants ****************/
+static const int BUCKETS = 257;         // hash buckets
+static const double BUSY_TTL = 5;       // cache 'name server busy' this long
+
+/**************** file-local global variables ****************/
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolved = PTHREAD_COND_INITIALIZER;
+static entry_t** table = NULL;          // BUCKETS lists, made on first use
+
+/**************** local functions ****************/
+static entry_t* findEntry(const char* hostname);
+static bool resolve(const char* hostname, struct in_addr* ip, double* ttl);
+static double now(void);
+
+/**************** resolver_lookup ****************/
+/* see resolver.h for description */
+bool
+resolver_lookup(const char* hostname, const int port, struct sockaddr_in* addr)
+{
+  if (hostname == NULL || addr == NULL || port < 0 || port > 65535) {
+    return false;
+  }
+
+  pthread_mutex_lock(&lock);
+  entry_t* entry = findEntry(hostname);
+  if (entry == NULL) {
+    // out of memory: just look it up, uncached
+    pthread_mutex_unlock(&lock);
+    double ttl;
+    struct in_addr ip;
+    bool found = resolve(hostname, &ip, &ttl);
+    if (found) {
+      memset(addr, 0, sizeof(*addr));
+      addr->sin_family = AF_INET;
+      addr->sin_addr = ip;
+      addr->sin_port = htons(port);
+    }
+    return found;
+  }
+
+  // wait out any lookup of this host already under way
+  while (entry->resolving) {
+    pthread_cond_wait(&resolved, &lock);
+  }
+
+  if (entry->expires <= now()) {
+    // missing or stale: look it up ourselves, without holding the lock
+    entry->resolving = true;
+    pthread_mutex_unlock(&lock);
+    double ttl;
+    struct in_addr ip;
+    bool found = resolve(hostname, &ip, &ttl);
+    pthread_mutex_lock(&lock);
+    entry->found = found;
+    entry->ip = ip;
+    entry->expires = now() + ttl;
+    entry->resolving = false;
+    pthread_cond_broadcast(&resolved);
+  }
+
+  bool found = entry->found;
+  if (found) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr = entry->ip;
+    addr->sin_port = htons(port);
+  }
+  pthread_mutex_unlock(&lock);
+  return found;
+}
+
+/**************** resolver_cached ****************/
+/* see resolver.h for description */
+bool
+resolver_cached(const char* hostname, const int port, struct sockaddr_in* addr,
+                bool* found)
+{
+  if (hostname == NULL || addr == NULL || found == NULL || port < 0 || port > 65535) {
+    return false;
+  }
+
+  pthread_mutex_lock(&lock);
+  entry_t* entry = findEntry(hostname);
+  bool fresh = entry != NULL && !entry->resolving && entry->expires > now();
+  if (fresh) {
+    *found = entry->found;
+    if (entry->found) {
+      memset(addr, 0, sizeof(*addr));
+      addr->sin_family = AF_INET;
+      addr->sin_addr = entry->ip;
+      addr->sin_port = htons(port);
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  return fresh;
+}
+
+/**************** resolver_flush ****************/
+/* see resolver.h for description */
+void
+resolver_flush(void)
+{
+  pthread_mutex_lock(&lock);
+  for (int b = 0; table != NULL && b < BUCKETS; b++) {
+    for (entry_t* entry = table[b]; entry != NULL; entry = entry->next) {
+      if (!entry->resolving) {
+        entry->expires = 0;
+      }
+    }
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+/**************** local functions ****************/
+
+/* findEntry: return the entry for hostname, adding an expired one if
+ * there is none yet; NULL if out of memory.  Caller holds the lock.
+ */
+static entry_t*
+findEntry(const char* hostname)
+{
+  if (table == NULL) {
+    table = calloc(BUCKETS, sizeof(entry_t*));
+    if (table == NULL) {
+      return NULL;
+    }
+  }
+
+  unsigned long b = hash_jenkins(hostname, BUCKETS);
+  for (entry_t* entry = table[b]; entry != NULL; entry = entry->next) {
+    if (strcmp(entry->hostname, hostname) == 0) {
+      return entry;
+    }
+  }
+
+  entry_t* entry = calloc(1, sizeof(entry_t));
+  if (entry == NULL || (entry->hostname = strdup(hostname)) == NULL) {
+    free(entry);
+    return NULL;
+  }
+  entry->next = table[b];
+  table[b] = entry;
+  return entry;
+}
+
+/* resolve: ask the system for the IPv4 address of hostname.
+ * Sets *ip if found, and *ttl to how long the answer may be kept.
+ */
+static bool
+resolve(const char* hostname, struct in_addr* ip, double* ttl)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* hostp = NULL;
+
+  int err = getaddrinfo(hostname, NULL, &hints, &hostp);
+  if (err == 0 && hostp != NULL) {
+    *ip = ((struct sockaddr_in*) hostp->ai_addr)->sin_addr;
+    freeaddrinfo(hostp);
+    *ttl = RESOLVER_TTL;
+    return true;
+  }
+
+  memset(ip, 0, sizeof(*ip));
+  // a name server that is busy or out of reach may answer soon;
+  // a name that does not exist will not
+  *ttl = (err == EAI_AGAIN || err == EAI_SYSTEM || err == EAI_MEMORY)
+    ? BUSY_TTL : RESOLVER_NEGATIVE_TTL;
+  return false;
+}
+
+/* now: monotonic time in seconds */
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,63 @@
+/*
+ * resolver - process-wide cache of hostname lookups
+ *
+ * A crawler contacts the same few hosts over and over; looking each one
+ * up again for every fetch (and every retry) wastes time and can stall
+ * the fetch behind a slow name server.  The resolver remembers each
+ * answer for a while: a hit costs one hash lookup under a mutex and never
+ * touches the network.  Names that fail to resolve are remembered too,
+ * so fetches to a bad host fail fast instead of asking again.
+ *
+ * One cache serves the whole process, and every function may be called
+ * from any thread.  When several threads want the same uncached name at
+ * once, only one of them asks; the others wait for its answer.
+ *
+ * CS50 TSE, 2024
+ */
+
+#ifndef __RESOLVER_H
+#define __RESOLVER_H
+
+#include <stdbool.h>
+#include <netinet/in.h>
+
+/**************** resolver_lookup ****************/
+/* Find the IPv4 address of a host.
+ *
+ * Caller provides:
+ *   hostname, e.g., "cs50tse.cs.dartmouth.edu" (or a dotted address);
+ *   port, in host byte order; addr pointing to a sockaddr_in to fill in.
+ * We return:
+ *   true, with *addr ready to pass to connect(), if the name resolves;
+ *   false if it does not, or arguments are bad.
+ * We guarantee:
+ *   answers are cached for RESOLVER_TTL seconds, failures for
+ *   RESOLVER_NEGATIVE_TTL seconds (less if the name server was merely
+ *   unavailable), so the result may be up to that old.
+ */
+bool resolver_lookup(const char* hostname, const int port, struct sockaddr_in* addr);
+
+/**************** resolver_cached ****************/
+/* Answer from the cache alone, without ever waiting.
+ *
+ * Caller provides:
+ *   hostname, port and addr as for resolver_lookup; found pointing to a
+ *   bool.
+ * We return:
+ *   true if the cache holds a fresh answer, with *found set to it (and
+ *   *addr filled in if the name resolves); false if the answer would
+ *   need a lookup, or arguments are bad -- call resolver_lookup, from a
+ *   thread that may block.
+ */
+bool resolver_cached(const char* hostname, const int port, struct sockaddr_in* addr,
+                     bool* found);
+
+/**************** resolver_flush ****************/
+/* Forget every cached answer.  Lookups in progress are not disturbed. */
+void resolver_flush(void);
+
+/* how long, in seconds, answers and failures are cached */
+#define RESOLVER_TTL 300
+#define RESOLVER_NEGATIVE_TTL 60
+
+#endif // __RESOLVER_H
@@ -12,7 +12,7 @@
 /* students shouldn't take advantage of the gnu extensions, 
  * but parsing html without them is a pain.
  */
-#define _GNU_SOURCE       // strncasecmp, strdup
+#define _GNU_SOURCE       // strncasecmp, strdup, asprintf
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -20,9 +20,16 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
-#include <netdb.h>
-#include "file.h"
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
 #include "webpage.h"
+#include "http.h"
+#include "resolver.h"
+#include "linkscan.h"
 #include "mem.h"
 
 /* ***************************************** */
@@ -36,6 +43,14 @@ struct URL {
   char* fragment;             // #top
 };
 
+/* idleConn_t: an open connection, parked between requests to its server */
+typedef struct idleConn {
+  int sock;                   // connected socket
+  char* server;               // "hostname:port" it is connected to
+  double since;               // when it was parked
+  struct idleConn* next;
+} idleConn_t;
+
 /* webpage_t: structure to represent a web page, and its contents.
  * The innards should not be visible to users of the webpage module.
  */
@@ -44,16 +59,31 @@ typedef struct webpage {
   char* html;                              // html code of the page
   size_t html_len;                         // length of html code
   int depth;                               // depth of crawl
+  char* etag;                              // ETag validator, or NULL
+  char* lastModified;                      // Last-Modified validator, or NULL
+  bool unchanged;                          // last fetch answered 304
+  int status;                              // HTTP status of the last fetch (0: none)
+  double fetchTime;                        // seconds the last fetch took
 } webpage_t;
 
 /* *********************************************************************** */
 /* Private function prototypes */
 
-static FILE* connectToHost(const char* hostname, const int port);
-static inline bool isBlankLine(const char* line);
+static int connectToHost(const char* hostname, const int port);
+static http_response_t* exchange(const int sock, const char* request,
+                                 bool* received, bool* reusable);
+static int poolTake(const char* server, bool* reused);
+static void poolPut(const char* server, const int sock);
+static double now(void);
+static void takeValidators(webpage_t* page, const http_response_t* resp);
+static bool takeResponse(webpage_t* page, http_response_t* resp);
 static char* removeDotSegments(char* input);
 static void removeWhitespace(char* str);
 static char* fixRelativeURL(char* base, char* rel, size_t len);
+static char* basePrefix(const char* base, size_t* rootLen);
+static const char* skipWhitespace(const char* str);
+static bool startsHTTP(const char* str);
+static bool knownExtension(const char* path, const size_t pathLen);
 static bool parseURL(const char* str, struct URL* url);
 static void freeURL(struct URL url);
 static bool burstURL(const char* url, char** hostname, 
@@ -67,6 +97,20 @@ static void printURL(struct URL url);
 
 static const int MAX_TRY = 3;    // maximum attempts to fetch
 static const int HTTP_PORT = 80; // default web server port
+static const int IO_TIMEOUT = 30;         // seconds a send or recv may block
+static const size_t READ_BLOCK = 16384;   // bytes per recv
+static const int MAX_IDLE = 64;           // parked connections, all servers
+static const double IDLE_TIMEOUT = 10.0;  // seconds a connection stays parked
+
+/* connections kept open for reuse by later fetches (see poolTake) */
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static idleConn_t* pool = NULL;           // most recently parked first
+static int poolSize = 0;
+
+/* urls beginning with this are internal (see webpage_setInternalPrefix) */
+static const char* internalPrefix = INTERNAL_PREFIX;
+static archive_t* archive = NULL;        // see webpage_setArchive
+static bool replaying = false;           // answer fetches from 'archive'
 
 static const char* EXTS[] = {  // valid extensions
   "html",
@@ -107,6 +151,11 @@ webpage_new(char* url, const int depth, char* html)
   page->depth = depth;
   page->html = html;
   page->html_len = html ? strlen(html) : 0;
+  page->etag = NULL;
+  page->lastModified = NULL;
+  page->unchanged = false;
+  page->status = 0;
+  page->fetchTime = 0;
 
   return page;
 }
@@ -120,6 +169,8 @@ webpage_delete(void* data)
   if (page != NULL) {
     if (page->url) free(page->url);
     if (page->html) free(page->html);
+    free(page->etag);
+    free(page->lastModified);
     free(page);
   }
 }
@@ -135,11 +186,14 @@ webpage_delete(void* data)
  * 
  * Pseudocode:
  *     1. check for valid page 
- *     2. parse url into hostname, port, and filename
- *     3. open a connection to the given host
- *     4. send http request
- *     5. fetch html response
- *     6. cleanup
+ *     2. if replaying an archive, take the response from it, skip to 9
+ *     3. parse url into hostname, port, and filename
+ *     4. take a parked connection to the host, or open a new one
+ *     5. send http request
+ *     6. fetch http response, framed by the http module
+ *     7. park the connection if the server lets us keep it; else close it
+ *     8. cleanup; if recording an archive, add the response to it
+ *     9. take the html, or note a 304, from the response
  */
 bool 
 webpage_fetch(webpage_t* page)
@@ -148,6 +202,17 @@ webpage_fetch(webpage_t* page)
   if (page == NULL || page->url == NULL || page->html != NULL) {
     return false;
   }
+  double start = now();
+  page->status = 0;
+  page->fetchTime = 0;
+
+  // when replaying, the archive answers; there is no network at all
+  if (archive != NULL && replaying) {
+    page->unchanged = false;
+    bool replayed = takeResponse(page, archive_replay(archive, page->url));
+    page->fetchTime = now() - start;
+    return replayed;
+  }
 
   // burst the URL into its components;
   // all we care about are hostname, port, and pathname
@@ -158,70 +223,174 @@ webpage_fetch(webpage_t* page)
     return false;
   }
 
-  // attempt to connect to server 
-  FILE* http_fp = NULL; 
-  for (int try = 0;  http_fp == NULL && try < MAX_TRY; try++) {
-    // open connection - exit on error
-    http_fp = connectToHost(hostname, port);
-
-#ifndef NOSLEEP // CS50 students: please don't turn off the sleep!
-    sleep(1);   // sleep one second between fetches, to lighten load on server
-#endif
+  // prepare the HTTP request (conditional, if the page has validators),
+  // and the key for the connection pool
+  char* request = http_request(hostname, pathname, true,
+                               page->etag, page->lastModified);
+  char* server = NULL;
+  page->unchanged = false;
+  if (asprintf(&server, "%s:%d", hostname, port) < 0) {
+    server = NULL;
   }
 
-  // failed to connect?
-  if (http_fp == NULL) {
-    return false;
-  }
+  // send the request and receive the response
+  // (spacing fetches out, to lighten load on the server, is up to the
+  // caller: the crawler's scheduler enforces a delay per host)
+  http_response_t* resp = NULL;
+  for (int try = 0; request && server && resp == NULL && try < MAX_TRY; try++) {
+    bool reused = false;
+    int sock = poolTake(server, &reused);
+    if (sock < 0) {
+      sock = connectToHost(hostname, port);
+    }
+    if (sock < 0) {
+      continue;
+    }
 
-  // prepare and send HTTP request; receive response
-  char* httpResponse = NULL;
-  const char* httpFormat =
-    "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n";
-  if (fprintf(http_fp, httpFormat, pathname, hostname) >= 0) {
-    // ensure stdio buffer is flushed to socket
-    fflush(http_fp);
-    // read the server's response
-    httpResponse = file_readLine(http_fp);
+    bool received = false, reusable = false;
+    resp = exchange(sock, request, &received, &reusable);
+    if (resp == NULL) {
+      close(sock);
+      if (reused && !received) {
+        // the server had quietly closed the parked connection;
+        // that is no fault of this fetch, so it does not count as a try
+        try--;
+      }
+    } else if (reusable && http_response_keepAlive(resp)) {
+      poolPut(server, sock);
+    } else {
+      close(sock);
+    }
   }
 
   free(hostname);
   free(pathname);
+  free(request);
+  free(server);
 
-  // did we succeed? check the response
-  bool success = false;
+  // record the response as it came, before its body is taken
+  if (resp != NULL && archive != NULL) {
+    archive_put(archive, page->url, resp);
+  }
 
-  if (httpResponse != NULL) {
-    // check response code to see whether we succeeded
-    int httpResponseCode = 0;
-    if (sscanf(httpResponse, "HTTP/1.1 %d", &httpResponseCode) == 1
-        && httpResponseCode == 200) {
-      // success! ignore the rest of the header, then grab the page
-      // read lines until we read a blank line or fail to read a line
-      char* line = file_readLine(http_fp);
-      while (line != NULL && !isBlankLine(line)) {
-        free(line);
-        line = file_readLine(http_fp);
-      }
-      // did we exit the loop because we read an empty line?
-      if (line != NULL) {
-        free(line); // the blank line
-
-        // then grab everything else - that should be the page content
-        char* html = file_readFile(http_fp);
-        if (html != NULL) {
-          page->html = html;
-          success = true;
-        } 
-      }
-    }
-    free(httpResponse);
+  page->fetchTime = now() - start;
+  return takeResponse(page, resp);
+}
+
+/**************** webpage_setArchive ****************/
+/* see webpage.h for documentation */
+void
+webpage_setArchive(archive_t* newArchive, const bool replay)
+{
+  archive = newArchive;
+  replaying = newArchive != NULL && replay;
+}
+
+/**************** webpage_getArchive ****************/
+/* see webpage.h for documentation */
+archive_t*
+webpage_getArchive(bool* replay)
+{
+  if (replay != NULL) {
+    *replay = replaying;
+  }
+  return archive;
+}
+
+/**************** webpage_setValidators ****************/
+/* see webpage.h for documentation */
+bool
+webpage_setValidators(webpage_t* page, const char* etag, const char* lastModified)
+{
+  if (page == NULL) {
+    return false;
+  }
+  char* etagCopy = etag ? strdup(etag) : NULL;
+  char* lastModifiedCopy = lastModified ? strdup(lastModified) : NULL;
+  if ((etag != NULL && etagCopy == NULL)
+      || (lastModified != NULL && lastModifiedCopy == NULL)) {
+    free(etagCopy);
+    free(lastModifiedCopy);
+    return false;
   }
+  free(page->etag);
+  free(page->lastModified);
+  page->etag = etagCopy;
+  page->lastModified = lastModifiedCopy;
+  return true;
+}
 
-  // clean up
-  fclose(http_fp);
+/* getters for the validators - see webpage.h for documentation */
+const char* webpage_getETag(const webpage_t* page) {
+  return page ? page->etag : NULL;
+}
+const char* webpage_getLastModified(const webpage_t* page) {
+  return page ? page->lastModified : NULL;
+}
 
-  return success;
+/**************** webpage_isUnchanged ****************/
+/* see webpage.h for documentation */
+bool
+webpage_isUnchanged(const webpage_t* page)
+{
+  return page ? page->unchanged : false;
+}
+
+/**************** webpage_setUnchanged ****************/
+/* see webpage.h for documentation */
+void
+webpage_setUnchanged(webpage_t* page, const bool unchanged)
+{
+  if (page != NULL) {
+    page->unchanged = unchanged;
+  }
+}
+
+/**************** webpage_getStatus ****************/
+/* see webpage.h for documentation */
+int
+webpage_getStatus(const webpage_t* page)
+{
+  return page ? page->status : 0;
+}
+
+/**************** webpage_getFetchTime ****************/
+/* see webpage.h for documentation */
+double
+webpage_getFetchTime(const webpage_t* page)
+{
+  return page ? page->fetchTime : 0;
+}
+
+/**************** webpage_setFetchResult ****************/
+/* see webpage.h for documentation */
+void
+webpage_setFetchResult(webpage_t* page, const int status, const double seconds)
+{
+  if (page != NULL) {
+    page->status = status;
+    page->fetchTime = seconds;
+  }
+}
+
+/**************** webpage_closeConnections ****************/
+/* see webpage.h for documentation */
+void
+webpage_closeConnections(void)
+{
+  pthread_mutex_lock(&poolLock);
+  idleConn_t* conn = pool;
+  pool = NULL;
+  poolSize = 0;
+  pthread_mutex_unlock(&poolLock);
+
+  while (conn != NULL) {
+    idleConn_t* next = conn->next;
+    close(conn->sock);
+    free(conn->server);
+    free(conn);
+    conn = next;
+  }
 }
 
 /**************** webpage_getNextWord ****************/
@@ -437,6 +606,141 @@ webpage_getNextURL(webpage_t* page, int* pos)
   }
 }
 
+/**************** webpage_scanURLs ****************/
+/* See "webpage.h" for full documentation.
+ *
+ * Follows webpage_getNextURL step for step, on the html as it would be
+ * once squeezed: the patterns are found by linkscan, which allows the
+ * whitespace between their characters; the other tests look at the next
+ * character that is not whitespace; and each url is copied without its
+ * whitespace.  Where webpage_getNextURL moves on from a bad link it
+ * meets the same "<a" again until it is past it, so here we go on from
+ * the character after it.
+ *
+ * The base url is parsed once, not once per relative link, and the
+ * "href=" and '#' found for one link are kept for the next, since the
+ * search for each would otherwise run on to the end of the page when the
+ * page has few of them.
+ */
+int
+webpage_scanURLs(webpage_t* page, void* arg,
+                 void (*itemfunc)(void* arg, const char* url))
+{
+  if (page == NULL || page->html == NULL || page->url == NULL || itemfunc == NULL) {
+    return 0;
+  }
+
+  const char* html = page->html;           // the html document
+  const char* stop = html + strlen(html);  // its terminating NUL
+  size_t rootLen = 0;                      // prefix for "/path" relative urls
+  char* prefix = NULL;                     // prefix for other relative urls
+  bool based = false;                      // have we tried to make prefix?
+  char* url = NULL;                        // the url passed to itemfunc
+  size_t size = 0;                         // bytes allocated for url
+  int count = 0;                           // urls passed to itemfunc
+  const char* href = NULL;                 // the last "href=" found
+  const char* value = NULL;                // just after its '='
+  const char* hash = NULL;                 // the last '#' found
+  const char* hashFrom = NULL;             // where the search for it began
+  const char* pos = html;                  // where to look for the next "<a"
+  const char* lnk;                         // hyperlink tag
+
+  while ((lnk = linkscan_anchor(pos, stop)) != NULL) {
+    // find next href after hyperlink tag; one found for an earlier tag
+    // is the next after this one too, if it is not before it
+    if (href == NULL || href < lnk) {
+      href = linkscan_href(lnk, stop, &value);
+    }
+    // no more links on this page
+    if (href == NULL) {
+      break;
+    }
+
+    // if the href we have is outside the current tag, continue
+    const char* end = memchr(lnk, '>', stop - lnk);
+    if (end != NULL && end < href) {
+      pos = lnk + 1;
+      continue;
+    }
+
+    // is the url quoted?
+    const char* start = value;             // beginning of url
+    const char* first = skipWhitespace(start);
+    if (*first == '\'' || *first == '"') { // yes, href="url" or href='url'
+      start = first + 1;
+      end = memchr(start, *first, stop - start);
+    } else {                               // no, href=url
+      end = memchr(start, '>', stop - start);
+    }
+
+    // if there is a # before the end of the url, exclude the #fragment
+    if (hashFrom == NULL || (hash != NULL && hash < start)) {
+      hashFrom = start;
+      hash = memchr(start, '#', stop - start);
+    }
+    if (hash != NULL && end != NULL && hash < end) {
+      end = hash;
+    }
+
+    // if we don't know where to end the url, or it is an internal
+    // reference, continue
+    first = skipWhitespace(start);
+    if (end == NULL || *first == '#') {
+      pos = lnk + 1;
+      continue;
+    }
+
+    // is the url absolute, i.e, ':' must precede any '/', '?', or '#'
+    const char* ptr = strpbrk(start, ":/?#");
+    bool relative = (ptr == NULL || *ptr != ':');
+    if (!relative && !startsHTTP(first)) { // absolute, but not http(s)
+      pos = lnk + 1;
+      continue;
+    }
+    pos = end;
+
+    // have a good link now; a relative one goes after the base url,
+    // or after its host if it begins with '/'
+    const char* lead = "";
+    size_t leadLen = 0;
+    if (relative) {
+      if (!based) {
+        prefix = basePrefix(page->url, &rootLen);
+        based = true;
+      }
+      if (prefix == NULL) {
+        break;                             // webpage_getNextURL stops here too
+      }
+      lead = prefix;
+      leadLen = (*first == '/') ? rootLen : strlen(prefix);
+    }
+    size_t need = leadLen + (end - start) + 1;
+    if (need > size) {
+      char* grown = realloc(url, need);
+      if (grown == NULL) {
+        break;
+      }
+      url = grown;
+      size = need;
+    }
+    memcpy(url, lead, leadLen);
+    char* dst = url + leadLen;
+    for (const char* src = start; src < end; src++) {
+      if (!isspace((unsigned char)*src)) {
+        *dst++ = *src;
+      }
+    }
+    *dst = '\0';
+
+    itemfunc(arg, url);
+    count++;
+  }
+
+  free(url);
+  free(prefix);
+  return count;
+}
+
 /******************** normalizeURL *******************************/
 /* Normalize the url according to RFC 3986 chapter 3.
  * see webpage.h for documentation.
@@ -549,6 +853,76 @@ normalizeURL(const char* url)
   return result;
 }
 
+/***********************************************************************
+ * normalizeURLInto - see webpage.h for interface description.
+ *
+ * The fast path takes urls of the form http[s]://host/path[?query][#frag]
+ * with no '@' anywhere and no "." or ".." path segment.  For those,
+ * parseURL and removeDotSegments change nothing but the case of the
+ * scheme and host, so normalizeURL's result is the url with those
+ * lowercased -- provided the extension check passes.
+ */
+url_class_t
+normalizeURLInto(const char* url, char* buf, const size_t size)
+{
+  if (url == NULL || buf == NULL || size == 0) {
+    return URL_INVALID;
+  }
+
+  // scheme: "http://" or "https://", in any case
+  size_t schemeLen = 0;
+  if (strncasecmp(url, "http://", 7) == 0) {
+    schemeLen = 7;
+  } else if (strncasecmp(url, "https://", 8) == 0) {
+    schemeLen = 8;
+  }
+  // host: up to the first '/', which must come before any '?' or '#'
+  const char* host = url + schemeLen;
+  const char* hostEnd = host + strcspn(host, "/?#@");
+  bool fast = schemeLen > 0 && hostEnd > host && *hostEnd == '/';
+
+  // path: up to the first '?' or '#'; no "." or ".." segments, no '@'
+  const char* path = hostEnd;
+  size_t pathLen = fast ? strcspn(path, "?#") : 0;
+  for (size_t i = 0; fast && i < pathLen; i++) {
+    if (path[i] == '@') {
+      fast = false;
+    } else if (path[i] == '/' && path[i + 1] == '.') {
+      size_t dots = (i + 2 < pathLen && path[i + 2] == '.') ? 2 : 1;
+      char after = (i + 1 + dots < pathLen) ? path[i + 1 + dots] : '\0';
+      fast = !(after == '/' || after == '\0');
+    }
+  }
+  const char* rest = path + pathLen;     // query and fragment
+  if (fast && strchr(rest, '@') != NULL) {
+    fast = false;                        // parseURL would see user info
+  }
+
+  if (!fast) {
+    // the long way
+    char* normal = normalizeURL(url);
+    url_class_t class = URL_INVALID;
+    if (normal != NULL && strlen(normal) < size) {
+      strcpy(buf, normal);
+      class = isInternalURL(buf) ? URL_INTERNAL : URL_EXTERNAL;
+    }
+    free(normal);
+    return class;
+  }
+
+  size_t len = strlen(url);
+  if (len >= size || !knownExtension(path, pathLen)) {
+    return URL_INVALID;
+  }
+  // lowercase scheme and host, copy the rest
+  size_t i = 0;
+  for (; url + i < hostEnd; i++) {
+    buf[i] = tolower((unsigned char) url[i]);
+  }
+  memcpy(buf + i, hostEnd, len - i + 1);
+  return isInternalURL(buf) ? URL_INTERNAL : URL_EXTERNAL;
+}
+
 /***********************************************************************
  * isInternalURL - see webpage.h for interface description.
  */
@@ -558,10 +932,19 @@ isInternalURL(const char* url)
   if (url == NULL) {
     return false;
   } else {
-    return (strncmp(url, INTERNAL_PREFIX, strlen(INTERNAL_PREFIX)) == 0);
+    return (strncmp(url, internalPrefix, strlen(internalPrefix)) == 0);
   }
 }
 
+/***********************************************************************
+ * webpage_setInternalPrefix - see webpage.h for interface description.
+ */
+void
+webpage_setInternalPrefix(const char* prefix)
+{
+  internalPrefix = (prefix != NULL) ? prefix : INTERNAL_PREFIX;
+}
+
 
 /***********************************************************************
  * INTERNAL FUNCTIONS
@@ -844,42 +1227,247 @@ burstURL(const char* url, char** hostname, int* port, char** pathname)
 
 /* ********************* connectToHost ************************** */
 /* Connect to the given hostname and port, 
- * returning an open FILE* for the socket,
- * or NULL on failure.
+ * returning the connected socket, or -1 on failure.
+ *
+ * Looks the hostname up through the resolver module, which is safe to
+ * call from several threads at once and answers repeat lookups from its
+ * cache.  Sends and receives
+ * on the socket give up after IO_TIMEOUT seconds, so a stalled server
+ * cannot hold a fetch forever.
  */
-static FILE* 
+static int 
 connectToHost(const char* hostname, const int port)
 {
-  // Look up the hostname specified on command line
-  struct hostent *hostp = gethostbyname(hostname);
-  if (hostp == NULL) {
-    return NULL;
-  }
-
-  // Initialize fields of the server address
+  // Look up the hostname; the resolver caches the answer for later fetches
   struct sockaddr_in server;  // address of the server
-  server.sin_family = AF_INET;
-  bcopy(hostp->h_addr_list[0], &server.sin_addr, hostp->h_length);
-  server.sin_port = htons(port);
+  if (!resolver_lookup(hostname, port, &server)) {
+    return -1;
+  }
 
   // Create socket (a file descriptor)
   int comm_sock = socket(AF_INET, SOCK_STREAM, 0);
   if (comm_sock < 0) {
-    return NULL;
+    return -1;
   }
+  struct timeval timeout = { .tv_sec = IO_TIMEOUT, .tv_usec = 0 };
+  setsockopt(comm_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(comm_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
 
   // And connect that socket to that server   
   if (connect(comm_sock, (struct sockaddr *) &server, sizeof(server)) < 0) {
+    close(comm_sock);
+    return -1;
+  }
+
+  return comm_sock;
+}
+
+/* ********************* exchange ************************** */
+/* Send the request on the socket and read one whole response.
+ *
+ * The http module decides where the response ends -- by Content-Length,
+ * by chunked coding, or by the server closing -- so the next response
+ * on a kept-alive connection starts cleanly at the next byte.
+ * Returns the completed response, or NULL if anything went wrong;
+ * *received tells whether any response bytes arrived at all, and
+ * *reusable whether the connection may carry another request.
+ */
+static http_response_t*
+exchange(const int sock, const char* request, bool* received, bool* reusable)
+{
+  *received = false;
+  *reusable = false;
+
+  // send the whole request; MSG_NOSIGNAL, as the server may have gone
+  size_t len = strlen(request);
+  for (size_t sent = 0; sent < len; ) {
+    ssize_t n = send(sock, request + sent, len - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return NULL;
+    }
+    sent += n;
+  }
+
+  http_response_t* resp = http_response_new();
+  char* buf = malloc(READ_BLOCK);
+  if (resp == NULL || buf == NULL) {
+    http_response_delete(resp);
+    free(buf);
     return NULL;
   }
 
-  // to make it easier to work with, switch to stdio
-  FILE* http_fp = fdopen(comm_sock, "r+");
-  if (http_fp == NULL) {
+  http_state_t state = HTTP_MORE;
+  while (state == HTTP_MORE) {
+    ssize_t n = recv(sock, buf, READ_BLOCK, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      state = HTTP_ERROR;                 // includes timeouts
+    } else if (n == 0) {
+      state = http_response_eof(resp);
+      *reusable = false;                  // the server has closed
+    } else {
+      *received = true;
+      size_t used = 0;
+      state = http_response_feed(resp, buf, n, &used);
+      // bytes beyond the response: the response is whole, but the
+      // connection cannot be trusted with another request
+      *reusable = used == (size_t) n;
+    }
+  }
+  free(buf);
+
+  if (state != HTTP_DONE) {
+    http_response_delete(resp);
     return NULL;
   }
+  return resp;
+}
+
+/* ********************* poolTake ************************** */
+/* Take a parked connection to server ("hostname:port") out of the pool.
+ * Connections parked too long, or that the server has since closed
+ * (or, wrongly, sent more bytes on), are closed along the way.
+ * Returns the socket, with *reused true; or -1 if there is none.
+ */
+static int
+poolTake(const char* server, bool* reused)
+{
+  *reused = false;
+  double t = now();
+
+  pthread_mutex_lock(&poolLock);
+  int sock = -1;
+  idleConn_t** prevp = &pool;
+  while (sock < 0 && *prevp != NULL) {
+    idleConn_t* conn = *prevp;
+    bool expired = t - conn->since > IDLE_TIMEOUT;
+    if (!expired && strcmp(conn->server, server) != 0) {
+      prevp = &conn->next;
+      continue;
+    }
+
+    // unlink it: either we use it, or it is no good to anyone
+    *prevp = conn->next;
+    poolSize--;
+    if (!expired) {
+      // a live idle connection has nothing to read, so recv must fail
+      char c;
+      ssize_t n = recv(conn->sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        sock = conn->sock;
+      }
+    }
+    if (sock < 0) {
+      close(conn->sock);
+    }
+    free(conn->server);
+    free(conn);
+  }
+  pthread_mutex_unlock(&poolLock);
+
+  *reused = sock >= 0;
+  return sock;
+}
+
+/* ********************* poolPut ************************** */
+/* Park a connection to server for a later fetch; if the pool is full,
+ * its least recently parked connection is closed to make room.
+ */
+static void
+poolPut(const char* server, const int sock)
+{
+  idleConn_t* conn = malloc(sizeof(idleConn_t));
+  char* name = strdup(server);
+  if (conn == NULL || name == NULL) {
+    free(conn);
+    free(name);
+    close(sock);
+    return;
+  }
+  conn->sock = sock;
+  conn->server = name;
+  conn->since = now();
+
+  idleConn_t* oldest = NULL;
+  pthread_mutex_lock(&poolLock);
+  conn->next = pool;
+  pool = conn;
+  if (++poolSize > MAX_IDLE) {
+    idleConn_t** prevp = &pool;
+    while ((*prevp)->next != NULL) {
+      prevp = &(*prevp)->next;
+    }
+    oldest = *prevp;
+    *prevp = NULL;
+    poolSize--;
+  }
+  pthread_mutex_unlock(&poolLock);
+
+  if (oldest != NULL) {
+    close(oldest->sock);
+    free(oldest->server);
+    free(oldest);
+  }
+}
 
-  return http_fp;
+/* ********************* takeValidators ************************** */
+/* Replace the page's validators with those the server sent; a 304
+ * that repeats none of them leaves the old ones in place.
+ */
+static void
+takeValidators(webpage_t* page, const http_response_t* resp)
+{
+  const char* etag = http_response_header(resp, "ETag");
+  const char* lastModified = http_response_header(resp, "Last-Modified");
+  if (http_response_status(resp) == 304 && etag == NULL && lastModified == NULL) {
+    return;
+  }
+  webpage_setValidators(page, etag, lastModified);
+}
+
+/* ********************* takeResponse ************************** */
+/* Take the outcome of a fetch from its response (or NULL if none
+ * came): a 200 gives the page its html, a 304 marks it unchanged.
+ * The response is deleted.  Returns true only for a 200 with its body.
+ */
+static bool
+takeResponse(webpage_t* page, http_response_t* resp)
+{
+  bool success = false;
+  if (resp != NULL) {
+    page->status = http_response_status(resp);
+    if (http_response_status(resp) == 200) {
+      size_t len = 0;
+      char* html = http_response_takeBody(resp, &len);
+      if (html != NULL) {
+        page->html = html;
+        page->html_len = len;
+        takeValidators(page, resp);
+        success = true;
+      }
+    } else if (http_response_status(resp) == 304
+               && (page->etag != NULL || page->lastModified != NULL)) {
+      page->unchanged = true;
+      takeValidators(page, resp);
+    }
+    http_response_delete(resp);
+  }
+  return success;
+}
+
+/* ********************* now ************************** */
+/* Return the time, in seconds, on the monotonic clock. */
+static double
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 
@@ -1026,6 +1614,40 @@ removeDotSegments(char* input)
   return out;
 }
 
+/* ***************************************************************** */
+/*
+ * knownExtension - apply normalizeURL's file-extension check to a path
+ * @path: the path, not necessarily terminated after pathLen
+ *
+ * Returns false if the last segment has an extension not in EXTS.
+ */
+static bool
+knownExtension(const char* path, const size_t pathLen)
+{
+  const char* dot = NULL;                  // last '.' in the path
+  const char* slash = NULL;                // last '/' in the path
+  for (const char* p = path; p < path + pathLen; p++) {
+    if (*p == '.') {
+      dot = p;
+    } else if (*p == '/') {
+      slash = p;
+    }
+  }
+  if (dot == NULL || slash == NULL || dot < slash || dot + 1 == path + pathLen) {
+    return true;                           // no extension
+  }
+  const char* ext = dot + 1;
+  size_t extLen = path + pathLen - ext;
+  for (int i = 0; EXTS[i] != NULL; i++) {
+    size_t n = strlen(EXTS[i]);
+    // as normalizeURL does, compare the first strlen(EXTS[i]) characters
+    if (extLen >= n && strncasecmp(ext, EXTS[i], n) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 /* ***************************************************************** */
 /*
  * fixRelativeURL - resolves a relative url to an absolute url
@@ -1115,6 +1737,92 @@ fixRelativeURL(char* base, char* rel, size_t len)
 }
 
 
+/* ***************************************************************** */
+/*
+ * basePrefix - what fixRelativeURL puts before a relative url
+ * @base: base url to resolve from
+ * @rootLen: where to store the length of the part that precedes a
+ *           url relative to the domain root
+ *
+ * Returns a newly allocated string holding the base url's scheme, user
+ * and host, then its path up to the right-most '/', then a '/': the
+ * part that precedes a url relative to the base.  Its first *rootLen
+ * characters, the scheme, user and host, precede a url that begins
+ * with '/'.  Returns NULL if the base url cannot be parsed.
+ */
+static char*
+basePrefix(const char* base, size_t* rootLen)
+{
+  char* prefix;                            // prefix to build
+  char* slash;                             // right-most '/' in a path
+  struct URL tmp;                          // parsed url
+
+  if (!parseURL(base, &tmp)) {
+    freeURL(tmp);
+    return NULL;
+  }
+
+  prefix = calloc(strlen(base) + 2, sizeof(char));
+  if (prefix != NULL) {
+    if (tmp.scheme) {                      // scheme
+      strcat(prefix, tmp.scheme);
+    }
+    if (tmp.user) {                        // user
+      strcat(prefix, tmp.user);
+    }
+    if (tmp.host) {                        // host
+      strcat(prefix, tmp.host);
+    }
+    *rootLen = strlen(prefix);
+    // add the base path up to the right-most '/'
+    if (tmp.path
+        && (slash = strrchr(tmp.path, '/'))
+        && (slash != tmp.path)) {
+      strncat(prefix, tmp.path, slash - tmp.path);
+    }
+    strcat(prefix, "/");                   // separate base and relative path
+  }
+
+  freeURL(tmp);
+  return prefix;
+}
+
+/* ***************************************************************** */
+/*
+ * skipWhitespace - the first character of str that is not whitespace
+ * @str: string to look at
+ *
+ * Returns str itself if it does not begin with whitespace, or its NUL
+ * if it is all whitespace.
+ */
+static const char*
+skipWhitespace(const char* str)
+{
+  while (isspace((unsigned char)*str)) {
+    str++;
+  }
+  return str;
+}
+
+/* ***************************************************************** */
+/*
+ * startsHTTP - whether str begins with "http", in any case, once its
+ * whitespace is removed
+ * @str: string to look at
+ */
+static bool
+startsHTTP(const char* str)
+{
+  for (const char* want = "http"; *want != '\0'; want++) {
+    str = skipWhitespace(str);
+    if (tolower((unsigned char)*str) != *want) {
+      return false;
+    }
+    str++;
+  }
+  return true;
+}
+
 /* ***************************************************************** */
 /*
  * removeWhitespace - removes whitespace from str
@@ -1140,17 +1848,3 @@ removeWhitespace(char* str)
   } while ((*prev++ = *cur++));            // condense to front of str
 }
 
-/* **************** isBlankLine ******************/
-/* Input: line, a non-NULL pointer to a string.
- * Return true if the string is pointing to a blank line, that is, 
- * an empty string, or
- * with only newline (LF), only carriage return (CR), or only CRLF.
- */
-static inline bool
-isBlankLine(const char* line)
-{
-  return (   (line[0] == '\0')
-             || (strcmp(line, "\n") == 0) 
-             || (strcmp(line, "\r") == 0) 
-             || (strcmp(line, "\r\n") == 0));
-}
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include "archive.h"
 
 /***********************************************************************/
 /* webpage_t: opaque struct to represent a web page, and its contents.
@@ -99,6 +100,16 @@ void webpage_delete(void* data);
  *  }
  *  webpage_delete(page);
  *
+ * Politeness:
+ *   webpage_fetch does not pause between fetches; callers that fetch many
+ *   pages must space out requests to the same server themselves.
+ *
+ * Connections:
+ *   webpage_fetch asks the server to keep the connection open, and parks
+ *   it afterwards so a later fetch from the same host:port (in any thread)
+ *   can skip the TCP handshake.  Parked connections are closed after a few
+ *   seconds unused; call webpage_closeConnections() to close them sooner.
+ *
  * Limitations:
  *   * can only handle http (not https or other schemes)
  *   * can only handle URLs of form http://host[:port][/pathname]
@@ -106,6 +117,90 @@ void webpage_delete(void* data);
  */
 bool webpage_fetch(webpage_t* page);
 
+/***************** webpage_setValidators ******************************/
+/* set the validators a fetch of the page sends, to make it conditional
+ *
+ * Caller provides
+ *   page, a valid webpage_t*; etag and lastModified, the ETag and
+ *   Last-Modified values from an earlier fetch of the same URL, either or
+ *   both NULL.  Both strings are copied.
+ *
+ * We return:
+ *   true on success; false on bad arguments or out of memory, leaving
+ *   the page's validators as they were.
+ *
+ * Conditional fetches:
+ *   webpage_fetch sends each validator the page has (If-None-Match,
+ *   If-Modified-Since).  If the server answers 304 Not Modified, the fetch
+ *   returns false with page->html still NULL, and webpage_isUnchanged
+ *   returns true.  After any successful fetch, or a 304, the validators
+ *   are those the server sent, ready for the next fetch of the URL.
+ */
+bool webpage_setValidators(webpage_t* page, const char* etag, const char* lastModified);
+
+/* getters for the validators; NULL if the page has none */
+const char* webpage_getETag(const webpage_t* page);
+const char* webpage_getLastModified(const webpage_t* page);
+
+/***************** webpage_isUnchanged ******************************/
+/* return true if the last conditional fetch of the page found it unchanged
+ * (HTTP 304); false otherwise.
+ */
+bool webpage_isUnchanged(const webpage_t* page);
+
+/***************** webpage_setUnchanged ******************************/
+/* record whether a conditional fetch found the page unchanged; for
+ * fetchers other than webpage_fetch, such as the fetchloop module.
+ */
+void webpage_setUnchanged(webpage_t* page, const bool unchanged);
+
+/***************** webpage_getStatus, webpage_getFetchTime ****************/
+/* how the last fetch of the page went: the HTTP status of its response,
+ * or 0 if no response came (nor was tried); and the seconds it took,
+ * retries included.  Both are 0 for a page never fetched.
+ */
+int webpage_getStatus(const webpage_t* page);
+double webpage_getFetchTime(const webpage_t* page);
+
+/***************** webpage_setFetchResult ******************************/
+/* record how a fetch went, as webpage_getStatus and webpage_getFetchTime
+ * report it; for fetchers other than webpage_fetch, such as the
+ * fetchloop module.
+ */
+void webpage_setFetchResult(webpage_t* page, const int status, const double seconds);
+
+/***************** webpage_closeConnections ******************************/
+/* Close every connection webpage_fetch has parked for reuse.
+ * Safe to call at any time; later fetches simply open new connections.
+ */
+void webpage_closeConnections(void);
+
+/***************** webpage_setArchive ******************************/
+/* record every fetch into an archive, or answer every fetch from one
+ *
+ * Caller provides
+ *   archive, from archive_create (to record) or archive_load (to replay),
+ *   or NULL to go back to fetching from the network without recording;
+ *   replay, true to answer fetches from the archive, false to record.
+ *
+ * Notes:
+ *   When recording, every complete response webpage_fetch receives is
+ *   added to the archive before it is used, whatever its status.
+ *   When replaying, webpage_fetch opens no connection and looks up no
+ *   host: it answers with the next response recorded for page->url,
+ *   exactly as if the server had sent it, and fails at once if none was.
+ *   The fetchloop module follows the same setting.
+ *   The archive is not copied; the caller closes it once fetching is over.
+ *   Call it before any other thread fetches.
+ */
+void webpage_setArchive(archive_t* archive, const bool replay);
+
+/***************** webpage_getArchive ******************************/
+/* return the archive given to webpage_setArchive, or NULL, with *replay
+ * set to whether fetches are answered from it.
+ */
+archive_t* webpage_getArchive(bool* replay);
+
 
 /**************** webpage_getNextWord ***********************************/
 /* return the next word from page->html[pos]
@@ -173,6 +268,37 @@ char* webpage_getNextWord(webpage_t* page, int* pos);
 
 char* webpage_getNextURL(webpage_t* page, int* pos);
 
+/****************** webpage_scanURLs ***********************************/
+/* find every url on the page in one call, leaving page->html unchanged
+ *
+ * Caller provides:
+ *   page: pointer to valid webpage_t with page->html not NULL;
+ *   arg: anything, passed on to itemfunc;
+ *   itemfunc: called once for each url.
+ *
+ * We return:
+ *   the number of urls passed to itemfunc.
+ *
+ * Notes:
+ *   itemfunc gets the same urls, in the same order, as a loop of
+ *   webpage_getNextURL calls from *pos = 0 would return; whitespace
+ *   in the html is skipped over rather than squeezed out.
+ *   The url passed to itemfunc is ours, and is overwritten once
+ *   itemfunc returns; itemfunc must copy any url it means to keep.
+ *   Finding the links is done by the 'linkscan' module, which tests
+ *   16 or 32 bytes of html at a time where the CPU allows.
+ *
+ * Usage example: (print all urls in a page)
+ * static void printURL(void* arg, const char* url) {
+ *     printf("Found url: %s\n", url);
+ * }
+ * ...
+ * webpage_scanURLs(page, NULL, printURL);
+ */
+
+int webpage_scanURLs(webpage_t* page, void* arg,
+                     void (*itemfunc)(void* arg, const char* url));
+
 /***********************************************************************
  * normalizeURL - returns a normalized form of the url
  *
@@ -196,6 +322,38 @@ char* webpage_getNextURL(webpage_t* page, int* pos);
 char* normalizeURL(const char* url);
 
 
+/***********************************************************************
+ * normalizeURLInto - normalize a url into the caller's buffer, and
+ *                    classify it
+ *
+ * Caller provides:
+ *    url: string containing absolute url to normalize
+ *    buf, size: where to put the normalized url; size >= strlen(url)+1
+ *      is always enough, as normalizing never makes a url longer.
+ *
+ * Returns:
+ *   URL_INTERNAL or URL_EXTERNAL, with buf holding exactly the string
+ *   normalizeURL would return and the answer isInternalURL would give
+ *   for it; or
+ *   URL_INVALID in every case where normalizeURL would return NULL, or
+ *   if buf is too small.
+ *
+ * Notes:
+ *   Nothing is allocated for a typical url (http or https, no user info,
+ *   no "." or ".." segments): its scheme and host are lowercased and the
+ *   rest copied, in one pass.  Other urls go the long way, via
+ *   normalizeURL.  Scanning a page's links this way costs no memory per
+ *   link.
+ */
+typedef enum {
+  URL_INVALID,           // cannot be normalized
+  URL_EXTERNAL,          // normalized; not internal
+  URL_INTERNAL,          // normalized; internal
+} url_class_t;
+
+url_class_t normalizeURLInto(const char* url, char* buf, const size_t size);
+
+
 /***********************************************************************
  * isInternalURL - verify whether the given url is 'internal' to CS50
  *
@@ -206,10 +364,25 @@ char* normalizeURL(const char* url);
  *   true if the url is non-NULL and "internal",
  *   false otherwise.
  *
- * "internal" means that the normalized url begins with INTERNAL_PREFIX.
+ * "internal" means that the normalized url begins with INTERNAL_PREFIX,
+ * or with the prefix last given to webpage_setInternalPrefix.
  */
 bool isInternalURL(const char* url);
 
+/***********************************************************************
+ * webpage_setInternalPrefix - change which urls isInternalURL accepts
+ *
+ * Caller provides:
+ *   prefix: a normalized absolute url, such as "http://127.0.0.1:8080/tse/",
+ *   or NULL to go back to INTERNAL_PREFIX.
+ *
+ * Notes:
+ *   prefix is not copied; it must stay valid while urls are checked.
+ *   Call it before any other thread calls isInternalURL.
+ *   This lets the crawler run against a local test site.
+ */
+void webpage_setInternalPrefix(const char* prefix);
+
 // All normalized URLs beginning with this prefix are considered "internal"
 static const
 char INTERNAL_PREFIX[] = "http://cs50tse.cs.dartmouth.edu/tse/";
@@ -27,6 +27,7 @@
 #include "pagedir.h"
 #include "file.h"
 #include "word.h"
+#include "manifest.h"
 
 
 // Node structure for a linked list to sort integer pairs.
@@ -48,15 +49,15 @@ int fileno(FILE *stream);
 
 // internal function prototypes
 static int parseArgs(char *args[], char **pageDir, char **indexFile);
-static int query(index_t *index, char *pageDir, char **queryList);
-static void readParse(index_t *index, char *pageDir);
+static int query(index_t *index, char *pageDir, manifest_t *manifest, char **queryList);
+static void readParse(index_t *index, char *pageDir, manifest_t *manifest);
 static char *prompt();
 static int tokenize(char **list, char *line);
 static bool isOP(char *word);
 static bool validateQuery(char **query, int querySize);
 static void countersIntersect(void *arg, const int key, const int val1);
 static void countersUnion(void *arg, const int key, const int val1);
-static int sortPrint(counters_t *scores, char *pageDir);
+static int sortPrint(counters_t *scores, char *pageDir, manifest_t *manifest);
 static void sortIterate(void *arg, const int key, const int val);
 static void copyIter(void *arg, const int key, const int val);
 static void logMessage(const int argc, ...);
@@ -136,12 +137,13 @@ static int parseArgs(char *args[], char **pageDir, char **indexFile) {
  * 
  * @param index indexer to query
  * @param pageDir pointer to char pointer to store the page directory
+ * @param manifest the page directory's manifest, or NULL if it has none
  *  * @param queryList list of words in query
  * @return int return status code
  * - 0 for failure
  * - -1 for success
  */
-static int query(index_t *index, char *pageDir, char **queryList) {
+static int query(index_t *index, char *pageDir, manifest_t *manifest, char **queryList) {
     if (index == NULL || pageDir == NULL || queryList == NULL) {
         logMessage(1, "query: Invalid arguments\n");
         return -1;
@@ -247,7 +249,7 @@ static int query(index_t *index, char *pageDir, char **queryList) {
         counters_delete(next);
     }
 
-    sortPrint(queryResult, pageDir);    // sort and print result
+    sortPrint(queryResult, pageDir, manifest);    // sort and print result
 
     prep_return:    // return prep location that can be jumped to from anywhere in the fucntion
         if (queryList != NULL) {
@@ -267,8 +269,9 @@ static int query(index_t *index, char *pageDir, char **queryList) {
  * 
  * @param index indexer to query
  * @param pageDir pointer to char pointer to store the page directory
+ * @param manifest the page directory's manifest, or NULL if it has none
  */
-static void readParse(index_t *index, char *pageDir) {
+static void readParse(index_t *index, char *pageDir, manifest_t *manifest) {
     if (index == NULL || pageDir == NULL) {
         logMessage(1, "readParse: invalid arguments\n");
         return;
@@ -312,7 +315,7 @@ static void readParse(index_t *index, char *pageDir) {
             if (list[i] != NULL) printf("%s ", list[i]);
         }
         printf("\n");
-        query(index, pageDir, list);    // run words in list as query
+        query(index, pageDir, manifest, list);    // run words in list as query
         if (line != NULL) free(line);
         line = NULL;
     }
@@ -498,13 +501,15 @@ static void countersUnion(void *arg, const int key, const int val1) {
  * 
  * Iterates through a counters structure to sort its entries, then prints each entry's score
  * and associated document URL, retrieved based on the document ID stored in the counter.
- * Assumes the presence of a getPageUrl function that retrieves a document URL given its ID.
+ * The URL is looked up in the mapped manifest, with no file I/O; only a document the
+ * manifest lacks (or every one, without a manifest) is read from the page directory by getPageUrl.
  * 
  * @param scores Counters structure containing document scores.
  * @param pageDir String containing the path to the page directory.
+ * @param manifest The page directory's manifest, or NULL if it has none.
  * @return int Returns 0 on success, -1 on failure (invalid arguments or sorting/printing issues).
  */
-static int sortPrint(counters_t *scores, char *pageDir) {
+static int sortPrint(counters_t *scores, char *pageDir, manifest_t *manifest) {
     // Validate function arguments
     if (scores == NULL || pageDir == NULL) {
         logMessage(1, "sortPrint: Invalid arguments\n");
@@ -523,8 +528,11 @@ static int sortPrint(counters_t *scores, char *pageDir) {
 
     // If there are sorted items, print each item's score and associated document URL.
     for (lnode_t *node = args.argNode; node != NULL;) {
-        char *url = getPageUrl(pageDir, node->values[0]); // Retrieve URL for the document ID
-        if (url != NULL) {
+        char *url;
+        manifestEntry_t entry;
+        if (manifestGet(manifest, node->values[0], &entry)) {   // URL straight from the mapped manifest
+            printf("score\t%d doc %d: %s\n", node->values[1], node->values[0], entry.url);
+        } else if ((url = getPageUrl(pageDir, node->values[0])) != NULL) { // Retrieve URL for the document ID
             printf("score\t%d doc %d: %s\n", node->values[1], node->values[0], url);
             free(url); // Free the URL string allocated by getPageUrl
         } else {
@@ -648,6 +656,7 @@ int main(int argc, char const *argv[]) {
     char *pageDir = NULL;
     char *indexFile = NULL;
     index_t *index = NULL;
+    manifest_t *manifest = NULL;
 
     if (parseArgs((char **) argv, &pageDir, &indexFile) == -1) {    // parse arguments into varaibles and validate them
         logMessage(5, "%s", "main: invalid arguments (", "%s", argv[1], "%s" , ", ", "%s", argv[2], "%s", ")\n");
@@ -658,12 +667,14 @@ int main(int argc, char const *argv[]) {
     index = indexLoad((char *) indexFile);  // load an index using filename provided
     if (index == NULL) goto prep_exit;  // ensure index was created
 
-    readParse(index, pageDir);
+    manifest = manifestOpen(pageDir);   // map the docIDs' URLs once, if the crawler listed them
+    readParse(index, pageDir, manifest);
 
     prep_exit:  // exit prep that can be moved to from anypoint in the function to cover all bases
     if (pageDir != NULL) free(pageDir);
     if(indexFile != NULL) free(indexFile);
     if (index != NULL) indexDelete(index);
+    manifestClose(manifest);
     return exit_code;
 }
 